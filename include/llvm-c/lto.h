@@ -40,7 +40,7 @@ typedef bool lto_bool_t;
  * @{
  */
 
-#define LTO_API_VERSION 15
+#define LTO_API_VERSION 17
 
 /**
  * \since prior to LTO_API_VERSION=3
@@ -571,6 +571,72 @@ extern void
 lto_codegen_set_should_embed_uselists(lto_code_gen_t cg,
                                       lto_bool_t ShouldEmbedUselists);
 
+/**
+ * \brief Sets the number of parallel code generation jobs.
+ *
+ * Sets the number of partitions the optimized merged module is split into by
+ * \a lto_codegen_compile_optimized_parallel(). Each partition is code
+ * generated on its own thread. A value of 0 is treated as 1.
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern void
+lto_codegen_set_codegen_jobs(lto_code_gen_t cg, unsigned int jobs);
+
+/**
+ * Generates code for the optimized merged module into one native object file
+ * per code generation job (see \a lto_codegen_set_codegen_jobs()), compiling
+ * the partitions concurrently. It will not run any IR optimizations on the
+ * merged module. Linked together, the object files are equivalent to the
+ * single object file produced by \a lto_codegen_compile_optimized().
+ *
+ * On success returns the number of object files, which can be retrieved with
+ * \a lto_codegen_get_object(). On failure, returns 0 (check
+ * lto_get_error_message() for details).
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern unsigned int
+lto_codegen_compile_optimized_parallel(lto_code_gen_t cg);
+
+/**
+ * Returns a pointer to the object file at the given index generated by the
+ * last call to \a lto_codegen_compile_optimized_parallel(), and sets length to
+ * its size. The buffer is owned by the lto_code_gen_t and will be freed when
+ * lto_codegen_dispose() is called, or
+ * lto_codegen_compile_optimized_parallel() is called again.
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern const void*
+lto_codegen_get_object(lto_code_gen_t cg, unsigned int index, size_t* length);
+
+/**
+ * Sets the directory used to cache the generated object files between links.
+ * The objects are keyed by a hash of the merged module and of all the
+ * optimization and code generation options, so that linking unchanged inputs
+ * again reuses them. Concurrent links sharing the directory are supported.
+ * Passing NULL or an empty path disables the cache, which is the default.
+ *
+ * \since LTO_API_VERSION=17
+ */
+extern void
+lto_codegen_set_cache_dir(lto_code_gen_t cg, const char *cache_dir);
+
+/**
+ * Sets the pruning policy of the cache directory: the cache is scanned at
+ * most once every \p interval seconds (a negative value disables pruning),
+ * entries unused for \p expiration seconds are removed (0 means never), and
+ * the least recently used entries are removed while the cache is larger than
+ * \p max_size bytes (0 means no limit).
+ *
+ * \since LTO_API_VERSION=17
+ */
+extern void
+lto_codegen_set_cache_pruning_policy(lto_code_gen_t cg, int interval,
+                                     unsigned int expiration,
+                                     unsigned long long max_size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -181,6 +181,9 @@ public:
   /// empty - Returns true if there are no nodes in the folding set.
   bool empty() const { return NumNodes == 0; }
 
+  /// capacity - Returns the number of buckets in the folding set's hash table.
+  unsigned capacity() const { return NumBuckets; }
+
 private:
 
   /// GrowHashTable - Double the size of the hash table and rehash everything.
@@ -30,6 +30,7 @@
 #ifndef LLVM_ANALYSIS_LOOPINFO_H
 #define LLVM_ANALYSIS_LOOPINFO_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -478,6 +479,7 @@ public:
 
 private:
   friend class LoopInfoBase<BasicBlock, Loop>;
+  friend class LoopAnalysis;
   explicit Loop(BasicBlock *BB) : LoopBase<BasicBlock, Loop>(BB) {}
 };
 
@@ -714,6 +716,10 @@ template <> struct GraphTraits<Loop*> {
 class LoopAnalysis {
   static char PassID;
 
+  static bool readLoop(ArrayRef<uint32_t> &Data,
+                       ArrayRef<BasicBlock *> Blocks, LoopInfo &LI,
+                       Loop *Parent);
+
 public:
   typedef LoopInfo Result;
 
@@ -724,6 +730,15 @@ public:
   static StringRef name() { return "LoopAnalysis"; }
 
   LoopInfo run(Function &F, AnalysisManager<Function> *AM);
+
+  /// \brief Save \p LI to \p Data for an \c AnalysisResultCache, as the
+  /// positions of the blocks of each loop followed by its subloops.
+  void writeToCache(Function &F, const LoopInfo &LI,
+                    std::vector<uint32_t> &Data);
+
+  /// \brief Rebuild \p LI from \p Data saved by \c writeToCache, without
+  /// needing the dominator tree.
+  bool readFromCache(Function &F, ArrayRef<uint32_t> Data, LoopInfo &LI);
 };
 
 /// \brief Printer pass for the \c LoopAnalysis results.
@@ -754,6 +769,10 @@ public:
   /// \brief Calculate the natural loop information for a given function.
   bool runOnFunction(Function &F) override;
 
+  FunctionPass *createParallelCopy() const override {
+    return new LoopInfoWrapperPass();
+  }
+
   void verifyAnalysis() const override;
 
   void releaseMemory() override { LI.releaseMemory(); }
@@ -34,6 +34,10 @@ struct PostDominatorTree : public FunctionPass {
 
   bool runOnFunction(Function &F) override;
 
+  FunctionPass *createParallelCopy() const override {
+    return new PostDominatorTree();
+  }
+
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.setPreservesAll();
   }
@@ -79,6 +83,18 @@ struct PostDominatorTree : public FunctionPass {
     return DT->findNearestCommonDominator(A, B);
   }
 
+  typedef DominatorTreeBase<BasicBlock>::UpdateType UpdateType;
+
+  /// Update the tree after the edge From->To was added to the function.
+  void insertEdge(BasicBlock *From, BasicBlock *To) { DT->insertEdge(From, To); }
+
+  /// Update the tree after the edge From->To was removed from the function.
+  void deleteEdge(BasicBlock *From, BasicBlock *To) { DT->deleteEdge(From, To); }
+
+  /// Update the tree after the edges in Updates were inserted into or deleted
+  /// from the function.
+  void applyUpdates(ArrayRef<UpdateType> Updates) { DT->applyUpdates(Updates); }
+
   /// Get all nodes post-dominated by R, including R itself.
   void getDescendants(BasicBlock *R,
                       SmallVectorImpl<BasicBlock *> &Result) const {
@@ -50,6 +50,7 @@ namespace llvm {
   class SCEVUnknown;
   class SCEV;
   template<> struct FoldingSetTrait<SCEV>;
+  template <typename PtrType> class SmallPtrSetImpl;
 
   /// SCEV - This class represents an analyzed expression in the program.  These
   /// are opaque objects that the client is not allowed to do much with
@@ -58,9 +59,12 @@ namespace llvm {
   class SCEV : public FoldingSetNode {
     friend struct FoldingSetTrait<SCEV>;
 
-    /// FastID - A reference to an Interned FoldingSetNodeID for this node.
-    /// The ScalarEvolution's BumpPtrAllocator holds the data.
-    FoldingSetNodeIDRef FastID;
+    /// FastIDData, FastIDSize - A reference to an Interned FoldingSetNodeID
+    /// for this node. The ScalarEvolution's BumpPtrAllocator holds the data.
+    /// Keeping the size as 32 bits lets it share a word with the fields below,
+    /// which saves a word in every SCEV.
+    const unsigned *FastIDData;
+    unsigned FastIDSize;
 
     // The SCEV baseclass this node corresponds to
     const unsigned short SCEVType;
@@ -71,6 +75,10 @@ namespace llvm {
     unsigned short SubclassData;
 
   private:
+    FoldingSetNodeIDRef getFastID() const {
+      return FoldingSetNodeIDRef(FastIDData, FastIDSize);
+    }
+
     SCEV(const SCEV &) = delete;
     void operator=(const SCEV &) = delete;
 
@@ -100,7 +108,8 @@ namespace llvm {
                        NoWrapMask  = (1 << 3) -1 };
 
     explicit SCEV(const FoldingSetNodeIDRef ID, unsigned SCEVTy) :
-      FastID(ID), SCEVType(SCEVTy), SubclassData(0) {}
+      FastIDData(ID.getData()), FastIDSize(ID.getSize()), SCEVType(SCEVTy),
+      SubclassData(0) {}
 
     unsigned getSCEVType() const { return SCEVType; }
 
@@ -141,14 +150,14 @@ namespace llvm {
   // temporary FoldingSetNodeID values.
   template<> struct FoldingSetTrait<SCEV> : DefaultFoldingSetTrait<SCEV> {
     static void Profile(const SCEV &X, FoldingSetNodeID& ID) {
-      ID = X.FastID;
+      ID = X.getFastID();
     }
     static bool Equals(const SCEV &X, const FoldingSetNodeID &ID,
                        unsigned IDHash, FoldingSetNodeID &TempID) {
-      return ID == X.FastID;
+      return ID == X.getFastID();
     }
     static unsigned ComputeHash(const SCEV &X, FoldingSetNodeID &TempID) {
-      return X.FastID.ComputeHash();
+      return X.getFastID().ComputeHash();
     }
   };
 
@@ -350,19 +359,41 @@ namespace llvm {
       /// subexpression.
       bool hasOperand(const SCEV *S, ScalarEvolution *SE) const;
 
+      /// collectOperands - Add all of the subexpressions of the backedge taken
+      /// count expressions to Ops.
+      void collectOperands(SmallPtrSetImpl<const SCEV *> &Ops,
+                           ScalarEvolution *SE) const;
+
       /// clear - Invalidate this result and free associated memory.
       void clear();
     };
 
     /// BackedgeTakenCounts - Cache the backedge-taken count of the loops for
-    /// this function as they are computed.
+    /// this function as they are computed. The cache is flushed when it grows
+    /// beyond -scalar-evolution-max-cached-loops entries.
     DenseMap<const Loop*, BackedgeTakenInfo> BackedgeTakenCounts;
 
+    /// BackedgeTakenCountUsers - The loops whose entries in BackedgeTakenCounts
+    /// refer to each expression, so that forgetMemoizedResults doesn't have to
+    /// search every entry. This may be out of date: a loop listed here may have
+    /// since been forgotten and recomputed.
+    DenseMap<const SCEV *, SmallVector<const Loop *, 2>> BackedgeTakenCountUsers;
+
+    /// NumPendingBackedgeTakenCounts - The number of backedge-taken counts
+    /// being computed. Their placeholder entries in BackedgeTakenCounts must
+    /// stay, so the cache is only flushed when this is zero.
+    unsigned NumPendingBackedgeTakenCounts;
+
+    /// flushBackedgeTakenCounts - Drop all cached backedge-taken counts but
+    /// the one of loop Keep.
+    void flushBackedgeTakenCounts(const Loop *Keep);
+
     /// ConstantEvolutionLoopExitValue - This map contains entries for all of
     /// the PHI instructions that we attempt to compute constant evolutions for.
     /// This allows us to avoid potentially expensive recomputation of these
     /// properties.  An instruction maps to null if we are unable to compute its
-    /// exit value.
+    /// exit value. Like BackedgeTakenCounts, this is flushed when it grows too
+    /// big.
     DenseMap<PHINode*, Constant*> ConstantEvolutionLoopExitValue;
 
     /// ValuesAtScopes - This map contains entries for all the expressions
@@ -948,6 +979,10 @@ namespace llvm {
                              SmallVectorImpl<const SCEV *> &Sizes,
                              const SCEV *ElementSize) const;
 
+    /// getMemoryUsage - Return the number of bytes currently used by the
+    /// expressions and caches of this analysis.
+    size_t getMemoryUsage() const;
+
     bool runOnFunction(Function &F) override;
     void releaseMemory() override;
     void getAnalysisUsage(AnalysisUsage &AU) const override;
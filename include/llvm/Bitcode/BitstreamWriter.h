@@ -104,6 +104,30 @@ public:
   /// \brief Retrieve the current position in the stream, in bits.
   uint64_t GetCurrentBitNo() const { return GetBufferOffset() * 8 + CurBit; }
 
+  /// \brief Backpatch the 32-bit field that starts at bit \p BitNo of the
+  /// output, which need not be aligned, with the specified value. The field
+  /// must already have been flushed to the output.
+  void BackpatchField32(uint64_t BitNo, uint32_t NewWord) {
+    assert(BitNo + 32 <= GetBufferOffset() * 8 && "Field not flushed yet");
+    uint64_t ByteNo = BitNo / 8;
+    unsigned Shift = BitNo % 8;
+    uint64_t Mask = uint64_t(0xFFFFFFFF) << Shift;
+    uint64_t Value = uint64_t(NewWord) << Shift;
+    for (; Mask; Mask >>= 8, Value >>= 8, ++ByteNo) {
+      unsigned char ByteMask = Mask, ByteValue = Value;
+      Out[ByteNo] = (Out[ByteNo] & ~ByteMask) | (ByteValue & ByteMask);
+    }
+  }
+
+  /// \brief Append complete blocks written by another writer, at a position
+  /// of this one that is 32-bit aligned. The blocks must have been written
+  /// with the same abbrev id width and block info as this writer has here.
+  void EmitAlignedBlocks(StringRef Bytes) {
+    assert(CurBit == 0 && "Not 32-bit aligned");
+    assert((Bytes.size() & 3) == 0 && "Blocks not 32-bit aligned");
+    Out.append(Bytes.begin(), Bytes.end());
+  }
+
   //===--------------------------------------------------------------------===//
   // Basic Primitives for emitting bits to the stream.
   //===--------------------------------------------------------------------===//
@@ -42,7 +42,11 @@ namespace bitc {
 
     TYPE_BLOCK_ID_NEW,
 
-    USELIST_BLOCK_ID
+    USELIST_BLOCK_ID,
+
+    // Function summaries, either as a sub-block of a module or as the only
+    // top-level block of a combined function index file.
+    FUNCTION_SUMMARY_BLOCK_ID
   };
 
 
@@ -73,6 +77,24 @@ namespace bitc {
 
     MODULE_CODE_GCNAME      = 11,  // GCNAME: [strchr x N]
     MODULE_CODE_COMDAT      = 12,  // COMDAT: [selection_kind, name]
+
+    // VSTOFFSET: [offset]
+    // The 32-bit word offset of the module-level value symbol table, which
+    // follows the function blocks.
+    MODULE_CODE_VSTOFFSET   = 13,
+  };
+
+  /// FUNCTION_SUMMARY blocks describe the function definitions of a module
+  /// (or, in a combined index, of a set of modules) for cross-module
+  /// importing. Names are referred to by the index of their NAME record.
+  enum FunctionSummaryCodes {
+    FS_CODE_MODULE_PATH     = 1,  // MODULE_PATH: [modid, strchr x N]
+    FS_CODE_NAME            = 2,  // NAME: [strchr x N]
+    // PERMODULE_ENTRY: [nameid, linkage, instcount, flags, calleenameid x N]
+    FS_CODE_PERMODULE_ENTRY = 3,
+    // COMBINED_ENTRY: [modid, nameid, linkage, instcount, flags,
+    //                  calleenameid x N]
+    FS_CODE_COMBINED_ENTRY  = 4
   };
 
   /// PARAMATTR blocks have code for defining a parameter attribute set.
@@ -129,10 +151,11 @@ namespace bitc {
     TST_CODE_ENTRY = 1     // TST_ENTRY: [typeid, namechar x N]
   };
 
-  // The value symbol table only has one code (VST_ENTRY_CODE).
+  // Value symbol table codes.
   enum ValueSymtabCodes {
     VST_CODE_ENTRY   = 1,  // VST_ENTRY: [valid, namechar x N]
-    VST_CODE_BBENTRY = 2   // VST_BBENTRY: [bbid, namechar x N]
+    VST_CODE_BBENTRY = 2,  // VST_BBENTRY: [bbid, namechar x N]
+    VST_CODE_FNENTRY = 3   // VST_FNENTRY: [valid, offset, namechar x N]
   };
 
   enum MetadataCodes {
@@ -23,6 +23,7 @@
 namespace llvm {
   class BitstreamWriter;
   class DataStreamer;
+  class FunctionInfoIndex;
   class LLVMContext;
   class Module;
   class ModulePass;
@@ -53,9 +54,28 @@ namespace llvm {
                          DiagnosticHandlerFunction DiagnosticHandler = nullptr);
 
   /// Read the specified bitcode file, returning the module.
+  ///
+  /// If \c NumThreads is not 1, parse the function bodies on up to that many
+  /// threads, 0 meaning one per hardware thread. This needs the function
+  /// offsets of the module-level value symbol table, so older bitcode is
+  /// still read serially. The use-list order of values that several functions
+  /// use may differ from that of a serial read.
   ErrorOr<std::unique_ptr<Module>>
   parseBitcodeFile(MemoryBufferRef Buffer, LLVMContext &Context,
-                   DiagnosticHandlerFunction DiagnosticHandler = nullptr);
+                   DiagnosticHandlerFunction DiagnosticHandler = nullptr,
+                   unsigned NumThreads = 1);
+
+  /// Check if the given bitcode buffer contains a function summary block,
+  /// either a per-module one or a combined function index.
+  bool hasFunctionSummary(MemoryBufferRef Buffer,
+                          DiagnosticHandlerFunction DiagnosticHandler);
+
+  /// Parse the function summary block of the specified bitcode buffer into a
+  /// FunctionInfoIndex, without reading any IR. For a per-module summary the
+  /// buffer identifier is used as the module path of the summaries.
+  ErrorOr<std::unique_ptr<FunctionInfoIndex>>
+  getFunctionInfoIndex(MemoryBufferRef Buffer,
+                       DiagnosticHandlerFunction DiagnosticHandler);
 
   /// \brief Write the specified module to the specified raw output stream.
   ///
@@ -65,8 +85,22 @@ namespace llvm {
   /// If \c ShouldPreserveUseListOrder, encode the use-list order for each \a
   /// Value in \c M.  These will be reconstructed exactly when \a M is
   /// deserialized.
+  ///
+  /// If \c EmitFunctionSummary, emit a function summary block describing the
+  /// function definitions of \c M, for use by a ThinLTO link.
+  ///
+  /// If \c NumThreads is not 1, encode the function bodies on up to that many
+  /// threads, 0 meaning one per hardware thread. The output is the same as
+  /// with a single thread.
   void WriteBitcodeToFile(const Module *M, raw_ostream &Out,
-                          bool ShouldPreserveUseListOrder = false);
+                          bool ShouldPreserveUseListOrder = false,
+                          bool EmitFunctionSummary = false,
+                          unsigned NumThreads = 1);
+
+  /// Write the specified combined function index to the given raw output
+  /// stream as a standalone bitcode file.
+  void WriteFunctionSummaryToFile(const FunctionInfoIndex &Index,
+                                  raw_ostream &Out);
 
   /// isBitcodeWrapper - Return true if the given bytes are the magic bytes
   /// for an LLVM IR bitcode wrapper.
@@ -29,6 +29,26 @@ inline void DominatorTreeBase<MachineBasicBlock>::addRoot(MachineBasicBlock* MBB
   this->Roots.push_back(MBB);
 }
 
+/// Machine basic blocks are already numbered densely, so dominator tree
+/// construction can find its own numbers for them without hashing.
+template <> class DomTreeNodeNumbers<MachineBasicBlock> {
+  std::vector<unsigned> Numbers;
+
+public:
+  explicit DomTreeNodeNumbers(unsigned NumNodes) { Numbers.reserve(NumNodes); }
+
+  unsigned lookup(MachineBasicBlock *MBB) const {
+    unsigned Index = MBB->getNumber();
+    return Index < Numbers.size() ? Numbers[Index] : 0;
+  }
+  void set(MachineBasicBlock *MBB, unsigned Num) {
+    unsigned Index = MBB->getNumber();
+    if (Index >= Numbers.size())
+      Numbers.resize(Index + 1);
+    Numbers[Index] = Num;
+  }
+};
+
 EXTERN_TEMPLATE_INSTANTIATION(class DomTreeNodeBase<MachineBasicBlock>);
 EXTERN_TEMPLATE_INSTANTIATION(class DominatorTreeBase<MachineBasicBlock>);
 
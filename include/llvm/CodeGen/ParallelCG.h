@@ -0,0 +1,73 @@
+//===-- llvm/CodeGen/ParallelCG.h - Parallel code generation ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This header declares functions that can be used for parallel code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_PARALLELCG_H
+#define LLVM_CODEGEN_PARALLELCG_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Target/TargetMachine.h"
+#include <functional>
+
+namespace llvm {
+
+class Module;
+class TargetOptions;
+class raw_pwrite_stream;
+
+/// Split M into OSs.size() partitions, and generate code for each. Writes
+/// OSs.size() output files to the output streams in OSs. The resulting output
+/// files if linked together are intended to be equivalent to the single output
+/// file that would have been code generated from M.
+///
+/// Each partition is code generated on its own thread in a private
+/// LLVMContext. If OSs.size() == 1, M is code generated directly on the calling
+/// thread and is left unmodified; otherwise the local symbols of M are
+/// externalized as described in SplitModule().
+///
+/// If ReuseOutput is set, it is called on the calling thread with the index
+/// and the bitcode of each partition before it is code generated. When it
+/// returns true, the caller already has the output of that partition: it is
+/// not code generated and nothing is written to its stream.
+void splitCodeGen(Module &M, ArrayRef<raw_pwrite_stream *> OSs, StringRef CPU,
+                  StringRef Features, const TargetOptions &Options,
+                  Reloc::Model RM = Reloc::Default,
+                  CodeModel::Model CM = CodeModel::Default,
+                  CodeGenOpt::Level OL = CodeGenOpt::Default,
+                  TargetMachine::CodeGenFileType FT =
+                      TargetMachine::CGFT_ObjectFile,
+                  std::function<bool(unsigned, StringRef)> ReuseOutput =
+                      nullptr);
+
+/// Generate code for M on up to NumThreads threads, writing a single output
+/// file to OS that is equivalent to the one code generated from M directly.
+///
+/// The function definitions of M are cut into contiguous pieces of roughly
+/// equal size which are code generated concurrently, each in its own
+/// LLVMContext. What the AsmPrinter of each piece emits is recorded, and the
+/// recordings are replayed into one MCStreamer in the original order, so the
+/// output does not depend on thread scheduling. Modules that cannot be code
+/// generated in pieces, such as those with debug info, are code generated on
+/// the calling thread. M is not changed to make the pieces fit together.
+void splitCodeGenInOrder(Module &M, raw_pwrite_stream &OS, unsigned NumThreads,
+                         StringRef CPU, StringRef Features,
+                         const TargetOptions &Options,
+                         Reloc::Model RM = Reloc::Default,
+                         CodeModel::Model CM = CodeModel::Default,
+                         CodeGenOpt::Level OL = CodeGenOpt::Default,
+                         TargetMachine::CodeGenFileType FT =
+                             TargetMachine::CGFT_ObjectFile);
+
+} // namespace llvm
+
+#endif
@@ -14,6 +14,7 @@
 #include "llvm/DebugInfo/DWARF/DWARFFormValue.h"
 #include "llvm/DebugInfo/DWARF/DWARFRelocMap.h"
 #include <cstdint>
+#include <vector>
 
 namespace llvm {
 
@@ -47,6 +48,10 @@ public:
 
   bool extract();
   void dump(raw_ostream &OS) const;
+
+  /// Append the DIE offsets of all the entries of the table to \p Offsets.
+  /// Returns false if the entries don't have a DIE offset atom.
+  bool getDIEOffsets(std::vector<uint32_t> &Offsets) const;
 };
 
 }
@@ -21,6 +21,7 @@
 #include "llvm/DebugInfo/DWARF/DWARFDebugRangeList.h"
 #include "llvm/DebugInfo/DWARF/DWARFSection.h"
 #include "llvm/DebugInfo/DWARF/DWARFTypeUnit.h"
+#include <list>
 #include <vector>
 
 namespace llvm {
@@ -51,6 +52,17 @@ class DWARFContext : public DIContext {
   std::unique_ptr<DWARFDebugAbbrev> AbbrevDWO;
   std::unique_ptr<DWARFDebugLocDWO> LocDWO;
 
+  /// Sorted offsets of the DIEs listed in .apple_names, if it was parsed.
+  std::unique_ptr<std::vector<uint32_t>> AppleNamesDIEOffsets;
+
+  /// Units with all their DIEs extracted, most recently used first, when
+  /// their number is limited.
+  unsigned MaxUnitsWithDIEs = 0;
+  std::list<DWARFUnit *> UnitsWithDIEs;
+  DenseMap<DWARFUnit *, std::list<DWARFUnit *>::iterator> UnitsWithDIEsPos;
+  void updateUnitsWithDIEs(DWARFUnit *U);
+  void removeFromUnitsWithDIEs(DWARFUnit *U);
+
   DWARFContext(DWARFContext &) = delete;
   DWARFContext &operator=(DWARFContext &) = delete;
 
@@ -164,6 +176,37 @@ public:
   /// Get a pointer to a parsed line table corresponding to a compile unit.
   const DWARFDebugLine::LineTable *getLineTableForUnit(DWARFUnit *cu);
 
+  /// Get the sorted offsets of the DIEs listed in the .apple_names
+  /// accelerator table, empty if there is none. Units use them to find their
+  /// subprograms without extracting all their DIEs.
+  ArrayRef<uint32_t> getAppleNamesDIEOffsets();
+
+  /// Keep all the DIEs of at most \p MaxUnits units extracted between
+  /// queries. At each call to releaseUnusedUnitDIEs(), the DIEs of the least
+  /// recently used units over that number are released, except for their
+  /// unit DIE, and pointers to them become dangling. They are extracted again
+  /// if needed. 0, the default, means no limit.
+  void setMaxUnitsWithDIEs(unsigned MaxUnits);
+
+  /// Release the DIEs of the least recently used units over the limit set by
+  /// setMaxUnitsWithDIEs(). This is only done at points where no DIE pointers
+  /// are held: by dump() between units, at the start of each address query,
+  /// and by clients between their own top-level queries. A single query may
+  /// extract more units than the limit, e.g. to follow cross-unit references.
+  void releaseUnusedUnitDIEs();
+
+  /// Called by DWARFUnit when all its DIEs get extracted, or are used. This
+  /// only records the order in which the units were used.
+  void noteUnitDIEsUsed(DWARFUnit *U) {
+    if (MaxUnitsWithDIEs)
+      updateUnitsWithDIEs(U);
+  }
+  /// Called by DWARFUnit when its DIEs are released.
+  void noteUnitDIEsCleared(DWARFUnit *U) {
+    if (MaxUnitsWithDIEs)
+      removeFromUnitsWithDIEs(U);
+  }
+
   DILineInfo getLineInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier()) override;
   DILineInfoTable getLineInfoForAddressRange(uint64_t Address, uint64_t Size,
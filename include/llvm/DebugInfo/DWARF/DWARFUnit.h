@@ -134,6 +134,19 @@ class DWARFUnit {
   };
   std::unique_ptr<DWOHolder> DWO;
 
+  /// Start address of each range of addresses covered by the same subprogram
+  /// DIE, and the offset of the first such DIE (-1U if there is none). It is
+  /// built on the first address lookup, so that lookups don't need all the
+  /// DIEs of the unit to be extracted.
+  std::vector<std::pair<uint64_t, uint32_t>> SubprogramMap;
+  bool SubprogramMapIsBuilt;
+  /// Whether SubprogramMap only has the subprograms listed in the accelerator
+  /// tables, which don't list unnamed ones.
+  bool SubprogramMapIsFromAccelTable;
+  /// The DIE subtree of the last subprogram looked up, when the DIEs of the
+  /// unit aren't extracted.
+  std::vector<DWARFDebugInfoEntryMinimal> SubprogramDIEs;
+
 protected:
   virtual bool extractImpl(DataExtractor debug_info, uint32_t *offset_ptr);
   /// Size in bytes of the unit header.
@@ -205,6 +218,17 @@ public:
 
   void collectAddressRanges(DWARFAddressRangesVector &CURanges);
 
+  /// clearDIEs - Clear parsed DIEs to keep memory usage low, along with the
+  /// subprogram address map and the cached subprogram subtree.
+  void clearDIEs(bool KeepCUDie);
+
+  /// getDWOUnit - returns the unit of the .dwo file this skeleton unit refers
+  /// to, loading it if necessary, or nullptr if there is none.
+  DWARFUnit *getDWOUnit() {
+    parseDWO();
+    return DWO ? DWO->getUnit() : nullptr;
+  }
+
   /// getInlinedChainForAddress - fetches inlined chain for a given address.
   /// Returns empty chain if there is no subprogram containing address. The
   /// chain is valid as long as parsed compile unit DIEs are not cleared.
@@ -262,20 +286,32 @@ private:
   /// extractDIEsToVector - Appends all parsed DIEs to a vector.
   void extractDIEsToVector(bool AppendCUDie, bool AppendNonCUDIEs,
                            std::vector<DWARFDebugInfoEntryMinimal> &DIEs) const;
+  /// walkDIESubtree - Calls \p Fn on the DIE at \p DIEOffset and on all its
+  /// children, in order, without keeping them.
+  void walkDIESubtree(
+      uint32_t DIEOffset,
+      function_ref<void(const DWARFDebugInfoEntryMinimal &)> Fn) const;
   /// setDIERelations - We read in all of the DIE entries into our flat list
   /// of DIE entries and now we need to go back through all of them and set the
   /// parent, sibling and child pointers for quick DIE navigation.
-  void setDIERelations();
-  /// clearDIEs - Clear parsed DIEs to keep memory usage low.
-  void clearDIEs(bool KeepCUDie);
+  static void setDIERelations(std::vector<DWARFDebugInfoEntryMinimal> &DIEs);
 
   /// parseDWO - Parses .dwo file for current compile unit. Returns true if
   /// it was actually constructed.
   bool parseDWO();
 
+  /// buildSubprogramMap - Fills SubprogramMap with the subprograms listed in
+  /// the .apple_names accelerator table if \p UseAccelTable and it has any,
+  /// or else with all the subprogram DIEs of the unit.
+  void buildSubprogramMap(bool UseAccelTable);
+  /// lookUpSubprogramMap - Returns the offset of the first subprogram DIE
+  /// encompassing \p Address in SubprogramMap, or -1U.
+  uint32_t lookUpSubprogramMap(uint64_t Address) const;
+
   /// getSubprogramForAddress - Returns subprogram DIE with address range
-  /// encompassing the provided address. The pointer is alive as long as parsed
-  /// compile unit DIEs are not cleared.
+  /// encompassing the provided address. Only the subtree of this DIE is
+  /// extracted if the DIEs of the unit aren't. The pointer is alive until the
+  /// next call, or as long as parsed compile unit DIEs are not cleared.
   const DWARFDebugInfoEntryMinimal *getSubprogramForAddress(uint64_t Address);
 };
 
@@ -0,0 +1,79 @@
+//===- AnalysisResultCache.h - Results kept across runs ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file defines AnalysisResultCache, which keeps the results of function
+/// analyses around between runs of the compiler, so that a pipeline that is
+/// run again over functions that did not change doesn't have to recompute
+/// them.
+///
+/// An analysis opts in by providing these members, which the analysis
+/// manager uses when it is given a cache (see AnalysisManager::setResultCache):
+///
+/// \code
+///   void writeToCache(Function &F, const Result &R,
+///                     std::vector<uint32_t> &Data);
+///   bool readFromCache(Function &F, ArrayRef<uint32_t> Data, Result &R);
+/// \endcode
+///
+/// Results are keyed by the name of the analysis and a hash of the control
+/// flow graph of the function, and must only refer to blocks by their
+/// position in the function. Only analyses whose result is a function of the
+/// CFG alone can be cached this way; their result is then valid for any
+/// function with the same CFG.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_ANALYSISRESULTCACHE_H
+#define LLVM_IR_ANALYSISRESULTCACHE_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace llvm {
+
+class Function;
+
+/// \brief A store of function analysis results that can be saved to and
+/// loaded from a file.
+class AnalysisResultCache {
+public:
+  AnalysisResultCache() : Changed(false) {}
+
+  /// \brief Load the results saved in the file at \p Path, replacing those in
+  /// the cache. A file that doesn't exist leaves the cache empty.
+  std::error_code load(StringRef Path);
+
+  /// \brief Save the results in the cache to the file at \p Path, unless
+  /// nothing was added since the cache was loaded.
+  std::error_code save(StringRef Path);
+
+  /// \brief Return the key of the result of analysis \p Analysis for \p F.
+  static std::string getKey(StringRef Analysis, const Function &F);
+
+  /// \brief Return the result saved for \p Key, or null if there is none.
+  const std::vector<uint32_t> *lookup(StringRef Key) const;
+
+  /// \brief Save \p Data as the result for \p Key.
+  void insert(StringRef Key, std::vector<uint32_t> Data);
+
+  /// \brief Return the number of results in the cache.
+  unsigned size() const { return Results.size(); }
+
+private:
+  StringMap<std::vector<uint32_t>> Results;
+  bool Changed;
+};
+
+} // End llvm namespace
+
+#endif
@@ -107,6 +107,11 @@ public:
   }
   ~BasicBlock() override;
 
+  /// \brief Allocate a BasicBlock from the current IRArena of this thread if
+  /// there is one.
+  void *operator new(size_t Size);
+  void operator delete(void *Ptr);
+
   /// \brief Return the enclosing method, or null if none.
   const Function *getParent() const { return Parent; }
         Function *getParent()       { return Parent; }
@@ -178,6 +178,14 @@ public:
   /// \brief Run the analysis pass over a function and produce a dominator tree.
   DominatorTree run(Function &F);
 
+  /// \brief Save \p DT to \p Data for an \c AnalysisResultCache, as the
+  /// position of each block and of its immediate dominator.
+  void writeToCache(Function &F, const DominatorTree &DT,
+                    std::vector<uint32_t> &Data);
+
+  /// \brief Rebuild \p DT from \p Data saved by \c writeToCache.
+  bool readFromCache(Function &F, ArrayRef<uint32_t> Data, DominatorTree &DT);
+
   /// \brief Provide access to a name for this pass for debugging purposes.
   static StringRef name() { return "DominatorTreeAnalysis"; }
 
@@ -219,6 +227,10 @@ public:
 
   bool runOnFunction(Function &F) override;
 
+  FunctionPass *createParallelCopy() const override {
+    return new DominatorTreeWrapperPass();
+  }
+
   void verifyAnalysis() const override;
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
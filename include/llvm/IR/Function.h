@@ -26,9 +26,12 @@
 #include "llvm/IR/CallingConv.h"
 #include "llvm/IR/GlobalObject.h"
 #include "llvm/Support/Compiler.h"
+#include <memory>
+#include <vector>
 
 namespace llvm {
 
+class ChangedInstructionSet;
 class FunctionType;
 class LLVMContext;
 
@@ -68,6 +71,9 @@ private:
   ValueSymbolTable *SymTab;               ///< Symbol table of args/instructions
   AttributeSet AttributeSets;             ///< Parameter attributes
   FunctionType *Ty;
+  /// The instructions that changed since tracking started, or null if the
+  /// changes of the function aren't tracked.
+  std::unique_ptr<ChangedInstructionSet> ChangedInsts;
 
   /*
    * Value::SubclassData
@@ -545,6 +551,51 @@ public:
   /// setjmp or other function that gcc recognizes as "returning twice".
   bool callsFunctionThatReturnsTwice() const;
 
+  /// \name Change tracking
+  ///
+  /// While its changes are tracked, a function records the instructions that
+  /// are inserted into it (alone or with their block) or moved within it, the
+  /// instructions that get an operand set (through Use::set, setOperand or
+  /// any of the replace-uses entry points), and the operands of the
+  /// instructions that are removed from it. Passes that change code in other
+  /// ways, e.g. by flipping flags, and want it looked at again call
+  /// noteChangedInstruction. Passes that only need to revisit what changed
+  /// since they last ran use this to avoid sweeping the whole function. While
+  /// any function is tracked, setting a use takes a slower path, so tracking
+  /// should be stopped when the passes that use it are done.
+  /// @{
+
+  /// \brief Start tracking the changes of this function, forgetting the
+  /// changes recorded so far.
+  void startTrackingChanges();
+
+  /// \brief Stop tracking the changes of this function. Passes that rely on
+  /// the tracking then fall back to looking at the whole function.
+  void stopTrackingChanges();
+
+  bool isTrackingChanges() const { return ChangedInsts != nullptr; }
+
+  /// \brief Record \p I, an instruction of this function, as changed if the
+  /// changes of the function are tracked.
+  void noteChangedInstruction(Instruction *I) {
+    if (isTrackingChanges())
+      recordChangedInstruction(I);
+  }
+
+  /// \brief Forget about \p I, which is about to leave this function, and
+  /// record its operands that remain in the function as changed if
+  /// \p NoteOperands is true.
+  void noteRemovedInstruction(Instruction *I, bool NoteOperands = true) {
+    if (isTrackingChanges())
+      forgetChangedInstruction(I, NoteOperands);
+  }
+
+  /// \brief Move the instructions recorded as changed to \p Changed, in the
+  /// order in which they were first recorded, and keep tracking.
+  void takeChangedInstructions(std::vector<Instruction *> &Changed);
+
+  /// @}
+
   /// \brief Check if this has any metadata.
   bool hasMetadata() const { return hasMetadataHashEntry(); }
 
@@ -589,6 +640,9 @@ private:
   }
 
   void clearMetadata();
+
+  void recordChangedInstruction(Instruction *I);
+  void forgetChangedInstruction(Instruction *I, bool NoteOperands);
 };
 
 inline ValueSymbolTable *
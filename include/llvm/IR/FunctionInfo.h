@@ -0,0 +1,155 @@
+//===-- llvm/FunctionInfo.h - Function Info Index ---------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// @file
+/// FunctionInfo.h This file contains the declarations the classes that hold
+/// the function info index and summary.
+///
+/// A function summary is a compact description of a function definition
+/// (linkage, size and direct call edges) that is emitted into each bitcode
+/// file. A "thin link" merges the summaries of all modules into a combined
+/// FunctionInfoIndex without loading any IR, which each module's backend can
+/// then consult to decide which functions to import from other modules.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_FUNCTIONINFO_H
+#define LLVM_IR_FUNCTIONINFO_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/IR/GlobalValue.h"
+#include <memory>
+#include <vector>
+
+namespace llvm {
+
+class Function;
+class Module;
+
+/// \brief Function summary information to aid decisions and implementation of
+/// importing.
+///
+/// The module path and callee names are owned by the FunctionInfoIndex that
+/// holds the summary.
+class FunctionSummary {
+  /// Path of the module defining the function.
+  StringRef ModulePath;
+
+  /// Linkage of the function definition.
+  GlobalValue::LinkageTypes Linkage;
+
+  /// Number of instructions (ignoring debug instructions, e.g.) computed
+  /// during the initial compile step when the function index is first built.
+  unsigned InstCount;
+
+  /// Whether the definition can be copied into another module as an
+  /// available_externally body, i.e. it has an ODR-safe linkage and refers to
+  /// no local symbols of its defining module.
+  bool IsEligibleForImport;
+
+  /// Names of the functions called directly by this function.
+  std::vector<StringRef> Callees;
+
+public:
+  FunctionSummary(StringRef ModulePath, GlobalValue::LinkageTypes Linkage,
+                  unsigned InstCount, bool IsEligibleForImport)
+      : ModulePath(ModulePath), Linkage(Linkage), InstCount(InstCount),
+        IsEligibleForImport(IsEligibleForImport) {}
+
+  StringRef modulePath() const { return ModulePath; }
+  GlobalValue::LinkageTypes getLinkage() const { return Linkage; }
+  unsigned instCount() const { return InstCount; }
+  bool isEligibleForImport() const { return IsEligibleForImport; }
+
+  ArrayRef<StringRef> callees() const { return Callees; }
+  void addCallee(StringRef Name) { Callees.push_back(Name); }
+};
+
+/// List of function summaries for a particular function name. There is
+/// usually a single definition, but linkonce and weak functions may be
+/// defined in several modules.
+typedef std::vector<std::unique_ptr<FunctionSummary>> FunctionSummaryList;
+
+/// Map from function name to the corresponding function summary list.
+typedef StringMap<FunctionSummaryList> FunctionSummaryMapTy;
+
+/// Map from module path to module identifier, used to name the modules of a
+/// combined index.
+typedef StringMap<uint64_t> ModulePathStringTableTy;
+
+/// Class to hold the function summaries of one or more modules.
+class FunctionInfoIndex {
+  /// Map from function name to the summaries of its definitions.
+  FunctionSummaryMapTy FunctionMap;
+
+  /// Holds strings for the module paths, mapped to their module identifiers.
+  ModulePathStringTableTy ModulePathStringTable;
+
+  /// Owns the callee names referenced by the summaries.
+  StringSet<> Names;
+
+public:
+  FunctionInfoIndex() = default;
+  FunctionInfoIndex(const FunctionInfoIndex &) = delete;
+  FunctionInfoIndex &operator=(const FunctionInfoIndex &) = delete;
+
+  typedef FunctionSummaryMapTy::const_iterator const_iterator;
+  const_iterator begin() const { return FunctionMap.begin(); }
+  const_iterator end() const { return FunctionMap.end(); }
+  bool empty() const { return FunctionMap.empty(); }
+
+  /// Get the summaries of the definitions of the function named \p FuncName,
+  /// or null if the index does not know the function.
+  const FunctionSummaryList *findFunctionSummaries(StringRef FuncName) const {
+    auto I = FunctionMap.find(FuncName);
+    return I == FunctionMap.end() ? nullptr : &I->second;
+  }
+
+  /// Add a summary for a definition of \p FuncName.
+  void addFunctionSummary(StringRef FuncName,
+                          std::unique_ptr<FunctionSummary> Summary) {
+    FunctionMap[FuncName].push_back(std::move(Summary));
+  }
+
+  /// Add a module path with the given identifier, returning the copy owned by
+  /// the index. An already present path keeps its original identifier.
+  StringRef addModulePath(StringRef ModPath, uint64_t ModId) {
+    return ModulePathStringTable.insert(std::make_pair(ModPath, ModId))
+        .first->first();
+  }
+
+  /// Get the identifier of the given module path.
+  uint64_t getModuleId(StringRef ModPath) const {
+    return ModulePathStringTable.lookup(ModPath);
+  }
+
+  const ModulePathStringTableTy &modulePaths() const {
+    return ModulePathStringTable;
+  }
+
+  /// Return a copy of \p Name owned by the index.
+  StringRef internName(StringRef Name) {
+    return Names.insert(Name).first->first();
+  }
+
+  /// Compute the summaries of all the function definitions in \p M and add
+  /// them to the index under the module path \p ModPath.
+  void addModule(const Module &M, StringRef ModPath, uint64_t ModId = 0);
+
+  /// Add the summaries from another function index to this index. The
+  /// module paths of \p Other are assigned identifiers starting at
+  /// \p NextModuleId, which is updated accordingly.
+  void mergeFrom(const FunctionInfoIndex &Other, uint64_t &NextModuleId);
+};
+
+} // End llvm namespace
+
+#endif
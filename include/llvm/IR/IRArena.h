@@ -0,0 +1,157 @@
+//===-- llvm/IR/IRArena.h - Arena for instructions and blocks ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief This file declares IRArena, an allocator that instructions, basic
+/// blocks and hung off operand lists can be created from instead of the
+/// global heap.
+///
+/// Building a large function allocates every instruction, block and operand
+/// list separately. An arena carves them out of large slabs instead, so that
+/// the IR of a function is close together in memory and takes far fewer calls
+/// to the system allocator. Deleting an object returns its storage to a free
+/// list of its size class, from which later objects of the same size are
+/// allocated.
+///
+/// Allocation from an arena is opt-in: instructions and blocks are created in
+/// the current arena of their thread, which an IRArena::Scope sets:
+/// \code
+///   IntrusiveRefCntPtr<IRArena> Arena(new IRArena());
+///   {
+///     IRArena::Scope S(Arena.get());
+///     // Build the function; its instructions and blocks live in Arena.
+///   }
+/// \endcode
+///
+/// Every object allocated from an arena holds a reference to it, so the arena
+/// lives until all of them are deleted, wherever they were moved to. To work
+/// on several functions in parallel, give each function an arena of its own.
+/// An object that was moved to another function is still deleted into the
+/// arena of its first function, possibly while a thread works on that one, so
+/// the arenas lock themselves while a context is multithreaded (see
+/// LLVMContext::enterMultithreadedRegion). Otherwise the objects of one arena
+/// must only be created and deleted by one thread at a time.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_IRARENA_H
+#define LLVM_IR_IRARENA_H
+
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Mutex.h"
+#include <atomic>
+#include <cstddef>
+
+namespace llvm {
+
+class IRArena {
+  /// The header in front of every object allocated from an arena.
+  struct Header {
+    IRArena *Arena;
+    /// The size class of the object, or zero if the object is too large to
+    /// be pooled and was allocated from the global heap.
+    size_t SizeClass;
+  };
+
+  enum : size_t {
+    /// Objects are pooled in size classes of this many bytes.
+    SizeClassBytes = 2 * sizeof(void *),
+    /// Objects larger than this are not worth pooling.
+    NumSizeClasses = 64,
+    MaxPooledSize = NumSizeClasses * SizeClassBytes
+  };
+
+  BumpPtrAllocator Allocator;
+  /// The free storage of each size class, linked through the first word of
+  /// the storage.
+  void *FreeLists[NumSizeClasses + 1];
+  size_t NumLiveObjects;
+  size_t NumReusedObjects;
+  /// The references to this arena: one per live object, and the ones of
+  /// IntrusiveRefCntPtr.
+  unsigned RefCount;
+
+  /// Guards the state of the arena while arenas may be used by several
+  /// threads at once.
+  sys::SmartMutex<true> Lock;
+  class Guard;
+
+  /// \brief Number of contexts in a multithreaded region (see
+  /// LLVMContext::enterMultithreadedRegion). While it isn't zero, the arenas
+  /// lock themselves.
+  static std::atomic<unsigned> NumMultithreadedContexts;
+
+  static bool mayBeShared() {
+    return NumMultithreadedContexts.load(std::memory_order_relaxed) != 0;
+  }
+
+  IRArena(const IRArena &) = delete;
+  void operator=(const IRArena &) = delete;
+
+  static Header *getHeader(void *Ptr) {
+    return static_cast<Header *>(Ptr) - 1;
+  }
+
+  friend class LLVMContext;
+
+public:
+  IRArena();
+  ~IRArena();
+
+  /// \brief Add a reference to this arena, for IntrusiveRefCntPtr.
+  void Retain();
+
+  /// \brief Drop a reference to this arena, deleting it if it was the last.
+  void Release();
+
+  /// \brief Allocate \p Size bytes from this arena. The storage must be
+  /// freed with \c deallocate.
+  void *allocate(size_t Size);
+
+  /// \brief Return the storage of an object allocated from an arena to the
+  /// free list of its size class.
+  static void deallocate(void *Ptr);
+
+  /// \brief Return the arena \p Ptr was allocated from.
+  static IRArena *getArena(void *Ptr) { return getHeader(Ptr)->Arena; }
+
+  /// \brief Return the arena instructions and blocks created by this thread
+  /// are allocated from, or null to allocate them from the global heap.
+  static IRArena *getCurrent();
+
+  /// \brief Return the number of objects allocated from this arena that have
+  /// not been deleted yet.
+  size_t getNumLiveObjects() const { return NumLiveObjects; }
+
+  /// \brief Return the number of allocations that reused the storage of a
+  /// deleted object.
+  size_t getNumReusedObjects() const { return NumReusedObjects; }
+
+  /// \brief Return the number of bytes of slabs this arena allocated.
+  size_t getTotalMemory() const { return Allocator.getTotalMemory(); }
+
+  /// \brief Make an arena the current arena of this thread for the lifetime
+  /// of the scope. Scopes nest; a null arena makes the current thread
+  /// allocate from the global heap again.
+  class Scope {
+    IRArena *Prev;
+
+    Scope(const Scope &) = delete;
+    void operator=(const Scope &) = delete;
+
+  public:
+    explicit Scope(IRArena *Arena);
+    ~Scope();
+  };
+};
+
+} // end namespace llvm
+
+#endif
@@ -505,6 +505,14 @@ protected:
     return getSubclassDataFromValue() & ~HasMetadataBit;
   }
 
+  /// Allocate an Instruction with hung off operands, from the current
+  /// IRArena of this thread if there is one.
+  void *operator new(size_t Size);
+
+  /// Allocate an Instruction with \p Us operands co-allocated, from the
+  /// current IRArena of this thread if there is one.
+  void *operator new(size_t Size, unsigned Us);
+
   Instruction(Type *Ty, unsigned iType, Use *Ops, unsigned NumOps,
               Instruction *InsertBefore = nullptr);
   Instruction(Type *Ty, unsigned iType, Use *Ops, unsigned NumOps,
@@ -160,6 +160,52 @@ public:
   /// any global mutex or cannot block the execution in another LLVM context.
   void yield();
 
+  /// \brief Enter a region where several threads may use this context at the
+  /// same time, each of them working on different functions. Regions nest
+  /// and end with \c exitMultithreadedRegion.
+  ///
+  /// Within a region, the state of the context that is shared between
+  /// functions is only accessed under a lock: uniqued types, constants,
+  /// attributes and metadata, value names and handles, instruction metadata
+  /// and the use lists of constants, globals and metadata wrappers. Creating
+  /// or deleting globals, or walking the use list of a value that isn't local
+  /// to a function, is still not supported.
+  ///
+  /// Types, attributes and constants have locks of their own, and the tables
+  /// of integer, floating point and aggregate constants, constant expressions
+  /// and use lists are split in independently locked shards, so that threads
+  /// creating unrelated values rarely wait on each other. Metadata nodes that
+  /// already exist are looked up without taking the lock of the rest of the
+  /// shared state.
+  ///
+  /// The threads tell which function they work on with \c
+  /// setMultithreadedWorkOrder. When the outermost region ends, the use lists
+  /// of the values that aren't local to a function are put in the order a
+  /// serial run over the functions in that order would have given them.
+  void enterMultithreadedRegion();
+
+  /// \brief Leave the region entered by the matching call to \c
+  /// enterMultithreadedRegion. Only call this once the other threads stopped
+  /// using the context.
+  void exitMultithreadedRegion();
+
+  /// \brief Tell the multithreaded regions that the calling thread now works
+  /// on the function at position \p Order of the serial order of their work,
+  /// usually the order of the functions in the module.
+  static void setMultithreadedWorkOrder(unsigned Order);
+
+  /// \brief Return true if several threads may be using this context.
+  bool isMultithreaded() const;
+
+  /// \brief Set whether the IR readers allocate the instructions and blocks
+  /// of each function body they read from an IRArena of its own, instead of
+  /// one by one from the global heap. Off by default.
+  void setUseFunctionArenas(bool Enable);
+
+  /// \brief Return true if the IR readers allocate function bodies from
+  /// arenas, see \c setUseFunctionArenas.
+  bool useFunctionArenas() const;
+
   /// emitError - Emit an error message to the currently installed error handler
   /// with optional location information.  This function returns, so code should
   /// be prepared to drop the erroneous construct on the floor and "not crash".
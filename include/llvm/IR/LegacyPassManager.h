@@ -58,6 +58,12 @@ public:
   /// whether any of the passes modifies the module, and if so, return true.
   bool run(Module &M);
 
+  /// setNumFunctionPassThreads - Run sequences of function passes on up to
+  /// \p N functions at the same time, when all of the passes of a sequence
+  /// support it (see FunctionPass::createParallelCopy). 0 means one thread
+  /// per hardware thread. The default of 1 runs all the passes serially.
+  void setNumFunctionPassThreads(unsigned N);
+
 private:
   /// PassManagerImpl_New is the actual class. PassManager is just the
   /// wraper to publish simple pass manager interface
@@ -227,6 +227,11 @@ public:
   void dumpPasses() const;
   void dumpArguments() const;
 
+  /// Number of functions that function pass managers may process at the same
+  /// time. 0 means one per hardware thread.
+  unsigned getNumFunctionPassThreads() const { return NumFunctionPassThreads; }
+  void setNumFunctionPassThreads(unsigned N) { NumFunctionPassThreads = N; }
+
   // Active Pass Managers
   PMStack activeStack;
 
@@ -260,6 +265,8 @@ private:
   /// FIXME: This is an egregious hack because querying the pass registry is
   /// either slow or racy.
   mutable DenseMap<AnalysisID, const PassInfo *> AnalysisPassInfos;
+
+  unsigned NumFunctionPassThreads;
 };
 
 
@@ -470,6 +477,15 @@ public:
   PassManagerType getPassManagerType() const override {
     return PMT_FunctionPassManager;
   }
+
+private:
+  /// Return true if the passes can run on several functions of \p M at the
+  /// same time.
+  bool canRunInParallel(Module &M);
+
+  /// Run the passes on the functions of \p M with \p NumThreads threads. Each
+  /// thread runs its own copies of the passes.
+  bool runInParallel(Module &M, unsigned NumThreads);
 };
 
 Timer *getPassTimer(Pass *);
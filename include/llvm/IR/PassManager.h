@@ -419,17 +419,20 @@ public:
   ///
   /// A flag can be passed to indicate that the manager should perform debug
   /// logging.
-  AnalysisManager(bool DebugLogging = false) : DebugLogging(DebugLogging) {}
+  AnalysisManager(bool DebugLogging = false)
+      : ResultCache(nullptr), DebugLogging(DebugLogging) {}
 
   // We have to explicitly define all the special member functions because MSVC
   // refuses to generate them.
   AnalysisManager(AnalysisManager &&Arg)
       : BaseT(std::move(static_cast<BaseT &>(Arg))),
         AnalysisResults(std::move(Arg.AnalysisResults)),
+        ResultCache(Arg.ResultCache),
         DebugLogging(std::move(Arg.DebugLogging)) {}
   AnalysisManager &operator=(AnalysisManager &&RHS) {
     BaseT::operator=(std::move(static_cast<BaseT &>(RHS)));
     AnalysisResults = std::move(RHS.AnalysisResults);
+    ResultCache = RHS.ResultCache;
     DebugLogging = std::move(RHS.DebugLogging);
     return *this;
   }
@@ -453,6 +456,12 @@ public:
     AnalysisResultLists.clear();
   }
 
+  /// \brief Set the cache that analyses which support it read their results
+  /// from and write them to, or null to always run the analyses.
+  ///
+  /// The cache must outlive the analysis manager or be reset.
+  void setResultCache(AnalysisResultCache *Cache) { ResultCache = Cache; }
+
 private:
   AnalysisManager(const AnalysisManager &) = delete;
   AnalysisManager &operator=(const AnalysisManager &) = delete;
@@ -471,7 +480,9 @@ private:
       if (DebugLogging)
         dbgs() << "Running analysis: " << P.name() << "\n";
       AnalysisResultListT &ResultList = AnalysisResultLists[&IR];
-      ResultList.emplace_back(PassID, P.run(IR, this));
+      ResultList.emplace_back(PassID, ResultCache
+                                          ? P.run(IR, this, *ResultCache)
+                                          : P.run(IR, this));
 
       // P.run may have inserted elements into AnalysisResults and invalidated
       // RI.
@@ -579,6 +590,9 @@ private:
   /// analysis result.
   AnalysisResultMapT AnalysisResults;
 
+  /// \brief The cache of results kept across runs, if any.
+  AnalysisResultCache *ResultCache;
+
   /// \brief A flag indicating whether debug logging is enabled.
   bool DebugLogging;
 };
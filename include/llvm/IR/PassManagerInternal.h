@@ -18,8 +18,11 @@
 #ifndef LLVM_IR_PASSMANAGERINTERNAL_H
 #define LLVM_IR_PASSMANAGERINTERNAL_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/AnalysisResultCache.h"
+#include <type_traits>
 
 namespace llvm {
 
@@ -254,10 +257,66 @@ template <typename IRUnitT> struct AnalysisPassConcept {
   virtual std::unique_ptr<AnalysisResultConcept<IRUnitT>>
   run(IRUnitT &IR, AnalysisManager<IRUnitT> *AM) = 0;
 
+  /// \brief Method to run this analysis over a unit of IR, reusing a result
+  /// from \p Cache if the analysis supports it and there is one, and adding
+  /// the result to \p Cache otherwise.
+  virtual std::unique_ptr<AnalysisResultConcept<IRUnitT>>
+  run(IRUnitT &IR, AnalysisManager<IRUnitT> *AM,
+      AnalysisResultCache &Cache) = 0;
+
   /// \brief Polymorphic method to access the name of a pass.
   virtual StringRef name() = 0;
 };
 
+/// \brief SFINAE metafunction for computing whether \c PassT can read its
+/// results from an \c AnalysisResultCache, and thus also write them.
+template <typename IRUnitT, typename PassT> class PassHasResultCacheMethods {
+  typedef char SmallType;
+  struct BigType {
+    char a, b;
+  };
+
+  template <typename T, bool (T::*)(IRUnitT &, ArrayRef<uint32_t>,
+                                    typename T::Result &)>
+  struct Checker;
+
+  template <typename T> static SmallType f(Checker<T, &T::readFromCache> *);
+  template <typename T> static BigType f(...);
+
+public:
+  enum { Value = sizeof(f<PassT>(nullptr)) == sizeof(SmallType) };
+};
+
+/// \brief Run \p Pass by calling \p Run, as it cannot use a result cache.
+template <typename ResultModelT, typename IRUnitT, typename PassT,
+          typename RunT>
+std::unique_ptr<AnalysisResultConcept<IRUnitT>>
+runWithResultCache(PassT &, IRUnitT &, AnalysisResultCache &, RunT Run,
+                   std::false_type) {
+  return make_unique<ResultModelT>(Run());
+}
+
+/// \brief Read the result of \p Pass from \p Cache, or compute it by calling
+/// \p Run and add it to \p Cache.
+template <typename ResultModelT, typename IRUnitT, typename PassT,
+          typename RunT>
+std::unique_ptr<AnalysisResultConcept<IRUnitT>>
+runWithResultCache(PassT &Pass, IRUnitT &IR, AnalysisResultCache &Cache,
+                   RunT Run, std::true_type) {
+  std::string Key = AnalysisResultCache::getKey(PassT::name(), IR);
+  if (const std::vector<uint32_t> *Data = Cache.lookup(Key)) {
+    typename PassT::Result Result;
+    if (Pass.readFromCache(IR, *Data, Result))
+      return make_unique<ResultModelT>(std::move(Result));
+  }
+
+  auto Model = make_unique<ResultModelT>(Run());
+  std::vector<uint32_t> Data;
+  Pass.writeToCache(IR, Model->Result, Data);
+  Cache.insert(Key, std::move(Data));
+  return std::move(Model);
+}
+
 /// \brief Wrapper to model the analysis pass concept.
 ///
 /// Can wrap any type which implements a suitable \c run method. The method
@@ -298,6 +357,17 @@ struct AnalysisPassModel<IRUnitT, PassT, true> : AnalysisPassConcept<IRUnitT> {
     return make_unique<ResultModelT>(Pass.run(IR, AM));
   }
 
+  /// \brief The model reads and writes the cache through \c PassT if it
+  /// provides \c readFromCache and \c writeToCache methods.
+  std::unique_ptr<AnalysisResultConcept<IRUnitT>>
+  run(IRUnitT &IR, AnalysisManager<IRUnitT> *AM,
+      AnalysisResultCache &Cache) override {
+    return runWithResultCache<ResultModelT>(
+        Pass, IR, Cache, [&] { return Pass.run(IR, AM); },
+        std::integral_constant<
+            bool, PassHasResultCacheMethods<IRUnitT, PassT>::Value>());
+  }
+
   /// \brief The model delegates to a static \c PassT::name method.
   ///
   /// The returned string ref must point to constant immutable data!
@@ -336,6 +406,17 @@ struct AnalysisPassModel<IRUnitT, PassT, false> : AnalysisPassConcept<IRUnitT> {
     return make_unique<ResultModelT>(Pass.run(IR));
   }
 
+  /// \brief The model reads and writes the cache through \c PassT if it
+  /// provides \c readFromCache and \c writeToCache methods.
+  std::unique_ptr<AnalysisResultConcept<IRUnitT>>
+  run(IRUnitT &IR, AnalysisManager<IRUnitT> *,
+      AnalysisResultCache &Cache) override {
+    return runWithResultCache<ResultModelT>(
+        Pass, IR, Cache, [&] { return Pass.run(IR); },
+        std::integral_constant<
+            bool, PassHasResultCacheMethods<IRUnitT, PassT>::Value>());
+  }
+
   /// \brief The model delegates to a static \c PassT::name method.
   ///
   /// The returned string ref must point to constant immutable data!
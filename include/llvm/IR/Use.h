@@ -29,6 +29,7 @@
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/Support/CBindingWrapping.h"
 #include "llvm/Support/Compiler.h"
+#include <atomic>
 #include <cstddef>
 #include <iterator>
 
@@ -81,7 +82,11 @@ private:
 
   /// Destructor - Only for zap()
   ~Use() {
-    if (Val)
+    if (!Val)
+      return;
+    if (LLVM_UNLIKELY(mayNeedUseListLock()))
+      removeFromListLocked();
+    else
       removeFromList();
   }
 
@@ -136,6 +141,39 @@ private:
   Use *Next;
   PointerIntPair<Use **, 2, PrevPtrTag> Prev;
 
+  /// \brief Number of contexts in a multithreaded region (see
+  /// LLVMContext::enterMultithreadedRegion). While it isn't zero, the use
+  /// lists of the values that aren't local to a function are edited under the
+  /// lock of their context.
+  static std::atomic<unsigned> NumMultithreadedContexts;
+
+  static bool mayNeedUseListLock() {
+    return NumMultithreadedContexts.load(std::memory_order_relaxed) != 0;
+  }
+
+  /// \brief Number of functions whose changes are tracked (see
+  /// Function::startTrackingChanges). While it isn't zero, setting a use to
+  /// a value records its user as changed in the function of the user.
+  static std::atomic<unsigned> NumChangeTrackingFunctions;
+
+  /// \brief Return true if set() can't just edit the use lists.
+  static bool needsSlowSet() {
+    return (NumMultithreadedContexts.load(std::memory_order_relaxed) |
+            NumChangeTrackingFunctions.load(std::memory_order_relaxed)) != 0;
+  }
+  void setSlow(Value *V);
+  void setLocked(Value *V);
+  void removeFromListLocked();
+
+  /// \brief Make the uses at the front of the use list of \p From use \p To
+  /// instead, up to the first one that is an operand of a constant other
+  /// than a global. Those have to be updated through their constant.
+  ///
+  /// The uses end up in the same order as if \c set(To) was called on each of
+  /// them, but the run is walked once, cut from the list of \p From as a
+  /// whole, and the use-list locks are only taken once.
+  static void replaceLeadingUses(Value *From, Value *To);
+
   void setPrev(Use **NewPrev) { Prev.setPointer(NewPrev); }
   void addToList(Use **List) {
     Next = *List;
@@ -152,6 +190,8 @@ private:
   }
 
   friend class Value;
+  friend class LLVMContext;
+  friend class Function;
 };
 
 /// \brief Allow clients to treat uses just like values when using
@@ -32,6 +32,8 @@ namespace llvm {
 template <class>
 struct OperandTraits;
 
+class IRArena;
+
 class User : public Value {
   User(const User &) = delete;
   template <unsigned>
@@ -50,6 +52,14 @@ protected:
   /// This is used for subclasses which have a fixed number of operands.
   void *operator new(size_t Size, unsigned Us);
 
+  /// Allocate a User with an operand pointer co-allocated, from \p Arena if
+  /// it isn't null.
+  static void *allocateHungoffUser(size_t Size, IRArena *Arena);
+
+  /// Allocate a User with \p Us operands co-allocated, from \p Arena if it
+  /// isn't null.
+  static void *allocateFixedUser(size_t Size, unsigned Us, IRArena *Arena);
+
   User(Type *ty, unsigned vty, Use *OpList, unsigned NumOps)
       : Value(ty, vty) {
     assert(NumOps < (1u << NumUserOperandsBits) && "Too many operands");
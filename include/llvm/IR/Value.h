@@ -103,13 +103,19 @@ protected:
   ///
   /// Note, this should *NOT* be used directly by any class other than User.
   /// User uses this value to find the Use list.
-  static const unsigned NumUserOperandsBits = 29;
-  unsigned NumUserOperands : 29;
+  static const unsigned NumUserOperandsBits = 28;
+  unsigned NumUserOperands : 28;
 
   bool IsUsedByMD : 1;
   bool HasName : 1;
   bool HasHungOffUses : 1;
 
+  /// \brief Whether the storage of this value was allocated from an IRArena.
+  ///
+  /// Like HasHungOffUses, this is set by operator new of the subclasses that
+  /// can be allocated from an arena and is not touched by the constructors.
+  bool HasArenaStorage : 1;
+
 private:
   template <typename UseT> // UseT == 'Use' or 'const Use'
   class use_iterator_impl
@@ -526,6 +532,8 @@ inline raw_ostream &operator<<(raw_ostream &OS, const Value &V) {
 }
 
 void Use::set(Value *V) {
+  if (LLVM_UNLIKELY(needsSlowSet()))
+    return setSlow(V);
   if (Val) removeFromList();
   Val = V;
   if (V) V->addUse(*this);
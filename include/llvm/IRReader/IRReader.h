@@ -34,15 +34,18 @@ std::unique_ptr<Module> getLazyIRFileModule(StringRef Filename,
 
 /// If the given MemoryBuffer holds a bitcode image, return a Module
 /// for it.  Otherwise, attempt to parse it as LLVM Assembly and return
-/// a Module for it.
+/// a Module for it.  The function bodies of a bitcode image are parsed on up
+/// to NumThreads threads (see parseBitcodeFile).
 std::unique_ptr<Module> parseIR(MemoryBufferRef Buffer, SMDiagnostic &Err,
-                                LLVMContext &Context);
+                                LLVMContext &Context, unsigned NumThreads = 1);
 
 /// If the given file holds a bitcode image, return a Module for it.
 /// Otherwise, attempt to parse it as LLVM Assembly and return a Module
-/// for it.
+/// for it.  The function bodies of a bitcode image are parsed on up to
+/// NumThreads threads (see parseBitcodeFile).
 std::unique_ptr<Module> parseIRFile(StringRef Filename, SMDiagnostic &Err,
-                                    LLVMContext &Context);
+                                    LLVMContext &Context,
+                                    unsigned NumThreads = 1);
 }
 
 #endif
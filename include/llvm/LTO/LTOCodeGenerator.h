@@ -40,7 +40,9 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Linker/Linker.h"
+#include "llvm/Support/CodeGen.h"
 #include "llvm/Target/TargetOptions.h"
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -49,7 +51,9 @@ namespace llvm {
   class DiagnosticInfo;
   class GlobalValue;
   class Mangler;
+  class MD5;
   class MemoryBuffer;
+  class MemoryBufferRef;
   class TargetLibraryInfo;
   class TargetMachine;
   class raw_ostream;
@@ -79,6 +83,35 @@ struct LTOCodeGenerator {
   void setAttr(const char *mAttr) { MAttr = mAttr; }
   void setOptLevel(unsigned optLevel) { OptLevel = optLevel; }
 
+  // Set the number of partitions the merged module is split into by
+  // compileOptimizedParallel(). Each partition is code generated on its own
+  // thread. writeMergedModules() also encodes bitcode on as many threads.
+  void setCodeGenJobs(unsigned Jobs) { CodeGenJobs = Jobs ? Jobs : 1; }
+
+  // Set the directory used to cache the generated objects. The objects are
+  // keyed by a hash of the merged module and of every option that affects
+  // optimization and code generation, so relinking unchanged inputs reuses
+  // the previous objects. With several codegen jobs, each partition is keyed
+  // by a hash of its own bitcode instead, so that only the partitions touched
+  // by a change are generated again. An empty path (the default) disables the
+  // cache.
+  void setCacheDir(StringRef Path) { CacheDir = Path; }
+
+  // Set the minimum interval, in seconds, between two scans of the cache
+  // directory for pruning. A negative value disables pruning.
+  void setCachePruningInterval(int Interval) { CachePruningInterval = Interval; }
+
+  // Set the number of seconds after which an unused cache entry is removed.
+  // A value of 0 disables expiration.
+  void setCacheEntryExpiration(unsigned Expiration) {
+    CacheEntryExpiration = Expiration;
+  }
+
+  // Set the maximum total size in bytes of the cache. The least recently
+  // used entries are removed to stay within this budget. A value of 0 means
+  // no limit.
+  void setMaxCacheSize(uint64_t Size) { MaxCacheSize = Size; }
+
   void setShouldInternalize(bool Value) { ShouldInternalize = Value; }
   void setShouldEmbedUselists(bool Value) { ShouldEmbedUselists = Value; }
 
@@ -117,6 +150,9 @@ struct LTOCodeGenerator {
   // (linker), it brings the object to a buffer, and return the buffer to the
   // caller. This function should delete intermediate object file once its content
   // is brought to memory. Return NULL if the compilation was not successful.
+  //
+  // When a cache directory is set and holds the object for the same inputs and
+  // options, that object is returned and the merged module is left as is.
   std::unique_ptr<MemoryBuffer> compile(bool disableInline,
                                         bool disableGVNLoadPRE,
                                         bool disableVectorization,
@@ -133,6 +169,19 @@ struct LTOCodeGenerator {
   // if the compilation was not successful.
   std::unique_ptr<MemoryBuffer> compileOptimized(std::string &errMsg);
 
+  // Compiles the merged optimized module into one object file per codegen job
+  // (see setCodeGenJobs()), generating code for the partitions concurrently.
+  // The objects are appended to the given vector; linked together they are
+  // equivalent to the single object produced by compileOptimized(). Returns
+  // true on success.
+  //
+  // NOTE that with more than one codegen job the local symbols of the merged
+  // module are given hidden visibility so that partitions can refer to each
+  // other.
+  bool compileOptimizedParallel(
+      std::vector<std::unique_ptr<MemoryBuffer>> &Objects,
+      std::string &errMsg);
+
   void setDiagnosticHandler(lto_diagnostic_handler_t, void *);
 
   LLVMContext &getContext() { return Context; }
@@ -140,8 +189,30 @@ struct LTOCodeGenerator {
 private:
   void initializeLTOPasses();
 
-  bool compileOptimized(raw_pwrite_stream &out, std::string &errMsg);
+  bool compileOptimized(
+      ArrayRef<raw_pwrite_stream *> Out, std::string &errMsg,
+      std::function<bool(unsigned, StringRef)> ReuseOutput = nullptr);
   bool compileOptimizedToFile(const char **name, std::string &errMsg);
+  bool writeObjectToTempFile(MemoryBufferRef Object, const char **name,
+                             std::string &errMsg);
+  bool compileOptimizedToBuffers(
+      unsigned NumObjects, std::vector<std::unique_ptr<MemoryBuffer>> &Objects,
+      std::string &errMsg,
+      std::function<bool(unsigned, StringRef)> ReuseOutput = nullptr);
+
+  typedef std::function<bool(std::vector<std::unique_ptr<MemoryBuffer>> &,
+                             std::string &)> CompileFnTy;
+  void hashCodeGenOptions(MD5 &Hasher);
+  std::string computeCacheKey(StringRef Pipeline);
+  std::string computePartitionCacheKey(StringRef Bitcode);
+  std::string getCacheEntryPath(StringRef Key);
+  std::unique_ptr<MemoryBuffer> loadCacheEntry(StringRef Key);
+  void storeCacheEntry(StringRef Key, MemoryBufferRef Object);
+  void pruneCache();
+  bool compileCached(StringRef Key, CompileFnTy Compile,
+                     std::vector<std::unique_ptr<MemoryBuffer>> &Objects,
+                     std::string &errMsg);
+
   void applyScopeRestrictions();
   void applyRestriction(GlobalValue &GV, ArrayRef<StringRef> Libcalls,
                         std::vector<const char *> &MustPreserveList,
@@ -169,8 +240,16 @@ private:
   std::string MCpu;
   std::string MAttr;
   std::string NativeObjectPath;
+  std::string FeatureStr;
   TargetOptions Options;
+  Reloc::Model RelocModel = Reloc::Default;
+  CodeGenOpt::Level CGOptLevel = CodeGenOpt::Default;
   unsigned OptLevel = 2;
+  unsigned CodeGenJobs = 1;
+  std::string CacheDir;
+  int CachePruningInterval = 1200;
+  unsigned CacheEntryExpiration = 7 * 24 * 3600;
+  uint64_t MaxCacheSize = 0;
   lto_diagnostic_handler_t DiagHandler = nullptr;
   void *DiagContext = nullptr;
   LTOModule *OwnedModule = nullptr;
@@ -691,12 +691,18 @@ private:
                                const MCAsmLayout &Layout) const;
 
   /// \brief Perform one layout iteration and return true if any offsets
-  /// were adjusted.
-  bool layoutOnce(MCAsmLayout &Layout);
-
-  /// \brief Perform one layout iteration of the given section and return true
-  /// if any offsets were adjusted.
-  bool layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec);
+  /// were adjusted. Sections in \p FinalSections are skipped, and sections
+  /// whose layout can not change anymore are added to it.
+  bool layoutOnce(MCAsmLayout &Layout,
+                  SmallPtrSetImpl<const MCSection *> &FinalSections);
+
+  /// \brief Relax the given section until its layout stops changing and
+  /// return true if any offsets were adjusted. \p IsFinal is set if the
+  /// layout of the section does not depend on other sections.
+  bool relaxSection(MCAsmLayout &Layout, MCSection &Sec, bool &IsFinal);
+
+  /// \brief Relax a single fragment and return true if its size changed.
+  bool relaxFragment(MCAsmLayout &Layout, MCFragment &F);
 
   bool relaxInstruction(MCAsmLayout &Layout, MCRelaxableFragment &IF);
 
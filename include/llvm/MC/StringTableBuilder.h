@@ -20,6 +20,7 @@ namespace llvm {
 class StringTableBuilder {
   SmallString<256> StringTable;
   StringMap<size_t> StringIndexMap;
+  bool Finalized = false;
 
 public:
   /// \brief Add a string to the builder. Returns a StringRef to the internal
@@ -32,11 +33,16 @@ public:
   enum Kind {
     ELF,
     WinCOFF,
-    MachO
+    MachO,
+    RAW
   };
 
   /// \brief Analyze the strings and build the final table. No more strings can
   /// be added after this point.
+  ///
+  /// A RAW table has no header, padding or terminators; the strings are laid
+  /// out as added, so they should carry their own terminators if the reader
+  /// needs one.
   void finalize(Kind kind);
 
   /// \brief Retrieve the string table data. Can only be used after the table
@@ -50,15 +56,16 @@ public:
   /// after the table is finalized.
   size_t getOffset(StringRef s) {
     assert(isFinalized());
-    assert(StringIndexMap.count(s) && "String is not in table!");
-    return StringIndexMap[s];
+    auto I = StringIndexMap.find(s);
+    assert(I != StringIndexMap.end() && "String is not in table!");
+    return I->second;
   }
 
   void clear();
 
 private:
   bool isFinalized() {
-    return !StringTable.empty();
+    return Finalized;
   }
 };
 
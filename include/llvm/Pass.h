@@ -304,6 +304,19 @@ public:
   ///
   virtual bool runOnFunction(Function &F) = 0;
 
+  /// createParallelCopy - Return a new, unscheduled instance of this pass if
+  /// it may run on several functions of a module at the same time, or null
+  /// otherwise. The function pass manager only runs a sequence of passes on
+  /// several threads when all of them provide a copy.
+  ///
+  /// A pass that opts in must only touch the function it runs on: it must
+  /// not create or delete globals, walk the use lists of constants or
+  /// globals, or keep state across runOnFunction calls outside of the
+  /// analysis results that it provides. It must only use analyses that it
+  /// declares as required. The copies don't get doInitialization or
+  /// doFinalization calls.
+  virtual FunctionPass *createParallelCopy() const { return nullptr; }
+
   void assignPassManager(PMStack &PMS, PassManagerType T) override;
 
   ///  Return what kind of Pass Manager can manage this pass.
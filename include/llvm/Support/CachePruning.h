@@ -0,0 +1,77 @@
+//=- CachePruning.h - Helper to manage the pruning of a cache dir -*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements pruning of a directory intended for cache storage, using
+// various policies.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_CACHE_PRUNING_H
+#define LLVM_SUPPORT_CACHE_PRUNING_H
+
+#include "llvm/ADT/StringRef.h"
+#include <string>
+
+namespace llvm {
+
+/// Handle pruning a directory provided a path and some options to control what
+/// to prune.
+///
+/// Only the files whose name starts with "llvmcache-" are considered to be
+/// cache entries; anything else in the directory is left alone.
+class CachePruning {
+public:
+  /// Prepare to prune \p Path.
+  CachePruning(StringRef Path) : Path(Path) {}
+
+  /// Define the pruning interval. This is intended to be used to avoid scanning
+  /// the directory too often. It does not impact the decision of which file to
+  /// prune. A value of 0 forces the scan to occurs. A negative value disables
+  /// pruning.
+  CachePruning &setPruningInterval(int PruningInterval) {
+    Interval = PruningInterval;
+    return *this;
+  }
+
+  /// Define the expiration for a file. When a file hasn't been used (as
+  /// recorded by its modification time) for \p ExpireAfter seconds, it is
+  /// removed from the cache. A value of 0 disables the expiration-based
+  /// pruning.
+  CachePruning &setEntryExpiration(unsigned ExpireAfter) {
+    Expiration = ExpireAfter;
+    return *this;
+  }
+
+  /// Define the maximum total size in bytes of the cache entries. When it is
+  /// exceeded, the least recently used entries are removed until the cache
+  /// fits. A value of 0 disables the size-based pruning.
+  CachePruning &setMaxSize(uint64_t MaxSizeInBytes) {
+    MaxSize = MaxSizeInBytes;
+    return *this;
+  }
+
+  /// Peform pruning using the supplied options, returns true if pruning
+  /// occured, i.e. if PruningInterval was expired.
+  bool prune();
+
+  /// Record that the cache entry at \p EntryPath was just used, so that it is
+  /// pruned last.
+  static void touchEntry(StringRef EntryPath);
+
+private:
+  // Options that matches the setters above.
+  std::string Path;
+  unsigned Expiration = 0;
+  int Interval = 0;
+  uint64_t MaxSize = 0;
+};
+
+} // namespace llvm
+
+#endif
@@ -43,6 +43,18 @@ bool isAvailable();
 Status compress(StringRef InputBuffer, SmallVectorImpl<char> &CompressedBuffer,
                 CompressionLevel Level = DefaultCompression);
 
+/// Compress \p InputBuffer into a single zlib stream, deflating blocks of
+/// \p BlockSize bytes on up to \p NumThreads threads (0 means one per
+/// hardware thread). Each block is primed with the 32 KiB of input before it,
+/// so the result is nearly as small as that of compress(). The output depends
+/// on \p BlockSize but not on \p NumThreads, and an input no larger than one
+/// block compresses to the same bytes as with compress().
+Status compressInBlocks(StringRef InputBuffer,
+                        SmallVectorImpl<char> &CompressedBuffer,
+                        CompressionLevel Level = DefaultCompression,
+                        size_t BlockSize = 128 * 1024,
+                        unsigned NumThreads = 0);
+
 Status uncompress(StringRef InputBuffer,
                   SmallVectorImpl<char> &UncompressedBuffer,
                   size_t UncompressedSize);
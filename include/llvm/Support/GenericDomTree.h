@@ -18,6 +18,7 @@
 #ifndef LLVM_SUPPORT_GENERICDOMTREE_H
 #define LLVM_SUPPORT_GENERICDOMTREE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -27,9 +28,16 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <queue>
 
 namespace llvm {
 
+/// \brief Whether dominator trees are built with the Semi-NCA algorithm rather
+/// than with Lengauer-Tarjan. Both give the same trees, but Semi-NCA takes
+/// quadratic time on some graphs, such as ladders, so it is off by default;
+/// this is controlled by the -dom-tree-semi-nca option.
+extern bool DomTreeUseSemiNCA;
+
 /// \brief Base class that other, more interesting dominator analyses
 /// inherit from.
 template <class NodeT> class DominatorBase {
@@ -70,6 +78,7 @@ template <class NodeT> class DomTreeNodeBase {
   NodeT *TheBB;
   DomTreeNodeBase<NodeT> *IDom;
   std::vector<DomTreeNodeBase<NodeT> *> Children;
+  unsigned Level;
   mutable int DFSNumIn, DFSNumOut;
 
   template <class N> friend class DominatorTreeBase;
@@ -92,7 +101,8 @@ public:
   }
 
   DomTreeNodeBase(NodeT *BB, DomTreeNodeBase<NodeT> *iDom)
-      : TheBB(BB), IDom(iDom), DFSNumIn(-1), DFSNumOut(-1) {}
+      : TheBB(BB), IDom(iDom), Level(iDom ? iDom->Level + 1 : 0),
+        DFSNumIn(-1), DFSNumOut(-1) {}
 
   std::unique_ptr<DomTreeNodeBase<NodeT>>
   addChild(std::unique_ptr<DomTreeNodeBase<NodeT>> C) {
@@ -102,6 +112,10 @@ public:
 
   size_t getNumChildren() const { return Children.size(); }
 
+  /// getLevel - Return the depth of this node in the tree, the root being at
+  /// level 0.
+  unsigned getLevel() const { return Level; }
+
   void clearAllChildren() { Children.clear(); }
 
   bool compare(const DomTreeNodeBase<NodeT> *Other) const {
@@ -135,6 +149,7 @@ public:
       // Switch to new dominator
       IDom = NewIDom;
       IDom->Children.push_back(this);
+      updateLevels();
     }
   }
 
@@ -150,6 +165,22 @@ private:
     return this->DFSNumIn >= other->DFSNumIn &&
            this->DFSNumOut <= other->DFSNumOut;
   }
+
+  // Recompute the level of this node and of the nodes below it after the
+  // immediate dominator changed.
+  void updateLevels() {
+    if (Level == IDom->Level + 1)
+      return;
+    SmallVector<DomTreeNodeBase<NodeT> *, 16> WorkStack;
+    WorkStack.push_back(this);
+    while (!WorkStack.empty()) {
+      DomTreeNodeBase<NodeT> *Current = WorkStack.pop_back_val();
+      Current->Level = Current->IDom->Level + 1;
+      for (DomTreeNodeBase<NodeT> *Child : Current->Children)
+        if (Child->Level != Current->Level + 1)
+          WorkStack.push_back(Child);
+    }
+  }
 };
 
 template <class NodeT>
@@ -174,10 +205,14 @@ void PrintDomTree(const DomTreeNodeBase<NodeT> *N, raw_ostream &o,
     PrintDomTree<NodeT>(*I, o, Lev + 1);
 }
 
-// The calculate routine is provided in a separate header but referenced here.
+// The calculate routines are provided in a separate header but referenced
+// here.
 template <class FuncT, class N>
 void Calculate(DominatorTreeBase<typename GraphTraits<N>::NodeType> &DT,
                FuncT &F);
+template <class FuncT, class N>
+void CalculateSemiNCA(DominatorTreeBase<typename GraphTraits<N>::NodeType> &DT,
+                      FuncT &F);
 
 /// \brief Core dominator tree base class.
 ///
@@ -608,6 +643,74 @@ public:
       this->Split<NodeT *, GraphTraits<NodeT *>>(*this, NewBB);
   }
 
+  /// \brief The kind of change made to an edge, for applyUpdates.
+  enum UpdateKind { Insert, Delete };
+
+  /// \brief An edge from \p From to \p To that was inserted into or deleted
+  /// from the graph.
+  struct UpdateType {
+    UpdateKind Kind;
+    NodeT *From;
+    NodeT *To;
+
+    UpdateType(UpdateKind Kind, NodeT *From, NodeT *To)
+        : Kind(Kind), From(From), To(To) {}
+  };
+
+  /// insertEdge - Update the tree after the edge From->To was added to the
+  /// graph. To may be a new block, or one that was unreachable, in which case
+  /// the blocks that it makes reachable are added to the tree.
+  void insertEdge(NodeT *From, NodeT *To) {
+    applyUpdates(UpdateType(Insert, From, To));
+  }
+
+  /// deleteEdge - Update the tree after the edge From->To was removed from the
+  /// graph. The blocks that it leaves unreachable are removed from the tree.
+  void deleteEdge(NodeT *From, NodeT *To) {
+    applyUpdates(UpdateType(Delete, From, To));
+  }
+
+  /// applyUpdates - Update the tree after the edges in Updates were inserted
+  /// into or deleted from the graph, which must have no other changes since
+  /// the tree was last up to date. Each edge must be listed at most once, and
+  /// deleted edges must not appear twice in the original graph, as a
+  /// switch to the same block on two values does.
+  ///
+  /// Only the part of the tree below the nearest common dominator of the ends
+  /// of an edge is visited. A post-dominator tree is recalculated when the
+  /// set of exit blocks changes.
+  void applyUpdates(ArrayRef<UpdateType> Updates) {
+    // Each update is applied to the graph as it was before the updates after
+    // it were made, which getTreeChildren obtains by undoing those updates.
+    PendingUpdates Pending;
+    for (const UpdateType &U : Updates) {
+      std::pair<NodeT *, NodeT *> Edge = getTreeEdge(U);
+      Pending.Children[Edge.first].push_back(
+          std::make_pair(Edge.second, U.Kind));
+      Pending.Parents[Edge.second].push_back(
+          std::make_pair(Edge.first, U.Kind));
+    }
+
+    for (const UpdateType &U : Updates) {
+      std::pair<NodeT *, NodeT *> Edge = getTreeEdge(U);
+      removePending(Pending.Children[Edge.first], Edge.second, U.Kind);
+      removePending(Pending.Parents[Edge.second], Edge.first, U.Kind);
+
+      // Adding a successor to an exit block or removing the last one changes
+      // the roots of a post-dominator tree, which is rebuilt instead. The graph
+      // is then final, so there is nothing more to do.
+      if (this->IsPostDominators && changesRoots(U, Pending)) {
+        recalculate(*U.From->getParent());
+        return;
+      }
+
+      if (U.Kind == Insert)
+        insertTreeEdge(Edge.first, Edge.second, Pending);
+      else
+        deleteTreeEdge(Edge.first, Edge.second, Pending);
+    }
+  }
+
   /// print - Convert to human readable form
   ///
   void print(raw_ostream &o) const {
@@ -639,6 +742,11 @@ protected:
   friend void
   Calculate(DominatorTreeBase<typename GraphTraits<N>::NodeType> &DT, FuncT &F);
 
+  template <class FuncT, class N>
+  friend void
+  CalculateSemiNCA(DominatorTreeBase<typename GraphTraits<N>::NodeType> &DT,
+                   FuncT &F);
+
 
   DomTreeNodeBase<NodeT> *getNodeForBlock(NodeT *BB) {
     if (DomTreeNodeBase<NodeT> *Node = getNode(BB))
@@ -661,6 +769,425 @@ protected:
 
   void addRoot(NodeT *BB) { this->Roots.push_back(BB); }
 
+  //===--------------------------------------------------------------------===//
+  // Incremental updates, after "An Experimental Study of Dynamic Dominators"
+  // by Georgiadis et al. Everything here works on edges in the direction of
+  // the tree: for post-dominators, from the successor to the predecessor.
+
+  typedef SmallVector<std::pair<NodeT *, UpdateKind>, 4> PendingEdgeList;
+
+  // The edges of the updates that were not applied yet, by the node they start
+  // at and by the node they end at.
+  struct PendingUpdates {
+    DenseMap<NodeT *, PendingEdgeList> Children;
+    DenseMap<NodeT *, PendingEdgeList> Parents;
+  };
+
+  std::pair<NodeT *, NodeT *> getTreeEdge(const UpdateType &U) const {
+    if (this->IsPostDominators)
+      return std::make_pair(U.To, U.From);
+    return std::make_pair(U.From, U.To);
+  }
+
+  static void removePending(PendingEdgeList &List, NodeT *N, UpdateKind Kind) {
+    auto I = std::find(List.begin(), List.end(), std::make_pair(N, Kind));
+    assert(I != List.end() && "Update is not pending!");
+    List.erase(I);
+  }
+
+  // Get the children of N in the direction of the tree, or its parents if
+  // Reverse, in the graph as it was before the pending updates. The virtual
+  // root of a post-dominator tree is the null node, whose children are the
+  // exit blocks.
+  void getTreeChildren(NodeT *N, const PendingUpdates &Pending, bool Reverse,
+                       SmallVectorImpl<NodeT *> &Result) const {
+    Result.clear();
+    if (!N) {
+      assert(!Reverse && "The virtual root has no parents!");
+      Result.append(this->Roots.begin(), this->Roots.end());
+      return;
+    }
+    if (this->IsPostDominators == Reverse) {
+      typedef GraphTraits<NodeT *> Traits;
+      Result.append(Traits::child_begin(N), Traits::child_end(N));
+    } else {
+      typedef GraphTraits<Inverse<NodeT *>> Traits;
+      Result.append(Traits::child_begin(N), Traits::child_end(N));
+    }
+
+    const DenseMap<NodeT *, PendingEdgeList> &Edges =
+        Reverse ? Pending.Parents : Pending.Children;
+    auto I = Edges.find(N);
+    if (I == Edges.end())
+      return;
+    for (const auto &Edge : I->second) {
+      if (Edge.second == Delete) {
+        Result.push_back(Edge.first);
+        continue;
+      }
+      auto Inserted = std::find(Result.begin(), Result.end(), Edge.first);
+      if (Inserted != Result.end())
+        Result.erase(Inserted);
+    }
+  }
+
+  // Return true if U makes a block an exit block or stops it from being one,
+  // or connects a new exit block to the graph.
+  bool changesRoots(const UpdateType &U, const PendingUpdates &Pending) const {
+    SmallVector<NodeT *, 8> Succs;
+    if (U.Kind == Delete) {
+      getTreeChildren(U.From, Pending, /*Reverse=*/true, Succs);
+      return Succs.empty();
+    }
+    if (std::find(this->Roots.begin(), this->Roots.end(), U.From) !=
+        this->Roots.end())
+      return true;
+    if (getNode(U.To))
+      return false;
+    getTreeChildren(U.To, Pending, /*Reverse=*/true, Succs);
+    return Succs.empty();
+  }
+
+  static DomTreeNodeBase<NodeT> *findNCDNode(DomTreeNodeBase<NodeT> *A,
+                                             DomTreeNodeBase<NodeT> *B) {
+    while (A != B) {
+      if (A->getLevel() < B->getLevel())
+        std::swap(A, B);
+      A = A->getIDom();
+    }
+    return A;
+  }
+
+  // The state of a Semi-NCA run over a part of the graph. Nodes are numbered
+  // from 1 in DFS order.
+  struct SemiNCAInfo {
+    struct NodeInfo {
+      unsigned DFSNum;
+      unsigned Parent;
+      unsigned Semi;
+      NodeT *Label;
+      NodeT *IDom;
+      SmallVector<NodeT *, 2> ReverseChildren;
+
+      NodeInfo()
+          : DFSNum(0), Parent(0), Semi(0), Label(nullptr), IDom(nullptr) {}
+    };
+
+    std::vector<NodeT *> NumToNode;
+    DenseMap<NodeT *, NodeInfo> NodeToInfo;
+
+    SemiNCAInfo() : NumToNode(1, nullptr) {}
+  };
+
+  // Number the nodes reachable from Root, going into a node only if
+  // Descend(From, To) returns true for an edge leading to it.
+  template <typename DescendFn>
+  void runDFS(SemiNCAInfo &S, NodeT *Root, const PendingUpdates &Pending,
+              DescendFn Descend) const {
+    SmallVector<NodeT *, 32> WorkList;
+    SmallVector<NodeT *, 8> Children;
+    WorkList.push_back(Root);
+    while (!WorkList.empty()) {
+      NodeT *BB = WorkList.pop_back_val();
+      unsigned BBNum = S.NumToNode.size();
+      {
+        auto &BBInfo = S.NodeToInfo[BB];
+        if (BBInfo.DFSNum != 0)
+          continue;
+        BBInfo.DFSNum = BBInfo.Semi = BBNum;
+        BBInfo.Label = BB;
+      }
+      S.NumToNode.push_back(BB);
+
+      getTreeChildren(BB, Pending, /*Reverse=*/false, Children);
+      for (NodeT *Succ : Children) {
+        auto SI = S.NodeToInfo.find(Succ);
+        if (SI != S.NodeToInfo.end() && SI->second.DFSNum != 0) {
+          if (Succ != BB)
+            SI->second.ReverseChildren.push_back(BB);
+          continue;
+        }
+        if (!Descend(BB, Succ))
+          continue;
+        auto &SuccInfo = S.NodeToInfo[Succ];
+        SuccInfo.Parent = BBNum;
+        SuccInfo.ReverseChildren.push_back(BB);
+        WorkList.push_back(Succ);
+      }
+    }
+  }
+
+  // Find the node with the smallest semidominator on the path from V to the
+  // root of its tree in the forest of the nodes numbered LastLinked or more,
+  // compressing the path.
+  static NodeT *
+  eval(SemiNCAInfo &S, NodeT *V, unsigned LastLinked,
+       SmallVectorImpl<typename SemiNCAInfo::NodeInfo *> &Stack) {
+    auto *VInfo = &S.NodeToInfo[V];
+    if (VInfo->Parent < LastLinked)
+      return VInfo->Label;
+
+    do {
+      Stack.push_back(VInfo);
+      VInfo = &S.NodeToInfo[S.NumToNode[VInfo->Parent]];
+    } while (VInfo->Parent >= LastLinked);
+
+    const auto *PInfo = VInfo;
+    const auto *PLabelInfo = &S.NodeToInfo[PInfo->Label];
+    do {
+      VInfo = Stack.pop_back_val();
+      VInfo->Parent = PInfo->Parent;
+      const auto *VLabelInfo = &S.NodeToInfo[VInfo->Label];
+      if (PLabelInfo->Semi < VLabelInfo->Semi)
+        VInfo->Label = PInfo->Label;
+      else
+        PLabelInfo = VLabelInfo;
+      PInfo = VInfo;
+    } while (!Stack.empty());
+    return VInfo->Label;
+  }
+
+  // Compute the immediate dominators of the nodes numbered by runDFS, relative
+  // to the part of the graph it visited.
+  static void runSemiNCA(SemiNCAInfo &S) {
+    unsigned NumNodes = S.NumToNode.size();
+    for (unsigned i = 1; i < NumNodes; ++i) {
+      auto &VInfo = S.NodeToInfo[S.NumToNode[i]];
+      VInfo.IDom = S.NumToNode[VInfo.Parent];
+    }
+
+    SmallVector<typename SemiNCAInfo::NodeInfo *, 32> EvalStack;
+    for (unsigned i = NumNodes - 1; i >= 2; --i) {
+      auto &WInfo = S.NodeToInfo[S.NumToNode[i]];
+      WInfo.Semi = WInfo.Parent;
+      for (NodeT *V : WInfo.ReverseChildren) {
+        unsigned SemiU = S.NodeToInfo[eval(S, V, i + 1, EvalStack)].Semi;
+        if (SemiU < WInfo.Semi)
+          WInfo.Semi = SemiU;
+      }
+    }
+
+    for (unsigned i = 2; i < NumNodes; ++i) {
+      auto &WInfo = S.NodeToInfo[S.NumToNode[i]];
+      NodeT *WIDomCandidate = WInfo.IDom;
+      while (S.NodeToInfo[WIDomCandidate].DFSNum > WInfo.Semi)
+        WIDomCandidate = S.NodeToInfo[WIDomCandidate].IDom;
+      WInfo.IDom = WIDomCandidate;
+    }
+  }
+
+  // Give the nodes below the root of a Semi-NCA run their new immediate
+  // dominators.
+  void reattachExistingSubtree(SemiNCAInfo &S) {
+    for (unsigned i = 2, e = S.NumToNode.size(); i < e; ++i) {
+      NodeT *N = S.NumToNode[i];
+      getNode(N)->setIDom(getNode(S.NodeToInfo[N].IDom));
+    }
+  }
+
+  void insertTreeEdge(NodeT *From, NodeT *To, const PendingUpdates &Pending) {
+    DomTreeNodeBase<NodeT> *FromTN = getNode(From);
+    // An edge out of an unreachable block changes nothing.
+    if (!FromTN)
+      return;
+    DFSInfoValid = false;
+    if (DomTreeNodeBase<NodeT> *ToTN = getNode(To))
+      insertReachable(FromTN, ToTN, Pending);
+    else
+      insertUnreachable(FromTN, To, Pending);
+  }
+
+  void insertReachable(DomTreeNodeBase<NodeT> *FromTN,
+                       DomTreeNodeBase<NodeT> *ToTN,
+                       const PendingUpdates &Pending) {
+    // The nodes whose immediate dominator changes are those below the nearest
+    // common dominator NCD that have a path from To on which no node is
+    // shallower than they are. Their new immediate dominator is NCD. Find them
+    // from the deepest up, going through the deeper nodes that lead to them.
+    DomTreeNodeBase<NodeT> *NCD = findNCDNode(FromTN, ToTN);
+    unsigned NCDLevel = NCD->getLevel();
+    if (NCDLevel + 1 >= ToTN->getLevel())
+      return;
+
+    // The bucket queue orders the nodes by level, then by when they were
+    // found, so that the children of NCD end up in a deterministic order.
+    std::vector<DomTreeNodeBase<NodeT> *> Found;
+    std::priority_queue<std::pair<unsigned, unsigned>> Bucket;
+    SmallPtrSet<DomTreeNodeBase<NodeT> *, 16> Visited;
+    SmallVector<DomTreeNodeBase<NodeT> *, 16> Affected;
+    SmallVector<DomTreeNodeBase<NodeT> *, 8> UnaffectedOnCurrentLevel;
+    SmallVector<NodeT *, 8> Children;
+
+    Found.push_back(ToTN);
+    Bucket.push(std::make_pair(ToTN->getLevel(), 0));
+    Visited.insert(ToTN);
+    while (!Bucket.empty()) {
+      DomTreeNodeBase<NodeT> *TN = Found[Bucket.top().second];
+      Bucket.pop();
+      Affected.push_back(TN);
+
+      unsigned CurrentLevel = TN->getLevel();
+      while (true) {
+        getTreeChildren(TN->getBlock(), Pending, /*Reverse=*/false, Children);
+        for (NodeT *Succ : Children) {
+          DomTreeNodeBase<NodeT> *SuccTN = getNode(Succ);
+          assert(SuccTN && "Unreachable successor of a reachable node!");
+          unsigned SuccLevel = SuccTN->getLevel();
+          if (SuccLevel <= NCDLevel + 1 || !Visited.insert(SuccTN).second)
+            continue;
+
+          if (SuccLevel > CurrentLevel) {
+            // Succ keeps its immediate dominator, but may lead to nodes that
+            // don't.
+            UnaffectedOnCurrentLevel.push_back(SuccTN);
+          } else {
+            Bucket.push(std::make_pair(SuccLevel, Found.size()));
+            Found.push_back(SuccTN);
+          }
+        }
+
+        if (UnaffectedOnCurrentLevel.empty())
+          break;
+        TN = UnaffectedOnCurrentLevel.pop_back_val();
+      }
+    }
+
+    for (DomTreeNodeBase<NodeT> *TN : Affected)
+      TN->setIDom(NCD);
+  }
+
+  void insertUnreachable(DomTreeNodeBase<NodeT> *FromTN, NodeT *To,
+                         const PendingUpdates &Pending) {
+    // Build the tree of the blocks that To makes reachable, which they can
+    // only be reached through To, and hang it below From. Then add the edges
+    // from them to the blocks that were already reachable.
+    SmallVector<std::pair<NodeT *, NodeT *>, 8> EdgesToReachable;
+    SemiNCAInfo S;
+    runDFS(S, To, Pending, [&](NodeT *BB, NodeT *Succ) {
+      if (!getNode(Succ))
+        return true;
+      EdgesToReachable.push_back(std::make_pair(BB, Succ));
+      return false;
+    });
+    runSemiNCA(S);
+
+    for (unsigned i = 1, e = S.NumToNode.size(); i < e; ++i) {
+      NodeT *N = S.NumToNode[i];
+      DomTreeNodeBase<NodeT> *IDomNode =
+          i == 1 ? FromTN : getNode(S.NodeToInfo[N].IDom);
+      DomTreeNodes[N] = IDomNode->addChild(
+          llvm::make_unique<DomTreeNodeBase<NodeT>>(N, IDomNode));
+    }
+
+    for (const auto &Edge : EdgesToReachable)
+      insertReachable(getNode(Edge.first), getNode(Edge.second), Pending);
+  }
+
+  void deleteTreeEdge(NodeT *From, NodeT *To, const PendingUpdates &Pending) {
+    DomTreeNodeBase<NodeT> *FromTN = getNode(From);
+    DomTreeNodeBase<NodeT> *ToTN = getNode(To);
+    if (!FromTN || !ToTN)
+      return;
+
+    // The blocks may still be connected by another edge.
+    SmallVector<NodeT *, 8> Children;
+    getTreeChildren(From, Pending, /*Reverse=*/false, Children);
+    if (std::find(Children.begin(), Children.end(), To) != Children.end())
+      return;
+
+    // Nothing changes if To dominates From.
+    if (findNCDNode(FromTN, ToTN) == ToTN)
+      return;
+
+    DFSInfoValid = false;
+    if (ToTN->getIDom() != FromTN || hasProperSupport(ToTN, Pending))
+      deleteReachable(FromTN, ToTN, Pending);
+    else
+      deleteUnreachable(ToTN, Pending);
+  }
+
+  // Return true if TN has a parent in the graph that it doesn't dominate, so
+  // that it is still reachable.
+  bool hasProperSupport(DomTreeNodeBase<NodeT> *TN,
+                        const PendingUpdates &Pending) {
+    SmallVector<NodeT *, 8> Parents;
+    getTreeChildren(TN->getBlock(), Pending, /*Reverse=*/true, Parents);
+    for (NodeT *Parent : Parents) {
+      DomTreeNodeBase<NodeT> *ParentTN = getNode(Parent);
+      if (ParentTN && findNCDNode(TN, ParentTN) != TN)
+        return true;
+    }
+    return false;
+  }
+
+  void deleteReachable(DomTreeNodeBase<NodeT> *FromTN,
+                       DomTreeNodeBase<NodeT> *ToTN,
+                       const PendingUpdates &Pending) {
+    // Only the nodes below the nearest common dominator of From and To can
+    // change, and the paths to them from it don't leave its subtree, so
+    // recompute that subtree.
+    DomTreeNodeBase<NodeT> *NCD = findNCDNode(FromTN, ToTN);
+    unsigned Level = NCD->getLevel();
+    SemiNCAInfo S;
+    runDFS(S, NCD->getBlock(), Pending, [&](NodeT *, NodeT *Succ) {
+      DomTreeNodeBase<NodeT> *SuccTN = getNode(Succ);
+      return SuccTN && SuccTN->getLevel() > Level;
+    });
+    runSemiNCA(S);
+    reattachExistingSubtree(S);
+  }
+
+  void deleteUnreachable(DomTreeNodeBase<NodeT> *ToTN,
+                         const PendingUpdates &Pending) {
+    // To and the nodes it dominates are now unreachable. Collect them, and the
+    // other nodes they lead to, which may have lost paths.
+    unsigned Level = ToTN->getLevel();
+    SmallVector<NodeT *, 16> Affected;
+    SemiNCAInfo S;
+    runDFS(S, ToTN->getBlock(), Pending, [&](NodeT *, NodeT *Succ) {
+      DomTreeNodeBase<NodeT> *SuccTN = getNode(Succ);
+      if (!SuccTN)
+        return false;
+      if (SuccTN->getLevel() > Level)
+        return true;
+      if (std::find(Affected.begin(), Affected.end(), Succ) == Affected.end())
+        Affected.push_back(Succ);
+      return false;
+    });
+
+    // The subtree to recompute is that of the shallowest nearest common
+    // dominator of To and an affected node that doesn't dominate To.
+    DomTreeNodeBase<NodeT> *MinNode = ToTN;
+    for (NodeT *N : Affected) {
+      DomTreeNodeBase<NodeT> *TN = getNode(N);
+      DomTreeNodeBase<NodeT> *NCD = findNCDNode(TN, ToTN);
+      if (NCD != TN && NCD->getLevel() < MinNode->getLevel())
+        MinNode = NCD;
+    }
+
+    // Erase the unreachable nodes, children before their parents.
+    bool RebuildAbove = MinNode != ToTN;
+    for (unsigned i = S.NumToNode.size() - 1; i > 0; --i) {
+      NodeT *N = S.NumToNode[i];
+      DomTreeNodeBase<NodeT> *TN = getNode(N);
+      std::vector<DomTreeNodeBase<NodeT> *> &Siblings = TN->getIDom()->Children;
+      Siblings.erase(std::find(Siblings.begin(), Siblings.end(), TN));
+      DomTreeNodes.erase(N);
+    }
+
+    if (!RebuildAbove)
+      return;
+
+    unsigned MinLevel = MinNode->getLevel();
+    SemiNCAInfo Rebuild;
+    runDFS(Rebuild, MinNode->getBlock(), Pending, [&](NodeT *, NodeT *Succ) {
+      DomTreeNodeBase<NodeT> *SuccTN = getNode(Succ);
+      return SuccTN && SuccTN->getLevel() > MinLevel;
+    });
+    runSemiNCA(Rebuild);
+    reattachExistingSubtree(Rebuild);
+  }
+
 public:
   /// updateDFSNumbers - Assign In and Out numbers to the nodes while walking
   /// dominator tree in dfs order.
@@ -717,12 +1244,16 @@ public:
   template <class FT> void recalculate(FT &F) {
     typedef GraphTraits<FT *> TraitsTy;
     reset();
-    this->Vertex.push_back(nullptr);
 
     if (!this->IsPostDominators) {
       // Initialize root
       NodeT *entry = TraitsTy::getEntryNode(&F);
       this->Roots.push_back(entry);
+      if (DomTreeUseSemiNCA) {
+        CalculateSemiNCA<FT, NodeT *>(*this, F);
+        return;
+      }
+      this->Vertex.push_back(nullptr);
       this->IDoms[entry] = nullptr;
       this->DomTreeNodes[entry] = nullptr;
 
@@ -737,13 +1268,37 @@ public:
 
         // Prepopulate maps so that we don't get iterator invalidation issues
         // later.
-        this->IDoms[I] = nullptr;
+        if (!DomTreeUseSemiNCA)
+          this->IDoms[I] = nullptr;
         this->DomTreeNodes[I] = nullptr;
       }
 
+      if (DomTreeUseSemiNCA) {
+        CalculateSemiNCA<FT, Inverse<NodeT *>>(*this, F);
+        return;
+      }
+      this->Vertex.push_back(nullptr);
       Calculate<FT, Inverse<NodeT *>>(*this, F);
     }
   }
+
+  /// recalculateFromIDoms - rebuild a dominator tree rooted at \p Entry from
+  /// a list of the blocks reachable from it paired with their immediate
+  /// dominators, such as one saved from an earlier tree. Every block must come
+  /// after its immediate dominator in the list.
+  void recalculateFromIDoms(NodeT *Entry,
+                            ArrayRef<std::pair<NodeT *, NodeT *>> IDomList) {
+    assert(!this->IsPostDominators &&
+           "Cannot rebuild post-dominators from a list of idoms!");
+    reset();
+    this->Roots.push_back(Entry);
+    RootNode = (DomTreeNodes[Entry] =
+                    llvm::make_unique<DomTreeNodeBase<NodeT>>(Entry, nullptr))
+                   .get();
+    for (const auto &BlockAndIDom : IDomList)
+      addNewBlock(BlockAndIDom.first, BlockAndIDom.second);
+    updateDFSNumbers();
+  }
 };
 
 // These two functions are declared out of line as a workaround for building
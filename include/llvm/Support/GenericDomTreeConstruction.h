@@ -19,14 +19,27 @@
 /// out that the theoretically slower O(n*log(n)) implementation is actually
 /// faster than the almost-linear O(n*alpha(n)) version, even for large CFGs.
 ///
+/// It also provides the Semi-NCA algorithm described in:
+///
+///   Finding Dominators in Practice
+///   L. Georgiadis, R. E. Tarjan & R. F. Werneck, JGAA 10(1) 2006, pgs 69-94.
+///
+/// which computes the semidominators the same way, but then finds each
+/// immediate dominator as the nearest common ancestor of its parent and its
+/// semidominator in the tree built so far. CalculateSemiNCA keeps everything
+/// it needs in arrays indexed by DFS number, so it only has to look nodes up
+/// when it follows an edge.
+///
 //===----------------------------------------------------------------------===//
 
 
 #ifndef LLVM_SUPPORT_GENERICDOMTREECONSTRUCTION_H
 #define LLVM_SUPPORT_GENERICDOMTREECONSTRUCTION_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/GenericDomTree.h"
+#include "llvm/Support/MathExtras.h"
 
 namespace llvm {
 
@@ -288,6 +301,188 @@ void Calculate(DominatorTreeBase<typename GraphTraits<NodeT>::NodeType>& DT,
   DT.updateDFSNumbers();
 }
 
+/// DomTreeNodeNumbers - Map from the nodes of a graph to the numbers that
+/// CalculateSemiNCA gives them in DFS order, or 0 for nodes it hasn't reached.
+/// Graphs whose nodes are already numbered densely specialize this to avoid
+/// hashing.
+template <class NodeT> class DomTreeNodeNumbers {
+  DenseMap<NodeT *, unsigned> Numbers;
+
+public:
+  explicit DomTreeNodeNumbers(unsigned NumNodes)
+      : Numbers(NextPowerOf2(NumNodes * 4 / 3 + 1)) {}
+
+  unsigned lookup(NodeT *N) const { return Numbers.lookup(N); }
+  void set(NodeT *N, unsigned Num) { Numbers[N] = Num; }
+};
+
+/// SemiNCAEval - Return the node with the smallest semidominator on the path
+/// from V to the root of its tree in the forest of nodes numbered LastLinked or
+/// more, compressing the path. Ancestor links the nodes of the forest.
+inline unsigned SemiNCAEval(unsigned V, unsigned LastLinked,
+                            std::vector<unsigned> &Ancestor,
+                            std::vector<unsigned> &Label,
+                            const std::vector<unsigned> &Semi,
+                            SmallVectorImpl<unsigned> &Stack) {
+  if (Ancestor[V] < LastLinked)
+    return Label[V];
+
+  do {
+    Stack.push_back(V);
+    V = Ancestor[V];
+  } while (Ancestor[V] >= LastLinked);
+
+  unsigned P = V;
+  unsigned PLabel = Label[P];
+  do {
+    V = Stack.pop_back_val();
+    Ancestor[V] = Ancestor[P];
+    if (Semi[PLabel] < Semi[Label[V]])
+      Label[V] = PLabel;
+    else
+      PLabel = Label[V];
+    P = V;
+  } while (!Stack.empty());
+  return Label[V];
+}
+
+/// CalculateSemiNCA - Build DT with the Semi-NCA algorithm. Finding the
+/// nearest common ancestors takes quadratic time in the worst case (e.g., a
+/// long ladder, where each rung's ancestor walk goes up to the top), but is
+/// faster than Calculate on most graphs.
+template <class FuncT, class NodeT>
+void CalculateSemiNCA(
+    DominatorTreeBase<typename GraphTraits<NodeT>::NodeType> &DT, FuncT &F) {
+  typedef GraphTraits<NodeT> GraphT;
+  typedef GraphTraits<Inverse<NodeT>> InvTraits;
+  typedef typename GraphT::NodeType NodeType;
+
+  unsigned NumBlocks = GraphTraits<FuncT *>::size(&F);
+  DomTreeNodeNumbers<NodeType> NodeToNum(NumBlocks);
+
+  // Everything below is indexed by DFS number. Number 0 is not used, and
+  // number 1 is the virtual root if there are several roots.
+  std::vector<NodeType *> NumToNode(1, nullptr);
+  std::vector<unsigned> Parent(1, 0);
+  NumToNode.reserve(NumBlocks + 2);
+  Parent.reserve(NumBlocks + 2);
+
+  bool MultipleRoots = (DT.Roots.size() > 1);
+  if (MultipleRoots) {
+    NumToNode.push_back(nullptr);
+    Parent.push_back(0);
+  }
+
+  // Step #1: Number the nodes in depth-first order. The order is the same as
+  // DFSPass's, so that the children of each node in the tree come out in the
+  // same order as with Calculate.
+  SmallVector<std::pair<unsigned, typename GraphT::ChildIteratorType>, 32>
+      Worklist;
+  for (NodeType *Root : DT.Roots) {
+    unsigned RootNum = NumToNode.size();
+    NodeToNum.set(Root, RootNum);
+    NumToNode.push_back(Root);
+    Parent.push_back(RootNum > 1 ? 1 : 0);
+    Worklist.push_back(std::make_pair(RootNum, GraphT::child_begin(Root)));
+
+    while (!Worklist.empty()) {
+      unsigned BBNum = Worklist.back().first;
+      typename GraphT::ChildIteratorType &NextSucc = Worklist.back().second;
+      if (NextSucc == GraphT::child_end(NumToNode[BBNum])) {
+        Worklist.pop_back();
+        continue;
+      }
+
+      NodeType *Succ = *NextSucc;
+      ++NextSucc;
+      if (NodeToNum.lookup(Succ))
+        continue;
+
+      unsigned SuccNum = NumToNode.size();
+      NodeToNum.set(Succ, SuccNum);
+      NumToNode.push_back(Succ);
+      Parent.push_back(BBNum);
+      Worklist.push_back(std::make_pair(SuccNum, GraphT::child_begin(Succ)));
+    }
+  }
+  unsigned N = NumToNode.size() - 1;
+
+  // Some blocks might not have been reached (e.g., blocks of infinite loops),
+  // in which case an artificial exit node is required.
+  MultipleRoots |= (DT.isPostDominator() && N != NumBlocks);
+
+  // Step #2: Calculate the semidominators of all vertices, from the last
+  // numbered up. Parent, which IDom starts out as, links the forest that Eval
+  // walks.
+  std::vector<unsigned> IDom(Parent);
+  std::vector<unsigned> Semi(N + 1), Label(N + 1);
+  for (unsigned i = 1; i <= N; ++i)
+    Semi[i] = Label[i] = i;
+
+  SmallVector<unsigned, 32> EvalStack;
+  for (unsigned i = N; i >= 2; --i) {
+    unsigned &WSemi = Semi[i];
+    WSemi = Parent[i];
+    for (typename InvTraits::ChildIteratorType
+             CI = InvTraits::child_begin(NumToNode[i]),
+             E = InvTraits::child_end(NumToNode[i]);
+         CI != E; ++CI) {
+      // Only if this predecessor is reachable!
+      if (unsigned V = NodeToNum.lookup(*CI)) {
+        unsigned SemiU =
+            Semi[SemiNCAEval(V, i + 1, Parent, Label, Semi, EvalStack)];
+        if (SemiU < WSemi)
+          WSemi = SemiU;
+      }
+    }
+  }
+
+  // Step #3: The immediate dominator of each vertex is the nearest common
+  // ancestor of its parent and its semidominator, which is the first vertex
+  // on the parent's dominator tree path that isn't below the semidominator.
+  for (unsigned i = 2; i <= N; ++i) {
+    unsigned WIDom = IDom[i];
+    while (WIDom > Semi[i])
+      WIDom = IDom[WIDom];
+    IDom[i] = WIDom;
+  }
+
+  if (DT.Roots.empty()) return;
+
+  // Add a node for the root.  This node might be the actual root, if there is
+  // one exit block, or it may be the virtual exit (denoted by (BasicBlock *)0)
+  // which postdominates all real exits if there are multiple exit blocks, or
+  // an infinite loop.
+  NodeType *Root = !MultipleRoots ? DT.Roots[0] : nullptr;
+
+  DT.RootNode =
+      (DT.DomTreeNodes[Root] =
+           llvm::make_unique<DomTreeNodeBase<NodeType>>(Root, nullptr)).get();
+
+  // Create the nodes in DFS order, which makes each one's immediate dominator
+  // come first. The exception is a single exit block whose post-dominator tree
+  // has an artificial root anyway, which goes under that root when first used.
+  std::vector<DomTreeNodeBase<NodeType> *> NumToTreeNode(N + 1, nullptr);
+  if (N >= 1 && NumToNode[1] == Root)
+    NumToTreeNode[1] = DT.RootNode;
+  for (unsigned i = 2; i <= N; ++i) {
+    DomTreeNodeBase<NodeType> *&IDomNode = NumToTreeNode[IDom[i]];
+    if (!IDomNode) {
+      assert(IDom[i] == 1 && "Immediate dominator not created yet!");
+      IDomNode = (DT.DomTreeNodes[NumToNode[1]] = DT.RootNode->addChild(
+                      llvm::make_unique<DomTreeNodeBase<NodeType>>(
+                          NumToNode[1], DT.RootNode))).get();
+    }
+
+    NodeType *W = NumToNode[i];
+    NumToTreeNode[i] = (DT.DomTreeNodes[W] = IDomNode->addChild(
+                            llvm::make_unique<DomTreeNodeBase<NodeType>>(
+                                W, IDomNode))).get();
+  }
+
+  DT.updateDFSNumbers();
+}
+
 }
 
 #endif
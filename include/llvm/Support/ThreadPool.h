@@ -0,0 +1,223 @@
+//===-- llvm/Support/ThreadPool.h - A ThreadPool implementation -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a C++11 based thread pool with per-worker task queues and
+// work stealing, and task groups to wait for a subset of its tasks.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Support/thread.h"
+
+#ifdef _MSC_VER
+// concrt.h depends on eh.h for __uncaught_exception declaration
+// even if we disable exceptions.
+#include <eh.h>
+
+// Disable warnings from ppltasks.h transitively included by <future>.
+#pragma warning(push)
+#pragma warning(disable:4530)
+#pragma warning(disable:4062)
+#endif
+
+#include <future>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+class TaskGroup;
+
+/// A ThreadPool for asynchronous parallel execution on a defined number of
+/// threads.
+///
+/// Each worker thread has its own queue of tasks. The tasks that a worker
+/// submits go to its own queue, where it takes the newest one first, and the
+/// ones submitted from other threads are spread over the queues. A worker
+/// whose queue is empty steals the oldest task of another queue, and waits on
+/// a condition variable when there is no task anywhere.
+class ThreadPool {
+public:
+#ifndef _MSC_VER
+  using VoidTy = void;
+  using TaskTy = std::function<void()>;
+  using PackagedTaskTy = std::packaged_task<void()>;
+#else
+  // MSVC 2013 has a bug and can't use std::packaged_task<void()>;
+  // We force it to use bool(bool) instead.
+  using VoidTy = bool;
+  using TaskTy = std::function<bool(bool)>;
+  using PackagedTaskTy = std::packaged_task<bool(bool)>;
+#endif
+
+  /// Construct a pool with the number of core available on the system (or
+  /// whatever the value returned by std::thread::hardware_concurrency() is).
+  ThreadPool();
+
+  /// Construct a pool of \p ThreadCount threads
+  ThreadPool(unsigned ThreadCount);
+
+  /// Blocking destructor: the pool will wait for all the threads to complete.
+  ~ThreadPool();
+
+  /// Asynchronous submission of a task to the pool. The returned future can be
+  /// used to wait for the task to finish and is *non-blocking* on destruction.
+  template <typename Function, typename... Args>
+  inline std::shared_future<VoidTy> async(Function &&F, Args &&... ArgList) {
+    auto Task =
+        std::bind(std::forward<Function>(F), std::forward<Args>(ArgList)...);
+#ifndef _MSC_VER
+    return asyncImpl(std::move(Task));
+#else
+    return asyncImpl([Task] (bool) -> bool {
+      Task();
+      return true;
+    });
+#endif
+  }
+
+  /// Asynchronous submission of a task to the pool. The returned future can be
+  /// used to wait for the task to finish and is *non-blocking* on destruction.
+  template <typename Function>
+  inline std::shared_future<VoidTy> async(Function &&F) {
+#ifndef _MSC_VER
+    return asyncImpl(std::forward<Function>(F));
+#else
+    return asyncImpl([F] (bool) -> bool {
+      F();
+      return true;
+    });
+#endif
+  }
+
+  /// Blocking wait for all the threads to complete and the queue to be empty.
+  /// It is an error to try to add new tasks while blocking on this call, or to
+  /// call it from a task of the pool; wait on a TaskGroup instead.
+  void wait();
+
+  /// Number of worker threads of the pool. When LLVM is built without thread
+  /// support, tasks are run on the calling thread by wait().
+  unsigned getThreadCount() const { return ThreadCount; }
+
+private:
+  friend class TaskGroup;
+
+  /// Asynchronous submission of a task to the pool. The returned future can be
+  /// used to wait for the task to finish and is *non-blocking* on destruction.
+  std::shared_future<VoidTy> asyncImpl(TaskTy F);
+
+  /// Run a task that is waiting for execution on the calling worker thread,
+  /// taking it from its own queue first. Return false if there was none, or if
+  /// the calling thread isn't a worker of the pool.
+  bool runPendingTask();
+
+  /// Run \p Task and signal its completion to wait().
+  void runTask(PackagedTaskTy &Task);
+
+  /// Threads in flight
+  std::vector<llvm::thread> Threads;
+
+#if LLVM_ENABLE_THREADS
+  /// The tasks waiting for execution on a worker thread. The worker pushes
+  /// and pops at the back, and other threads steal from the front.
+  struct WorkerQueue {
+    std::mutex Lock;
+    std::deque<PackagedTaskTy> Tasks;
+  };
+  std::vector<std::unique_ptr<WorkerQueue>> Queues;
+
+  /// Take a task from the queue of worker \p Self, or steal one from another
+  /// queue.
+  bool popTask(unsigned Self, PackagedTaskTy &Task);
+
+  /// The queue that the next task submitted from outside the pool goes to.
+  std::atomic<unsigned> NextQueue;
+
+  /// Number of tasks in the queues. Idle workers sleep on QueueCondition
+  /// until it isn't zero.
+  std::atomic<unsigned> PendingTasks;
+  std::mutex QueueLock;
+  std::condition_variable QueueCondition;
+
+  /// Signal for the destruction of the pool, asking thread to exit.
+  bool EnableFlag;
+#else
+  /// Tasks waiting for execution in the pool.
+  std::queue<PackagedTaskTy> Tasks;
+#endif
+
+  /// Number of tasks submitted and not finished yet.
+  std::atomic<unsigned> UnfinishedTasks;
+
+  /// Locking and signaling for job completion
+  std::mutex CompletionLock;
+  std::condition_variable CompletionCondition;
+
+  unsigned ThreadCount;
+};
+
+/// A set of tasks of a ThreadPool that can be waited for on their own, while
+/// other tasks of the pool run. A task may create a group for the work it
+/// splits off and wait on it: a waiting worker runs tasks of the pool instead
+/// of blocking as long as there are some.
+class TaskGroup {
+public:
+  explicit TaskGroup(ThreadPool &Pool) : Pool(Pool), UnfinishedTasks(0) {}
+
+  /// Blocking destructor: waits for the tasks of the group to complete.
+  ~TaskGroup() { wait(); }
+
+  /// Asynchronous submission of a task of the group to the pool.
+  template <typename Function, typename... Args>
+  inline std::shared_future<ThreadPool::VoidTy> async(Function &&F,
+                                                      Args &&... ArgList) {
+    std::function<void()> Task =
+        std::bind(std::forward<Function>(F), std::forward<Args>(ArgList)...);
+    {
+      std::unique_lock<std::mutex> LockGuard(Lock);
+      ++UnfinishedTasks;
+    }
+    return Pool.async([this, Task] {
+      Task();
+      finishTask();
+    });
+  }
+
+  /// Wait for the tasks of the group, including the ones they submit to the
+  /// group, to complete.
+  void wait();
+
+private:
+  void finishTask();
+
+  ThreadPool &Pool;
+
+  /// Number of tasks of the group that didn't finish yet, and signaling for
+  /// their completion.
+  unsigned UnfinishedTasks;
+  std::mutex Lock;
+  std::condition_variable Condition;
+};
+}
+
+#endif // LLVM_SUPPORT_THREADPOOL_H
@@ -14,6 +14,7 @@
 #ifndef LLVM_TARGET_TARGETMACHINE_H
 #define LLVM_TARGET_TARGETMACHINE_H
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/IR/DataLayout.h"
@@ -21,6 +22,7 @@
 #include "llvm/Support/CodeGen.h"
 #include "llvm/Target/TargetOptions.h"
 #include <cassert>
+#include <memory>
 #include <string>
 
 namespace llvm {
@@ -34,6 +36,7 @@ class MCCodeGenInfo;
 class MCContext;
 class MCInstrInfo;
 class MCRegisterInfo;
+class MCStreamer;
 class MCSubtargetInfo;
 class MCSymbol;
 class Target;
@@ -98,6 +101,13 @@ protected: // Can only create subclasses.
 
   unsigned RequireStructuredCFG : 1;
 
+  /// The number given to the first function code generated, and whether this
+  /// is the last piece. These are set when a module is code generated in
+  /// pieces whose output is joined back together, so that the pieces agree on
+  /// function numbers and emit the start and the end of the file once.
+  unsigned FirstFunctionNumber;
+  bool LastCodeGenPart;
+
 public:
   mutable TargetOptions Options;
 
@@ -149,6 +159,17 @@ public:
   bool requiresStructuredCFG() const { return RequireStructuredCFG; }
   void setRequiresStructuredCFG(bool Value) { RequireStructuredCFG = Value; }
 
+  /// Code generate a piece of a module whose first function is numbered
+  /// \p FirstFunctionNumber. The piece with FirstFunctionNumber == 0 emits the
+  /// directives at the start of the file, and the last piece the global
+  /// variables, the declarations and the directives at the end of the file.
+  void setCodeGenPart(unsigned FirstFunctionNumber, bool IsLast) {
+    this->FirstFunctionNumber = FirstFunctionNumber;
+    LastCodeGenPart = IsLast;
+  }
+  unsigned getFirstFunctionNumber() const { return FirstFunctionNumber; }
+  bool isLastCodeGenPart() const { return LastCodeGenPart; }
+
   /// Returns the code generation relocation model. The choices are static, PIC,
   /// and dynamic-no-pic, and target default.
   Reloc::Model getRelocationModel() const;
@@ -229,6 +250,23 @@ public:
     return true;
   }
 
+  /// Create the streamer that addPassesToEmitFile would emit a file of the
+  /// given type to, using the symbols and sections of the given MCContext.
+  /// Returns null if this file type is not supported.
+  virtual std::unique_ptr<MCStreamer>
+  createMCStreamer(raw_pwrite_stream &, CodeGenFileType, MCContext &);
+
+  /// Add passes to the specified pass manager to get machine code emitted to
+  /// the streamer that \p CreateStreamer returns for the MCContext of the code
+  /// generator. This method returns true if machine code is not supported or
+  /// no streamer was returned, or false on success.
+  virtual bool addPassesToEmitStreamer(
+      PassManagerBase &,
+      function_ref<std::unique_ptr<MCStreamer>(MCContext &)>
+      /*CreateStreamer*/) {
+    return true;
+  }
+
   void getNameWithPrefix(SmallVectorImpl<char> &Name, const GlobalValue *GV,
                          Mangler &Mang, bool MayAlwaysUsePrivate = false) const;
   MCSymbol *getSymbol(const GlobalValue *GV, Mangler &Mang) const;
@@ -271,6 +309,15 @@ public:
   bool addPassesToEmitMC(PassManagerBase &PM, MCContext *&Ctx,
                          raw_pwrite_stream &OS,
                          bool DisableVerify = true) override;
+
+  std::unique_ptr<MCStreamer> createMCStreamer(raw_pwrite_stream &Out,
+                                               CodeGenFileType FileType,
+                                               MCContext &Context) override;
+
+  bool addPassesToEmitStreamer(
+      PassManagerBase &PM,
+      function_ref<std::unique_ptr<MCStreamer>(MCContext &)> CreateStreamer)
+      override;
 };
 
 } // End llvm namespace
@@ -24,6 +24,7 @@ class Pass;
 class Function;
 class BasicBlock;
 class GlobalValue;
+class FunctionInfoIndex;
 
 //===----------------------------------------------------------------------===//
 //
@@ -170,6 +171,12 @@ ModulePass *createBlockExtractorPass();
 /// (prototypes) that are not used.
 ModulePass *createStripDeadPrototypesPass();
 
+//===----------------------------------------------------------------------===//
+/// createFunctionImportPass - This pass imports, as available_externally
+/// definitions, the functions of other modules selected from a function
+/// summary index. If no index is given, it is read from -summary-file.
+ModulePass *createFunctionImportPass(const FunctionInfoIndex *Index = nullptr);
+
 //===----------------------------------------------------------------------===//
 /// createFunctionAttrsPass - This pass discovers functions that do not access
 /// memory, or only read memory, and gives them the readnone/readonly attribute.
@@ -0,0 +1,56 @@
+//===- llvm/Transforms/IPO/FunctionImport.h - ThinLTO importing -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the FunctionImporter, which uses a combined function
+// summary index to pull small function definitions from other modules into
+// the module being compiled, so that they become visible to the inliner.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_IPO_FUNCTIONIMPORT_H
+#define LLVM_TRANSFORMS_IPO_FUNCTIONIMPORT_H
+
+#include "llvm/ADT/StringRef.h"
+#include <functional>
+#include <memory>
+
+namespace llvm {
+
+class FunctionInfoIndex;
+class LLVMContext;
+class Module;
+
+/// The function importer is automatically importing function from other
+/// modules based on the provided summary informations.
+class FunctionImporter {
+public:
+  /// Function used to load a module given its path. The module is expected to
+  /// be lazily loaded in the destination context: only the imported
+  /// functions are materialized.
+  typedef std::function<std::unique_ptr<Module>(StringRef Path)>
+      ModuleLoaderTy;
+
+  FunctionImporter(const FunctionInfoIndex &Index, ModuleLoaderTy ModuleLoader)
+      : Index(Index), ModuleLoader(ModuleLoader) {}
+
+  /// Import functions in Module \p M based on the summary informations.
+  /// Imported definitions get available_externally linkage. Returns true if
+  /// the module was changed.
+  bool importFunctions(Module &M);
+
+private:
+  /// The summaries index used to trigger importing.
+  const FunctionInfoIndex &Index;
+
+  /// Loads the source modules.
+  ModuleLoaderTy ModuleLoader;
+};
+}
+
+#endif // LLVM_TRANSFORMS_IPO_FUNCTIONIMPORT_H
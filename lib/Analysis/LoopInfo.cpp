@@ -679,6 +679,81 @@ LoopInfo LoopAnalysis::run(Function &F, AnalysisManager<Function> *AM) {
   return LI;
 }
 
+static void writeLoop(const Loop *L,
+                      const DenseMap<const BasicBlock *, uint32_t> &Positions,
+                      std::vector<uint32_t> &Data) {
+  Data.push_back(L->getNumBlocks());
+  for (const BasicBlock *BB : L->getBlocks())
+    Data.push_back(Positions.lookup(BB));
+  Data.push_back(L->getSubLoops().size());
+  for (const Loop *SubLoop : L->getSubLoops())
+    writeLoop(SubLoop, Positions, Data);
+}
+
+void LoopAnalysis::writeToCache(Function &F, const LoopInfo &LI,
+                                std::vector<uint32_t> &Data) {
+  DenseMap<const BasicBlock *, uint32_t> Positions;
+  for (BasicBlock &BB : F)
+    Positions.insert(std::make_pair(&BB, Positions.size()));
+
+  Data.push_back(LI.end() - LI.begin());
+  for (const Loop *L : LI)
+    writeLoop(L, Positions, Data);
+}
+
+/// Read the loop at the start of \p Data into \p LI, as a child of \p Parent
+/// or a top level loop, and drop it from \p Data.
+bool LoopAnalysis::readLoop(ArrayRef<uint32_t> &Data,
+                            ArrayRef<BasicBlock *> Blocks, LoopInfo &LI,
+                            Loop *Parent) {
+  if (Data.empty() || Data[0] == 0 || Data.size() - 1 <= Data[0])
+    return false;
+  ArrayRef<uint32_t> LoopBlocks = Data.slice(1, Data[0]);
+  Data = Data.slice(1 + Data[0]);
+  for (uint32_t Block : LoopBlocks)
+    if (Block >= Blocks.size())
+      return false;
+
+  // Hand the loop over to LI or its parent right away so that it is freed if
+  // the data turns out to be invalid later on. Blocks are mapped to the
+  // parent loop before the subloops, which are mapped to them in turn.
+  Loop *L = new Loop(Blocks[LoopBlocks[0]]);
+  if (Parent)
+    Parent->addChildLoop(L);
+  else
+    LI.addTopLevelLoop(L);
+  LI.changeLoopFor(Blocks[LoopBlocks[0]], L);
+  for (uint32_t Block : LoopBlocks.slice(1)) {
+    if (L->contains(Blocks[Block]))
+      return false;
+    L->addBlockEntry(Blocks[Block]);
+    LI.changeLoopFor(Blocks[Block], L);
+  }
+
+  uint32_t NumSubLoops = Data[0];
+  Data = Data.slice(1);
+  for (uint32_t I = 0; I != NumSubLoops; ++I)
+    if (!readLoop(Data, Blocks, LI, L))
+      return false;
+  return true;
+}
+
+bool LoopAnalysis::readFromCache(Function &F, ArrayRef<uint32_t> Data,
+                                 LoopInfo &LI) {
+  std::vector<BasicBlock *> Blocks;
+  for (BasicBlock &BB : F)
+    Blocks.push_back(&BB);
+  if (Data.empty())
+    return false;
+
+  uint32_t NumLoops = Data[0];
+  Data = Data.slice(1);
+  for (uint32_t I = 0; I != NumLoops; ++I)
+    if (!readLoop(Data, Blocks, LI, nullptr))
+      return false;
+  return Data.empty();
+}
+
 PreservedAnalyses LoopPrinterPass::run(Function &F,
                                        AnalysisManager<Function> *AM) {
   AM->getResult<LoopAnalysis>(F).print(OS);
@@ -101,6 +101,12 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumSCEVs, "Number of SCEV expressions created");
+STATISTIC(NumSCEVBytes, "Number of bytes allocated for SCEV expressions");
+STATISTIC(NumBackedgeTakenCountsFlushed,
+          "Number of backedge-taken counts dropped from a full cache");
+STATISTIC(NumExitValuesFlushed,
+          "Number of constant loop exit values dropped from a full cache");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -109,6 +115,18 @@ MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
                                  "derived loop"),
                         cl::init(100));
 
+static cl::opt<unsigned>
+MaxCachedLoops("scalar-evolution-max-cached-loops", cl::Hidden,
+               cl::desc("Maximum number of loops whose backedge-taken counts "
+                        "are kept before the cache is flushed (0 = no limit)"),
+               cl::init(4096));
+
+static cl::opt<unsigned>
+MaxCachedExitValues("scalar-evolution-max-cached-exit-values", cl::Hidden,
+                    cl::desc("Maximum number of constant loop exit values "
+                             "kept before the cache is flushed (0 = no limit)"),
+                    cl::init(4096));
+
 // FIXME: Enable this with XDEBUG when the test suite is clean.
 static cl::opt<bool>
 VerifySCEV("verify-scev",
@@ -4613,7 +4631,9 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // ComputeBackedgeTakenCount may allocate memory for its result. Inserting it
   // into the BackedgeTakenCounts map transfers ownership. Otherwise, the result
   // must be cleared in this scope.
+  ++NumPendingBackedgeTakenCounts;
   BackedgeTakenInfo Result = ComputeBackedgeTakenCount(L);
+  --NumPendingBackedgeTakenCounts;
 
   if (Result.getExact(this) != getCouldNotCompute()) {
     assert(isLoopInvariant(Result.getExact(this), L) &&
@@ -4670,7 +4690,38 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // recusive call to getBackedgeTakenInfo (on a different
   // loop), which would invalidate the iterator computed
   // earlier.
-  return BackedgeTakenCounts.find(L)->second = Result;
+  BackedgeTakenInfo &Cached = BackedgeTakenCounts.find(L)->second = Result;
+
+  // If the cache is full and no other count is being computed, start over
+  // with just this loop. Erasing entries doesn't move the others, so Cached
+  // stays valid.
+  if (MaxCachedLoops && !NumPendingBackedgeTakenCounts &&
+      BackedgeTakenCounts.size() > MaxCachedLoops)
+    flushBackedgeTakenCounts(L);
+
+  if (Cached.hasAnyInfo()) {
+    SmallPtrSet<const SCEV *, 16> Ops;
+    Cached.collectOperands(Ops, this);
+    for (const SCEV *Op : Ops)
+      BackedgeTakenCountUsers[Op].push_back(L);
+  }
+  return Cached;
+}
+
+/// flushBackedgeTakenCounts - Drop all cached backedge-taken counts but the
+/// one of loop Keep, whose users the caller records again.
+void ScalarEvolution::flushBackedgeTakenCounts(const Loop *Keep) {
+  for (DenseMap<const Loop*, BackedgeTakenInfo>::iterator I =
+         BackedgeTakenCounts.begin(), E = BackedgeTakenCounts.end(); I != E; ) {
+    if (I->first == Keep) {
+      ++I;
+      continue;
+    }
+    I->second.clear();
+    BackedgeTakenCounts.erase(I++);
+    ++NumBackedgeTakenCountsFlushed;
+  }
+  BackedgeTakenCountUsers.clear();
 }
 
 /// forgetLoop - This method should be called by the client when it has
@@ -4813,6 +4864,27 @@ bool ScalarEvolution::BackedgeTakenInfo::hasOperand(const SCEV *S,
   return false;
 }
 
+void ScalarEvolution::BackedgeTakenInfo::collectOperands(
+    SmallPtrSetImpl<const SCEV *> &Ops, ScalarEvolution *SE) const {
+  struct OperandCollector {
+    SmallPtrSetImpl<const SCEV *> &Ops;
+    OperandCollector(SmallPtrSetImpl<const SCEV *> &Ops) : Ops(Ops) {}
+    bool follow(const SCEV *S) { return Ops.insert(S).second; }
+    bool isDone() const { return false; }
+  } Collector(Ops);
+
+  if (Max && Max != SE->getCouldNotCompute())
+    visitAll(Max, Collector);
+
+  if (!ExitNotTaken.ExitingBlock)
+    return;
+
+  for (const ExitNotTakenInfo *ENT = &ExitNotTaken;
+       ENT != nullptr; ENT = ENT->getNextExit())
+    if (ENT->ExactNotTaken != SE->getCouldNotCompute())
+      visitAll(ENT->ExactNotTaken, Collector);
+}
+
 /// Allocate memory for BackedgeTakenInfo and copy the not-taken count of each
 /// computable exit into a persistent ExitNotTakenInfo array.
 ScalarEvolution::BackedgeTakenInfo::BackedgeTakenInfo(
@@ -5467,6 +5539,12 @@ ScalarEvolution::getConstantEvolutionLoopExitValue(PHINode *PN,
   if (I != ConstantEvolutionLoopExitValue.end())
     return I->second;
 
+  if (MaxCachedExitValues &&
+      ConstantEvolutionLoopExitValue.size() >= MaxCachedExitValues) {
+    NumExitValuesFlushed += ConstantEvolutionLoopExitValue.size();
+    ConstantEvolutionLoopExitValue.clear();
+  }
+
   if (BEs.ugt(MaxBruteForceIterations))
     return ConstantEvolutionLoopExitValue[PN] = nullptr;  // Not going to evaluate it.
 
@@ -8056,7 +8134,8 @@ ScalarEvolution::SCEVCallbackVH::SCEVCallbackVH(Value *V, ScalarEvolution *se)
 //===----------------------------------------------------------------------===//
 
 ScalarEvolution::ScalarEvolution()
-    : FunctionPass(ID), WalkingBEDominatingConds(false), ValuesAtScopes(64),
+    : FunctionPass(ID), WalkingBEDominatingConds(false),
+      NumPendingBackedgeTakenCounts(0), ValuesAtScopes(64),
       LoopDispositions(64), BlockDispositions(64), FirstUnknown(nullptr) {
   initializeScalarEvolutionPass(*PassRegistry::getPassRegistry());
 }
@@ -8070,7 +8149,26 @@ bool ScalarEvolution::runOnFunction(Function &F) {
   return false;
 }
 
+size_t ScalarEvolution::getMemoryUsage() const {
+  return SCEVAllocator.getTotalMemory() +
+         UniqueSCEVs.capacity() * sizeof(void *) +
+         ValueExprMap.getMemorySize() + BackedgeTakenCounts.getMemorySize() +
+         BackedgeTakenCountUsers.getMemorySize() +
+         ConstantEvolutionLoopExitValue.getMemorySize() +
+         ValuesAtScopes.getMemorySize() + LoopDispositions.getMemorySize() +
+         BlockDispositions.getMemorySize() + UnsignedRanges.getMemorySize() +
+         SignedRanges.getMemorySize();
+}
+
 void ScalarEvolution::releaseMemory() {
+  if (!UniqueSCEVs.empty()) {
+    NumSCEVs += UniqueSCEVs.size();
+    NumSCEVBytes += SCEVAllocator.getTotalMemory();
+    DEBUG(dbgs() << "SCEV: " << F->getName() << " used " << getMemoryUsage()
+                 << " bytes for " << UniqueSCEVs.size() << " expressions and "
+                 << BackedgeTakenCounts.size() << " backedge-taken counts\n");
+  }
+
   // Iterate through all the SCEVUnknown instances and call their
   // destructors, so that they release their references to their values.
   for (SCEVUnknown *U = FirstUnknown; U; U = U->Next)
@@ -8091,6 +8189,7 @@ void ScalarEvolution::releaseMemory() {
   assert(!WalkingBEDominatingConds && "isLoopBackedgeGuardedByCond garbage!");
 
   BackedgeTakenCounts.clear();
+  BackedgeTakenCountUsers.clear();
   ConstantEvolutionLoopExitValue.clear();
   ValuesAtScopes.clear();
   LoopDispositions.clear();
@@ -8433,15 +8532,20 @@ void ScalarEvolution::forgetMemoizedResults(const SCEV *S) {
   UnsignedRanges.erase(S);
   SignedRanges.erase(S);
 
-  for (DenseMap<const Loop*, BackedgeTakenInfo>::iterator I =
-         BackedgeTakenCounts.begin(), E = BackedgeTakenCounts.end(); I != E; ) {
-    BackedgeTakenInfo &BEInfo = I->second;
-    if (BEInfo.hasOperand(S, this)) {
-      BEInfo.clear();
-      BackedgeTakenCounts.erase(I++);
+  // Only the loops listed in BackedgeTakenCountUsers can have a count that
+  // refers to S, but the list may be out of date, so check each of them.
+  auto Users = BackedgeTakenCountUsers.find(S);
+  if (Users == BackedgeTakenCountUsers.end())
+    return;
+  SmallVector<const Loop *, 2> Loops = std::move(Users->second);
+  BackedgeTakenCountUsers.erase(Users);
+  for (const Loop *L : Loops) {
+    DenseMap<const Loop*, BackedgeTakenInfo>::iterator I =
+      BackedgeTakenCounts.find(L);
+    if (I != BackedgeTakenCounts.end() && I->second.hasOperand(S, this)) {
+      I->second.clear();
+      BackedgeTakenCounts.erase(I);
     }
-    else
-      ++I;
   }
 }
 
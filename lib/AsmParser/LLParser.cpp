@@ -19,6 +19,7 @@
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
@@ -4339,6 +4340,13 @@ bool LLParser::ParseFunctionBody(Function &Fn) {
   int FunctionNumber = -1;
   if (!Fn.hasName()) FunctionNumber = NumberedVals.size()-1;
 
+  // With function arenas, the forward declared blocks and everything parsed
+  // below come from one arena, which lives as long as they do.
+  IntrusiveRefCntPtr<IRArena> Arena;
+  if (Context.useFunctionArenas())
+    Arena = new IRArena();
+  IRArena::Scope ArenaScope(Arena.get());
+
   PerFunctionState PFS(*this, Fn, FunctionNumber);
 
   // Resolve block addresses and allow basic blocks to be forward-declared
@@ -20,7 +20,9 @@
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/FunctionInfo.h"
 #include "llvm/IR/GVMaterializer.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
@@ -32,6 +34,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <deque>
 using namespace llvm;
@@ -44,6 +47,13 @@ enum {
 class BitcodeReaderValueList {
   std::vector<WeakVH> ValuePtrs;
 
+  /// The list whose values are the first entries of this one, if any. The
+  /// readers that parse function bodies on other threads share the
+  /// module-level values of the main reader this way. Shared entries are
+  /// never modified.
+  const BitcodeReaderValueList *Shared = nullptr;
+  unsigned NumShared = 0;
+
   /// As we resolve forward-referenced constants, we add information about them
   /// to this vector.  This allows us to resolve them in bulk instead of
   /// resolving each reference at a time.  See the code in
@@ -56,31 +66,42 @@ class BitcodeReaderValueList {
   LLVMContext &Context;
 public:
   BitcodeReaderValueList(LLVMContext &C) : Context(C) {}
+  /// Create a list that starts with the values of \p Shared, which must not
+  /// change while this list is in use.
+  BitcodeReaderValueList(LLVMContext &C, const BitcodeReaderValueList *Shared)
+      : Shared(Shared), NumShared(Shared->size()), Context(C) {}
   ~BitcodeReaderValueList() {
     assert(ResolveConstants.empty() && "Constants not resolved?");
   }
 
   // vector compatibility methods
-  unsigned size() const { return ValuePtrs.size(); }
-  void resize(unsigned N) { ValuePtrs.resize(N); }
+  unsigned size() const { return NumShared + ValuePtrs.size(); }
+  void resize(unsigned N) {
+    assert(N >= NumShared && "Cannot drop shared values!");
+    ValuePtrs.resize(N - NumShared);
+  }
   void push_back(Value *V) { ValuePtrs.emplace_back(V); }
 
   void clear() {
     assert(ResolveConstants.empty() && "Constants not resolved?");
     ValuePtrs.clear();
+    Shared = nullptr;
+    NumShared = 0;
   }
 
   Value *operator[](unsigned i) const {
-    assert(i < ValuePtrs.size());
-    return ValuePtrs[i];
+    assert(i < size());
+    if (i < NumShared)
+      return (*Shared)[i];
+    return ValuePtrs[i - NumShared];
   }
 
-  Value *back() const { return ValuePtrs.back(); }
-    void pop_back() { ValuePtrs.pop_back(); }
-  bool empty() const { return ValuePtrs.empty(); }
+  Value *back() const { return (*this)[size() - 1]; }
+  void pop_back() { ValuePtrs.pop_back(); }
+  bool empty() const { return size() == 0; }
   void shrinkTo(unsigned N) {
     assert(N <= size() && "Invalid shrinkTo request!");
-    ValuePtrs.resize(N);
+    resize(N);
   }
 
   Constant *getConstantFwdRef(unsigned Idx, Type *Ty);
@@ -100,28 +121,48 @@ class BitcodeReaderMDValueList {
   unsigned MaxFwdRef;
   std::vector<TrackingMDRef> MDValuePtrs;
 
+  /// The list whose nodes are the first entries of this one, if any, as for
+  /// BitcodeReaderValueList. Shared entries are never modified.
+  const BitcodeReaderMDValueList *Shared = nullptr;
+  unsigned NumShared = 0;
+
   LLVMContext &Context;
 public:
   BitcodeReaderMDValueList(LLVMContext &C)
       : NumFwdRefs(0), AnyFwdRefs(false), Context(C) {}
+  /// Create a list that starts with the nodes of \p Shared, which must not
+  /// change while this list is in use.
+  BitcodeReaderMDValueList(LLVMContext &C,
+                           const BitcodeReaderMDValueList *Shared)
+      : NumFwdRefs(0), AnyFwdRefs(false), Shared(Shared),
+        NumShared(Shared->size()), Context(C) {}
 
   // vector compatibility methods
-  unsigned size() const       { return MDValuePtrs.size(); }
-  void resize(unsigned N)     { MDValuePtrs.resize(N); }
+  unsigned size() const       { return NumShared + MDValuePtrs.size(); }
+  void resize(unsigned N) {
+    assert(N >= NumShared && "Cannot drop shared nodes!");
+    MDValuePtrs.resize(N - NumShared);
+  }
   void push_back(Metadata *MD) { MDValuePtrs.emplace_back(MD); }
-  void clear()                { MDValuePtrs.clear();  }
-  Metadata *back() const      { return MDValuePtrs.back(); }
+  void clear() {
+    MDValuePtrs.clear();
+    Shared = nullptr;
+    NumShared = 0;
+  }
+  Metadata *back() const      { return (*this)[size() - 1]; }
   void pop_back()             { MDValuePtrs.pop_back(); }
-  bool empty() const          { return MDValuePtrs.empty(); }
+  bool empty() const          { return size() == 0; }
 
   Metadata *operator[](unsigned i) const {
-    assert(i < MDValuePtrs.size());
-    return MDValuePtrs[i];
+    assert(i < size());
+    if (i < NumShared)
+      return (*Shared)[i];
+    return MDValuePtrs[i - NumShared];
   }
 
   void shrinkTo(unsigned N) {
     assert(N <= size() && "Invalid shrinkTo request!");
-    MDValuePtrs.resize(N);
+    resize(N);
   }
 
   Metadata *getValueFwdRef(unsigned Idx);
@@ -139,6 +180,9 @@ class BitcodeReader : public GVMaterializer {
   bool IsStreamed;
   uint64_t NextUnreadBit = 0;
   bool SeenValueSymbolTable = false;
+  /// The 32-bit word offset of the module-level value symbol table, from the
+  /// VSTOFFSET record, or 0 if it precedes the function blocks.
+  uint64_t VSTOffset = 0;
 
   std::vector<Type*> TypeList;
   BitcodeReaderValueList ValueList;
@@ -216,6 +260,22 @@ class BitcodeReader : public GVMaterializer {
 
   bool StripDebugInfo = false;
 
+  /// The number of threads materializeModule parses function bodies on.
+  unsigned NumThreads = 1;
+
+  /// True if this reader parses function bodies on a worker thread, on behalf
+  /// of the reader whose module-level state it shares.
+  bool IsParallelWorker = false;
+
+  /// The use-list orders read by a worker for values that other functions
+  /// use as well. Other threads may be adding uses to them, so they are
+  /// sorted once all the function bodies have been parsed and the context has
+  /// put the uses back in the order of a serial read. The writer lists such a
+  /// value in the last function that uses it, so sorting it late gives the
+  /// same order.
+  std::vector<std::pair<WeakVH, SmallVector<uint64_t, 8>>>
+      DeferredUseListOrders;
+
 public:
   std::error_code error(BitcodeError E, const Twine &Message);
   std::error_code error(BitcodeError E);
@@ -256,7 +316,16 @@ public:
 
   void setStripDebugInfo() override;
 
+  /// Parse the function bodies on up to \p N threads when the whole module is
+  /// materialized, 0 meaning one per hardware thread.
+  void setNumThreads(unsigned N) { NumThreads = N; }
+
 private:
+  /// Create a reader that parses function bodies for \p Parent on a worker
+  /// thread, reporting errors to \p DiagnosticHandler.
+  BitcodeReader(BitcodeReader &Parent,
+                DiagnosticHandlerFunction DiagnosticHandler);
+
   std::vector<StructType *> IdentifiedStructTypes;
   StructType *createIdentifiedStructType(LLVMContext &Context, StringRef Name);
   StructType *createIdentifiedStructType(LLVMContext &Context);
@@ -357,12 +426,16 @@ private:
   std::error_code parseTypeTable();
   std::error_code parseTypeTableBody();
 
-  std::error_code parseValueSymbolTable();
+  std::error_code parseValueSymbolTable(uint64_t Offset = 0);
   std::error_code parseConstants();
   std::error_code rememberAndSkipFunctionBody();
   /// Save the positions of the Metadata blocks and skip parsing the blocks.
   std::error_code rememberAndSkipMetadata();
   std::error_code parseFunctionBody(Function *F);
+  std::error_code
+  parseFunctionBodies(ArrayRef<std::pair<Function *, uint64_t>> Bodies,
+                      unsigned FirstPosition);
+  std::error_code parseFunctionBodiesInParallel();
   std::error_code globalCleanup();
   std::error_code resolveGlobalAndAliasInits();
   std::error_code parseMetadata();
@@ -437,6 +510,18 @@ BitcodeReader::BitcodeReader(LLVMContext &Context,
       Buffer(nullptr), IsStreamed(true), ValueList(Context),
       MDValueList(Context) {}
 
+BitcodeReader::BitcodeReader(BitcodeReader &Parent,
+                             DiagnosticHandlerFunction DiagnosticHandler)
+    : Context(Parent.Context), DiagnosticHandler(DiagnosticHandler),
+      TheModule(Parent.TheModule), Buffer(nullptr), IsStreamed(false),
+      TypeList(Parent.TypeList), ValueList(Context, &Parent.ValueList),
+      MDValueList(Context, &Parent.MDValueList),
+      MAttributes(Parent.MAttributes), MDKindMap(Parent.MDKindMap),
+      UseRelativeIDs(Parent.UseRelativeIDs),
+      WillMaterializeAllForwardRefs(true), IsParallelWorker(true) {
+  Stream.init(&*Parent.StreamFile);
+}
+
 std::error_code BitcodeReader::materializeForwardReferencedFunctions() {
   if (WillMaterializeAllForwardRefs)
     return std::error_code();
@@ -741,6 +826,7 @@ DEFINE_TRANSPARENT_OPERAND_ACCESSORS(ConstantPlaceHolder, Value)
 }
 
 void BitcodeReaderValueList::assignValue(Value *V, unsigned Idx) {
+  assert(Idx >= NumShared && "Cannot assign a shared value!");
   if (Idx == size()) {
     push_back(V);
     return;
@@ -749,7 +835,7 @@ void BitcodeReaderValueList::assignValue(Value *V, unsigned Idx) {
   if (Idx >= size())
     resize(Idx+1);
 
-  WeakVH &OldV = ValuePtrs[Idx];
+  WeakVH &OldV = ValuePtrs[Idx - NumShared];
   if (!OldV) {
     OldV = V;
     return;
@@ -774,15 +860,17 @@ Constant *BitcodeReaderValueList::getConstantFwdRef(unsigned Idx,
   if (Idx >= size())
     resize(Idx + 1);
 
-  if (Value *V = ValuePtrs[Idx]) {
+  if (Value *V = (*this)[Idx]) {
     if (Ty != V->getType())
       report_fatal_error("Type mismatch in constant table!");
     return cast<Constant>(V);
   }
+  if (Idx < NumShared)
+    report_fatal_error("Invalid reference to a module-level constant!");
 
   // Create and return a placeholder, which will later be RAUW'd.
   Constant *C = new ConstantPlaceHolder(Ty, Context);
-  ValuePtrs[Idx] = C;
+  ValuePtrs[Idx - NumShared] = C;
   return C;
 }
 
@@ -794,19 +882,20 @@ Value *BitcodeReaderValueList::getValueFwdRef(unsigned Idx, Type *Ty) {
   if (Idx >= size())
     resize(Idx + 1);
 
-  if (Value *V = ValuePtrs[Idx]) {
+  if (Value *V = (*this)[Idx]) {
     // If the types don't match, it's invalid.
     if (Ty && Ty != V->getType())
       return nullptr;
     return V;
   }
 
-  // No type specified, must be invalid reference.
-  if (!Ty) return nullptr;
+  // No type specified, or a shared value that was never defined, must be an
+  // invalid reference.
+  if (!Ty || Idx < NumShared) return nullptr;
 
   // Create and return a placeholder, which will later be RAUW'd.
   Value *V = new Argument(Ty);
-  ValuePtrs[Idx] = V;
+  ValuePtrs[Idx - NumShared] = V;
   return V;
 }
 
@@ -892,6 +981,7 @@ void BitcodeReaderValueList::resolveConstantForwardRefs() {
 }
 
 void BitcodeReaderMDValueList::assignValue(Metadata *MD, unsigned Idx) {
+  assert(Idx >= NumShared && "Cannot assign a shared node!");
   if (Idx == size()) {
     push_back(MD);
     return;
@@ -900,7 +990,7 @@ void BitcodeReaderMDValueList::assignValue(Metadata *MD, unsigned Idx) {
   if (Idx >= size())
     resize(Idx+1);
 
-  TrackingMDRef &OldMD = MDValuePtrs[Idx];
+  TrackingMDRef &OldMD = MDValuePtrs[Idx - NumShared];
   if (!OldMD) {
     OldMD.reset(MD);
     return;
@@ -916,8 +1006,9 @@ Metadata *BitcodeReaderMDValueList::getValueFwdRef(unsigned Idx) {
   if (Idx >= size())
     resize(Idx + 1);
 
-  if (Metadata *MD = MDValuePtrs[Idx])
+  if (Metadata *MD = (*this)[Idx])
     return MD;
+  assert(Idx >= NumShared && "Shared nodes are always resolved");
 
   // Track forward refs to be resolved later.
   if (AnyFwdRefs) {
@@ -931,7 +1022,7 @@ Metadata *BitcodeReaderMDValueList::getValueFwdRef(unsigned Idx) {
 
   // Create and return a placeholder, which will later be RAUW'd.
   Metadata *MD = MDNode::getTemporary(Context, None).release();
-  MDValuePtrs[Idx].reset(MD);
+  MDValuePtrs[Idx - NumShared].reset(MD);
   return MD;
 }
 
@@ -946,7 +1037,7 @@ void BitcodeReaderMDValueList::tryToResolveCycles() {
 
   // Resolve any cycles.
   for (unsigned I = MinFwdRef, E = MaxFwdRef + 1; I != E; ++I) {
-    auto &MD = MDValuePtrs[I];
+    auto &MD = MDValuePtrs[I - NumShared];
     auto *N = dyn_cast_or_null<MDNode>(MD);
     if (!N)
       continue;
@@ -1509,7 +1600,25 @@ std::error_code BitcodeReader::parseTypeTableBody() {
   }
 }
 
-std::error_code BitcodeReader::parseValueSymbolTable() {
+/// Parse the value symbol table at the current position or, if \p Offset is
+/// not 0, the one at the 32-bit word offset \p Offset, in which case the
+/// stream is moved back to the current position afterwards.
+std::error_code BitcodeReader::parseValueSymbolTable(uint64_t Offset) {
+  // The offsets of the function blocks in VST_FNENTRY records are those of
+  // their ENTER_SUBBLOCK abbrev id, while DeferredFunctionInfo records the
+  // position after the block id.
+  unsigned FuncBitcodeOffsetDelta =
+      Stream.getAbbrevIDWidth() + bitc::BlockIDWidth;
+  uint64_t CurrentBit = 0;
+  if (Offset > 0) {
+    CurrentBit = Stream.GetCurrentBitNo();
+    Stream.JumpToBit(Offset * 32);
+    BitstreamEntry Entry = Stream.advance();
+    if (Entry.Kind != BitstreamEntry::SubBlock ||
+        Entry.ID != bitc::VALUE_SYMTAB_BLOCK_ID)
+      return error("Invalid VSTOFFSET record");
+  }
+
   if (Stream.EnterSubBlock(bitc::VALUE_SYMTAB_BLOCK_ID))
     return error("Invalid record");
 
@@ -1517,6 +1626,18 @@ std::error_code BitcodeReader::parseValueSymbolTable() {
 
   Triple TT(TheModule->getTargetTriple());
 
+  auto SetName = [&](Value *V, StringRef Name) {
+    V->setName(Name);
+    if (auto *GO = dyn_cast<GlobalObject>(V)) {
+      if (GO->getComdat() == reinterpret_cast<Comdat *>(1)) {
+        if (TT.isOSBinFormatMachO())
+          GO->setComdat(nullptr);
+        else
+          GO->setComdat(TheModule->getOrInsertComdat(V->getName()));
+      }
+    }
+  };
+
   // Read all the records for this value table.
   SmallString<128> ValueName;
   while (1) {
@@ -1527,6 +1648,8 @@ std::error_code BitcodeReader::parseValueSymbolTable() {
     case BitstreamEntry::Error:
       return error("Malformed block");
     case BitstreamEntry::EndBlock:
+      if (Offset > 0)
+        Stream.JumpToBit(CurrentBit);
       return std::error_code();
     case BitstreamEntry::Record:
       // The interesting case.
@@ -1538,23 +1661,30 @@ std::error_code BitcodeReader::parseValueSymbolTable() {
     switch (Stream.readRecord(Entry.ID, Record)) {
     default:  // Default behavior: unknown type.
       break;
+    case bitc::VST_CODE_FNENTRY: {
+      // VST_FNENTRY: [valueid, offset, namechar x N]
+      if (Record.size() < 2 || convertToString(Record, 2, ValueName))
+        return error("Invalid record");
+      unsigned ValueID = Record[0];
+      if (ValueID >= ValueList.size())
+        return error("Invalid record");
+      auto *F = dyn_cast_or_null<Function>(ValueList[ValueID]);
+      if (!F || !DeferredFunctionInfo.count(F))
+        return error("Invalid record");
+
+      if (!ValueName.empty())
+        SetName(F, ValueName);
+      DeferredFunctionInfo[F] = Record[1] * 32 + FuncBitcodeOffsetDelta;
+      ValueName.clear();
+      break;
+    }
     case bitc::VST_CODE_ENTRY: {  // VST_ENTRY: [valueid, namechar x N]
       if (convertToString(Record, 1, ValueName))
         return error("Invalid record");
       unsigned ValueID = Record[0];
       if (ValueID >= ValueList.size() || !ValueList[ValueID])
         return error("Invalid record");
-      Value *V = ValueList[ValueID];
-
-      V->setName(StringRef(ValueName.data(), ValueName.size()));
-      if (auto *GO = dyn_cast<GlobalObject>(V)) {
-        if (GO->getComdat() == reinterpret_cast<Comdat *>(1)) {
-          if (TT.isOSBinFormatMachO())
-            GO->setComdat(nullptr);
-          else
-            GO->setComdat(TheModule->getOrInsertComdat(V->getName()));
-        }
-      }
+      SetName(ValueList[ValueID], ValueName);
       ValueName.clear();
       break;
     }
@@ -2527,13 +2657,15 @@ std::error_code BitcodeReader::parseConstants() {
       BlockAddressesTaken.insert(Fn);
 
       // If the function is already parsed we can insert the block address right
-      // away.
+      // away. A worker can't tell, as another thread may be parsing it, so it
+      // always uses a placeholder; parseFunctionBodiesInParallel resolves the
+      // ones that aren't taken by a function this worker parses later.
       BasicBlock *BB;
       unsigned BBID = Record[2];
       if (!BBID)
         // Invalid reference to entry block.
         return error("Invalid ID");
-      if (!Fn->empty()) {
+      if (!IsParallelWorker && !Fn->empty()) {
         Function::iterator BBI = Fn->begin(), BBE = Fn->end();
         for (size_t I = 0, E = BBID; I != E; ++I) {
           if (BBI == BBE)
@@ -2563,6 +2695,25 @@ std::error_code BitcodeReader::parseConstants() {
   }
 }
 
+/// Sort the use list of \p V by the indexes of a use-list record.
+static void applyUseListOrder(Value *V, ArrayRef<uint64_t> Record) {
+  unsigned NumUses = 0;
+  SmallDenseMap<const Use *, unsigned, 16> Order;
+  for (const Use &U : V->uses()) {
+    if (++NumUses > Record.size())
+      break;
+    Order[&U] = Record[NumUses - 1];
+  }
+  if (Order.size() != Record.size() || NumUses > Record.size())
+    // Mismatches can happen if the functions are being materialized lazily
+    // (out-of-order), or a value has been upgraded.
+    return;
+
+  V->sortUseList([&](const Use &L, const Use &R) {
+    return Order.lookup(&L) < Order.lookup(&R);
+  });
+}
+
 std::error_code BitcodeReader::parseUseLists() {
   if (Stream.EnterSubBlock(bitc::USELIST_BLOCK_ID))
     return error("Invalid record");
@@ -2606,21 +2757,13 @@ std::error_code BitcodeReader::parseUseLists() {
         V = FunctionBBs[ID];
       } else
         V = ValueList[ID];
-      unsigned NumUses = 0;
-      SmallDenseMap<const Use *, unsigned, 16> Order;
-      for (const Use &U : V->uses()) {
-        if (++NumUses > Record.size())
-          break;
-        Order[&U] = Record[NumUses - 1];
-      }
-      if (Order.size() != Record.size() || NumUses > Record.size())
-        // Mismatches can happen if the functions are being materialized lazily
-        // (out-of-order), or a value has been upgraded.
+      if (IsParallelWorker && !IsBB && !isa<Instruction>(V) &&
+          !isa<Argument>(V)) {
+        DeferredUseListOrders.emplace_back(
+            V, SmallVector<uint64_t, 8>(Record.begin(), Record.end()));
         break;
-
-      V->sortUseList([&](const Use &L, const Use &R) {
-        return Order.lookup(&L) < Order.lookup(&R);
-      });
+      }
+      applyUseListOrder(V, Record);
       break;
     }
     }
@@ -2665,6 +2808,9 @@ std::error_code BitcodeReader::rememberAndSkipFunctionBody() {
 
   // Save the current stream state.
   uint64_t CurBit = Stream.GetCurrentBitNo();
+  assert((DeferredFunctionInfo[Fn] == 0 ||
+          DeferredFunctionInfo[Fn] == CurBit) &&
+         "Mismatch between VST and scanned function offsets");
   DeferredFunctionInfo[Fn] = CurBit;
 
   // Skip over the function block for now.
@@ -2741,6 +2887,13 @@ std::error_code BitcodeReader::parseModule(bool Resume,
           return EC;
         break;
       case bitc::VALUE_SYMTAB_BLOCK_ID:
+        // With a VSTOFFSET record, the table was already read when the first
+        // function block was reached.
+        if (SeenValueSymbolTable && VSTOffset > 0) {
+          if (Stream.SkipBlock())
+            return error("Invalid record");
+          break;
+        }
         if (std::error_code EC = parseValueSymbolTable())
           return EC;
         SeenValueSymbolTable = true;
@@ -2771,15 +2924,31 @@ std::error_code BitcodeReader::parseModule(bool Resume,
           SeenFirstFunctionBody = true;
         }
 
+        if (VSTOffset > 0) {
+          // The value symbol table follows the function blocks and holds
+          // their offsets: read it now, so that any function can be
+          // materialized without scanning the others. If it was already
+          // read, we are resuming the parse after the function blocks were
+          // found through it, so skip them.
+          if (SeenValueSymbolTable) {
+            if (Stream.SkipBlock())
+              return error("Invalid record");
+            break;
+          }
+          if (std::error_code EC = parseValueSymbolTable(VSTOffset))
+            return EC;
+          SeenValueSymbolTable = true;
+        }
+
+        // Older bitcode has no function offsets, so build DeferredFunctionInfo
+        // as the blocks are seen.
         if (std::error_code EC = rememberAndSkipFunctionBody())
           return EC;
-        // For streaming bitcode, suspend parsing when we reach the function
-        // bodies. Subsequent materialization calls will resume it when
-        // necessary. For streaming, the function bodies must be at the end of
-        // the bitcode. If the bitcode file is old, the symbol table will be
-        // at the end instead and will not have been seen yet. In this case,
-        // just finish the parse now.
-        if (IsStreamed && SeenValueSymbolTable) {
+        // Suspend parsing when we reach the function bodies. Subsequent
+        // materialization calls will resume it when necessary. If the bitcode
+        // file is old, the symbol table will be at the end instead and will
+        // not have been seen yet. In this case, just finish the parse now.
+        if (SeenValueSymbolTable) {
           NextUnreadBit = Stream.GetCurrentBitNo();
           return std::error_code();
         }
@@ -2860,6 +3029,12 @@ std::error_code BitcodeReader::parseModule(bool Resume,
       GCTable.push_back(S);
       break;
     }
+    case bitc::MODULE_CODE_VSTOFFSET: { // VSTOFFSET: [offset]
+      if (Record.size() < 1)
+        return error("Invalid record");
+      VSTOffset = Record[0];
+      break;
+    }
     case bitc::MODULE_CODE_COMDAT: { // COMDAT: [selection_kind, name]
       if (Record.size() < 2)
         return error("Invalid record");
@@ -3030,8 +3205,7 @@ std::error_code BitcodeReader::parseModule(bool Resume,
       if (!isProto) {
         Func->setIsMaterializable(true);
         FunctionsWithBodies.push_back(Func);
-        if (IsStreamed)
-          DeferredFunctionInfo[Func] = 0;
+        DeferredFunctionInfo[Func] = 0;
       }
       break;
     }
@@ -3282,6 +3456,13 @@ std::error_code BitcodeReader::parseFunctionBody(Function *F) {
   unsigned ModuleValueListSize = ValueList.size();
   unsigned ModuleMDValueListSize = MDValueList.size();
 
+  // Allocate the body from an arena of its own if the context asks for it.
+  // The instructions and blocks keep the arena alive.
+  IntrusiveRefCntPtr<IRArena> Arena;
+  if (Context.useFunctionArenas())
+    Arena = new IRArena();
+  IRArena::Scope ArenaScope(Arena.get());
+
   // Add all the function arguments to the value table.
   for(Function::arg_iterator I = F->arg_begin(), E = F->arg_end(); I != E; ++I)
     ValueList.push_back(I);
@@ -4382,6 +4563,169 @@ std::error_code BitcodeReader::findFunctionInStream(
   return std::error_code();
 }
 
+/// Parse the function blocks at the given bit positions, on a worker thread.
+/// The first function is at \p FirstPosition in the order of a serial read.
+std::error_code BitcodeReader::parseFunctionBodies(
+    ArrayRef<std::pair<Function *, uint64_t>> Bodies, unsigned FirstPosition) {
+  assert(IsParallelWorker && "Expected a worker");
+  unsigned Position = FirstPosition;
+  for (const auto &Body : Bodies) {
+    // Let the context put the uses this function adds to shared values where
+    // a serial read would have.
+    LLVMContext::setMultithreadedWorkOrder(Position++);
+    Stream.JumpToBit(Body.second);
+    if (std::error_code EC = parseFunctionBody(Body.first))
+      return EC;
+  }
+  return std::error_code();
+}
+
+namespace {
+/// A run of function bodies that one thread parses, and the outcome.
+struct FunctionBodyChunk {
+  std::vector<std::pair<Function *, uint64_t>> Bodies;
+  unsigned FirstPosition = 0;
+  std::unique_ptr<BitcodeReader> Reader;
+  std::error_code EC;
+  std::string Message;
+};
+} // end anonymous namespace
+
+/// Parse the bodies of the functions that are still materializable on up to
+/// NumThreads threads. The functions are split in runs of about the same
+/// number of bits, each parsed by a worker reader with its own cursor that
+/// shares the module-level values of this one. What workers can't do while
+/// other threads create instructions (resolving block addresses across
+/// functions, sorting the use lists of shared values, reporting errors) is
+/// done here once they are finished, in the order of the functions.
+std::error_code BitcodeReader::parseFunctionBodiesInParallel() {
+  // The function blocks are located by the module-level VST. Without it, they
+  // would have to be found by scanning the stream ahead of the serial parse,
+  // which would report errors in a different order, so read those serially.
+  std::vector<std::pair<Function *, uint64_t>> Bodies;
+  for (Function &F : *TheModule) {
+    if (!F.isMaterializable())
+      continue;
+    auto DFII = DeferredFunctionInfo.find(&F);
+    assert(DFII != DeferredFunctionInfo.end() &&
+           "Deferred function not found!");
+    if (DFII->second == 0)
+      return std::error_code();
+    Bodies.emplace_back(&F, DFII->second);
+  }
+
+  unsigned NumChunks = std::min<size_t>(NumThreads, Bodies.size());
+  if (NumChunks < 2)
+    return std::error_code();
+
+  // The size of a body is the distance to the next function block. That of
+  // the last one also counts what follows it, which doesn't matter much.
+  std::vector<uint64_t> Starts;
+  for (const auto &Body : Bodies)
+    Starts.push_back(Body.second);
+  std::sort(Starts.begin(), Starts.end());
+  uint64_t EndBit = StreamFile->getBitcodeBytes().getExtent() * 8;
+  auto getBodySize = [&](uint64_t Start) {
+    auto Next = std::upper_bound(Starts.begin(), Starts.end(), Start);
+    return (Next == Starts.end() ? EndBit : *Next) - Start;
+  };
+
+  std::vector<FunctionBodyChunk> Chunks(NumChunks);
+  uint64_t ChunkBits = 0, BitsPerChunk = (EndBit - Starts.front()) / NumChunks;
+  unsigned C = 0;
+  for (unsigned I = 0, E = Bodies.size(); I != E; ++I) {
+    Chunks[C].Bodies.push_back(Bodies[I]);
+    ChunkBits += getBodySize(Bodies[I].second);
+    if (ChunkBits >= BitsPerChunk * (C + 1) && C + 1 != NumChunks) {
+      ++C;
+      Chunks[C].FirstPosition = I + 1;
+    }
+  }
+
+  for (FunctionBodyChunk &Chunk : Chunks) {
+    Chunk.Reader.reset(
+        new BitcodeReader(*this, [&Chunk](const DiagnosticInfo &DI) {
+          raw_string_ostream OS(Chunk.Message);
+          DiagnosticPrinterRawOStream DP(OS);
+          DI.print(DP);
+        }));
+
+    // Hand over the placeholders of the blocks whose address the module
+    // takes, so that the worker inserts them as it parses the function.
+    for (const auto &Body : Chunk.Bodies) {
+      auto BBFRI = BasicBlockFwdRefs.find(Body.first);
+      if (BBFRI == BasicBlockFwdRefs.end())
+        continue;
+      Chunk.Reader->BasicBlockFwdRefs[Body.first] = std::move(BBFRI->second);
+      BasicBlockFwdRefs.erase(BBFRI);
+    }
+  }
+
+  Context.enterMultithreadedRegion();
+  {
+    ThreadPool Pool(NumThreads);
+    for (FunctionBodyChunk &Chunk : Chunks)
+      Pool.async([&Chunk] {
+        Chunk.EC = Chunk.Reader->parseFunctionBodies(Chunk.Bodies,
+                                                     Chunk.FirstPosition);
+      });
+    Pool.wait();
+  }
+  Context.exitMultithreadedRegion();
+
+  std::error_code EC;
+  for (FunctionBodyChunk &Chunk : Chunks) {
+    BitcodeReader &R = *Chunk.Reader;
+    if (Chunk.EC && !EC)
+      EC = ::error(DiagnosticHandler, Chunk.EC, Chunk.Message);
+
+    InstsWithTBAATag.append(R.InstsWithTBAATag.begin(),
+                            R.InstsWithTBAATag.end());
+    BlockAddressesTaken.insert(R.BlockAddressesTaken.begin(),
+                               R.BlockAddressesTaken.end());
+
+    // Resolve the block addresses that the worker couldn't insert into the
+    // function as it parsed it.
+    for (auto &Refs : R.BasicBlockFwdRefs) {
+      Function *Fn = Refs.first;
+      if (EC || Fn->empty()) {
+        if (!EC)
+          EC = error("Never resolved function from blockaddress");
+        continue;
+      }
+      std::vector<BasicBlock *> Blocks;
+      for (BasicBlock &BB : *Fn)
+        Blocks.push_back(&BB);
+      if (Refs.second.size() > Blocks.size()) {
+        EC = error("Invalid ID");
+        continue;
+      }
+      for (unsigned I = 0, E = Refs.second.size(); I != E; ++I)
+        if (BasicBlock *Placeholder = Refs.second[I]) {
+          Placeholder->replaceAllUsesWith(Blocks[I]);
+          delete Placeholder;
+        }
+    }
+    R.BasicBlockFwdRefs.clear();
+  }
+  if (EC)
+    return EC;
+
+  for (FunctionBodyChunk &Chunk : Chunks) {
+    for (const auto &Order : Chunk.Reader->DeferredUseListOrders)
+      if (Value *V = Order.first)
+        applyUseListOrder(V, Order.second);
+
+    for (const auto &Body : Chunk.Bodies) {
+      Function *F = Body.first;
+      F->setIsMaterializable(false);
+      if (StripDebugInfo)
+        stripDebugInfo(*F);
+    }
+  }
+  return std::error_code();
+}
+
 //===----------------------------------------------------------------------===//
 // GVMaterializer implementation
 //===----------------------------------------------------------------------===//
@@ -4401,7 +4745,7 @@ std::error_code BitcodeReader::materialize(GlobalValue *GV) {
   assert(DFII != DeferredFunctionInfo.end() && "Deferred function not found!");
   // If its position is recorded as 0, its body is somewhere in the stream
   // but we haven't seen it yet.
-  if (DFII->second == 0 && IsStreamed)
+  if (DFII->second == 0)
     if (std::error_code EC = findFunctionInStream(F, DFII))
       return EC;
 
@@ -4468,6 +4812,12 @@ std::error_code BitcodeReader::materializeModule(Module *M) {
   // Promise to materialize all forward references.
   WillMaterializeAllForwardRefs = true;
 
+  if (NumThreads == 0)
+    NumThreads = thread::hardware_concurrency();
+  if (NumThreads > 1 && !IsStreamed)
+    if (std::error_code EC = parseFunctionBodiesInParallel())
+      return EC;
+
   // Iterate over the module, deserializing any functions that are still on
   // disk.
   for (Module::iterator F = TheModule->begin(), E = TheModule->end();
@@ -4569,6 +4919,234 @@ BitcodeReader::initLazyStream(std::unique_ptr<DataStreamer> Streamer) {
   return std::error_code();
 }
 
+//===----------------------------------------------------------------------===//
+// Function summary reader
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// Parses the function summary block of a bitcode file, either the
+/// per-module summary nested in the module block or the top-level block of a
+/// combined function index file, without reading any IR.
+class FunctionIndexBitcodeReader {
+  DiagnosticHandlerFunction DiagnosticHandler;
+  MemoryBufferRef Buffer;
+  BitstreamReader StreamFile;
+  BitstreamCursor Stream;
+
+  /// The index being populated, or null if we only check for presence.
+  FunctionInfoIndex *Index;
+  bool SeenSummary = false;
+
+  /// Names defined by the NAME records of the current summary block, in
+  /// order, and the module paths of a combined index by module id.
+  std::vector<StringRef> Names;
+  DenseMap<uint64_t, StringRef> ModulePaths;
+
+public:
+  FunctionIndexBitcodeReader(MemoryBufferRef Buffer,
+                             DiagnosticHandlerFunction DiagnosticHandler,
+                             FunctionInfoIndex *Index)
+      : DiagnosticHandler(DiagnosticHandler), Buffer(Buffer), Index(Index) {}
+
+  std::error_code parse();
+  bool seenSummary() const { return SeenSummary; }
+
+private:
+  std::error_code error(const Twine &Message) {
+    return ::error(DiagnosticHandler, Message);
+  }
+  std::error_code initStream();
+  std::error_code parseModule();
+  std::error_code parseSummaryBlock(bool IsCombined);
+  std::error_code getName(uint64_t Id, StringRef &Name);
+};
+}
+
+std::error_code FunctionIndexBitcodeReader::initStream() {
+  const unsigned char *BufPtr = (const unsigned char *)Buffer.getBufferStart();
+  const unsigned char *BufEnd = BufPtr + Buffer.getBufferSize();
+
+  if (Buffer.getBufferSize() & 3)
+    return error("Invalid bitcode signature");
+
+  // If we have a wrapper header, parse it and ignore the non-bc file contents.
+  if (isBitcodeWrapper(BufPtr, BufEnd))
+    if (SkipBitcodeWrapperHeader(BufPtr, BufEnd, true))
+      return error("Invalid bitcode wrapper header");
+
+  StreamFile.init(BufPtr, BufEnd);
+  Stream.init(&StreamFile);
+
+  // Sniff for the signature.
+  if (Stream.Read(8) != 'B' ||
+      Stream.Read(8) != 'C' ||
+      Stream.Read(4) != 0x0 ||
+      Stream.Read(4) != 0xC ||
+      Stream.Read(4) != 0xE ||
+      Stream.Read(4) != 0xD)
+    return error("Invalid bitcode signature");
+  return std::error_code();
+}
+
+std::error_code FunctionIndexBitcodeReader::getName(uint64_t Id,
+                                                    StringRef &Name) {
+  if (Id >= Names.size())
+    return error("Invalid function summary name id");
+  Name = Names[Id];
+  return std::error_code();
+}
+
+std::error_code FunctionIndexBitcodeReader::parseSummaryBlock(bool IsCombined) {
+  SeenSummary = true;
+  if (!Index)
+    return Stream.SkipBlock() ? error("Malformed block") : std::error_code();
+
+  if (Stream.EnterSubBlock(bitc::FUNCTION_SUMMARY_BLOCK_ID))
+    return error("Invalid record");
+
+  StringRef ModulePath;
+  if (!IsCombined)
+    ModulePath = Index->addModulePath(Buffer.getBufferIdentifier(), 0);
+
+  Names.clear();
+  SmallVector<uint64_t, 64> Record;
+  while (1) {
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      return std::error_code();
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    Record.clear();
+    unsigned Code = Stream.readRecord(Entry.ID, Record);
+    switch (Code) {
+    default: // Default behavior: ignore.
+      break;
+    case bitc::FS_CODE_MODULE_PATH: { // MODULE_PATH: [modid, strchr x N]
+      std::string Path;
+      if (Record.empty() || convertToString(Record, 1, Path))
+        return error("Invalid record");
+      ModulePaths[Record[0]] = Index->addModulePath(Path, Record[0]);
+      break;
+    }
+    case bitc::FS_CODE_NAME: { // NAME: [strchr x N]
+      std::string Name;
+      if (convertToString(Record, 0, Name))
+        return error("Invalid record");
+      Names.push_back(Index->internName(Name));
+      break;
+    }
+    // PERMODULE_ENTRY: [nameid, linkage, instcount, flags, calleenameid x N]
+    // COMBINED_ENTRY: [modid, nameid, linkage, instcount, flags,
+    //                  calleenameid x N]
+    case bitc::FS_CODE_PERMODULE_ENTRY:
+    case bitc::FS_CODE_COMBINED_ENTRY: {
+      bool IsCombinedEntry = Code == bitc::FS_CODE_COMBINED_ENTRY;
+      if (IsCombinedEntry != IsCombined)
+        return error("Invalid function summary entry");
+      unsigned Idx = 0;
+      StringRef EntryModulePath = ModulePath;
+      if (IsCombinedEntry) {
+        if (Record.empty())
+          return error("Invalid record");
+        auto MP = ModulePaths.find(Record[Idx++]);
+        if (MP == ModulePaths.end())
+          return error("Invalid function summary module id");
+        EntryModulePath = MP->second;
+      }
+      if (Record.size() < Idx + 4)
+        return error("Invalid record");
+      StringRef Name;
+      if (std::error_code EC = getName(Record[Idx], Name))
+        return EC;
+      auto Summary = llvm::make_unique<FunctionSummary>(
+          EntryModulePath, getDecodedLinkage(Record[Idx + 1]),
+          Record[Idx + 2], Record[Idx + 3] & 1);
+      for (unsigned I = Idx + 4, E = Record.size(); I != E; ++I) {
+        StringRef Callee;
+        if (std::error_code EC = getName(Record[I], Callee))
+          return EC;
+        Summary->addCallee(Callee);
+      }
+      Index->addFunctionSummary(Name, std::move(Summary));
+      break;
+    }
+    }
+  }
+  llvm_unreachable("Exit infinite loop");
+}
+
+std::error_code FunctionIndexBitcodeReader::parseModule() {
+  if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
+    return error("Invalid record");
+
+  // Skip everything but the function summary block.
+  while (1) {
+    BitstreamEntry Entry = Stream.advance();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      return std::error_code();
+
+    case BitstreamEntry::SubBlock:
+      if (Entry.ID == bitc::FUNCTION_SUMMARY_BLOCK_ID)
+        return parseSummaryBlock(/*IsCombined=*/false);
+      if (Stream.SkipBlock())
+        return error("Malformed block");
+      continue;
+
+    case BitstreamEntry::Record:
+      Stream.skipRecord(Entry.ID);
+      continue;
+    }
+  }
+}
+
+std::error_code FunctionIndexBitcodeReader::parse() {
+  if (std::error_code EC = initStream())
+    return EC;
+
+  // We expect a number of well-defined blocks, though we don't necessarily
+  // need to understand them all.
+  while (1) {
+    if (Stream.AtEndOfStream())
+      return std::error_code();
+
+    BitstreamEntry Entry = Stream.advance();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      return std::error_code();
+
+    case BitstreamEntry::SubBlock:
+      if (Entry.ID == bitc::MODULE_BLOCK_ID)
+        return parseModule();
+      if (Entry.ID == bitc::FUNCTION_SUMMARY_BLOCK_ID)
+        return parseSummaryBlock(/*IsCombined=*/true);
+
+      // Ignore other sub-blocks.
+      if (Stream.SkipBlock())
+        return error("Malformed block");
+      continue;
+
+    case BitstreamEntry::Record:
+      Stream.skipRecord(Entry.ID);
+      continue;
+    }
+  }
+}
+
 namespace {
 class BitcodeErrorCategoryType : public std::error_category {
   const char *name() const LLVM_NOEXCEPT override {
@@ -4605,15 +5183,20 @@ const std::error_category &llvm::BitcodeErrorCategory() {
 ///
 /// \param[in] MaterializeAll Set to \c true if we should materialize
 /// everything.
+///
+/// \param[in] NumThreads The number of threads to parse function bodies on
+/// when everything is materialized.
 static ErrorOr<std::unique_ptr<Module>>
 getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &&Buffer,
                          LLVMContext &Context, bool MaterializeAll,
                          DiagnosticHandlerFunction DiagnosticHandler,
-                         bool ShouldLazyLoadMetadata = false) {
+                         bool ShouldLazyLoadMetadata = false,
+                         unsigned NumThreads = 1) {
   std::unique_ptr<Module> M =
       make_unique<Module>(Buffer->getBufferIdentifier(), Context);
   BitcodeReader *R =
       new BitcodeReader(Buffer.get(), Context, DiagnosticHandler);
+  R->setNumThreads(NumThreads);
   M->setMaterializer(R);
 
   auto cleanupOnError = [&](std::error_code EC) {
@@ -4660,10 +5243,11 @@ ErrorOr<std::unique_ptr<Module>> llvm::getStreamedBitcodeModule(
 
 ErrorOr<std::unique_ptr<Module>>
 llvm::parseBitcodeFile(MemoryBufferRef Buffer, LLVMContext &Context,
-                       DiagnosticHandlerFunction DiagnosticHandler) {
+                       DiagnosticHandlerFunction DiagnosticHandler,
+                       unsigned NumThreads) {
   std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::getMemBuffer(Buffer, false);
   return getLazyBitcodeModuleImpl(std::move(Buf), Context, true,
-                                  DiagnosticHandler);
+                                  DiagnosticHandler, false, NumThreads);
   // TODO: Restore the use-lists to the in-memory state when the bitcode was
   // written.  We must defer until the Module has been fully materialized.
 }
@@ -4679,3 +5263,32 @@ llvm::getBitcodeTargetTriple(MemoryBufferRef Buffer, LLVMContext &Context,
     return "";
   return Triple.get();
 }
+
+/// Ignore diagnostics if the caller did not provide a handler; errors are
+/// still reported through the returned error code.
+static DiagnosticHandlerFunction
+getSummaryDiagHandler(DiagnosticHandlerFunction F) {
+  if (F)
+    return F;
+  return [](const DiagnosticInfo &) {};
+}
+
+bool llvm::hasFunctionSummary(MemoryBufferRef Buffer,
+                              DiagnosticHandlerFunction DiagnosticHandler) {
+  FunctionIndexBitcodeReader R(Buffer, getSummaryDiagHandler(DiagnosticHandler),
+                               nullptr);
+  if (R.parse())
+    return false;
+  return R.seenSummary();
+}
+
+ErrorOr<std::unique_ptr<FunctionInfoIndex>>
+llvm::getFunctionInfoIndex(MemoryBufferRef Buffer,
+                           DiagnosticHandlerFunction DiagnosticHandler) {
+  auto Index = llvm::make_unique<FunctionInfoIndex>();
+  FunctionIndexBitcodeReader R(Buffer, getSummaryDiagHandler(DiagnosticHandler),
+                               Index.get());
+  if (std::error_code EC = R.parse())
+    return EC;
+  return std::move(Index);
+}
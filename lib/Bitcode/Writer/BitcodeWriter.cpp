@@ -19,6 +19,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/FunctionInfo.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
@@ -29,6 +30,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cctype>
 #include <map>
@@ -483,8 +485,8 @@ static void WriteTypeTable(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   Stream.ExitBlock();
 }
 
-static unsigned getEncodedLinkage(const GlobalValue &GV) {
-  switch (GV.getLinkage()) {
+static unsigned getEncodedLinkage(const GlobalValue::LinkageTypes Linkage) {
+  switch (Linkage) {
   case GlobalValue::ExternalLinkage:
     return 0;
   case GlobalValue::WeakAnyLinkage:
@@ -511,6 +513,10 @@ static unsigned getEncodedLinkage(const GlobalValue &GV) {
   llvm_unreachable("Invalid linkage");
 }
 
+static unsigned getEncodedLinkage(const GlobalValue &GV) {
+  return getEncodedLinkage(GV.getLinkage());
+}
+
 static unsigned getEncodedVisibility(const GlobalValue &GV) {
   switch (GV.getVisibility()) {
   case GlobalValue::DefaultVisibility:   return 0;
@@ -572,9 +578,11 @@ static void writeComdats(const ValueEnumerator &VE, BitstreamWriter &Stream) {
 }
 
 // Emit top-level description of module, including target triple, inline asm,
-// descriptors for global variables, and function prototype info.
-static void WriteModuleInfo(const Module *M, const ValueEnumerator &VE,
-                            BitstreamWriter &Stream) {
+// descriptors for global variables, and function prototype info. Returns the
+// bit position of the placeholder for the offset of the value symbol table,
+// or 0 if the module has no function bodies.
+static uint64_t WriteModuleInfo(const Module *M, const ValueEnumerator &VE,
+                                BitstreamWriter &Stream) {
   // Emit various pieces of data attached to a module.
   if (!M->getTargetTriple().empty())
     WriteStringRecord(bitc::MODULE_CODE_TRIPLE, M->getTargetTriple(),
@@ -732,6 +740,26 @@ static void WriteModuleInfo(const Module *M, const ValueEnumerator &VE,
     Stream.EmitRecord(bitc::MODULE_CODE_ALIAS, Vals, AbbrevToUse);
     Vals.clear();
   }
+
+  // If there are function bodies, the value symbol table is written after
+  // them, so that it can hold their offsets and a reader can find any body
+  // without scanning the others. Emit a placeholder for its offset, which is
+  // backpatched once the table is written.
+  if (std::none_of(M->begin(), M->end(),
+                   [](const Function &F) { return !F.isDeclaration(); }))
+    return 0;
+
+  // VSTOFFSET: [offset]
+  // Blocks are 32-bit aligned, so the offset is in 32-bit words. Its field
+  // must have a fixed width to be backpatched.
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_VSTOFFSET));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned VSTOffsetAbbrev = Stream.EmitAbbrev(Abbv);
+
+  Vals.push_back(0);
+  Stream.EmitRecord(bitc::MODULE_CODE_VSTOFFSET, Vals, VSTOffsetAbbrev);
+  return Stream.GetCurrentBitNo() - 32;
 }
 
 static uint64_t GetOptimizationFlags(const Value *V) {
@@ -1990,6 +2018,21 @@ static void WriteInstruction(const Instruction &I, unsigned InstID,
   Vals.clear();
 }
 
+enum StringEncoding { SE_Char6, SE_Fixed7, SE_Fixed8 };
+
+/// Determine the encoding to use for the given string name and length.
+static StringEncoding getStringEncoding(const char *Str, unsigned StrLen) {
+  bool isChar6 = true;
+  for (const char *C = Str, *E = C + StrLen; C != E; ++C) {
+    if (isChar6)
+      isChar6 = BitCodeAbbrevOp::isChar6(*C);
+    if ((unsigned char)*C & 128)
+      // don't bother scanning the rest.
+      return SE_Fixed8;
+  }
+  return isChar6 ? SE_Char6 : SE_Fixed7;
+}
+
 // Emit names for globals/functions etc.
 static void WriteValueSymbolTable(const ValueSymbolTable &VST,
                                   const ValueEnumerator &VE,
@@ -2007,17 +2050,8 @@ static void WriteValueSymbolTable(const ValueSymbolTable &VST,
     const ValueName &Name = *SI;
 
     // Figure out the encoding to use for the name.
-    bool is7Bit = true;
-    bool isChar6 = true;
-    for (const char *C = Name.getKeyData(), *E = C+Name.getKeyLength();
-         C != E; ++C) {
-      if (isChar6)
-        isChar6 = BitCodeAbbrevOp::isChar6(*C);
-      if ((unsigned char)*C & 128) {
-        is7Bit = false;
-        break;  // don't bother scanning the rest.
-      }
-    }
+    StringEncoding Bits =
+        getStringEncoding(Name.getKeyData(), Name.getKeyLength());
 
     unsigned AbbrevToUse = VST_ENTRY_8_ABBREV;
 
@@ -2026,13 +2060,13 @@ static void WriteValueSymbolTable(const ValueSymbolTable &VST,
     unsigned Code;
     if (isa<BasicBlock>(SI->getValue())) {
       Code = bitc::VST_CODE_BBENTRY;
-      if (isChar6)
+      if (Bits == SE_Char6)
         AbbrevToUse = VST_BBENTRY_6_ABBREV;
     } else {
       Code = bitc::VST_CODE_ENTRY;
-      if (isChar6)
+      if (Bits == SE_Char6)
         AbbrevToUse = VST_ENTRY_6_ABBREV;
-      else if (is7Bit)
+      else if (Bits == SE_Fixed7)
         AbbrevToUse = VST_ENTRY_7_ABBREV;
     }
 
@@ -2048,6 +2082,79 @@ static void WriteValueSymbolTable(const ValueSymbolTable &VST,
   Stream.ExitBlock();
 }
 
+/// Emit the module-level value symbol table, which follows the function
+/// blocks, and backpatch its offset into the VSTOFFSET record. Each function
+/// body gets a VST_FNENTRY record with the 32-bit word offset of its block,
+/// even if the function has no name, so that a reader can materialize any
+/// function without scanning the blocks of the others. Offsets are relative
+/// to the start of the bitcode, i.e. exclude any wrapper header.
+static void WriteModuleValueSymbolTable(
+    const Module *M, const ValueEnumerator &VE, BitstreamWriter &Stream,
+    uint64_t VSTOffsetPlaceholder, uint64_t BitcodeStartBit,
+    DenseMap<const Function *, uint64_t> &FunctionIndex) {
+  uint64_t VSTOffset = Stream.GetCurrentBitNo() - BitcodeStartBit;
+  assert((VSTOffset & 31) == 0 && "VST block not 32-bit aligned");
+  Stream.BackpatchField32(VSTOffsetPlaceholder, VSTOffset / 32);
+
+  Stream.EnterSubblock(bitc::VALUE_SYMTAB_BLOCK_ID, 4);
+
+  // VST_FNENTRY: [valueid, offset, namechar x N]
+  unsigned FnEntryAbbrevs[3];
+  for (StringEncoding Bits : {SE_Char6, SE_Fixed7, SE_Fixed8}) {
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::VST_CODE_FNENTRY));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8)); // value id
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8)); // function offset
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    if (Bits == SE_Char6)
+      Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Char6));
+    else
+      Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed,
+                                Bits == SE_Fixed7 ? 7 : 8));
+    FnEntryAbbrevs[Bits] = Stream.EmitAbbrev(Abbv);
+  }
+
+  SmallVector<uint64_t, 64> NameVals;
+  auto WriteEntry = [&](const Value *V, StringRef Name) {
+    StringEncoding Bits = getStringEncoding(Name.data(), Name.size());
+
+    // VST_ENTRY:   [valueid, namechar x N]
+    // VST_FNENTRY: [valueid, offset, namechar x N]
+    unsigned Code = bitc::VST_CODE_ENTRY;
+    unsigned AbbrevToUse = VST_ENTRY_8_ABBREV;
+    if (Bits == SE_Char6)
+      AbbrevToUse = VST_ENTRY_6_ABBREV;
+    else if (Bits == SE_Fixed7)
+      AbbrevToUse = VST_ENTRY_7_ABBREV;
+
+    NameVals.push_back(VE.getValueID(V));
+    auto *F = dyn_cast<Function>(V);
+    if (F && !F->isDeclaration()) {
+      Code = bitc::VST_CODE_FNENTRY;
+      AbbrevToUse = FnEntryAbbrevs[Bits];
+      uint64_t BitcodeIndex = FunctionIndex[F] - BitcodeStartBit;
+      assert((BitcodeIndex & 31) == 0 && "function block not 32-bit aligned");
+      NameVals.push_back(BitcodeIndex / 32);
+    }
+    NameVals.append(Name.bytes_begin(), Name.bytes_end());
+
+    // Emit the finished record.
+    Stream.EmitRecord(Code, NameVals, AbbrevToUse);
+    NameVals.clear();
+  };
+
+  for (const ValueName &Name : M->getValueSymbolTable())
+    WriteEntry(Name.getValue(), Name.getKey());
+
+  // Unnamed functions aren't in the symbol table, but still need the offset
+  // of their body.
+  for (const Function &F : *M)
+    if (!F.isDeclaration() && !F.hasName())
+      WriteEntry(&F, StringRef());
+
+  Stream.ExitBlock();
+}
+
 static void WriteUseList(ValueEnumerator &VE, UseListOrder &&Order,
                          BitstreamWriter &Stream) {
   assert(Order.Shuffle.size() >= 2 && "Shuffle too small");
@@ -2083,8 +2190,13 @@ static void WriteUseListBlock(const Function *F, ValueEnumerator &VE,
 }
 
 /// WriteFunction - Emit a function body to the module stream.
-static void WriteFunction(const Function &F, ValueEnumerator &VE,
-                          BitstreamWriter &Stream) {
+static void
+WriteFunction(const Function &F, ValueEnumerator &VE, BitstreamWriter &Stream,
+              DenseMap<const Function *, uint64_t> &FunctionIndex) {
+  // Save the bit position of the start of this function block, for the
+  // value symbol table.
+  FunctionIndex[&F] = Stream.GetCurrentBitNo();
+
   Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
   VE.incorporateFunction(F);
 
@@ -2330,9 +2442,178 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   Stream.ExitBlock();
 }
 
+namespace {
+/// A run of consecutive function bodies that WriteFunctionsInParallel encodes
+/// on one thread.
+struct FunctionChunk {
+  std::vector<const Function *> Functions;
+  UseListOrderStack UseListOrders;
+  SmallVector<char, 0> Buffer;
+  /// The range of bits of Buffer that holds the function blocks.
+  uint64_t BeginBit = 0, EndBit = 0;
+  /// The bit position in Buffer of each function block.
+  DenseMap<const Function *, uint64_t> FunctionIndex;
+};
+} // end anonymous namespace
+
+/// Encode the function blocks of \p Chunk to its own buffer, with a copy of
+/// \p ModuleVE.
+static void WriteFunctionChunk(const ValueEnumerator &ModuleVE,
+                               FunctionChunk &Chunk) {
+  ValueEnumerator VE(ModuleVE, std::move(Chunk.UseListOrders));
+  BitstreamWriter Stream(Chunk.Buffer);
+
+  // Function blocks are nested in the module block and use the abbrevs of
+  // the block info block, so set up the same state as the module stream.
+  Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
+  WriteBlockInfo(VE, Stream);
+
+  Chunk.BeginBit = Stream.GetCurrentBitNo();
+  for (const Function *F : Chunk.Functions)
+    WriteFunction(*F, VE, Stream, Chunk.FunctionIndex);
+  Chunk.EndBit = Stream.GetCurrentBitNo();
+  Stream.ExitBlock();
+}
+
+/// Emit the function blocks of \p M, encoding them on up to \p NumThreads
+/// threads. The functions are split in runs of about the same number of
+/// instructions, each encoded to a separate buffer by its own copy of \p VE,
+/// and the buffers are appended in order, so the output is the same as that
+/// of a serial write.
+static void
+WriteFunctionsInParallel(const Module *M, ValueEnumerator &VE,
+                         BitstreamWriter &Stream,
+                         DenseMap<const Function *, uint64_t> &FunctionIndex,
+                         unsigned NumThreads) {
+  std::vector<const Function *> Bodies;
+  uint64_t NumInsts = 0;
+  for (const Function &F : *M) {
+    if (F.isDeclaration())
+      continue;
+    Bodies.push_back(&F);
+    for (const BasicBlock &BB : F)
+      NumInsts += BB.size();
+  }
+
+  std::vector<FunctionChunk> Chunks(
+      std::min<size_t>(NumThreads, Bodies.size()));
+  DenseMap<const Function *, unsigned> ChunkOf;
+  uint64_t ChunkInsts = 0, InstsPerChunk = NumInsts / Chunks.size() + 1;
+  unsigned C = 0;
+  for (const Function *F : Bodies) {
+    Chunks[C].Functions.push_back(F);
+    ChunkOf[F] = C;
+    for (const BasicBlock &BB : *F)
+      ChunkInsts += BB.size();
+    if (ChunkInsts >= InstsPerChunk * (C + 1) && C + 1 != Chunks.size())
+      ++C;
+  }
+
+  // Hand the use-list orders of each function to the chunk that writes it.
+  // The stack is popped from the back, so keep the order within a chunk.
+  for (UseListOrder &Order : VE.UseListOrders) {
+    assert(Order.F && "Module-level use-list orders should be written");
+    Chunks[ChunkOf[Order.F]].UseListOrders.push_back(std::move(Order));
+  }
+  VE.UseListOrders.clear();
+
+  {
+    ThreadPool Pool(NumThreads);
+    for (FunctionChunk &Chunk : Chunks)
+      Pool.async([&VE, &Chunk] { WriteFunctionChunk(VE, Chunk); });
+    Pool.wait();
+  }
+
+  for (FunctionChunk &Chunk : Chunks) {
+    uint64_t Base = Stream.GetCurrentBitNo();
+    Stream.EmitAlignedBlocks(
+        StringRef(Chunk.Buffer.data() + Chunk.BeginBit / 8,
+                  (Chunk.EndBit - Chunk.BeginBit) / 8));
+    for (const auto &Entry : Chunk.FunctionIndex)
+      FunctionIndex[Entry.first] = Entry.second - Chunk.BeginBit + Base;
+  }
+}
+
+/// Emit a function summary block for the summaries in \p Index. Names are
+/// emitted as NAME records on first use and referred to by their index. If
+/// \p M is given, this is the per-module summary of M and the entries follow
+/// the order of the functions in M; otherwise this is a combined index, and
+/// the module paths are emitted first.
+static void WriteFunctionSummaryBlock(const FunctionInfoIndex &Index,
+                                      const Module *M,
+                                      BitstreamWriter &Stream) {
+  Stream.EnterSubblock(bitc::FUNCTION_SUMMARY_BLOCK_ID, 3);
+
+  // Abbrev for FS_CODE_NAME and FS_CODE_MODULE_PATH.
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FS_CODE_NAME));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+  unsigned NameAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<uint64_t, 64> Vals;
+  if (!M) {
+    for (const auto &ModPath : Index.modulePaths()) {
+      Vals.push_back(ModPath.second);
+      Vals.append(ModPath.first().begin(), ModPath.first().end());
+      Stream.EmitRecord(bitc::FS_CODE_MODULE_PATH, Vals);
+      Vals.clear();
+    }
+  }
+
+  StringMap<unsigned> NameIds;
+  auto getNameId = [&](StringRef Name) {
+    auto Res = NameIds.insert(std::make_pair(Name, NameIds.size()));
+    if (Res.second) {
+      SmallVector<unsigned, 64> NameVals(Name.begin(), Name.end());
+      Stream.EmitRecord(bitc::FS_CODE_NAME, NameVals, NameAbbrev);
+    }
+    return Res.first->second;
+  };
+
+  auto writeEntry = [&](StringRef Name, const FunctionSummary &Summary) {
+    // Emit the names first so that the entry only refers to known ids.
+    unsigned NameId = getNameId(Name);
+    SmallVector<unsigned, 8> CalleeIds;
+    for (StringRef Callee : Summary.callees())
+      CalleeIds.push_back(getNameId(Callee));
+
+    // PERMODULE_ENTRY: [nameid, linkage, instcount, flags, calleenameid x N]
+    // COMBINED_ENTRY: [modid, nameid, linkage, instcount, flags,
+    //                  calleenameid x N]
+    if (!M)
+      Vals.push_back(Index.getModuleId(Summary.modulePath()));
+    Vals.push_back(NameId);
+    Vals.push_back(getEncodedLinkage(Summary.getLinkage()));
+    Vals.push_back(Summary.instCount());
+    Vals.push_back(Summary.isEligibleForImport() ? 1 : 0);
+    Vals.append(CalleeIds.begin(), CalleeIds.end());
+    Stream.EmitRecord(M ? bitc::FS_CODE_PERMODULE_ENTRY
+                        : bitc::FS_CODE_COMBINED_ENTRY,
+                      Vals);
+    Vals.clear();
+  };
+
+  if (M) {
+    for (const Function &F : *M)
+      if (const FunctionSummaryList *Summaries =
+              Index.findFunctionSummaries(F.getName()))
+        for (const auto &Summary : *Summaries)
+          writeEntry(F.getName(), *Summary);
+  } else {
+    for (const auto &FuncSummaries : Index)
+      for (const auto &Summary : FuncSummaries.second)
+        writeEntry(FuncSummaries.first(), *Summary);
+  }
+
+  Stream.ExitBlock();
+}
+
 /// WriteModule - Emit the specified module to the bitstream.
 static void WriteModule(const Module *M, BitstreamWriter &Stream,
-                        bool ShouldPreserveUseListOrder) {
+                        bool ShouldPreserveUseListOrder,
+                        bool EmitFunctionSummary, unsigned NumThreads,
+                        uint64_t BitcodeStartBit) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
   SmallVector<unsigned, 1> Vals;
@@ -2359,7 +2640,7 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream,
 
   // Emit top-level description of module, including target triple, inline asm,
   // descriptors for global variables, and function prototype info.
-  WriteModuleInfo(M, VE, Stream);
+  uint64_t VSTOffsetPlaceholder = WriteModuleInfo(M, VE, Stream);
 
   // Emit constants.
   WriteModuleConstants(VE, Stream);
@@ -2370,17 +2651,38 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream,
   // Emit metadata.
   WriteModuleMetadataStore(M, Stream);
 
-  // Emit names for globals/functions etc.
-  WriteValueSymbolTable(M->getValueSymbolTable(), VE, Stream);
+  // Emit names for globals/functions etc. If there are function bodies, this
+  // is done after them.
+  if (!VSTOffsetPlaceholder)
+    WriteValueSymbolTable(M->getValueSymbolTable(), VE, Stream);
 
   // Emit module-level use-lists.
   if (VE.shouldPreserveUseListOrder())
     WriteUseListBlock(nullptr, VE, Stream);
 
-  // Emit function bodies.
-  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
-    if (!F->isDeclaration())
-      WriteFunction(*F, VE, Stream);
+  // Emit function bodies. They can only be encoded separately from a 32-bit
+  // aligned position, which the end of the preceding block is.
+  DenseMap<const Function *, uint64_t> FunctionIndex;
+  if (NumThreads == 0)
+    NumThreads = thread::hardware_concurrency();
+  if (NumThreads > 1 && VSTOffsetPlaceholder &&
+      (Stream.GetCurrentBitNo() & 31) == 0)
+    WriteFunctionsInParallel(M, VE, Stream, FunctionIndex, NumThreads);
+  else
+    for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+      if (!F->isDeclaration())
+        WriteFunction(*F, VE, Stream, FunctionIndex);
+
+  if (VSTOffsetPlaceholder)
+    WriteModuleValueSymbolTable(M, VE, Stream, VSTOffsetPlaceholder,
+                                BitcodeStartBit, FunctionIndex);
+
+  // Emit the function summaries used for cross-module importing.
+  if (EmitFunctionSummary) {
+    FunctionInfoIndex Index;
+    Index.addModule(*M, M->getModuleIdentifier());
+    WriteFunctionSummaryBlock(Index, M, Stream);
+  }
 
   Stream.ExitBlock();
 }
@@ -2458,10 +2760,21 @@ static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
     Buffer.push_back(0);
 }
 
+/// Emit the bitcode file header, i.e. the 'BC' 0xC0DE magic number.
+static void WriteBitcodeHeader(BitstreamWriter &Stream) {
+  Stream.Emit((unsigned)'B', 8);
+  Stream.Emit((unsigned)'C', 8);
+  Stream.Emit(0x0, 4);
+  Stream.Emit(0xC, 4);
+  Stream.Emit(0xE, 4);
+  Stream.Emit(0xD, 4);
+}
+
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
 void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
-                              bool ShouldPreserveUseListOrder) {
+                              bool ShouldPreserveUseListOrder,
+                              bool EmitFunctionSummary, unsigned NumThreads) {
   SmallVector<char, 0> Buffer;
   Buffer.reserve(256*1024);
 
@@ -2474,17 +2787,15 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
   // Emit the module into the buffer.
   {
     BitstreamWriter Stream(Buffer);
+    // Offsets within the bitcode are relative to its start, after any header.
+    uint64_t BitcodeStartBit = Stream.GetCurrentBitNo();
 
     // Emit the file header.
-    Stream.Emit((unsigned)'B', 8);
-    Stream.Emit((unsigned)'C', 8);
-    Stream.Emit(0x0, 4);
-    Stream.Emit(0xC, 4);
-    Stream.Emit(0xE, 4);
-    Stream.Emit(0xD, 4);
+    WriteBitcodeHeader(Stream);
 
     // Emit the module.
-    WriteModule(M, Stream, ShouldPreserveUseListOrder);
+    WriteModule(M, Stream, ShouldPreserveUseListOrder, EmitFunctionSummary,
+                NumThreads, BitcodeStartBit);
   }
 
   if (TT.isOSDarwin())
@@ -2493,3 +2804,21 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
   // Write the generated bitstream to "Out".
   Out.write((char*)&Buffer.front(), Buffer.size());
 }
+
+void llvm::WriteFunctionSummaryToFile(const FunctionInfoIndex &Index,
+                                      raw_ostream &Out) {
+  SmallVector<char, 0> Buffer;
+  Buffer.reserve(256 * 1024);
+
+  {
+    BitstreamWriter Stream(Buffer);
+
+    // Emit the file header.
+    WriteBitcodeHeader(Stream);
+
+    // Emit the combined index as the only top-level block.
+    WriteFunctionSummaryBlock(Index, nullptr, Stream);
+  }
+
+  Out.write((char *)&Buffer.front(), Buffer.size());
+}
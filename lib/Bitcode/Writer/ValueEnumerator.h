@@ -105,6 +105,12 @@ private:
 public:
   ValueEnumerator(const Module &M, bool ShouldPreserveUseListOrder);
 
+  /// Copy the module-level state of \p VE, which must not have a function
+  /// incorporated, so that function blocks can be written with the copy on
+  /// another thread. \p Orders are the use-list orders of the functions the
+  /// copy is used for.
+  ValueEnumerator(const ValueEnumerator &VE, UseListOrderStack &&Orders);
+
   void dump() const;
   void print(raw_ostream &OS, const ValueMapType &Map, const char *Name) const;
   void print(raw_ostream &OS, const MetadataMapType &Map,
@@ -204,8 +204,9 @@ bool AsmPrinter::doInitialization(Module &M) {
   EmitStartOfAsmFile(M);
 
   // Very minimal debug info. It is ignored if we emit actual debug info. If we
-  // don't, this at least helps the user find where a global came from.
-  if (MAI->hasSingleParameterDotFile()) {
+  // don't, this at least helps the user find where a global came from. When a
+  // module is code generated in pieces only the first piece names the file.
+  if (MAI->hasSingleParameterDotFile() && TM.getFirstFunctionNumber() == 0) {
     // .file "foo.c"
     OutStreamer->EmitFileDirective(M.getModuleIdentifier());
   }
@@ -1018,23 +1019,27 @@ bool AsmPrinter::doFinalization(Module &M) {
   // where the got equivalent shows up before its use.
   computeGlobalGOTEquivs(M);
 
-  // Emit global variables.
-  for (const auto &G : M.globals())
-    EmitGlobalVariable(&G);
+  // When a module is code generated in pieces, the global variables and the
+  // declarations all go with the last piece.
+  if (TM.isLastCodeGenPart()) {
+    // Emit global variables.
+    for (const auto &G : M.globals())
+      EmitGlobalVariable(&G);
 
-  // Emit remaining GOT equivalent globals.
-  emitGlobalGOTEquivs();
+    // Emit remaining GOT equivalent globals.
+    emitGlobalGOTEquivs();
 
-  // Emit visibility info for declarations
-  for (const Function &F : M) {
-    if (!F.isDeclaration())
-      continue;
-    GlobalValue::VisibilityTypes V = F.getVisibility();
-    if (V == GlobalValue::DefaultVisibility)
-      continue;
+    // Emit visibility info for declarations
+    for (const Function &F : M) {
+      if (!F.isDeclaration())
+        continue;
+      GlobalValue::VisibilityTypes V = F.getVisibility();
+      if (V == GlobalValue::DefaultVisibility)
+        continue;
 
-    MCSymbol *Name = getSymbol(&F);
-    EmitVisibility(Name, V, false);
+      MCSymbol *Name = getSymbol(&F);
+      EmitVisibility(Name, V, false);
+    }
   }
 
   const TargetLoweringObjectFile &TLOF = getObjFileLowering();
@@ -1096,7 +1101,8 @@ bool AsmPrinter::doFinalization(Module &M) {
     }
   }
 
-  OutStreamer->AddBlankLine();
+  if (TM.isLastCodeGenPart())
+    OutStreamer->AddBlankLine();
   for (const auto &Alias : M.aliases()) {
     MCSymbol *Name = getSymbol(&Alias);
 
@@ -1141,7 +1147,8 @@ bool AsmPrinter::doFinalization(Module &M) {
   // If we don't have any trampolines, then we don't require stack memory
   // to be executable. Some targets have a directive to declare this.
   Function *InitTrampolineIntrinsic = M.getFunction("llvm.init.trampoline");
-  if (!InitTrampolineIntrinsic || InitTrampolineIntrinsic->use_empty())
+  if ((!InitTrampolineIntrinsic || InitTrampolineIntrinsic->use_empty()) &&
+      TM.isLastCodeGenPart())
     if (MCSection *S = MAI->getNonexecutableStackSection(OutContext))
       OutStreamer->SwitchSection(S);
 
@@ -141,31 +141,15 @@ addPassesToGenerateCode(LLVMTargetMachine *TM, PassManagerBase &PM,
   return &MMI->getContext();
 }
 
-bool LLVMTargetMachine::addPassesToEmitFile(
-    PassManagerBase &PM, raw_pwrite_stream &Out, CodeGenFileType FileType,
-    bool DisableVerify, AnalysisID StartAfter, AnalysisID StopAfter,
-    MachineFunctionInitializer *MFInitializer) {
-  // Add common CodeGen passes.
-  MCContext *Context = addPassesToGenerateCode(
-      this, PM, DisableVerify, StartAfter, StopAfter, MFInitializer);
-  if (!Context)
-    return true;
-
-  if (StopAfter) {
-    PM.add(createPrintMIRPass(outs()));
-    return false;
-  }
-
-  if (Options.MCOptions.MCSaveTempLabels)
-    Context->setAllowTemporaryLabels(false);
-
+std::unique_ptr<MCStreamer>
+LLVMTargetMachine::createMCStreamer(raw_pwrite_stream &Out,
+                                    CodeGenFileType FileType,
+                                    MCContext &Context) {
   const MCSubtargetInfo &STI = *getMCSubtargetInfo();
   const MCAsmInfo &MAI = *getMCAsmInfo();
   const MCRegisterInfo &MRI = *getMCRegisterInfo();
   const MCInstrInfo &MII = *getMCInstrInfo();
 
-  std::unique_ptr<MCStreamer> AsmStreamer;
-
   switch (FileType) {
   case CGFT_AssemblyFile: {
     MCInstPrinter *InstPrinter = getTarget().createMCInstPrinter(
@@ -174,43 +158,64 @@ bool LLVMTargetMachine::addPassesToEmitFile(
     // Create a code emitter if asked to show the encoding.
     MCCodeEmitter *MCE = nullptr;
     if (Options.MCOptions.ShowMCEncoding)
-      MCE = getTarget().createMCCodeEmitter(MII, MRI, *Context);
+      MCE = getTarget().createMCCodeEmitter(MII, MRI, Context);
 
     MCAsmBackend *MAB =
         getTarget().createMCAsmBackend(MRI, getTargetTriple().str(), TargetCPU);
     auto FOut = llvm::make_unique<formatted_raw_ostream>(Out);
-    MCStreamer *S = getTarget().createAsmStreamer(
-        *Context, std::move(FOut), Options.MCOptions.AsmVerbose,
+    return std::unique_ptr<MCStreamer>(getTarget().createAsmStreamer(
+        Context, std::move(FOut), Options.MCOptions.AsmVerbose,
         Options.MCOptions.MCUseDwarfDirectory, InstPrinter, MCE, MAB,
-        Options.MCOptions.ShowMCInst);
-    AsmStreamer.reset(S);
-    break;
+        Options.MCOptions.ShowMCInst));
   }
   case CGFT_ObjectFile: {
     // Create the code emitter for the target if it exists.  If not, .o file
     // emission fails.
-    MCCodeEmitter *MCE = getTarget().createMCCodeEmitter(MII, MRI, *Context);
+    MCCodeEmitter *MCE = getTarget().createMCCodeEmitter(MII, MRI, Context);
     MCAsmBackend *MAB =
         getTarget().createMCAsmBackend(MRI, getTargetTriple().str(), TargetCPU);
     if (!MCE || !MAB)
-      return true;
+      return nullptr;
 
     // Don't waste memory on names of temp labels.
-    Context->setUseNamesOnTempLabels(false);
+    Context.setUseNamesOnTempLabels(false);
 
     Triple T(getTargetTriple().str());
-    AsmStreamer.reset(getTarget().createMCObjectStreamer(
-        T, *Context, *MAB, Out, MCE, STI, Options.MCOptions.MCRelaxAll,
+    return std::unique_ptr<MCStreamer>(getTarget().createMCObjectStreamer(
+        T, Context, *MAB, Out, MCE, STI, Options.MCOptions.MCRelaxAll,
         /*DWARFMustBeAtTheEnd*/ true));
-    break;
   }
   case CGFT_Null:
     // The Null output is intended for use for performance analysis and testing,
     // not real users.
-    AsmStreamer.reset(getTarget().createNullStreamer(*Context));
-    break;
+    return std::unique_ptr<MCStreamer>(getTarget().createNullStreamer(Context));
+  }
+  llvm_unreachable("Invalid file type");
+}
+
+bool LLVMTargetMachine::addPassesToEmitFile(
+    PassManagerBase &PM, raw_pwrite_stream &Out, CodeGenFileType FileType,
+    bool DisableVerify, AnalysisID StartAfter, AnalysisID StopAfter,
+    MachineFunctionInitializer *MFInitializer) {
+  // Add common CodeGen passes.
+  MCContext *Context = addPassesToGenerateCode(
+      this, PM, DisableVerify, StartAfter, StopAfter, MFInitializer);
+  if (!Context)
+    return true;
+
+  if (StopAfter) {
+    PM.add(createPrintMIRPass(outs()));
+    return false;
   }
 
+  if (Options.MCOptions.MCSaveTempLabels)
+    Context->setAllowTemporaryLabels(false);
+
+  std::unique_ptr<MCStreamer> AsmStreamer =
+      createMCStreamer(Out, FileType, *Context);
+  if (!AsmStreamer)
+    return true;
+
   // Create the AsmPrinter, which takes ownership of AsmStreamer if successful.
   FunctionPass *Printer =
       getTarget().createAsmPrinter(*this, std::move(AsmStreamer));
@@ -222,6 +227,34 @@ bool LLVMTargetMachine::addPassesToEmitFile(
   return false;
 }
 
+bool LLVMTargetMachine::addPassesToEmitStreamer(
+    PassManagerBase &PM,
+    function_ref<std::unique_ptr<MCStreamer>(MCContext &)> CreateStreamer) {
+  // Add common CodeGen passes.
+  MCContext *Context =
+      addPassesToGenerateCode(this, PM, /*DisableVerify*/ true, nullptr,
+                              nullptr);
+  if (!Context)
+    return true;
+
+  if (Options.MCOptions.MCSaveTempLabels)
+    Context->setAllowTemporaryLabels(false);
+
+  std::unique_ptr<MCStreamer> Streamer = CreateStreamer(*Context);
+  if (!Streamer)
+    return true;
+
+  // Create the AsmPrinter, which takes ownership of Streamer if successful.
+  FunctionPass *Printer =
+      getTarget().createAsmPrinter(*this, std::move(Streamer));
+  if (!Printer)
+    return true;
+
+  PM.add(Printer);
+
+  return false;
+}
+
 /// addPassesToEmitMC - Add passes to the specified pass manager to get
 /// machine code emitted with the MCJIT. This method returns true if machine
 /// code is not supported. It fills the MCContext Ctx pointer which can be
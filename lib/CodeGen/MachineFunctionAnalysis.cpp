@@ -16,6 +16,7 @@
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
 #include "llvm/CodeGen/MachineFunctionInitializer.h"
+#include "llvm/Target/TargetMachine.h"
 using namespace llvm;
 
 char MachineFunctionAnalysis::ID = 0;
@@ -40,7 +41,7 @@ bool MachineFunctionAnalysis::doInitialization(Module &M) {
   MachineModuleInfo *MMI = getAnalysisIfAvailable<MachineModuleInfo>();
   assert(MMI && "MMI not around yet??");
   MMI->setModule(&M);
-  NextFnNum = 0;
+  NextFnNum = TM.getFirstFunctionNumber();
   return false;
 }
 
@@ -0,0 +1,1021 @@
+//===-- ParallelCG.cpp ----------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines functions that can be used for parallel code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/MCAsmInfo.h"
+#include "llvm/MC/MCContext.h"
+#include "llvm/MC/MCExpr.h"
+#include "llvm/MC/MCInst.h"
+#include "llvm/MC/MCObjectFileInfo.h"
+#include "llvm/MC/MCSectionELF.h"
+#include "llvm/MC/MCStreamer.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/MC/MCSymbolELF.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/thread.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+using namespace llvm;
+
+static void codegen(Module *M, llvm::raw_pwrite_stream &OS,
+                    const Target *TheTarget, StringRef CPU, StringRef Features,
+                    const TargetOptions &Options, Reloc::Model RM,
+                    CodeModel::Model CM, CodeGenOpt::Level OL,
+                    TargetMachine::CodeGenFileType FileType) {
+  std::unique_ptr<TargetMachine> TM(TheTarget->createTargetMachine(
+      M->getTargetTriple(), CPU, Features, Options, RM, CM, OL));
+
+  legacy::PassManager CodeGenPasses;
+  if (TM->addPassesToEmitFile(CodeGenPasses, OS, FileType))
+    report_fatal_error("Failed to setup codegen");
+  CodeGenPasses.run(*M);
+}
+
+void llvm::splitCodeGen(Module &M, ArrayRef<llvm::raw_pwrite_stream *> OSs,
+                        StringRef CPU, StringRef Features,
+                        const TargetOptions &Options, Reloc::Model RM,
+                        CodeModel::Model CM, CodeGenOpt::Level OL,
+                        TargetMachine::CodeGenFileType FileType,
+                        std::function<bool(unsigned, StringRef)> ReuseOutput) {
+  StringRef TripleStr = M.getTargetTriple();
+  std::string ErrMsg;
+  const Target *TheTarget = TargetRegistry::lookupTarget(TripleStr, ErrMsg);
+  if (!TheTarget)
+    report_fatal_error(Twine("Target not found: ") + ErrMsg);
+
+  if (OSs.size() == 1) {
+    codegen(&M, *OSs[0], TheTarget, CPU, Features, Options, RM, CM, OL,
+            FileType);
+    return;
+  }
+
+  std::vector<thread> Threads;
+  unsigned NumParts = 0;
+  SplitModule(M, OSs.size(), [&](std::unique_ptr<Module> MPart) {
+    // We want to clone the module in a new context to multi-thread the codegen.
+    // We do it by serializing partition modules to bitcode (while still on the
+    // main thread, in order to avoid data races) and spinning up new threads
+    // which deserialize the partitions into separate contexts.
+    // FIXME: Provide a more direct way to do this in LLVM.
+    SmallVector<char, 0> BC;
+    {
+      raw_svector_ostream BCOS(BC);
+      WriteBitcodeToFile(MPart.get(), BCOS);
+    }
+
+    unsigned PartIdx = NumParts++;
+    if (ReuseOutput && ReuseOutput(PartIdx, StringRef(BC.data(), BC.size())))
+      return;
+
+    llvm::raw_pwrite_stream *ThreadOS = OSs[PartIdx];
+    Threads.emplace_back(
+        [TheTarget, CPU, Features, Options, RM, CM, OL, FileType,
+         ThreadOS](const SmallVector<char, 0> &BC) {
+          LLVMContext Ctx;
+          ErrorOr<std::unique_ptr<Module>> MOrErr =
+              parseBitcodeFile(MemoryBufferRef(StringRef(BC.data(), BC.size()),
+                                               "<split-module>"),
+                               Ctx);
+          if (!MOrErr)
+            report_fatal_error("Failed to read bitcode");
+          std::unique_ptr<Module> MPartInCtx = std::move(MOrErr.get());
+
+          codegen(MPartInCtx.get(), *ThreadOS, TheTarget, CPU, Features,
+                  Options, RM, CM, OL, FileType);
+        },
+        // Pass BC using std::move to ensure that it get moved rather than
+        // copied into the thread's context.
+        std::move(BC));
+  });
+
+  for (thread &T : Threads)
+    T.join();
+}
+
+/// Return true if pieces of M can be code generated separately and their
+/// output replayed in order into one streamer. This rules out state that the
+/// AsmPrinter collects over the whole module (debug info, GC tables, stack
+/// maps, indirect personality references, the use of trampolines or of
+/// __morestack_addr), block labels that other functions may refer to, ${:uid}
+/// operands in inline asm, which are numbered per AsmPrinter, unnamed global
+/// values, which are numbered per Mangler, and aliases of functions, which are
+/// emitted after the global variables rather than with the function.
+static bool canCodeGenInPieces(const Module &M, const TargetMachine &TM) {
+  if (!TM.getTargetTriple().isOSBinFormatELF())
+    return false;
+  if (M.getNamedMetadata("llvm.dbg.cu"))
+    return false;
+
+  for (const GlobalVariable &GV : M.globals())
+    if (!GV.hasName())
+      return false;
+  for (const GlobalAlias &GA : M.aliases())
+    if (!GA.hasName() || !dyn_cast_or_null<GlobalVariable>(GA.getBaseObject()))
+      return false;
+
+  for (const Function &F : M) {
+    if (!F.hasName())
+      return false;
+    if (F.isDeclaration()) {
+      switch (F.getIntrinsicID()) {
+      case Intrinsic::experimental_stackmap:
+      case Intrinsic::experimental_patchpoint_void:
+      case Intrinsic::experimental_patchpoint_i64:
+      case Intrinsic::experimental_gc_statepoint:
+      case Intrinsic::init_trampoline:
+        if (!F.use_empty())
+          return false;
+        break;
+      default:
+        break;
+      }
+      continue;
+    }
+
+    if (F.hasGC() || F.hasFnAttribute("split-stack"))
+      return false;
+
+    for (const BasicBlock &BB : F) {
+      if (BB.hasAddressTaken())
+        return false;
+      for (const Instruction &I : BB) {
+        if (isa<LandingPadInst>(I) && TM.getRelocationModel() == Reloc::PIC_)
+          return false;
+        ImmutableCallSite CS(&I);
+        if (!CS)
+          continue;
+        if (const InlineAsm *IA = dyn_cast<InlineAsm>(CS.getCalledValue()))
+          if (IA->getAsmString().find("${:uid}") != std::string::npos)
+            return false;
+      }
+    }
+  }
+  return true;
+}
+
+static GlobalValue::ThreadLocalMode getThreadLocalMode(TLSModel::Model Model) {
+  switch (Model) {
+  case TLSModel::GeneralDynamic:
+    return GlobalValue::GeneralDynamicTLSModel;
+  case TLSModel::LocalDynamic:
+    return GlobalValue::LocalDynamicTLSModel;
+  case TLSModel::InitialExec:
+    return GlobalValue::InitialExecTLSModel;
+  case TLSModel::LocalExec:
+    return GlobalValue::LocalExecTLSModel;
+  }
+  llvm_unreachable("invalid TLS model");
+}
+
+/// Adjust MPiece, a clone of M holding one piece of its definitions, so that
+/// its output can be joined with that of the other pieces.
+static void preparePiece(Module &MPiece, const Module &M,
+                         const TargetMachine &TM, const Mangler &Mang,
+                         bool IsFirst, bool IsLast) {
+  // Everything that is only emitted once per module goes with the first or
+  // the last piece, which then also keeps the unused declarations.
+  if (!IsFirst)
+    MPiece.setModuleInlineAsm("");
+  if (!IsLast) {
+    if (NamedMDNode *Ident = MPiece.getNamedMetadata("llvm.ident"))
+      MPiece.eraseNamedMetadata(Ident);
+    for (auto I = MPiece.begin(), E = MPiece.end(); I != E;) {
+      Function &F = *I++;
+      F.removeDeadConstantUsers();
+      if (F.isDeclaration() && F.use_empty())
+        F.eraseFromParent();
+    }
+    for (auto I = MPiece.global_begin(), E = MPiece.global_end(); I != E;) {
+      GlobalVariable &GV = *I++;
+      GV.removeDeadConstantUsers();
+      if (GV.isDeclaration() && GV.use_empty())
+        GV.eraseFromParent();
+    }
+  }
+
+  // A function or alias defined by another piece becomes a declaration in
+  // this one, but it ends up in the same output as its definition. Access
+  // thread local ones with the TLS model of the definition. Refer to local ones
+  // by the name they are defined with, and with PIC keep the references to
+  // them direct by giving the declaration hidden visibility; the visibility
+  // directives emitted for symbols defined by another piece are dropped when
+  // the pieces are joined.
+  bool IsPIC = TM.getRelocationModel() == Reloc::PIC_;
+  auto ReferToDefinition = [&](GlobalValue &GV) {
+    if (!GV.isDeclaration())
+      return;
+    const GlobalValue *Orig = M.getNamedValue(GV.getName());
+    if (!Orig || Orig->isDeclaration())
+      return;
+    if (GV.isThreadLocal())
+      GV.setThreadLocalMode(getThreadLocalMode(TM.getTLSModel(Orig)));
+    if (!Orig->hasLocalLinkage())
+      return;
+    if (IsPIC)
+      GV.setVisibility(GlobalValue::HiddenVisibility);
+    if (Orig->hasPrivateLinkage()) {
+      SmallString<64> Name("\1");
+      Mang.getNameWithPrefix(Name, Orig, false);
+      GV.setName(Name);
+    }
+  };
+  for (Function &F : MPiece)
+    ReferToDefinition(F);
+  for (GlobalVariable &GV : MPiece.globals())
+    ReferToDefinition(GV);
+}
+
+/// The base names that CodeGen gives the temporary symbols it creates. The
+/// context numbers the symbols of each base name in the order they are created.
+static const char *const TempBases[] = {"tmp", "func_begin", "func_end",
+                                        "exception"};
+static const unsigned NumTempBases = array_lengthof(TempBases);
+
+/// Split \p Name, the name of a temporary symbol without its prefix, into the
+/// base name and number given to MCContext::createTempSymbol.
+static bool parseTempName(StringRef Name, StringRef &Base, unsigned &Number) {
+  size_t DigitsStart = Name.find_last_not_of("0123456789") + 1;
+  Base = Name.substr(0, DigitsStart);
+  return !Base.empty() && DigitsStart != Name.size() &&
+         !Name.substr(DigitsStart).getAsInteger(10, Number);
+}
+
+static int getTempBaseIndex(StringRef Base) {
+  for (unsigned I = 0; I != NumTempBases; ++I)
+    if (Base == TempBases[I])
+      return I;
+  return -1;
+}
+
+namespace {
+
+/// The streamer that the pieces of a module are replayed into, one after the
+/// other in their original order.
+struct JoinedOutput {
+  JoinedOutput(MCStreamer &Main, StringMap<unsigned> DefiningPieces)
+      : Main(Main), IsVerboseAsm(Main.isVerboseAsm()),
+        HasRawTextSupport(Main.hasRawTextSupport()),
+        DefiningPieces(std::move(DefiningPieces)) {}
+
+  MCStreamer &Main;
+  bool IsVerboseAsm;
+  bool HasRawTextSupport;
+
+  /// The piece that defines each function, by symbol name.
+  StringMap<unsigned> DefiningPieces;
+
+  /// The temporary symbols of the main context, by base name and number. The
+  /// entries are null for the labels that the main streamer created itself.
+  StringMap<std::vector<MCSymbol *>> Temps;
+
+  /// The number of temporary symbols of each base name in TempBases that the
+  /// pieces replayed so far created.
+  unsigned NumTemps[NumTempBases] = {};
+
+  /// Copies of the subtargets that the pieces emitted instructions for, which
+  /// the main streamer may refer to until it is finished.
+  std::vector<std::unique_ptr<MCSubtargetInfo>> Subtargets;
+
+  /// The unique ID given to the next unique section of the main streamer.
+  unsigned NextUniqueID = 0;
+
+  /// The index of the piece whose turn it is to be replayed.
+  unsigned NextPiece = 0;
+  std::mutex Mutex;
+  std::condition_variable TurnChanged;
+};
+
+/// A streamer that records what the AsmPrinter of one piece emits. When the
+/// piece is finished, it waits for the pieces before it and then replays its
+/// output into the main streamer, translating the symbols, sections and
+/// expressions of the piece into those of the main context. Temporary symbols
+/// are renumbered after those of the pieces before it. Operations that can't
+/// be translated are fatal errors.
+class PieceRecorder : public MCStreamer {
+  JoinedOutput &Out;
+  unsigned Piece;
+  std::vector<std::function<void()>> Events;
+  std::string Comments;
+  raw_string_ostream CommentOS;
+
+  DenseMap<const MCSymbol *, MCSymbol *> Symbols;
+  DenseMap<const MCSection *, MCSection *> Sections;
+  DenseMap<unsigned, unsigned> UniqueIDs;
+  std::vector<std::unique_ptr<MCSubtargetInfo>> Subtargets;
+
+  /// The number of temporary symbols of each base name that this piece
+  /// created, and that the pieces before it created.
+  unsigned NumTemps[NumTempBases] = {};
+  unsigned TempOffsets[NumTempBases] = {};
+
+  /// The label that the base class gave the frame instruction being recorded.
+  bool InFrameInstruction = false;
+  MCSymbol *FrameLabel = nullptr;
+
+  MCStreamer &main() { return Out.Main; }
+  MCContext &mainContext() { return Out.Main.getContext(); }
+  StringRef privatePrefix() {
+    return getContext().getAsmInfo()->getPrivateGlobalPrefix();
+  }
+
+  /// Record \p Event, after the comments that were added before it.
+  void record(std::function<void()> Event) {
+    flushComments();
+    Events.push_back(std::move(Event));
+  }
+
+  void flushComments() {
+    CommentOS.flush();
+    if (Comments.empty())
+      return;
+    std::string Text;
+    Text.swap(Comments);
+    Events.push_back(
+        [this, Text] { main().GetCommentOS() << renumberTemps(Text); });
+  }
+
+  /// Record a frame instruction, which \p EmitBase adds to the frame of the
+  /// piece and \p EmitMain to that of the main streamer. Both label it with a
+  /// new temporary symbol, and the main one is given the number that the
+  /// module would give it.
+  void recordFrameInstruction(function_ref<void()> EmitBase,
+                              std::function<void()> EmitMain);
+
+  MCSymbol *mapSymbol(const MCSymbol *Sym);
+  MCSymbol *createMainTemp(StringRef Base);
+  MCSymbol *getMainTemp(StringRef Base, unsigned Number);
+  std::string renumberTemps(StringRef Text);
+  MCSection *mapSection(MCSection *Section);
+  const MCExpr *mapExpr(const MCExpr *Expr);
+  MCInst mapInst(const MCInst &Inst);
+  const MCSubtargetInfo &copySubtarget(const MCSubtargetInfo &STI);
+
+public:
+  PieceRecorder(MCContext &Context, JoinedOutput &Out, unsigned Piece)
+      : MCStreamer(Context), Out(Out), Piece(Piece), CommentOS(Comments) {}
+
+  bool isVerboseAsm() const override { return Out.IsVerboseAsm; }
+  bool hasRawTextSupport() const override { return Out.HasRawTextSupport; }
+
+  void AddComment(const Twine &T) override {
+    if (Out.IsVerboseAsm)
+      CommentOS << T << '\n';
+  }
+  raw_ostream &GetCommentOS() override {
+    if (!Out.IsVerboseAsm)
+      return nulls();
+    return CommentOS;
+  }
+  void emitRawComment(const Twine &T, bool TabPrefix) override {
+    std::string Text = T.str();
+    record([=] { main().emitRawComment(renumberTemps(Text), TabPrefix); });
+  }
+  void AddBlankLine() override {
+    record([=] { main().AddBlankLine(); });
+  }
+
+  void InitSections(bool NoExecStack) override {
+    // Only the first piece starts the file. The others start in the text
+    // section, which the switch recorded by the base class leads to.
+    if (Piece == 0)
+      record([=] { main().InitSections(NoExecStack); });
+    MCStreamer::InitSections(NoExecStack);
+  }
+  void ChangeSection(MCSection *Section, const MCExpr *Subsection) override {
+    record([=] {
+      main().SwitchSection(mapSection(Section), mapExpr(Subsection));
+    });
+  }
+
+  void EmitLabel(MCSymbol *Symbol) override {
+    // The main streamer emits the labels at the start of its sections and
+    // those of frame instructions itself.
+    bool IsSectionStart =
+        Symbol == getCurrentSection().first->getBeginSymbol();
+    MCStreamer::EmitLabel(Symbol);
+    if (InFrameInstruction)
+      FrameLabel = Symbol;
+    else if (!IsSectionStart)
+      record([=] { main().EmitLabel(mapSymbol(Symbol)); });
+  }
+  void EmitAssemblerFlag(MCAssemblerFlag Flag) override {
+    record([=] { main().EmitAssemblerFlag(Flag); });
+  }
+  void EmitAssignment(MCSymbol *Symbol, const MCExpr *Value) override {
+    MCStreamer::EmitAssignment(Symbol, Value);
+    record([=] { main().EmitAssignment(mapSymbol(Symbol), mapExpr(Value)); });
+  }
+  void EmitWeakReference(MCSymbol *Alias, const MCSymbol *Symbol) override {
+    record([=] {
+      main().EmitWeakReference(mapSymbol(Alias), mapSymbol(Symbol));
+    });
+  }
+  bool EmitSymbolAttribute(MCSymbol *Symbol,
+                           MCSymbolAttr Attribute) override {
+    // Only the piece that defines a function sets its visibility.
+    if (Attribute == MCSA_Hidden || Attribute == MCSA_Protected ||
+        Attribute == MCSA_Internal) {
+      auto I = Out.DefiningPieces.find(Symbol->getName());
+      if (I != Out.DefiningPieces.end() && I->second != Piece)
+        return true;
+    }
+    record([=] { main().EmitSymbolAttribute(mapSymbol(Symbol), Attribute); });
+    return true;
+  }
+  void emitELFSize(MCSymbolELF *Symbol, const MCExpr *Value) override {
+    record([=] {
+      main().emitELFSize(cast<MCSymbolELF>(mapSymbol(Symbol)), mapExpr(Value));
+    });
+  }
+  void EmitCommonSymbol(MCSymbol *Symbol, uint64_t Size,
+                        unsigned ByteAlignment) override {
+    record([=] {
+      main().EmitCommonSymbol(mapSymbol(Symbol), Size, ByteAlignment);
+    });
+  }
+  void EmitLocalCommonSymbol(MCSymbol *Symbol, uint64_t Size,
+                             unsigned ByteAlignment) override {
+    record([=] {
+      main().EmitLocalCommonSymbol(mapSymbol(Symbol), Size, ByteAlignment);
+    });
+  }
+  void EmitZerofill(MCSection *Section, MCSymbol *Symbol, uint64_t Size,
+                    unsigned ByteAlignment) override {
+    record([=] {
+      main().EmitZerofill(mapSection(Section), mapSymbol(Symbol), Size,
+                          ByteAlignment);
+    });
+  }
+  void EmitTBSSSymbol(MCSection *Section, MCSymbol *Symbol, uint64_t Size,
+                      unsigned ByteAlignment) override {
+    record([=] {
+      main().EmitTBSSSymbol(mapSection(Section), mapSymbol(Symbol), Size,
+                            ByteAlignment);
+    });
+  }
+
+  void EmitBytes(StringRef Data) override {
+    std::string Bytes = Data;
+    record([=] { main().EmitBytes(Bytes); });
+  }
+  void EmitValueImpl(const MCExpr *Value, unsigned Size,
+                     const SMLoc &Loc) override {
+    record([=] { main().EmitValue(mapExpr(Value), Size); });
+  }
+  void EmitIntValue(uint64_t Value, unsigned Size) override {
+    record([=] { main().EmitIntValue(Value, Size); });
+  }
+  void EmitULEB128Value(const MCExpr *Value) override {
+    record([=] { main().EmitULEB128Value(mapExpr(Value)); });
+  }
+  void EmitSLEB128Value(const MCExpr *Value) override {
+    record([=] { main().EmitSLEB128Value(mapExpr(Value)); });
+  }
+  void EmitGPRel64Value(const MCExpr *Value) override {
+    record([=] { main().EmitGPRel64Value(mapExpr(Value)); });
+  }
+  void EmitGPRel32Value(const MCExpr *Value) override {
+    record([=] { main().EmitGPRel32Value(mapExpr(Value)); });
+  }
+  void EmitFill(uint64_t NumBytes, uint8_t FillValue) override {
+    record([=] { main().EmitFill(NumBytes, FillValue); });
+  }
+  void EmitZeros(uint64_t NumBytes) override {
+    record([=] { main().EmitZeros(NumBytes); });
+  }
+  void EmitValueToAlignment(unsigned ByteAlignment, int64_t Value,
+                            unsigned ValueSize,
+                            unsigned MaxBytesToEmit) override {
+    record([=] {
+      main().EmitValueToAlignment(ByteAlignment, Value, ValueSize,
+                                  MaxBytesToEmit);
+    });
+  }
+  void EmitCodeAlignment(unsigned ByteAlignment,
+                         unsigned MaxBytesToEmit) override {
+    record([=] { main().EmitCodeAlignment(ByteAlignment, MaxBytesToEmit); });
+  }
+  bool EmitValueToOffset(const MCExpr *Offset, unsigned char Value) override {
+    record([=] {
+      if (main().EmitValueToOffset(mapExpr(Offset), Value))
+        report_fatal_error("Invalid offset in code generated in pieces");
+    });
+    return false;
+  }
+
+  void EmitFileDirective(StringRef Filename) override {
+    std::string Name = Filename;
+    record([=] { main().EmitFileDirective(Name); });
+  }
+  void EmitIdent(StringRef IdentString) override {
+    std::string Ident = IdentString;
+    record([=] { main().EmitIdent(Ident); });
+  }
+  unsigned EmitDwarfFileDirective(unsigned FileNo, StringRef Directory,
+                                  StringRef Filename, unsigned CUID) override {
+    report_fatal_error("Line tables can't be code generated in pieces");
+  }
+  void EmitDwarfLocDirective(unsigned FileNo, unsigned Line, unsigned Column,
+                             unsigned Flags, unsigned Isa,
+                             unsigned Discriminator,
+                             StringRef FileName) override {
+    report_fatal_error("Line tables can't be code generated in pieces");
+  }
+
+  // The base class keeps track of the frames of the piece, so that it numbers
+  // the labels of the frame instructions as the module would.
+  void EmitCFISections(bool EH, bool Debug) override {
+    record([=] { main().EmitCFISections(EH, Debug); });
+  }
+  void EmitCFIStartProcImpl(MCDwarfFrameInfo &Frame) override {
+    bool IsSimple = Frame.IsSimple;
+    record([=] { main().EmitCFIStartProc(IsSimple); });
+  }
+  void EmitCFIEndProcImpl(MCDwarfFrameInfo &Frame) override {
+    MCStreamer::EmitCFIEndProcImpl(Frame);
+    record([=] { main().EmitCFIEndProc(); });
+  }
+  void EmitCFIDefCfa(int64_t Register, int64_t Offset) override {
+    recordFrameInstruction(
+        [&] { MCStreamer::EmitCFIDefCfa(Register, Offset); },
+        [=] { main().EmitCFIDefCfa(Register, Offset); });
+  }
+  void EmitCFIDefCfaOffset(int64_t Offset) override {
+    recordFrameInstruction([&] { MCStreamer::EmitCFIDefCfaOffset(Offset); },
+                           [=] { main().EmitCFIDefCfaOffset(Offset); });
+  }
+  void EmitCFIDefCfaRegister(int64_t Register) override {
+    recordFrameInstruction(
+        [&] { MCStreamer::EmitCFIDefCfaRegister(Register); },
+        [=] { main().EmitCFIDefCfaRegister(Register); });
+  }
+  void EmitCFIOffset(int64_t Register, int64_t Offset) override {
+    recordFrameInstruction(
+        [&] { MCStreamer::EmitCFIOffset(Register, Offset); },
+        [=] { main().EmitCFIOffset(Register, Offset); });
+  }
+  void EmitCFIPersonality(const MCSymbol *Sym, unsigned Encoding) override {
+    MCStreamer::EmitCFIPersonality(Sym, Encoding);
+    record([=] { main().EmitCFIPersonality(mapSymbol(Sym), Encoding); });
+  }
+  void EmitCFILsda(const MCSymbol *Sym, unsigned Encoding) override {
+    MCStreamer::EmitCFILsda(Sym, Encoding);
+    record([=] { main().EmitCFILsda(mapSymbol(Sym), Encoding); });
+  }
+  void EmitCFIRememberState() override {
+    recordFrameInstruction([&] { MCStreamer::EmitCFIRememberState(); },
+                           [=] { main().EmitCFIRememberState(); });
+  }
+  void EmitCFIRestoreState() override {
+    recordFrameInstruction([&] { MCStreamer::EmitCFIRestoreState(); },
+                           [=] { main().EmitCFIRestoreState(); });
+  }
+  void EmitCFISameValue(int64_t Register) override {
+    recordFrameInstruction([&] { MCStreamer::EmitCFISameValue(Register); },
+                           [=] { main().EmitCFISameValue(Register); });
+  }
+  void EmitCFIRestore(int64_t Register) override {
+    recordFrameInstruction([&] { MCStreamer::EmitCFIRestore(Register); },
+                           [=] { main().EmitCFIRestore(Register); });
+  }
+  void EmitCFIRelOffset(int64_t Register, int64_t Offset) override {
+    recordFrameInstruction(
+        [&] { MCStreamer::EmitCFIRelOffset(Register, Offset); },
+        [=] { main().EmitCFIRelOffset(Register, Offset); });
+  }
+  void EmitCFIAdjustCfaOffset(int64_t Adjustment) override {
+    recordFrameInstruction(
+        [&] { MCStreamer::EmitCFIAdjustCfaOffset(Adjustment); },
+        [=] { main().EmitCFIAdjustCfaOffset(Adjustment); });
+  }
+  void EmitCFIEscape(StringRef Values) override {
+    std::string Escape = Values;
+    recordFrameInstruction([&] { MCStreamer::EmitCFIEscape(Escape); },
+                           [=] { main().EmitCFIEscape(Escape); });
+  }
+  void EmitCFISignalFrame() override {
+    MCStreamer::EmitCFISignalFrame();
+    record([=] { main().EmitCFISignalFrame(); });
+  }
+  void EmitCFIUndefined(int64_t Register) override {
+    recordFrameInstruction([&] { MCStreamer::EmitCFIUndefined(Register); },
+                           [=] { main().EmitCFIUndefined(Register); });
+  }
+  void EmitCFIRegister(int64_t Register1, int64_t Register2) override {
+    recordFrameInstruction(
+        [&] { MCStreamer::EmitCFIRegister(Register1, Register2); },
+        [=] { main().EmitCFIRegister(Register1, Register2); });
+  }
+  void EmitCFIWindowSave() override {
+    recordFrameInstruction([&] { MCStreamer::EmitCFIWindowSave(); },
+                           [=] { main().EmitCFIWindowSave(); });
+  }
+
+  void EmitInstruction(const MCInst &Inst,
+                       const MCSubtargetInfo &STI) override {
+    // The subtarget may be a temporary one, as for inline asm.
+    const MCSubtargetInfo *Copy = &copySubtarget(STI);
+    record([=] { main().EmitInstruction(mapInst(Inst), *Copy); });
+  }
+  void EmitBundleAlignMode(unsigned AlignPow2) override {
+    record([=] { main().EmitBundleAlignMode(AlignPow2); });
+  }
+  void EmitBundleLock(bool AlignToEnd) override {
+    record([=] { main().EmitBundleLock(AlignToEnd); });
+  }
+  void EmitBundleUnlock() override {
+    record([=] { main().EmitBundleUnlock(); });
+  }
+  void EmitRawTextImpl(StringRef String) override {
+    std::string Text = String;
+    record([=] { main().EmitRawText(Text); });
+  }
+
+  void FinishImpl() override {
+    flushComments();
+    // The next symbol of each base name tells how many there were.
+    for (unsigned I = 0; I != NumTempBases; ++I) {
+      StringRef Name = getContext().createTempSymbol(TempBases[I], true)
+                           ->getName()
+                           .drop_front(privatePrefix().size());
+      StringRef Base;
+      if (!parseTempName(Name, Base, NumTemps[I]))
+        report_fatal_error("Temporary symbols of code generated in pieces "
+                           "must be named");
+    }
+
+    std::unique_lock<std::mutex> Lock(Out.Mutex);
+    Out.TurnChanged.wait(Lock, [&] { return Out.NextPiece == Piece; });
+    std::copy(std::begin(Out.NumTemps), std::end(Out.NumTemps), TempOffsets);
+    for (const std::function<void()> &Event : Events)
+      Event();
+    Events.clear();
+    for (unsigned I = 0; I != NumTempBases; ++I)
+      Out.NumTemps[I] += NumTemps[I];
+    for (std::unique_ptr<MCSubtargetInfo> &STI : Subtargets)
+      Out.Subtargets.push_back(std::move(STI));
+    ++Out.NextPiece;
+    Out.TurnChanged.notify_all();
+  }
+};
+
+} // end anonymous namespace
+
+void PieceRecorder::recordFrameInstruction(function_ref<void()> EmitBase,
+                                           std::function<void()> EmitMain) {
+  InFrameInstruction = true;
+  EmitBase();
+  InFrameInstruction = false;
+  StringRef Base;
+  unsigned Number;
+  if (!FrameLabel ||
+      !parseTempName(FrameLabel->getName().drop_front(privatePrefix().size()),
+                     Base, Number) ||
+      Base != TempBases[0])
+    report_fatal_error("Unexpected frame label in code generated in pieces");
+
+  record([=] {
+    // Create the symbols that come before the label, so that the main
+    // streamer creates it with the right number.
+    std::vector<MCSymbol *> &Temps = Out.Temps[TempBases[0]];
+    while (Temps.size() < Number + TempOffsets[0])
+      createMainTemp(TempBases[0]);
+    EmitMain();
+    Temps.push_back(nullptr);
+  });
+}
+
+MCSymbol *PieceRecorder::mapSymbol(const MCSymbol *Sym) {
+  if (!Sym)
+    return nullptr;
+  MCSymbol *&Mapped = Symbols[Sym];
+  if (Mapped)
+    return Mapped;
+
+  // Symbols looked up by name have the same name in the main context.
+  StringRef Name = Sym->getName();
+  if (!Name.empty() && getContext().lookupSymbol(Name) == Sym)
+    return Mapped = mainContext().getOrCreateSymbol(Name);
+
+  if (!Sym->isVariable() && Sym->isInSection() &&
+      Sym->getSection().getBeginSymbol() == Sym) {
+    Mapped = mapSection(&Sym->getSection())->getBeginSymbol();
+    if (!Mapped)
+      report_fatal_error("Section symbol missing from code generated in "
+                         "pieces");
+    return Mapped;
+  }
+
+  // Other symbols are temporary. Those that CodeGen creates are numbered
+  // after the ones of the pieces before this one, as the module would number
+  // them. Any others just get a new number.
+  StringRef Prefix = privatePrefix();
+  if (Name.startswith(Prefix))
+    Name = Name.drop_front(Prefix.size());
+  StringRef Base;
+  unsigned Number;
+  if (parseTempName(Name, Base, Number)) {
+    int Index = getTempBaseIndex(Base);
+    if (Index >= 0)
+      return Mapped = getMainTemp(Base, Number + TempOffsets[Index]);
+  } else {
+    Base = Name.empty() ? "tmp" : Name;
+  }
+  return Mapped = createMainTemp(Base);
+}
+
+MCSymbol *PieceRecorder::createMainTemp(StringRef Base) {
+  std::vector<MCSymbol *> &Temps = Out.Temps[Base];
+  Temps.push_back(mainContext().createTempSymbol(Base, true));
+  return Temps.back();
+}
+
+MCSymbol *PieceRecorder::getMainTemp(StringRef Base, unsigned Number) {
+  std::vector<MCSymbol *> &Temps = Out.Temps[Base];
+  while (Temps.size() <= Number)
+    createMainTemp(Base);
+  // A frame label can't be referred to, so the numbering is off. Make do with
+  // a new symbol.
+  if (!Temps[Number])
+    return createMainTemp(Base);
+  return Temps[Number];
+}
+
+/// Return \p Text with the names of the temporary symbols of this piece
+/// replaced by those they are given in the main context.
+std::string PieceRecorder::renumberTemps(StringRef Text) {
+  StringRef Prefix = privatePrefix();
+  std::string Result;
+  for (size_t Pos; (Pos = Text.find(Prefix)) != StringRef::npos;) {
+    Result += Text.substr(0, Pos + Prefix.size());
+    Text = Text.substr(Pos + Prefix.size());
+    for (unsigned I = 0; I != NumTempBases; ++I) {
+      StringRef Base = TempBases[I];
+      size_t End = Text.find_first_not_of("0123456789", Base.size());
+      unsigned Number;
+      if (!Text.startswith(Base) ||
+          Text.slice(Base.size(), End).getAsInteger(10, Number))
+        continue;
+      Result += Base;
+      Result += utostr(Number + TempOffsets[I]);
+      Text = Text.substr(End);
+      break;
+    }
+  }
+  Result += Text;
+  return Result;
+}
+
+MCSection *PieceRecorder::mapSection(MCSection *Section) {
+  if (!Section)
+    return nullptr;
+  MCSection *&Mapped = Sections[Section];
+  if (Mapped)
+    return Mapped;
+
+  auto *ELFSection = dyn_cast<MCSectionELF>(Section);
+  if (!ELFSection)
+    report_fatal_error("Section can't be code generated in pieces");
+
+  // Each piece numbers its unique sections from zero.
+  unsigned UniqueID = ELFSection->getUniqueID();
+  if (ELFSection->isUnique()) {
+    auto Inserted = UniqueIDs.insert(std::make_pair(UniqueID, 0u));
+    if (Inserted.second)
+      Inserted.first->second = Out.NextUniqueID++;
+    UniqueID = Inserted.first->second;
+  }
+
+  const MCSymbolELF *Group = nullptr;
+  if (ELFSection->getGroup())
+    Group = cast<MCSymbolELF>(mapSymbol(ELFSection->getGroup()));
+  const MCSectionELF *Associated = nullptr;
+  if (const MCSectionELF *S = ELFSection->getAssociatedSection())
+    Associated = cast<MCSectionELF>(mapSection(const_cast<MCSectionELF *>(S)));
+  return Mapped = mainContext().getELFSection(
+             ELFSection->getSectionName(), ELFSection->getType(),
+             ELFSection->getFlags(), ELFSection->getEntrySize(), Group,
+             UniqueID, nullptr, Associated);
+}
+
+const MCExpr *PieceRecorder::mapExpr(const MCExpr *Expr) {
+  if (!Expr)
+    return nullptr;
+  MCContext &Ctx = mainContext();
+  switch (Expr->getKind()) {
+  case MCExpr::Constant:
+    return MCConstantExpr::create(cast<MCConstantExpr>(Expr)->getValue(), Ctx);
+  case MCExpr::SymbolRef: {
+    const auto *SRE = cast<MCSymbolRefExpr>(Expr);
+    return MCSymbolRefExpr::create(mapSymbol(&SRE->getSymbol()),
+                                   SRE->getKind(), Ctx);
+  }
+  case MCExpr::Unary: {
+    const auto *UE = cast<MCUnaryExpr>(Expr);
+    return MCUnaryExpr::create(UE->getOpcode(), mapExpr(UE->getSubExpr()),
+                               Ctx);
+  }
+  case MCExpr::Binary: {
+    const auto *BE = cast<MCBinaryExpr>(Expr);
+    return MCBinaryExpr::create(BE->getOpcode(), mapExpr(BE->getLHS()),
+                                mapExpr(BE->getRHS()), Ctx);
+  }
+  case MCExpr::Target:
+    break;
+  }
+  report_fatal_error("Expression can't be code generated in pieces");
+}
+
+MCInst PieceRecorder::mapInst(const MCInst &Inst) {
+  MCInst Mapped = Inst;
+  Mapped.setLoc(SMLoc());
+  for (unsigned I = 0, E = Mapped.getNumOperands(); I != E; ++I) {
+    MCOperand &Op = Mapped.getOperand(I);
+    if (Op.isExpr())
+      Op.setExpr(mapExpr(Op.getExpr()));
+    else if (Op.isInst())
+      Op.setInst(new (mainContext()) MCInst(mapInst(*Op.getInst())));
+  }
+  return Mapped;
+}
+
+const MCSubtargetInfo &
+PieceRecorder::copySubtarget(const MCSubtargetInfo &STI) {
+  for (const std::unique_ptr<MCSubtargetInfo> &Copy : Subtargets)
+    if (Copy->getTargetTriple() == STI.getTargetTriple() &&
+        Copy->getCPU() == STI.getCPU() &&
+        Copy->getFeatureBits() == STI.getFeatureBits())
+      return *Copy;
+  Subtargets.emplace_back(new MCSubtargetInfo(STI));
+  return *Subtargets.back();
+}
+
+void llvm::splitCodeGenInOrder(Module &M, raw_pwrite_stream &OS,
+                               unsigned NumThreads, StringRef CPU,
+                               StringRef Features, const TargetOptions &Options,
+                               Reloc::Model RM, CodeModel::Model CM,
+                               CodeGenOpt::Level OL,
+                               TargetMachine::CodeGenFileType FileType) {
+  StringRef TripleStr = M.getTargetTriple();
+  std::string ErrMsg;
+  const Target *TheTarget = TargetRegistry::lookupTarget(TripleStr, ErrMsg);
+  if (!TheTarget)
+    report_fatal_error(Twine("Target not found: ") + ErrMsg);
+  std::unique_ptr<TargetMachine> TM(TheTarget->createTargetMachine(
+      TripleStr, CPU, Features, Options, RM, CM, OL));
+
+  // Cut the function definitions into contiguous pieces of about the same
+  // number of instructions, placing each function by the middle of its range.
+  std::vector<std::pair<const Function *, uint64_t>> Defs;
+  uint64_t TotalSize = 0;
+  for (const Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    uint64_t Size = 0;
+    for (const BasicBlock &BB : F)
+      Size += BB.size();
+    Defs.push_back(std::make_pair(&F, Size));
+    TotalSize += Size;
+  }
+
+  unsigned NumPieces = std::min<uint64_t>(NumThreads, Defs.size());
+  DenseMap<const GlobalValue *, unsigned> PieceOf;
+  std::vector<unsigned> FirstFunctionNumbers;
+  uint64_t Offset = 0;
+  unsigned LastPiece = ~0U;
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I) {
+    uint64_t Size = Defs[I].second;
+    unsigned Piece = (Offset + Size / 2) * NumPieces / (TotalSize + 1);
+    Offset += Size;
+    if (Piece != LastPiece) {
+      FirstFunctionNumbers.push_back(I);
+      LastPiece = Piece;
+    }
+    PieceOf[Defs[I].first] = FirstFunctionNumbers.size() - 1;
+  }
+  NumPieces = FirstFunctionNumbers.size();
+
+  // The pieces are replayed into a streamer with a context of its own.
+  MCObjectFileInfo MOFI;
+  MCContext Ctx(TM->getMCAsmInfo(), TM->getMCRegisterInfo(), &MOFI);
+  MOFI.InitMCObjectFileInfo(TM->getTargetTriple(), TM->getRelocationModel(),
+                            TM->getCodeModel(), Ctx);
+  if (Options.MCOptions.MCSaveTempLabels)
+    Ctx.setAllowTemporaryLabels(false);
+  std::unique_ptr<MCStreamer> Main;
+  if (NumPieces > 1 && canCodeGenInPieces(M, *TM)) {
+    Main = TM->createMCStreamer(OS, FileType, Ctx);
+    if (!Main)
+      report_fatal_error("Failed to setup codegen");
+    // The directives of a target streamer can't be recorded.
+    if (Main->getTargetStreamer())
+      Main.reset();
+  }
+  if (!Main) {
+    codegen(&M, OS, TheTarget, CPU, Features, Options, RM, CM, OL, FileType);
+    return;
+  }
+
+  // Global variables are emitted after all functions, so the last piece emits
+  // them, but every piece keeps their definitions to compile its functions
+  // against the same initializers as the module. Aliases go with the object
+  // they alias.
+  auto getPiece = [&](const GlobalValue *GV) {
+    if (auto *GA = dyn_cast<GlobalAlias>(GV))
+      if (const GlobalObject *Base = GA->getBaseObject())
+        GV = Base;
+    auto I = PieceOf.find(GV);
+    return I == PieceOf.end() ? NumPieces - 1 : I->second;
+  };
+
+  Mangler Mang(&M.getDataLayout());
+  StringMap<unsigned> DefiningPieces;
+  for (const auto &Def : Defs) {
+    SmallString<64> Name;
+    Mang.getNameWithPrefix(Name, Def.first, false);
+    DefiningPieces[Name] = PieceOf[Def.first];
+  }
+
+  JoinedOutput Joined(*Main, std::move(DefiningPieces));
+  std::string ModuleID = M.getModuleIdentifier();
+  std::vector<thread> Threads;
+  for (unsigned I = 0; I != NumPieces; ++I) {
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> MPiece(
+        CloneModule(&M, VMap, [&](const GlobalValue *GV) {
+          return isa<GlobalVariable>(GV) || getPiece(GV) == I;
+        }));
+    preparePiece(*MPiece, M, *TM, Mang, I == 0, I == NumPieces - 1);
+
+    // As in splitCodeGen, move the piece to a new context by way of bitcode.
+    SmallVector<char, 0> BC;
+    {
+      raw_svector_ostream BCOS(BC);
+      WriteBitcodeToFile(MPiece.get(), BCOS);
+    }
+
+    unsigned FirstFunctionNumber = FirstFunctionNumbers[I];
+    Threads.emplace_back(
+        [TheTarget, CPU, Features, Options, RM, CM, OL, ModuleID, I,
+         FirstFunctionNumber, NumPieces,
+         &Joined](const SmallVector<char, 0> &BC) {
+          LLVMContext Ctx;
+          ErrorOr<std::unique_ptr<Module>> MOrErr =
+              parseBitcodeFile(MemoryBufferRef(StringRef(BC.data(), BC.size()),
+                                               "<split-module>"),
+                               Ctx);
+          if (!MOrErr)
+            report_fatal_error("Failed to read bitcode");
+          std::unique_ptr<Module> MPieceInCtx = std::move(MOrErr.get());
+          MPieceInCtx->setModuleIdentifier(ModuleID);
+
+          std::unique_ptr<TargetMachine> PieceTM(TheTarget->createTargetMachine(
+              MPieceInCtx->getTargetTriple(), CPU, Features, Options, RM, CM,
+              OL));
+          PieceTM->setCodeGenPart(FirstFunctionNumber, I == NumPieces - 1);
+          legacy::PassManager CodeGenPasses;
+          if (PieceTM->addPassesToEmitStreamer(
+                  CodeGenPasses, [&](MCContext &PieceCtx) {
+                    return std::unique_ptr<MCStreamer>(
+                        new PieceRecorder(PieceCtx, Joined, I));
+                  }))
+            report_fatal_error("Failed to setup codegen");
+          CodeGenPasses.run(*MPieceInCtx);
+        },
+        std::move(BC));
+  }
+
+  for (thread &T : Threads)
+    T.join();
+  Main->Finish();
+}
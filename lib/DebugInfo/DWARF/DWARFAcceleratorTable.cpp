@@ -46,6 +46,47 @@ bool DWARFAcceleratorTable::extract() {
   return true;
 }
 
+bool DWARFAcceleratorTable::getDIEOffsets(
+    std::vector<uint32_t> &Offsets) const {
+  SmallVector<DWARFFormValue, 3> AtomForms;
+  int DIEOffsetAtom = -1;
+  for (const auto &Atom : HdrData.Atoms) {
+    if (Atom.first == dwarf::DW_ATOM_die_offset)
+      DIEOffsetAtom = AtomForms.size();
+    AtomForms.push_back(DWARFFormValue(Atom.second));
+  }
+  if (DIEOffsetAtom < 0)
+    return false;
+
+  // Every hash points to the list of the names with this hash.
+  unsigned HashesBase = sizeof(Hdr) + Hdr.HeaderDataLength + Hdr.NumBuckets * 4;
+  unsigned OffsetsBase = HashesBase + Hdr.NumHashes * 4;
+  for (unsigned HashIdx = 0; HashIdx < Hdr.NumHashes; ++HashIdx) {
+    unsigned OffsetsOffset = OffsetsBase + HashIdx * 4;
+    unsigned DataOffset = AccelSection.getU32(&OffsetsOffset);
+    while (AccelSection.isValidOffsetForDataOfSize(DataOffset, 4)) {
+      unsigned StringOffset = AccelSection.getU32(&DataOffset);
+      RelocAddrMap::const_iterator Reloc = Relocs.find(DataOffset - 4);
+      if (Reloc != Relocs.end())
+        StringOffset += Reloc->second.second;
+      if (!StringOffset)
+        break;
+      unsigned NumData = AccelSection.getU32(&DataOffset);
+      for (unsigned Data = 0; Data < NumData; ++Data) {
+        for (unsigned I = 0, E = AtomForms.size(); I != E; ++I) {
+          if (!AtomForms[I].extractValue(AccelSection, &DataOffset, nullptr))
+            return true;
+          if (I == unsigned(DIEOffsetAtom))
+            if (Optional<uint64_t> Value =
+                    AtomForms[I].getAsUnsignedConstant())
+              Offsets.push_back(HdrData.DIEOffsetBase + *Value);
+        }
+      }
+    }
+  }
+  return true;
+}
+
 void DWARFAcceleratorTable::dump(raw_ostream &OS) const {
   // Dump the header.
   OS << "Magic = " << format("0x%08x", Hdr.Magic) << '\n'
@@ -17,7 +17,9 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/thread.h"
 #include <algorithm>
+#include <atomic>
 using namespace llvm;
 using namespace dwarf;
 using namespace object;
@@ -85,30 +87,38 @@ void DWARFContext::dump(raw_ostream &OS, DIDumpType DumpType) {
 
   if (DumpType == DIDT_All || DumpType == DIDT_Info) {
     OS << "\n.debug_info contents:\n";
-    for (const auto &CU : compile_units())
+    for (const auto &CU : compile_units()) {
       CU->dump(OS);
+      releaseUnusedUnitDIEs();
+    }
   }
 
   if ((DumpType == DIDT_All || DumpType == DIDT_InfoDwo) &&
       getNumDWOCompileUnits()) {
     OS << "\n.debug_info.dwo contents:\n";
-    for (const auto &DWOCU : dwo_compile_units())
+    for (const auto &DWOCU : dwo_compile_units()) {
       DWOCU->dump(OS);
+      releaseUnusedUnitDIEs();
+    }
   }
 
   if ((DumpType == DIDT_All || DumpType == DIDT_Types) && getNumTypeUnits()) {
     OS << "\n.debug_types contents:\n";
     for (const auto &TUS : type_unit_sections())
-      for (const auto &TU : TUS)
+      for (const auto &TU : TUS) {
         TU->dump(OS);
+        releaseUnusedUnitDIEs();
+      }
   }
 
   if ((DumpType == DIDT_All || DumpType == DIDT_TypesDwo) &&
       getNumDWOTypeUnits()) {
     OS << "\n.debug_types.dwo contents:\n";
     for (const auto &DWOTUS : dwo_type_unit_sections())
-      for (const auto &DWOTU : DWOTUS)
+      for (const auto &DWOTU : DWOTUS) {
         DWOTU->dump(OS);
+        releaseUnusedUnitDIEs();
+      }
   }
 
   if (DumpType == DIDT_All || DumpType == DIDT_Loc) {
@@ -322,6 +332,65 @@ const DWARFDebugFrame *DWARFContext::getDebugFrame() {
   return DebugFrame.get();
 }
 
+ArrayRef<uint32_t> DWARFContext::getAppleNamesDIEOffsets() {
+  if (AppleNamesDIEOffsets)
+    return *AppleNamesDIEOffsets;
+
+  AppleNamesDIEOffsets.reset(new std::vector<uint32_t>());
+  const DWARFSection &Section = getAppleNamesSection();
+  if (Section.Data.empty())
+    return *AppleNamesDIEOffsets;
+  DataExtractor AccelSection(Section.Data, isLittleEndian(), 0);
+  DataExtractor StrData(getStringSection(), isLittleEndian(), 0);
+  DWARFAcceleratorTable Accel(AccelSection, StrData, Section.Relocs);
+  if (Accel.extract() && Accel.getDIEOffsets(*AppleNamesDIEOffsets)) {
+    std::sort(AppleNamesDIEOffsets->begin(), AppleNamesDIEOffsets->end());
+    AppleNamesDIEOffsets->erase(std::unique(AppleNamesDIEOffsets->begin(),
+                                            AppleNamesDIEOffsets->end()),
+                                AppleNamesDIEOffsets->end());
+  } else {
+    AppleNamesDIEOffsets->clear();
+  }
+  return *AppleNamesDIEOffsets;
+}
+
+void DWARFContext::setMaxUnitsWithDIEs(unsigned MaxUnits) {
+  MaxUnitsWithDIEs = MaxUnits;
+  if (!MaxUnits) {
+    UnitsWithDIEs.clear();
+    UnitsWithDIEsPos.clear();
+  }
+}
+
+void DWARFContext::updateUnitsWithDIEs(DWARFUnit *U) {
+  auto Pos = UnitsWithDIEsPos.find(U);
+  if (Pos != UnitsWithDIEsPos.end()) {
+    UnitsWithDIEs.splice(UnitsWithDIEs.begin(), UnitsWithDIEs, Pos->second);
+    return;
+  }
+  UnitsWithDIEs.push_front(U);
+  UnitsWithDIEsPos[U] = UnitsWithDIEs.begin();
+}
+
+void DWARFContext::releaseUnusedUnitDIEs() {
+  if (!MaxUnitsWithDIEs)
+    return;
+  while (UnitsWithDIEs.size() > MaxUnitsWithDIEs) {
+    DWARFUnit *LRU = UnitsWithDIEs.back();
+    UnitsWithDIEs.pop_back();
+    UnitsWithDIEsPos.erase(LRU);
+    LRU->clearDIEs(/*KeepCUDie=*/true);
+  }
+}
+
+void DWARFContext::removeFromUnitsWithDIEs(DWARFUnit *U) {
+  auto Pos = UnitsWithDIEsPos.find(U);
+  if (Pos == UnitsWithDIEsPos.end())
+    return;
+  UnitsWithDIEs.erase(Pos->second);
+  UnitsWithDIEsPos.erase(Pos);
+}
+
 const DWARFLineTable *
 DWARFContext::getLineTableForUnit(DWARFUnit *U) {
   if (!Line)
@@ -405,6 +474,7 @@ static bool getFunctionNameForAddress(DWARFCompileUnit *CU, uint64_t Address,
 
 DILineInfo DWARFContext::getLineInfoForAddress(uint64_t Address,
                                                DILineInfoSpecifier Spec) {
+  releaseUnusedUnitDIEs();
   DILineInfo Result;
 
   DWARFCompileUnit *CU = getCompileUnitForAddress(Address);
@@ -422,6 +492,7 @@ DILineInfo DWARFContext::getLineInfoForAddress(uint64_t Address,
 DILineInfoTable
 DWARFContext::getLineInfoForAddressRange(uint64_t Address, uint64_t Size,
                                          DILineInfoSpecifier Spec) {
+  releaseUnusedUnitDIEs();
   DILineInfoTable  Lines;
   DWARFCompileUnit *CU = getCompileUnitForAddress(Address);
   if (!CU)
@@ -464,6 +535,7 @@ DWARFContext::getLineInfoForAddressRange(uint64_t Address, uint64_t Size,
 DIInliningInfo
 DWARFContext::getInliningInfoForAddress(uint64_t Address,
                                         DILineInfoSpecifier Spec) {
+  releaseUnusedUnitDIEs();
   DIInliningInfo InliningInfo;
 
   DWARFCompileUnit *CU = getCompileUnitForAddress(Address);
@@ -540,29 +612,94 @@ static bool consumeCompressedDebugSectionHeader(StringRef &data,
   return true;
 }
 
+/// Get the name of \p Section without its "." or "_" prefix and its contents,
+/// preferring the version already relocated by the JIT. Returns false for
+/// sections that have no contents in the object file.
+static bool getSectionNameAndContents(const SectionRef &Section,
+                                      const LoadedObjectInfo *L,
+                                      StringRef &Name, StringRef &Data) {
+  Section.getName(Name);
+  // Skip BSS and Virtual sections, they aren't interesting.
+  if (Section.isBSS() || Section.isVirtual())
+    return false;
+
+  // Try to obtain an already relocated version of this section.
+  // Else use the unrelocated section from the object file. We'll have to
+  // apply relocations ourselves later.
+  if (!L || !L->getLoadedSectionContents(Name, Data))
+    Section.getContents(Data);
+
+  Name = Name.substr(Name.find_first_not_of("._")); // Skip . and _ prefixes.
+  return true;
+}
+
+namespace {
+/// A zlib-compressed debug section and the buffer it is inflated into.
+struct CompressedSection {
+  StringRef Data;
+  uint64_t OriginalSize;
+  SmallString<32> *Uncompressed;
+  zlib::Status Status;
+};
+}
+
+/// Inflate \p Sections. Each section is a separate zlib stream, so when there
+/// are several of them they are inflated on separate threads, largest first.
+static void uncompressSections(MutableArrayRef<CompressedSection> Sections) {
+  std::vector<CompressedSection *> Order;
+  for (CompressedSection &CS : Sections)
+    Order.push_back(&CS);
+  std::stable_sort(Order.begin(), Order.end(),
+                   [](const CompressedSection *A, const CompressedSection *B) {
+                     return A->OriginalSize > B->OriginalSize;
+                   });
+
+  std::atomic<size_t> Next(0);
+  auto UncompressNext = [&] {
+    for (size_t I = Next++; I < Order.size(); I = Next++) {
+      CompressedSection &CS = *Order[I];
+      CS.Status = zlib::uncompress(CS.Data, *CS.Uncompressed, CS.OriginalSize);
+    }
+  };
+  unsigned NumThreads =
+      std::min<size_t>(thread::hardware_concurrency(), Order.size());
+  std::vector<thread> Threads;
+  for (unsigned I = 1; I < NumThreads; ++I)
+    Threads.emplace_back(UncompressNext);
+  UncompressNext();
+  for (thread &T : Threads)
+    T.join();
+}
+
 DWARFContextInMemory::DWARFContextInMemory(const object::ObjectFile &Obj,
     const LoadedObjectInfo *L)
     : IsLittleEndian(Obj.isLittleEndian()),
       AddressSize(Obj.getBytesInAddress()) {
+  // Inflate the compressed debug sections before anything else, so that the
+  // large ones are not inflated one after the other.
+  SmallVector<CompressedSection, 4> Compressed;
+  if (zlib::isAvailable()) {
+    for (const SectionRef &Section : Obj.sections()) {
+      StringRef name;
+      StringRef data;
+      uint64_t OriginalSize;
+      if (getSectionNameAndContents(Section, L, name, data) &&
+          name.startswith("zdebug_") &&
+          consumeCompressedDebugSectionHeader(data, OriginalSize))
+        Compressed.push_back({data, OriginalSize, nullptr, zlib::StatusOK});
+    }
+    UncompressedSections.resize(Compressed.size());
+    for (unsigned I = 0, E = Compressed.size(); I != E; ++I)
+      Compressed[I].Uncompressed = &UncompressedSections[I];
+    uncompressSections(Compressed);
+  }
+
+  const CompressedSection *NextCompressed = Compressed.begin();
   for (const SectionRef &Section : Obj.sections()) {
     StringRef name;
-    Section.getName(name);
-    // Skip BSS and Virtual sections, they aren't interesting.
-    bool IsBSS = Section.isBSS();
-    if (IsBSS)
-      continue;
-    bool IsVirtual = Section.isVirtual();
-    if (IsVirtual)
-      continue;
     StringRef data;
-
-    // Try to obtain an already relocated version of this section.
-    // Else use the unrelocated section from the object file. We'll have to
-    // apply relocations ourselves later.
-    if (!L || !L->getLoadedSectionContents(name,data))
-      Section.getContents(data);
-
-    name = name.substr(name.find_first_not_of("._")); // Skip . and _ prefixes.
+    if (!getSectionNameAndContents(Section, L, name, data))
+      continue;
 
     // Check if debug info section is compressed with zlib.
     if (name.startswith("zdebug_")) {
@@ -570,15 +707,12 @@ DWARFContextInMemory::DWARFContextInMemory(const object::ObjectFile &Obj,
       if (!zlib::isAvailable() ||
           !consumeCompressedDebugSectionHeader(data, OriginalSize))
         continue;
-      UncompressedSections.resize(UncompressedSections.size() + 1);
-      if (zlib::uncompress(data, UncompressedSections.back(), OriginalSize) !=
-          zlib::StatusOK) {
-        UncompressedSections.pop_back();
+      const CompressedSection &CS = *NextCompressed++;
+      if (CS.Status != zlib::StatusOK)
         continue;
-      }
-      // Make data point to uncompressed section contents and save its contents.
+      // Make data point to uncompressed section contents.
       name = name.substr(1);
-      data = UncompressedSections.back();
+      data = *CS.Uncompressed;
     }
 
     StringRef *SectionData =
@@ -12,7 +12,9 @@
 #include "llvm/DebugInfo/DWARF/DWARFFormValue.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <cstdio>
+#include <set>
 
 using namespace llvm;
 using namespace dwarf;
@@ -118,6 +120,10 @@ void DWARFUnit::clear() {
   AddrOffsetSectionBase = 0;
   clearDIEs(false);
   DWO.reset();
+  SubprogramMap.clear();
+  SubprogramMapIsBuilt = false;
+  SubprogramMapIsFromAccelTable = false;
+  SubprogramDIEs.clear();
 }
 
 const char *DWARFUnit::getCompilationDir() {
@@ -136,13 +142,14 @@ uint64_t DWARFUnit::getDWOId() {
       .getAttributeValueAsUnsignedConstant(this, DW_AT_GNU_dwo_id, FailValue);
 }
 
-void DWARFUnit::setDIERelations() {
-  if (DieArray.size() <= 1)
+void DWARFUnit::setDIERelations(
+    std::vector<DWARFDebugInfoEntryMinimal> &DIEs) {
+  if (DIEs.size() <= 1)
     return;
 
   std::vector<DWARFDebugInfoEntryMinimal *> ParentChain;
   DWARFDebugInfoEntryMinimal *SiblingChain = nullptr;
-  for (auto &DIE : DieArray) {
+  for (auto &DIE : DIEs) {
     if (SiblingChain) {
       SiblingChain->setSibling(&DIE);
     }
@@ -161,7 +168,7 @@ void DWARFUnit::setDIERelations() {
       ParentChain.pop_back();
     }
   }
-  assert(SiblingChain == nullptr || SiblingChain == &DieArray[0]);
+  assert(SiblingChain == nullptr || SiblingChain == &DIEs[0]);
   assert(ParentChain.empty());
 }
 
@@ -216,10 +223,33 @@ void DWARFUnit::extractDIEsToVector(
                     "bounds cu 0x%8.8x at 0x%8.8x'\n", getOffset(), DIEOffset);
 }
 
+void DWARFUnit::walkDIESubtree(
+    uint32_t DIEOffset,
+    function_ref<void(const DWARFDebugInfoEntryMinimal &)> Fn) const {
+  uint32_t NextCUOffset = getNextUnitOffset();
+  DWARFDebugInfoEntryMinimal DIE;
+  uint32_t Depth = 0;
+  while (DIEOffset < NextCUOffset && DIE.extractFast(this, &DIEOffset)) {
+    Fn(DIE);
+    if (const DWARFAbbreviationDeclaration *AbbrDecl =
+            DIE.getAbbreviationDeclarationPtr()) {
+      if (AbbrDecl->hasChildren())
+        ++Depth;
+    } else if (Depth > 0) {
+      --Depth;
+    }
+    if (Depth == 0)
+      break;
+  }
+}
+
 size_t DWARFUnit::extractDIEsIfNeeded(bool CUDieOnly) {
   if ((CUDieOnly && DieArray.size() > 0) ||
-      DieArray.size() > 1)
+      DieArray.size() > 1) {
+    if (DieArray.size() > 1)
+      Context.noteUnitDIEsUsed(this);
     return 0; // Already parsed.
+  }
 
   bool HasCUDie = DieArray.size() > 0;
   extractDIEsToVector(!HasCUDie, !CUDieOnly, DieArray);
@@ -242,7 +272,9 @@ size_t DWARFUnit::extractDIEsIfNeeded(bool CUDieOnly) {
     // skeleton CU DIE, so that DWARF users not aware of it are not broken.
   }
 
-  setDIERelations();
+  setDIERelations(DieArray);
+  if (DieArray.size() > 1)
+    Context.noteUnitDIEsUsed(this);
   return DieArray.size();
 }
 
@@ -303,6 +335,14 @@ void DWARFUnit::clearDIEs(bool KeepCUDie) {
     // Save at least the compile unit DIE
     if (KeepCUDie)
       DieArray.push_back(TmpArray.front());
+    // Drop the subprogram lookup state along with the DIEs, so that a unit
+    // released by DWARFContext keeps nothing of them. It is rebuilt by the
+    // next lookup.
+    std::vector<std::pair<uint64_t, uint32_t>>().swap(SubprogramMap);
+    SubprogramMapIsBuilt = false;
+    SubprogramMapIsFromAccelTable = false;
+    std::vector<DWARFDebugInfoEntryMinimal>().swap(SubprogramDIEs);
+    Context.noteUnitDIEsCleared(this);
   }
 }
 
@@ -319,12 +359,14 @@ void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
 
   // This function is usually called if there in no .debug_aranges section
   // in order to produce a compile unit level set of address ranges that
-  // is accurate. If the DIEs weren't parsed, then we don't want all dies for
-  // all compile units to stay loaded when they weren't needed. So we can end
-  // up parsing the DWARF and then throwing them all away to keep memory usage
-  // down.
-  const bool ClearDIEs = extractDIEsIfNeeded(false) > 1;
-  DieArray[0].collectChildrenAddressRanges(this, CURanges);
+  // is accurate. Use the ranges of all the subprograms, without keeping
+  // the DIEs of all compile units loaded.
+  if (!SubprogramMapIsBuilt || SubprogramMapIsFromAccelTable)
+    buildSubprogramMap(/*UseAccelTable=*/false);
+  for (size_t I = 0, E = SubprogramMap.size(); I + 1 < E; ++I)
+    if (SubprogramMap[I].second != -1U)
+      CURanges.push_back(
+          std::make_pair(SubprogramMap[I].first, SubprogramMap[I + 1].first));
 
   // Collect address ranges from DIEs in .dwo if necessary.
   bool DWOCreated = parseDWO();
@@ -332,23 +374,118 @@ void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
     DWO->getUnit()->collectAddressRanges(CURanges);
   if (DWOCreated)
     DWO.reset();
+}
+
+void DWARFUnit::buildSubprogramMap(bool UseAccelTable) {
+  SubprogramMap.clear();
+  SubprogramMapIsBuilt = true;
+  SubprogramMapIsFromAccelTable = false;
+  // The unit DIE holds the base address and the ranges base.
+  extractDIEsIfNeeded(true);
+  if (DieArray.empty())
+    return;
+
+  struct Endpoint {
+    uint64_t Address;
+    uint32_t DIEOffset;
+    bool IsStart;
+  };
+  std::vector<Endpoint> Endpoints;
+  auto AddSubprogram = [&](const DWARFDebugInfoEntryMinimal &DIE) {
+    if (!DIE.isSubprogramDIE())
+      return;
+    for (const auto &R : DIE.getAddressRanges(this)) {
+      if (R.first >= R.second)
+        continue;
+      Endpoints.push_back({R.first, DIE.getOffset(), true});
+      Endpoints.push_back({R.second, DIE.getOffset(), false});
+    }
+  };
+
+  ArrayRef<uint32_t> AccelOffsets;
+  if (UseAccelTable && DieArray.size() <= 1) {
+    // Only look at the DIEs the accelerator table points to in this unit.
+    AccelOffsets = Context.getAppleNamesDIEOffsets();
+    auto Begin = std::lower_bound(AccelOffsets.begin(), AccelOffsets.end(),
+                                  Offset + getHeaderSize());
+    auto End = std::lower_bound(Begin, AccelOffsets.end(), getNextUnitOffset());
+    AccelOffsets = AccelOffsets.slice(Begin - AccelOffsets.begin(), End - Begin);
+  }
+  if (!AccelOffsets.empty()) {
+    SubprogramMapIsFromAccelTable = true;
+    for (uint32_t DIEOffset : AccelOffsets) {
+      DWARFDebugInfoEntryMinimal DIE;
+      if (DIE.extractFast(this, &DIEOffset))
+        AddSubprogram(DIE);
+    }
+  } else if (DieArray.size() > 1) {
+    for (const DWARFDebugInfoEntryMinimal &DIE : DieArray)
+      AddSubprogram(DIE);
+  } else {
+    walkDIESubtree(Offset + getHeaderSize(), AddSubprogram);
+  }
 
-  // Keep memory down by clearing DIEs if this generate function
-  // caused them to be parsed.
-  if (ClearDIEs)
-    clearDIEs(true);
+  // Sweep the endpoints keeping track of the subprograms covering the current
+  // address. Like a linear search of the DIEs, the first one wins.
+  std::sort(Endpoints.begin(), Endpoints.end(),
+            [](const Endpoint &LHS, const Endpoint &RHS) {
+              return LHS.Address < RHS.Address;
+            });
+  std::multiset<uint32_t> Active;
+  for (size_t I = 0, E = Endpoints.size(); I != E;) {
+    uint64_t Address = Endpoints[I].Address;
+    for (; I != E && Endpoints[I].Address == Address; ++I) {
+      if (Endpoints[I].IsStart)
+        Active.insert(Endpoints[I].DIEOffset);
+      else
+        Active.erase(Active.find(Endpoints[I].DIEOffset));
+    }
+    uint32_t DIEOffset = Active.empty() ? -1U : *Active.begin();
+    if (SubprogramMap.empty() || SubprogramMap.back().second != DIEOffset)
+      SubprogramMap.push_back(std::make_pair(Address, DIEOffset));
+  }
+}
+
+uint32_t DWARFUnit::lookUpSubprogramMap(uint64_t Address) const {
+  auto It = std::upper_bound(
+      SubprogramMap.begin(), SubprogramMap.end(), Address,
+      [](uint64_t Address, const std::pair<uint64_t, uint32_t> &Entry) {
+        return Address < Entry.first;
+      });
+  if (It == SubprogramMap.begin())
+    return -1U;
+  return std::prev(It)->second;
 }
 
 const DWARFDebugInfoEntryMinimal *
 DWARFUnit::getSubprogramForAddress(uint64_t Address) {
-  extractDIEsIfNeeded(false);
-  for (const DWARFDebugInfoEntryMinimal &DIE : DieArray) {
-    if (DIE.isSubprogramDIE() &&
-        DIE.addressRangeContainsAddress(this, Address)) {
-      return &DIE;
-    }
+  if (!SubprogramMapIsBuilt)
+    buildSubprogramMap(/*UseAccelTable=*/true);
+  uint32_t SubprogramOffset = lookUpSubprogramMap(Address);
+  if (SubprogramOffset == -1U && SubprogramMapIsFromAccelTable) {
+    // The accelerator table may miss unnamed subprograms, look at all the
+    // DIEs before giving up.
+    buildSubprogramMap(/*UseAccelTable=*/false);
+    SubprogramOffset = lookUpSubprogramMap(Address);
+  }
+  if (SubprogramOffset == -1U)
+    return nullptr;
+
+  if (DieArray.size() > 1)
+    return getDIEForOffset(SubprogramOffset);
+
+  // Extract only the subtree of the subprogram, which is enough to follow the
+  // inlined chain.
+  if (SubprogramDIEs.empty() ||
+      SubprogramDIEs.front().getOffset() != SubprogramOffset) {
+    SubprogramDIEs.clear();
+    walkDIESubtree(SubprogramOffset,
+                   [&](const DWARFDebugInfoEntryMinimal &DIE) {
+                     SubprogramDIEs.push_back(DIE);
+                   });
+    setDIERelations(SubprogramDIEs);
   }
-  return nullptr;
+  return SubprogramDIEs.empty() ? nullptr : &SubprogramDIEs.front();
 }
 
 DWARFDebugInfoEntryInlinedChain
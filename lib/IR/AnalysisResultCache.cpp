@@ -0,0 +1,169 @@
+//===- AnalysisResultCache.cpp - Analysis results saved across runs -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements AnalysisResultCache.
+//
+// A cache file starts with a magic string and the number of results, followed
+// by the results sorted by key. Each result is the length of its key, the key,
+// the number of words of data and the data, all numbers being 32-bit little
+// endian.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/AnalysisResultCache.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "analysis-result-cache"
+
+STATISTIC(NumHits, "Number of analysis results found in the cache");
+STATISTIC(NumMisses, "Number of analysis results not found in the cache");
+
+static const char Magic[] = {'L', 'L', 'V', 'M', 'A', 'R', 'C', '1'};
+
+static std::error_code invalidCacheFile() {
+  return std::make_error_code(std::errc::illegal_byte_sequence);
+}
+
+std::error_code AnalysisResultCache::load(StringRef Path) {
+  Results.clear();
+  Changed = false;
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr =
+      MemoryBuffer::getFile(Path);
+  if (std::error_code EC = BufOrErr.getError())
+    return EC == std::errc::no_such_file_or_directory ? std::error_code() : EC;
+
+  StringRef Buf = (*BufOrErr)->getBuffer();
+  if (!Buf.startswith(StringRef(Magic, sizeof(Magic))))
+    return invalidCacheFile();
+  const char *Ptr = Buf.begin() + sizeof(Magic), *End = Buf.end();
+  auto ReadWord = [&](uint32_t &W) {
+    if (End - Ptr < 4)
+      return false;
+    W = support::endian::read32le(Ptr);
+    Ptr += 4;
+    return true;
+  };
+
+  uint32_t NumResults;
+  if (!ReadWord(NumResults))
+    return invalidCacheFile();
+  for (uint32_t I = 0; I != NumResults; ++I) {
+    uint32_t KeySize, DataSize;
+    if (!ReadWord(KeySize) || uint64_t(End - Ptr) < KeySize)
+      return invalidCacheFile();
+    StringRef Key(Ptr, KeySize);
+    Ptr += KeySize;
+    if (!ReadWord(DataSize) || uint64_t(End - Ptr) / 4 < DataSize)
+      return invalidCacheFile();
+    std::vector<uint32_t> &Data = Results[Key];
+    Data.resize(DataSize);
+    for (uint32_t &W : Data)
+      ReadWord(W);
+  }
+  if (Ptr != End)
+    return invalidCacheFile();
+  return std::error_code();
+}
+
+std::error_code AnalysisResultCache::save(StringRef Path) {
+  if (!Changed)
+    return std::error_code();
+
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+  if (EC)
+    return EC;
+
+  // Write the results in a fixed order, so that the same results always give
+  // the same file.
+  std::vector<StringRef> Keys;
+  Keys.reserve(Results.size());
+  for (const auto &Result : Results)
+    Keys.push_back(Result.getKey());
+  std::sort(Keys.begin(), Keys.end());
+
+  support::endian::Writer<support::little> W(OS);
+  OS.write(Magic, sizeof(Magic));
+  W.write<uint32_t>(Keys.size());
+  for (StringRef Key : Keys) {
+    W.write<uint32_t>(Key.size());
+    OS << Key;
+    const std::vector<uint32_t> &Data = Results.find(Key)->getValue();
+    W.write<uint32_t>(Data.size());
+    for (uint32_t Word : Data)
+      W.write<uint32_t>(Word);
+  }
+
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    return std::make_error_code(std::errc::io_error);
+  }
+  Changed = false;
+  return std::error_code();
+}
+
+std::string AnalysisResultCache::getKey(StringRef Analysis,
+                                        const Function &F) {
+  // Hash the shape of the CFG: the successors of each block, by position.
+  DenseMap<const BasicBlock *, uint32_t> Positions;
+  for (const BasicBlock &BB : F)
+    Positions.insert(std::make_pair(&BB, Positions.size()));
+
+  MD5 Hash;
+  auto HashWord = [&Hash](uint32_t Word) {
+    uint8_t Bytes[4];
+    support::endian::write32le(Bytes, Word);
+    Hash.update(Bytes);
+  };
+  HashWord(Positions.size());
+  for (const BasicBlock &BB : F) {
+    const TerminatorInst *TI = BB.getTerminator();
+    unsigned NumSuccs = TI ? TI->getNumSuccessors() : 0;
+    HashWord(NumSuccs);
+    for (unsigned I = 0; I != NumSuccs; ++I)
+      HashWord(Positions.lookup(TI->getSuccessor(I)));
+  }
+  MD5::MD5Result Result;
+  Hash.final(Result);
+
+  std::string Key = Analysis;
+  Key += '\0';
+  Key.append(std::begin(Result), std::end(Result));
+  return Key;
+}
+
+const std::vector<uint32_t> *
+AnalysisResultCache::lookup(StringRef Key) const {
+  auto I = Results.find(Key);
+  if (I == Results.end()) {
+    ++NumMisses;
+    return nullptr;
+  }
+  ++NumHits;
+  return &I->getValue();
+}
+
+void AnalysisResultCache::insert(StringRef Key, std::vector<uint32_t> Data) {
+  Results[Key] = std::move(Data);
+  Changed = true;
+}
@@ -34,6 +34,7 @@ using namespace llvm;
 Attribute Attribute::get(LLVMContext &Context, Attribute::AttrKind Kind,
                          uint64_t Val) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->AttributesLock);
   FoldingSetNodeID ID;
   ID.AddInteger(Kind);
   if (Val) ID.AddInteger(Val);
@@ -57,6 +58,7 @@ Attribute Attribute::get(LLVMContext &Context, Attribute::AttrKind Kind,
 
 Attribute Attribute::get(LLVMContext &Context, StringRef Kind, StringRef Val) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->AttributesLock);
   FoldingSetNodeID ID;
   ID.AddString(Kind);
   if (!Val.empty()) ID.AddString(Val);
@@ -462,6 +464,7 @@ AttributeSetNode *AttributeSetNode::get(LLVMContext &C,
 
   // Otherwise, build a key to look up the existing attributes.
   LLVMContextImpl *pImpl = C.pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->AttributesLock);
   FoldingSetNodeID ID;
 
   SmallVector<Attribute, 8> SortedAttrs(Attrs.begin(), Attrs.end());
@@ -602,6 +605,7 @@ AttributeSet
 AttributeSet::getImpl(LLVMContext &C,
                       ArrayRef<std::pair<unsigned, AttributeSetNode*> > Attrs) {
   LLVMContextImpl *pImpl = C.pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->AttributesLock);
   FoldingSetNodeID ID;
   AttributeSetImpl::Profile(ID, Attrs);
 
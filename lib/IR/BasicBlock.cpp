@@ -16,6 +16,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
@@ -85,6 +86,20 @@ BasicBlock::~BasicBlock() {
   InstList.clear();
 }
 
+void *BasicBlock::operator new(size_t Size) {
+  IRArena *Arena = IRArena::getCurrent();
+  void *Storage = Arena ? Arena->allocate(Size) : ::operator new(Size);
+  reinterpret_cast<BasicBlock *>(Storage)->HasArenaStorage = Arena != nullptr;
+  return Storage;
+}
+
+void BasicBlock::operator delete(void *Ptr) {
+  if (static_cast<BasicBlock *>(Ptr)->HasArenaStorage)
+    IRArena::deallocate(Ptr);
+  else
+    ::operator delete(Ptr);
+}
+
 void BasicBlock::setParent(Function *parent) {
   // Set Parent=parent, updating instruction symtab entries as appropriate.
   InstList.setSymTabObject(&Parent, parent);
@@ -302,6 +302,7 @@ void Constant::destroyConstantImpl() {
   }
 
   // Value has no outstanding references it is safe to delete it now...
+  getContext().pImpl->logSharedValueDeletion(this);
   delete this;
 }
 
@@ -518,6 +519,7 @@ ConstantInt::ConstantInt(IntegerType *Ty, const APInt& V)
 
 ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
   if (!pImpl->TheTrueVal)
     pImpl->TheTrueVal = ConstantInt::get(Type::getInt1Ty(Context), 1);
   return pImpl->TheTrueVal;
@@ -525,6 +527,7 @@ ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
 
 ConstantInt *ConstantInt::getFalse(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
   if (!pImpl->TheFalseVal)
     pImpl->TheFalseVal = ConstantInt::get(Type::getInt1Ty(Context), 0);
   return pImpl->TheFalseVal;
@@ -558,7 +561,10 @@ Constant *ConstantInt::getFalse(Type *Ty) {
 ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   // get an existing value or the insertion position
   LLVMContextImpl *pImpl = Context.pImpl;
-  ConstantInt *&Slot = pImpl->IntConstants[V];
+  unsigned Shard = getContextShard(DenseMapAPIntKeyInfo::getHashValue(V));
+  ContextLockGuard Guard(pImpl->MultithreadedDepth,
+                         pImpl->IntConstantsLocks[Shard]);
+  ConstantInt *&Slot = pImpl->IntConstants[Shard][V];
   if (!Slot) {
     // Get the corresponding integer type for the bit width of the value.
     IntegerType *ITy = IntegerType::get(Context, V.getBitWidth());
@@ -697,8 +703,11 @@ Constant *ConstantFP::getZeroValueForNegation(Type *Ty) {
 // ConstantFP accessors.
 ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
   LLVMContextImpl* pImpl = Context.pImpl;
+  unsigned Shard = getContextShard(DenseMapAPFloatKeyInfo::getHashValue(V));
+  ContextLockGuard Guard(pImpl->MultithreadedDepth,
+                         pImpl->FPConstantsLocks[Shard]);
 
-  ConstantFP *&Slot = pImpl->FPConstants[V];
+  ConstantFP *&Slot = pImpl->FPConstants[Shard][V];
 
   if (!Slot) {
     Type *Ty;
@@ -1357,6 +1366,8 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
   assert((Ty->isStructTy() || Ty->isArrayTy() || Ty->isVectorTy()) &&
          "Cannot create an aggregate zero of non-aggregate type!");
   
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
   ConstantAggregateZero *&Entry = Ty->getContext().pImpl->CAZConstants[Ty];
   if (!Entry)
     Entry = new ConstantAggregateZero(Ty);
@@ -1367,13 +1378,19 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
 /// destroyConstant - Remove the constant from the constant table.
 ///
 void ConstantAggregateZero::destroyConstant() {
-  getContext().pImpl->CAZConstants.erase(getType());
+  SharedStateGuard Guard(getContext());
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
+    pImpl->CAZConstants.erase(getType());
+  }
   destroyConstantImpl();
 }
 
 /// destroyConstant - Remove the constant from the constant table...
 ///
 void ConstantArray::destroyConstant() {
+  SharedStateGuard Guard(getContext());
   getType()->getContext().pImpl->ArrayConstants.remove(this);
   destroyConstantImpl();
 }
@@ -1385,6 +1402,7 @@ void ConstantArray::destroyConstant() {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantStruct::destroyConstant() {
+  SharedStateGuard Guard(getContext());
   getType()->getContext().pImpl->StructConstants.remove(this);
   destroyConstantImpl();
 }
@@ -1392,6 +1410,7 @@ void ConstantStruct::destroyConstant() {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantVector::destroyConstant() {
+  SharedStateGuard Guard(getContext());
   getType()->getContext().pImpl->VectorConstants.remove(this);
   destroyConstantImpl();
 }
@@ -1437,6 +1456,8 @@ const APInt &Constant::getUniqueInteger() const {
 //
 
 ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
   ConstantPointerNull *&Entry = Ty->getContext().pImpl->CPNConstants[Ty];
   if (!Entry)
     Entry = new ConstantPointerNull(Ty);
@@ -1447,7 +1468,12 @@ ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantPointerNull::destroyConstant() {
-  getContext().pImpl->CPNConstants.erase(getType());
+  SharedStateGuard Guard(getContext());
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
+    pImpl->CPNConstants.erase(getType());
+  }
   // Free the constant and any dangling references to it.
   destroyConstantImpl();
 }
@@ -1457,6 +1483,8 @@ void ConstantPointerNull::destroyConstant() {
 //
 
 UndefValue *UndefValue::get(Type *Ty) {
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
   UndefValue *&Entry = Ty->getContext().pImpl->UVConstants[Ty];
   if (!Entry)
     Entry = new UndefValue(Ty);
@@ -1467,8 +1495,13 @@ UndefValue *UndefValue::get(Type *Ty) {
 // destroyConstant - Remove the constant from the constant table.
 //
 void UndefValue::destroyConstant() {
+  SharedStateGuard Guard(getContext());
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
+    pImpl->UVConstants.erase(getType());
+  }
   // Free the constant and any dangling references to it.
-  getContext().pImpl->UVConstants.erase(getType());
   destroyConstantImpl();
 }
 
@@ -1481,10 +1514,20 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
+  LLVMContextImpl *pImpl = F->getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
   BlockAddress *&BA =
     F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
-  if (!BA)
+  if (!BA) {
     BA = new BlockAddress(F, BB);
+    if (pImpl->isMultithreaded())
+      pImpl->BlockAddressRequests[BA] = pImpl->Clock.now();
+  } else if (pImpl->isMultithreaded()) {
+    auto R = pImpl->BlockAddressRequests.find(BA);
+    if (R != pImpl->BlockAddressRequests.end() &&
+        RegionClock::getWorkOrder() < R->second.Order)
+      R->second = pImpl->Clock.now();
+  }
 
   assert(BA->getFunction() == F && "Basic block moved between functions");
   return BA;
@@ -1504,8 +1547,9 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 
   const Function *F = BB->getParent();
   assert(F && "Block must have a parent");
-  BlockAddress *BA =
-      F->getContext().pImpl->BlockAddresses.lookup(std::make_pair(F, BB));
+  LLVMContextImpl *pImpl = F->getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
+  BlockAddress *BA = pImpl->BlockAddresses.lookup(std::make_pair(F, BB));
   assert(BA && "Refcount and block address map disagree!");
   return BA;
 }
@@ -1513,13 +1557,20 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 // destroyConstant - Remove the constant from the constant table.
 //
 void BlockAddress::destroyConstant() {
-  getFunction()->getType()->getContext().pImpl
-    ->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
+  SharedStateGuard Guard(getContext());
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
+    pImpl->BlockAddresses.erase(
+        std::make_pair(getFunction(), getBasicBlock()));
+    pImpl->BlockAddressRequests.erase(this);
+  }
   getBasicBlock()->AdjustBlockAddressRefCount(-1);
   destroyConstantImpl();
 }
 
 void BlockAddress::replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U) {
+  SharedStateGuard Guard(getContext());
   // This could be replacing either the Basic Block or the Function.  In either
   // case, we have to remove the map entry.
   Function *NewF = getFunction();
@@ -1532,23 +1583,30 @@ void BlockAddress::replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U) {
 
   // See if the 'new' entry already exists, if not, just update this in place
   // and return early.
-  BlockAddress *&NewBA =
-    getContext().pImpl->BlockAddresses[std::make_pair(NewF, NewBB)];
-  if (NewBA) {
-    replaceUsesOfWithOnConstantImpl(NewBA);
-    return;
+  BlockAddress *Replacement;
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
+    BlockAddress *&NewBA =
+      pImpl->BlockAddresses[std::make_pair(NewF, NewBB)];
+    if (!NewBA) {
+      getBasicBlock()->AdjustBlockAddressRefCount(-1);
+
+      // Remove the old entry, this can't cause the map to rehash (just a
+      // tombstone will get added).
+      pImpl->BlockAddresses.erase(std::make_pair(getFunction(),
+                                                 getBasicBlock()));
+      NewBA = this;
+      setOperand(0, NewF);
+      setOperand(1, NewBB);
+      getBasicBlock()->AdjustBlockAddressRefCount(1);
+      return;
+    }
+    Replacement = NewBA;
   }
-
-  getBasicBlock()->AdjustBlockAddressRefCount(-1);
-
-  // Remove the old entry, this can't cause the map to rehash (just a
-  // tombstone will get added).
-  getContext().pImpl->BlockAddresses.erase(std::make_pair(getFunction(),
-                                                          getBasicBlock()));
-  NewBA = this;
-  setOperand(0, NewF);
-  setOperand(1, NewBB);
-  getBasicBlock()->AdjustBlockAddressRefCount(1);
+  // The replacement destroys this constant, which takes the shared state
+  // lock, so the constants lock must be released first.
+  replaceUsesOfWithOnConstantImpl(Replacement);
 }
 
 //---- ConstantExpr::get() implementations.
@@ -2373,6 +2431,7 @@ Constant *ConstantExpr::getBinOpAbsorber(unsigned Opcode, Type *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantExpr::destroyConstant() {
+  SharedStateGuard Guard(getContext());
   getType()->getContext().pImpl->ExprConstants.remove(this);
   destroyConstantImpl();
 }
@@ -2472,10 +2531,10 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
     return ConstantAggregateZero::get(Ty);
 
   // Do a lookup to see if we have already formed one of these.
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
   auto &Slot =
-      *Ty->getContext()
-           .pImpl->CDSConstants.insert(std::make_pair(Elements, nullptr))
-           .first;
+      *pImpl->CDSConstants.insert(std::make_pair(Elements, nullptr)).first;
 
   // The bucket can point to a linked list of different CDS's that have the same
   // body but different types.  For example, 0,0,0,1 could be a 4 element array
@@ -2497,6 +2556,9 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
 }
 
 void ConstantDataSequential::destroyConstant() {
+  SharedStateGuard Guard(getContext());
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLockGuard CDSGuard(pImpl->MultithreadedDepth, pImpl->ConstantsLock);
   // Remove the constant from the StringMap.
   StringMap<ConstantDataSequential*> &CDSConstants = 
     getType()->getContext().pImpl->CDSConstants;
@@ -2840,6 +2902,7 @@ void Constant::replaceUsesOfWithOnConstantImpl(Constant *Replacement) {
 
 void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                 Use *U) {
+  SharedStateGuard Guard(getContext());
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
   Constant *ToC = cast<Constant>(To);
 
@@ -2886,6 +2949,7 @@ void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
 
 void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                  Use *U) {
+  SharedStateGuard Guard(getContext());
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
   Constant *ToC = cast<Constant>(To);
 
@@ -2937,6 +3001,7 @@ void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
 
 void ConstantVector::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                  Use *U) {
+  SharedStateGuard Guard(getContext());
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
   Constant *ToC = cast<Constant>(To);
 
@@ -2966,6 +3031,7 @@ void ConstantVector::replaceUsesOfWithOnConstant(Value *From, Value *To,
 
 void ConstantExpr::replaceUsesOfWithOnConstant(Value *From, Value *ToV,
                                                Use *U) {
+  SharedStateGuard Guard(getContext());
   assert(isa<Constant>(ToV) && "Cannot make Constant refer to non-constant!");
   Constant *To = cast<Constant>(ToV);
 
@@ -15,6 +15,8 @@
 #ifndef LLVM_LIB_IR_CONSTANTSCONTEXT_H
 #define LLVM_LIB_IR_CONSTANTSCONTEXT_H
 
+#include "ContextLocks.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/IR/InlineAsm.h"
@@ -23,6 +25,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 #include <map>
 #include <tuple>
 
@@ -519,6 +522,9 @@ public:
   typedef typename ConstantInfo<ConstantClass>::TypeClass TypeClass;
   typedef std::pair<TypeClass *, ValType> LookupKey;
 
+  /// Key and hash, to hash the key only once to find its shard and its slot.
+  typedef std::pair<unsigned, LookupKey> LookupKeyHashed;
+
 private:
   struct MapInfo {
     typedef DenseMapInfo<ConstantClass *> ConstantClassInfo;
@@ -538,6 +544,9 @@ private:
     static unsigned getHashValue(const LookupKey &Val) {
       return hash_combine(Val.first, Val.second.getHash());
     }
+    static unsigned getHashValue(const LookupKeyHashed &Val) {
+      return Val.first;
+    }
     static bool isEqual(const LookupKey &LHS, const ConstantClass *RHS) {
       if (RHS == getEmptyKey() || RHS == getTombstoneKey())
         return false;
@@ -545,64 +554,110 @@ private:
         return false;
       return LHS.second == RHS;
     }
+    static bool isEqual(const LookupKeyHashed &LHS, const ConstantClass *RHS) {
+      return isEqual(LHS.second, RHS);
+    }
   };
 
 public:
   typedef DenseMap<ConstantClass *, char, MapInfo> MapTy;
 
 private:
-  MapTy Map;
+  /// The constants are split in shards by hash. While the context is
+  /// multithreaded, a shard is only accessed under its lock.
+  const std::atomic<unsigned> &MultithreadedDepth;
+  MapTy Maps[NumContextShards];
+  sys::SmartMutex<true> Locks[NumContextShards];
+
+  /// The constants created while the context is multithreaded, with the
+  /// earliest time a thread asked for them, in serial order. A serial run
+  /// would have created them then. Guarded by the shard locks.
+  RegionClock &Clock;
+  DenseMap<ConstantClass *, RegionTime> Requests[NumContextShards];
 
 public:
-  typename MapTy::iterator map_begin() { return Map.begin(); }
-  typename MapTy::iterator map_end() { return Map.end(); }
+  ConstantUniqueMap(const std::atomic<unsigned> &MultithreadedDepth,
+                    RegionClock &Clock)
+      : MultithreadedDepth(MultithreadedDepth), Clock(Clock) {}
+
+  /// The maps of all the shards. Only walk them while the context isn't
+  /// multithreaded.
+  MutableArrayRef<MapTy> shard_maps() { return Maps; }
+
+  /// Move the times the constants created in the last multithreaded region
+  /// were asked for to \p Times.
+  void takeRequests(DenseMap<const Constant *, RegionTime> &Times) {
+    for (auto &ShardRequests : Requests) {
+      for (auto &I : ShardRequests)
+        Times[I.first] = I.second;
+      ShardRequests.clear();
+    }
+  }
 
   void freeConstants() {
-    for (auto &I : Map)
-      // Asserts that use_empty().
-      delete I.first;
+    for (auto &Map : Maps)
+      for (auto &I : Map)
+        // Asserts that use_empty().
+        delete I.first;
   }
 
 private:
-  ConstantClass *create(TypeClass *Ty, ValType V) {
-    ConstantClass *Result = V.create(Ty);
+  static unsigned getShard(const ConstantClass *CP) {
+    return getContextShard(MapInfo::getHashValue(CP));
+  }
 
-    assert(Result->getType() == Ty && "Type specified is not correct!");
-    insert(Result);
+  /// Insert the constant into its proper slot. The shard must be locked.
+  void insert(unsigned Shard, ConstantClass *CP) { Maps[Shard][CP] = '\0'; }
 
-    return Result;
+  /// Remove this constant from the map. The shard must be locked.
+  void remove(unsigned Shard, ConstantClass *CP) {
+    MapTy &Map = Maps[Shard];
+    typename MapTy::iterator I = Map.find(CP);
+    assert(I != Map.end() && "Constant not found in constant table!");
+    assert(I->first == CP && "Didn't find correct element?");
+    Map.erase(I);
+    Requests[Shard].erase(CP);
+  }
+
+  /// Note that a thread of a multithreaded region asks for \p CP, which
+  /// exists already. The shard must be locked.
+  void noteRequest(unsigned Shard, ConstantClass *CP) {
+    auto I = Requests[Shard].find(CP);
+    if (I != Requests[Shard].end() &&
+        RegionClock::getWorkOrder() < I->second.Order)
+      I->second = Clock.now();
   }
 
 public:
   /// Return the specified constant from the map, creating it if necessary.
   ConstantClass *getOrCreate(TypeClass *Ty, ValType V) {
     LookupKey Lookup(Ty, V);
-    ConstantClass *Result = nullptr;
-
-    auto I = find(Lookup);
-    if (I == Map.end())
-      Result = create(Ty, V);
-    else
-      Result = I->first;
-    assert(Result && "Unexpected nullptr");
+    LookupKeyHashed Hashed(MapInfo::getHashValue(Lookup), Lookup);
+    unsigned Shard = getContextShard(Hashed.first);
+    MapTy &Map = Maps[Shard];
+    ContextLockGuard Guard(MultithreadedDepth, Locks[Shard]);
+
+    bool IsMultithreaded = MultithreadedDepth.load(std::memory_order_relaxed);
+    auto I = Map.find_as(Hashed);
+    if (I != Map.end()) {
+      if (IsMultithreaded)
+        noteRequest(Shard, I->first);
+      return I->first;
+    }
 
+    ConstantClass *Result = V.create(Ty);
+    assert(Result->getType() == Ty && "Type specified is not correct!");
+    Map[Result] = '\0';
+    if (IsMultithreaded)
+      Requests[Shard][Result] = Clock.now();
     return Result;
   }
 
-  /// Find the constant by lookup key.
-  typename MapTy::iterator find(LookupKey Lookup) {
-    return Map.find_as(Lookup);
-  }
-
-  /// Insert the constant into its proper slot.
-  void insert(ConstantClass *CP) { Map[CP] = '\0'; }
-
   /// Remove this constant from the map
   void remove(ConstantClass *CP) {
-    typename MapTy::iterator I = Map.find(CP);
-    assert(I != Map.end() && "Constant not found in constant table!");
-    assert(I->first == CP && "Didn't find correct element?");
-    Map.erase(I);
+    unsigned Shard = getShard(CP);
+    ContextLockGuard Guard(MultithreadedDepth, Locks[Shard]);
+    remove(Shard, CP);
   }
 
   ConstantClass *replaceOperandsInPlace(ArrayRef<Constant *> Operands,
@@ -610,13 +665,23 @@ public:
                                         Constant *To, unsigned NumUpdated = 0,
                                         unsigned OperandNo = ~0u) {
     LookupKey Lookup(CP->getType(), ValType(Operands, CP));
-    auto I = find(Lookup);
-    if (I != Map.end())
+    LookupKeyHashed Hashed(MapInfo::getHashValue(Lookup), Lookup);
+    unsigned OldShard = getShard(CP);
+    unsigned NewShard = getContextShard(Hashed.first);
+    ContextShardPairGuard Guard(MultithreadedDepth, Locks, OldShard, NewShard);
+
+    auto I = Maps[NewShard].find_as(Hashed);
+    if (I != Maps[NewShard].end())
       return I->first;
 
+    // Keep the time the constant was asked for across the move.
+    auto R = Requests[OldShard].find(CP);
+    bool HasRequest = R != Requests[OldShard].end();
+    RegionTime RequestTime = HasRequest ? R->second : RegionTime();
+
     // Update to the new value.  Optimize for the case when we have a single
     // operand that we're changing, but handle bulk updates efficiently.
-    remove(CP);
+    remove(OldShard, CP);
     if (NumUpdated == 1) {
       assert(OperandNo < CP->getNumOperands() && "Invalid index");
       assert(CP->getOperand(OperandNo) != To && "I didn't contain From!");
@@ -626,7 +691,9 @@ public:
         if (CP->getOperand(I) == From)
           CP->setOperand(I, To);
     }
-    insert(CP);
+    insert(NewShard, CP);
+    if (HasRequest)
+      Requests[NewShard][CP] = RequestTime;
     return nullptr;
   }
 
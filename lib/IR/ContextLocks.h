@@ -0,0 +1,141 @@
+//===-- ContextLocks.h - Locks of the uniquing tables -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief This file defines the helpers used to lock the uniquing tables of
+/// an LLVMContext while it is in a multithreaded region.
+///
+/// The tables that are hit the most (integer, floating point and aggregate
+/// constants, constant expressions and use lists) are split in shards, each
+/// with its own lock, so that threads creating unrelated values rarely wait
+/// on each other. The other tables each have their own lock, apart from the
+/// one that protects the rest of the state that functions share.
+///
+/// To avoid deadlocks, the locks are always taken in this order:
+///   1. the shared state lock (SharedStateGuard);
+///   2. the attributes lock, the constants lock and the metadata uniquing lock;
+///   3. the lock of a shard of a constant table;
+///   4. the type lock;
+///   5. the lock of a shard of the use lists.
+/// A thread may skip levels, but never takes a lock of a lower level while it
+/// holds one of a higher level. Locks are recursive, so a thread may take a
+/// lock it already holds.
+///
+/// The additions to the shared use lists are logged with the time they would
+/// have happened in a serial run (see RegionClock), so that the use lists can
+/// be put back in a deterministic order once the region ends.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_IR_CONTEXTLOCKS_H
+#define LLVM_LIB_IR_CONTEXTLOCKS_H
+
+#include "llvm/Support/Mutex.h"
+#include <atomic>
+#include <tuple>
+#include <utility>
+
+namespace llvm {
+
+/// Number of shards of the sharded uniquing tables of a context.
+enum : unsigned { NumContextShards = 16 };
+
+/// Return the shard of a sharded table an entry with hash \p Hash belongs to.
+/// The hash is mixed first, as the low bits of the hashes of the DenseMap key
+/// infos are often weak.
+inline unsigned getContextShard(unsigned Hash) {
+  return (Hash * 0x9E3779B9u) >> 28;
+}
+static_assert(NumContextShards == 16, "getContextShard assumes 16 shards");
+
+/// \brief Scoped lock of one of the locks of a context. Does nothing unless
+/// the context is in a multithreaded region.
+class ContextLockGuard {
+  sys::SmartMutex<true> *Lock;
+
+  ContextLockGuard(const ContextLockGuard &) = delete;
+  void operator=(const ContextLockGuard &) = delete;
+
+public:
+  ContextLockGuard(const std::atomic<unsigned> &MultithreadedDepth,
+                   sys::SmartMutex<true> &M)
+      : Lock(MultithreadedDepth.load(std::memory_order_relaxed) ? &M
+                                                                : nullptr) {
+    if (Lock)
+      Lock->lock();
+  }
+  ~ContextLockGuard() {
+    if (Lock)
+      Lock->unlock();
+  }
+};
+
+/// \brief Scoped lock of two shards of the same table, taken in index order.
+class ContextShardPairGuard {
+  sys::SmartMutex<true> *First, *Second;
+
+  ContextShardPairGuard(const ContextShardPairGuard &) = delete;
+  void operator=(const ContextShardPairGuard &) = delete;
+
+public:
+  ContextShardPairGuard(const std::atomic<unsigned> &MultithreadedDepth,
+                        sys::SmartMutex<true> *Locks, unsigned Shard1,
+                        unsigned Shard2)
+      : First(nullptr), Second(nullptr) {
+    if (!MultithreadedDepth.load(std::memory_order_relaxed))
+      return;
+    if (Shard2 < Shard1)
+      std::swap(Shard1, Shard2);
+    First = &Locks[Shard1];
+    First->lock();
+    if (Shard2 != Shard1) {
+      Second = &Locks[Shard2];
+      Second->lock();
+    }
+  }
+  ~ContextShardPairGuard() {
+    if (Second)
+      Second->unlock();
+    if (First)
+      First->unlock();
+  }
+};
+
+/// \brief The time of an event of a multithreaded region, in the order a
+/// serial run of the work of the region would have: the position of the
+/// function the thread worked on (see LLVMContext::setMultithreadedWorkOrder),
+/// then the order in which the events happened.
+struct RegionTime {
+  unsigned Order;
+  unsigned Seq;
+
+  bool operator<(const RegionTime &RHS) const {
+    return std::tie(Order, Seq) < std::tie(RHS.Order, RHS.Seq);
+  }
+};
+
+/// \brief Hands out the times of the events of a multithreaded region. The
+/// events of a function happen on a single thread, so they are ordered as in
+/// a serial run.
+class RegionClock {
+  std::atomic<unsigned> NextSeq;
+
+public:
+  RegionClock() : NextSeq(0) {}
+
+  RegionTime now() { return RegionTime{getWorkOrder(), NextSeq++}; }
+  void reset() { NextSeq = 0; }
+
+  /// Return the position of the function the calling thread works on.
+  static unsigned getWorkOrder();
+};
+
+} // end namespace llvm
+
+#endif
@@ -48,7 +48,7 @@ DILocation *DILocation::getImpl(LLVMContext &Context, unsigned Line,
   assert(Scope && "Expected scope");
   if (Storage == Uniqued) {
     if (auto *N =
-            getUniqued(Context.pImpl->DILocations,
+            getUniqued(Context, Context.pImpl->DILocations,
                        DILocationInfo::KeyTy(Line, Column, Scope, InlinedAt)))
       return N;
     if (!ShouldCreate)
@@ -57,6 +57,13 @@ DILocation *DILocation::getImpl(LLVMContext &Context, unsigned Line,
     assert(ShouldCreate && "Expected non-uniqued nodes to always be created");
   }
 
+  SharedStateGuard Guard(Context);
+  if (Storage == Uniqued && Context.pImpl->isMultithreaded())
+    if (auto *N =
+            getUniqued(Context, Context.pImpl->DILocations,
+                       DILocationInfo::KeyTy(Line, Column, Scope, InlinedAt)))
+      return N;
+
   SmallVector<Metadata *, 2> Ops;
   Ops.push_back(Scope);
   if (InlinedAt)
@@ -80,6 +87,7 @@ unsigned DILocation::computeNewDiscriminator() const {
   // AddDiscriminators::runOnFunction(), where it doesn't pollute the
   // LLVMContext.
   std::pair<const char *, unsigned> Key(getFilename().data(), getLine());
+  SharedStateGuard Guard(getContext());
   return ++getContext().pImpl->DiscriminatorTable[Key];
 }
 
@@ -175,7 +183,7 @@ GenericDINode *GenericDINode::getImpl(LLVMContext &Context, unsigned Tag,
   unsigned Hash = 0;
   if (Storage == Uniqued) {
     GenericDINodeInfo::KeyTy Key(Tag, getString(Header), DwarfOps);
-    if (auto *N = getUniqued(Context.pImpl->GenericDINodes, Key))
+    if (auto *N = getUniqued(Context, Context.pImpl->GenericDINodes, Key))
       return N;
     if (!ShouldCreate)
       return nullptr;
@@ -184,6 +192,13 @@ GenericDINode *GenericDINode::getImpl(LLVMContext &Context, unsigned Tag,
     assert(ShouldCreate && "Expected non-uniqued nodes to always be created");
   }
 
+  SharedStateGuard Guard(Context);
+  if (Storage == Uniqued && Context.pImpl->isMultithreaded())
+    if (auto *N = getUniqued(
+            Context, Context.pImpl->GenericDINodes,
+            GenericDINodeInfo::KeyTy(Tag, getString(Header), DwarfOps)))
+      return N;
+
   // Use a nullptr for empty headers.
   assert(isCanonical(Header) && "Expected canonical MDString");
   Metadata *PreOps[] = {Header};
@@ -201,7 +216,7 @@ void GenericDINode::recalculateHash() {
 #define DEFINE_GETIMPL_LOOKUP(CLASS, ARGS)                                     \
   do {                                                                         \
     if (Storage == Uniqued) {                                                  \
-      if (auto *N = getUniqued(Context.pImpl->CLASS##s,                        \
+      if (auto *N = getUniqued(Context, Context.pImpl->CLASS##s,               \
                                CLASS##Info::KeyTy(UNWRAP_ARGS(ARGS))))         \
         return N;                                                              \
       if (!ShouldCreate)                                                       \
@@ -210,7 +225,12 @@ void GenericDINode::recalculateHash() {
       assert(ShouldCreate &&                                                   \
              "Expected non-uniqued nodes to always be created");               \
     }                                                                          \
-  } while (false)
+  } while (false);                                                             \
+  SharedStateGuard Guard(Context);                                             \
+  if (Storage == Uniqued && Context.pImpl->isMultithreaded())                  \
+    if (auto *N = getUniqued(Context, Context.pImpl->CLASS##s,                 \
+                             CLASS##Info::KeyTy(UNWRAP_ARGS(ARGS))))           \
+      return N
 #define DEFINE_GETIMPL_STORE(CLASS, ARGS, OPS)                                 \
   return storeImpl(new (ArrayRef<Metadata *>(OPS).size())                      \
                        CLASS(Context, Storage, UNWRAP_ARGS(ARGS), OPS),        \
@@ -310,6 +310,54 @@ DominatorTree DominatorTreeAnalysis::run(Function &F) {
   return DT;
 }
 
+void DominatorTreeAnalysis::writeToCache(Function &F, const DominatorTree &DT,
+                                         std::vector<uint32_t> &Data) {
+  DenseMap<const BasicBlock *, uint32_t> Positions;
+  for (BasicBlock &BB : F)
+    Positions.insert(std::make_pair(&BB, Positions.size()));
+
+  // Walk the tree in preorder so that each block comes after its immediate
+  // dominator, keeping the children in order so that the rebuilt tree is the
+  // same as this one.
+  const DomTreeNode *Root = DT.getRootNode();
+  if (!Root)
+    return;
+  SmallVector<const DomTreeNode *, 32> Worklist;
+  Worklist.append(Root->getChildren().rbegin(), Root->getChildren().rend());
+  while (!Worklist.empty()) {
+    const DomTreeNode *N = Worklist.pop_back_val();
+    Data.push_back(Positions.lookup(N->getBlock()));
+    Data.push_back(Positions.lookup(N->getIDom()->getBlock()));
+    Worklist.append(N->getChildren().rbegin(), N->getChildren().rend());
+  }
+}
+
+bool DominatorTreeAnalysis::readFromCache(Function &F, ArrayRef<uint32_t> Data,
+                                          DominatorTree &DT) {
+  std::vector<BasicBlock *> Blocks;
+  for (BasicBlock &BB : F)
+    Blocks.push_back(&BB);
+  if (Blocks.empty() || Data.size() % 2 != 0)
+    return false;
+
+  // Check that every block comes after its immediate dominator, so that the
+  // tree can be rebuilt from the list without asserting.
+  std::vector<bool> InTree(Blocks.size());
+  InTree[0] = true;
+  SmallVector<std::pair<BasicBlock *, BasicBlock *>, 32> IDoms;
+  for (unsigned I = 0, E = Data.size(); I != E; I += 2) {
+    uint32_t Block = Data[I], IDom = Data[I + 1];
+    if (Block >= Blocks.size() || IDom >= Blocks.size() || InTree[Block] ||
+        !InTree[IDom])
+      return false;
+    InTree[Block] = true;
+    IDoms.push_back(std::make_pair(Blocks[Block], Blocks[IDom]));
+  }
+
+  DT.recalculateFromIDoms(Blocks[0], IDoms);
+  return true;
+}
+
 char DominatorTreeAnalysis::PassID;
 
 DominatorTreePrinterPass::DominatorTreePrinterPass(raw_ostream &OS) : OS(OS) {}
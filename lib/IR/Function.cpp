@@ -31,6 +31,7 @@
 #include "llvm/Support/RWMutex.h"
 #include "llvm/Support/StringPool.h"
 #include "llvm/Support/Threading.h"
+#include <algorithm>
 using namespace llvm;
 
 // Explicit instantiations of SymbolTableListTraits since some of the methods
@@ -246,6 +247,19 @@ void Function::eraseFromParent() {
 // Function Implementation
 //===----------------------------------------------------------------------===//
 
+namespace llvm {
+/// \brief The instructions of a function that changed since its changes
+/// started being tracked.
+class ChangedInstructionSet {
+public:
+  /// The position of each instruction in Order.
+  DenseMap<Instruction *, unsigned> Index;
+  /// The instructions in the order in which they were recorded, with nulls
+  /// where instructions were forgotten.
+  std::vector<Instruction *> Order;
+};
+}
+
 Function::Function(FunctionType *Ty, LinkageTypes Linkage, const Twine &name,
                    Module *ParentModule)
     : GlobalObject(PointerType::getUnqual(Ty), Value::FunctionVal, nullptr, 0,
@@ -316,6 +330,7 @@ void Function::setParent(Module *parent) {
 //
 void Function::dropAllReferences() {
   setIsMaterializable(false);
+  stopTrackingChanges();
 
   for (iterator I = begin(), E = end(); I != E; ++I)
     I->dropAllReferences();
@@ -903,8 +918,75 @@ bool Function::callsFunctionThatReturnsTwice() const {
   return false;
 }
 
+void Function::startTrackingChanges() {
+  if (ChangedInsts) {
+    ChangedInsts->Index.clear();
+    ChangedInsts->Order.clear();
+    return;
+  }
+  ChangedInsts.reset(new ChangedInstructionSet());
+  ++getContext().pImpl->NumChangeTrackingFunctions;
+  ++Use::NumChangeTrackingFunctions;
+}
+
+void Function::stopTrackingChanges() {
+  if (!ChangedInsts)
+    return;
+  ChangedInsts.reset();
+  --getContext().pImpl->NumChangeTrackingFunctions;
+  --Use::NumChangeTrackingFunctions;
+}
+
+void Function::takeChangedInstructions(std::vector<Instruction *> &Changed) {
+  assert(ChangedInsts && "Changes of the function aren't tracked");
+  Changed.clear();
+  Changed.reserve(ChangedInsts->Index.size());
+  for (Instruction *I : ChangedInsts->Order)
+    if (I)
+      Changed.push_back(I);
+  ChangedInsts->Index.clear();
+  ChangedInsts->Order.clear();
+}
+
+void Function::recordChangedInstruction(Instruction *I) {
+  assert(I->getParent() && I->getParent()->getParent() == this &&
+         "Recording an instruction of another function");
+  auto Inserted = ChangedInsts->Index.insert(
+      std::make_pair(I, unsigned(ChangedInsts->Order.size())));
+  if (Inserted.second)
+    ChangedInsts->Order.push_back(I);
+}
+
+void Function::forgetChangedInstruction(Instruction *I, bool NoteOperands) {
+  auto It = ChangedInsts->Index.find(I);
+  if (It != ChangedInsts->Index.end()) {
+    ChangedInsts->Order[It->second] = nullptr;
+    ChangedInsts->Index.erase(It);
+
+    // Squeeze out the forgotten instructions once they are the majority, so
+    // that creating and deleting instructions over and over doesn't grow the
+    // list without bound.
+    std::vector<Instruction *> &Order = ChangedInsts->Order;
+    if (Order.size() > 64 && Order.size() > 2 * ChangedInsts->Index.size()) {
+      Order.erase(std::remove(Order.begin(), Order.end(), nullptr),
+                  Order.end());
+      for (unsigned Idx = 0, E = Order.size(); Idx != E; ++Idx)
+        ChangedInsts->Index[Order[Idx]] = Idx;
+    }
+  }
+
+  // The operands lose a user, which may let them be simplified further.
+  if (NoteOperands)
+    for (Use &Op : I->operands())
+      if (auto *OpI = dyn_cast_or_null<Instruction>(Op.get()))
+        if (OpI != I && OpI->getParent() &&
+            OpI->getParent()->getParent() == this)
+          recordChangedInstruction(OpI);
+}
+
 Constant *Function::getPrefixData() const {
   assert(hasPrefixData());
+  SharedStateGuard Guard(getContext());
   const LLVMContextImpl::PrefixDataMapTy &PDMap =
       getContext().pImpl->PrefixDataMap;
   assert(PDMap.find(this) != PDMap.end());
@@ -916,6 +998,7 @@ void Function::setPrefixData(Constant *PrefixData) {
     return;
 
   unsigned SCData = getSubclassDataFromValue();
+  SharedStateGuard Guard(getContext());
   LLVMContextImpl::PrefixDataMapTy &PDMap = getContext().pImpl->PrefixDataMap;
   ReturnInst *&PDHolder = PDMap[this];
   if (PrefixData) {
@@ -934,6 +1017,7 @@ void Function::setPrefixData(Constant *PrefixData) {
 
 Constant *Function::getPrologueData() const {
   assert(hasPrologueData());
+  SharedStateGuard Guard(getContext());
   const LLVMContextImpl::PrologueDataMapTy &SOMap =
       getContext().pImpl->PrologueDataMap;
   assert(SOMap.find(this) != SOMap.end());
@@ -945,6 +1029,7 @@ void Function::setPrologueData(Constant *PrologueData) {
     return;
 
   unsigned PDData = getSubclassDataFromValue();
+  SharedStateGuard Guard(getContext());
   LLVMContextImpl::PrologueDataMapTy &PDMap = getContext().pImpl->PrologueDataMap;
   ReturnInst *&PDHolder = PDMap[this];
   if (PrologueData) {
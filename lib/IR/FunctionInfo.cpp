@@ -0,0 +1,115 @@
+//===-- FunctionInfo.cpp - Function Info Index ----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the function info index and summary classes for the
+// IR library.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/FunctionInfo.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+using namespace llvm;
+
+/// Return true if a copy of a definition with linkage \p L may be placed in
+/// another module as an available_externally definition.
+static bool hasImportableLinkage(GlobalValue::LinkageTypes L) {
+  return GlobalValue::isExternalLinkage(L) ||
+         GlobalValue::isLinkOnceODRLinkage(L) ||
+         GlobalValue::isWeakODRLinkage(L) ||
+         GlobalValue::isAvailableExternallyLinkage(L);
+}
+
+/// Return true if \p C (transitively) refers to a local symbol or a block
+/// address, neither of which can be referenced from another module.
+static bool refersToLocal(const Constant *C,
+                          SmallPtrSetImpl<const Constant *> &Visited) {
+  if (!Visited.insert(C).second)
+    return false;
+  if (auto *GV = dyn_cast<GlobalValue>(C))
+    return GV->hasLocalLinkage();
+  if (isa<BlockAddress>(C))
+    return true;
+  for (const Value *Op : C->operands())
+    if (refersToLocal(cast<Constant>(Op), Visited))
+      return true;
+  return false;
+}
+
+static std::unique_ptr<FunctionSummary>
+computeFunctionSummary(const Function &F, StringRef ModPath,
+                       FunctionInfoIndex &Index) {
+  unsigned NumInsts = 0;
+  bool IsEligible = hasImportableLinkage(F.getLinkage()) && !F.hasComdat();
+  SmallPtrSet<const Constant *, 16> Visited;
+  std::vector<StringRef> Callees;
+  SmallPtrSet<const Function *, 16> SeenCallees;
+
+  for (const Instruction &I : inst_range(F)) {
+    if (isa<DbgInfoIntrinsic>(I))
+      continue;
+    ++NumInsts;
+
+    if (ImmutableCallSite CS = ImmutableCallSite(&I))
+      if (const Function *Callee = CS.getCalledFunction())
+        if (Callee->hasName() && !Callee->isIntrinsic() &&
+            SeenCallees.insert(Callee).second)
+          Callees.push_back(Index.internName(Callee->getName()));
+
+    if (!IsEligible)
+      continue;
+    for (const Value *Op : I.operands())
+      if (auto *C = dyn_cast<Constant>(Op))
+        if (refersToLocal(C, Visited)) {
+          IsEligible = false;
+          break;
+        }
+  }
+
+  auto Summary = llvm::make_unique<FunctionSummary>(ModPath, F.getLinkage(),
+                                                    NumInsts, IsEligible);
+  for (StringRef Callee : Callees)
+    Summary->addCallee(Callee);
+  return Summary;
+}
+
+void FunctionInfoIndex::addModule(const Module &M, StringRef ModPath,
+                                  uint64_t ModId) {
+  ModPath = addModulePath(ModPath, ModId);
+  for (const Function &F : M) {
+    if (F.isDeclaration() || !F.hasName())
+      continue;
+    addFunctionSummary(F.getName(), computeFunctionSummary(F, ModPath, *this));
+  }
+}
+
+void FunctionInfoIndex::mergeFrom(const FunctionInfoIndex &Other,
+                                  uint64_t &NextModuleId) {
+  // Module paths of Other that have not been seen before get fresh ids.
+  for (const auto &ModPath : Other.modulePaths())
+    if (!ModulePathStringTable.count(ModPath.first()))
+      addModulePath(ModPath.first(), NextModuleId++);
+
+  for (const auto &FuncSummaries : Other) {
+    for (const auto &Summary : FuncSummaries.second) {
+      auto NewSummary = llvm::make_unique<FunctionSummary>(
+          addModulePath(Summary->modulePath(), 0), Summary->getLinkage(),
+          Summary->instCount(), Summary->isEligibleForImport());
+      for (StringRef Callee : Summary->callees())
+        NewSummary->addCallee(internName(Callee));
+      addFunctionSummary(FuncSummaries.first(), std::move(NewSummary));
+    }
+  }
+}
@@ -54,6 +54,7 @@ void GlobalValue::copyAttributesFrom(const GlobalValue *Src) {
   setVisibility(Src->getVisibility());
   setUnnamedAddr(Src->hasUnnamedAddr());
   setDLLStorageClass(Src->getDLLStorageClass());
+  setThreadLocalMode(Src->getThreadLocalMode());
 }
 
 unsigned GlobalValue::getAlignment() const {
@@ -238,7 +239,6 @@ void GlobalVariable::copyAttributesFrom(const GlobalValue *Src) {
   assert(isa<GlobalVariable>(Src) && "Expected a GlobalVariable!");
   GlobalObject::copyAttributesFrom(Src);
   const GlobalVariable *SrcVar = cast<GlobalVariable>(Src);
-  setThreadLocalMode(SrcVar->getThreadLocalMode());
   setExternallyInitialized(SrcVar->isExternallyInitialized());
 }
 
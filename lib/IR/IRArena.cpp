@@ -0,0 +1,124 @@
+//===-- IRArena.cpp - Arena for instructions and blocks -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements IRArena.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/IRArena.h"
+#include "llvm/Support/Compiler.h"
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+using namespace llvm;
+
+/// The current arena of this thread.
+static LLVM_THREAD_LOCAL IRArena *CurrentArena = nullptr;
+
+std::atomic<unsigned> IRArena::NumMultithreadedContexts(0);
+
+/// Locks an arena while some context is multithreaded. The passes working on
+/// other functions may then delete objects that were moved out of the
+/// function of the arena.
+class IRArena::Guard {
+  sys::SmartMutex<true> *M;
+
+public:
+  explicit Guard(IRArena &Arena) : M(nullptr) {
+    if (LLVM_UNLIKELY(mayBeShared())) {
+      M = &Arena.Lock;
+      M->lock();
+    }
+  }
+  ~Guard() {
+    if (M)
+      M->unlock();
+  }
+};
+
+IRArena::IRArena() : NumLiveObjects(0), NumReusedObjects(0), RefCount(0) {
+  std::fill(std::begin(FreeLists), std::end(FreeLists), nullptr);
+}
+
+IRArena::~IRArena() {
+  assert(!NumLiveObjects && "Deleting an arena that objects still live in");
+}
+
+void IRArena::Retain() {
+  Guard G(*this);
+  ++RefCount;
+}
+
+void IRArena::Release() {
+  bool IsLast;
+  {
+    Guard G(*this);
+    assert(RefCount && "Releasing an arena more often than it was retained");
+    IsLast = --RefCount == 0;
+  }
+  // The guard must be gone before the arena it locks.
+  if (IsLast)
+    delete this;
+}
+
+void *IRArena::allocate(size_t Size) {
+  size_t SizeClass = (Size + SizeClassBytes - 1) / SizeClassBytes;
+  if (Size > MaxPooledSize)
+    SizeClass = 0;
+  Guard G(*this);
+  Header *H;
+  if (!SizeClass) {
+    H = static_cast<Header *>(::operator new(sizeof(Header) + Size));
+  } else if (void *Free = FreeLists[SizeClass]) {
+    FreeLists[SizeClass] = *static_cast<void **>(Free);
+    H = getHeader(Free);
+    ++NumReusedObjects;
+  } else {
+    H = static_cast<Header *>(
+        Allocator.Allocate(sizeof(Header) + SizeClass * SizeClassBytes,
+                           AlignOf<Header>::Alignment));
+  }
+  H->Arena = this;
+  H->SizeClass = SizeClass;
+  ++NumLiveObjects;
+  ++RefCount;
+  return H + 1;
+}
+
+void IRArena::deallocate(void *Ptr) {
+  Header *H = getHeader(Ptr);
+  IRArena *Arena = H->Arena;
+  bool IsLast;
+  {
+    Guard G(*Arena);
+    assert(Arena->NumLiveObjects &&
+           "Freeing more objects than were allocated");
+    --Arena->NumLiveObjects;
+    if (H->SizeClass) {
+      *static_cast<void **>(Ptr) = Arena->FreeLists[H->SizeClass];
+      Arena->FreeLists[H->SizeClass] = Ptr;
+    }
+    IsLast = --Arena->RefCount == 0;
+  }
+  if (!H->SizeClass)
+    ::operator delete(H);
+  // This deletes the arena once its last object is gone and nobody else
+  // holds on to it.
+  if (IsLast)
+    delete Arena;
+}
+
+IRArena *IRArena::getCurrent() { return CurrentArena; }
+
+IRArena::Scope::Scope(IRArena *Arena) : Prev(CurrentArena) {
+  CurrentArena = Arena;
+}
+
+IRArena::Scope::~Scope() { CurrentArena = Prev; }
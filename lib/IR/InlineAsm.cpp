@@ -48,6 +48,7 @@ InlineAsm::InlineAsm(PointerType *Ty, const std::string &asmString,
 }
 
 void InlineAsm::destroyConstant() {
+  SharedStateGuard Guard(getContext());
   getType()->getContext().pImpl->InlineAsms.remove(this);
   delete this;
 }
@@ -14,12 +14,21 @@
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/Type.h"
 using namespace llvm;
 
+void *Instruction::operator new(size_t Size) {
+  return allocateHungoffUser(Size, IRArena::getCurrent());
+}
+
+void *Instruction::operator new(size_t Size, unsigned Us) {
+  return allocateFixedUser(Size, Us, IRArena::getCurrent());
+}
+
 Instruction::Instruction(Type *ty, unsigned it, Use *Ops, unsigned NumOps,
                          Instruction *InsertBefore)
   : User(ty, Value::InstructionVal + it, Ops, NumOps), Parent(nullptr) {
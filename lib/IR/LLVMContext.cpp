@@ -18,6 +18,7 @@
 #include "llvm/IR/DebugLoc.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -166,6 +167,42 @@ void LLVMContext::yield() {
     pImpl->YieldCallback(this, pImpl->YieldOpaqueHandle);
 }
 
+void LLVMContext::enterMultithreadedRegion() {
+  if (pImpl->MultithreadedDepth++ == 0) {
+    ++Use::NumMultithreadedContexts;
+    ++IRArena::NumMultithreadedContexts;
+  }
+}
+
+void LLVMContext::exitMultithreadedRegion() {
+  assert(pImpl->isMultithreaded() && "Not in a multithreaded region");
+  if (--pImpl->MultithreadedDepth == 0) {
+    --Use::NumMultithreadedContexts;
+    --IRArena::NumMultithreadedContexts;
+    pImpl->restoreUseListOrder();
+  }
+}
+
+/// The position of the function the thread works on in the serial order of
+/// the work of a multithreaded region.
+static LLVM_THREAD_LOCAL unsigned WorkOrder = 0;
+
+void LLVMContext::setMultithreadedWorkOrder(unsigned Order) {
+  WorkOrder = Order;
+}
+
+unsigned RegionClock::getWorkOrder() { return WorkOrder; }
+
+bool LLVMContext::isMultithreaded() const { return pImpl->isMultithreaded(); }
+
+void LLVMContext::setUseFunctionArenas(bool Enable) {
+  pImpl->UseFunctionArenas = Enable;
+}
+
+bool LLVMContext::useFunctionArenas() const {
+  return pImpl->UseFunctionArenas;
+}
+
 void LLVMContext::emitError(const Twine &ErrorStr) {
   diagnose(DiagnosticInfoInlineAsm(ErrorStr));
 }
@@ -243,6 +280,7 @@ void LLVMContext::emitError(unsigned LocCookie, const Twine &ErrorStr) {
 
 /// Return a unique non-zero ID for the specified metadata kind.
 unsigned LLVMContext::getMDKindID(StringRef Name) const {
+  SharedStateGuard Guard(*pImpl);
   // If this is new, assign it its ID.
   return pImpl->CustomMDKindNames.insert(
                                      std::make_pair(
@@ -253,6 +291,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
 /// getHandlerNames - Populate client supplied smallvector using custome
 /// metadata name and ID.
 void LLVMContext::getMDKindNames(SmallVectorImpl<StringRef> &Names) const {
+  SharedStateGuard Guard(*pImpl);
   Names.resize(pImpl->CustomMDKindNames.size());
   for (StringMap<unsigned>::const_iterator I = pImpl->CustomMDKindNames.begin(),
        E = pImpl->CustomMDKindNames.end(); I != E; ++I)
@@ -20,7 +20,13 @@
 using namespace llvm;
 
 LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
-  : TheTrueVal(nullptr), TheFalseVal(nullptr),
+  : MultithreadedDepth(0), NumChangeTrackingFunctions(0),
+    ArrayConstants(MultithreadedDepth, Clock),
+    StructConstants(MultithreadedDepth, Clock),
+    VectorConstants(MultithreadedDepth, Clock),
+    ExprConstants(MultithreadedDepth, Clock),
+    InlineAsms(MultithreadedDepth, Clock),
+    TheTrueVal(nullptr), TheFalseVal(nullptr),
     VoidTy(C, Type::VoidTyID),
     LabelTy(C, Type::LabelTyID),
     HalfTy(C, Type::HalfTyID),
@@ -44,6 +50,7 @@ LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
   RespectDiagnosticFilters = false;
   YieldCallback = nullptr;
   YieldOpaqueHandle = nullptr;
+  UseFunctionArenas = false;
   NamedStructTypesUniqueID = 0;
 }
 
@@ -98,14 +105,14 @@ LLVMContextImpl::~LLVMContextImpl() {
 #include "llvm/IR/Metadata.def"
 
   // Free the constants.
-  std::for_each(ExprConstants.map_begin(), ExprConstants.map_end(),
-                DropFirst());
-  std::for_each(ArrayConstants.map_begin(), ArrayConstants.map_end(),
-                DropFirst());
-  std::for_each(StructConstants.map_begin(), StructConstants.map_end(),
-                DropFirst());
-  std::for_each(VectorConstants.map_begin(), VectorConstants.map_end(),
-                DropFirst());
+  for (auto &Map : ExprConstants.shard_maps())
+    std::for_each(Map.begin(), Map.end(), DropFirst());
+  for (auto &Map : ArrayConstants.shard_maps())
+    std::for_each(Map.begin(), Map.end(), DropFirst());
+  for (auto &Map : StructConstants.shard_maps())
+    std::for_each(Map.begin(), Map.end(), DropFirst());
+  for (auto &Map : VectorConstants.shard_maps())
+    std::for_each(Map.begin(), Map.end(), DropFirst());
   ExprConstants.freeConstants();
   ArrayConstants.freeConstants();
   StructConstants.freeConstants();
@@ -114,8 +121,10 @@ LLVMContextImpl::~LLVMContextImpl() {
   DeleteContainerSeconds(CPNConstants);
   DeleteContainerSeconds(UVConstants);
   InlineAsms.freeConstants();
-  DeleteContainerSeconds(IntConstants);
-  DeleteContainerSeconds(FPConstants);
+  for (auto &Map : IntConstants)
+    DeleteContainerSeconds(Map);
+  for (auto &Map : FPConstants)
+    DeleteContainerSeconds(Map);
   
   for (StringMap<ConstantDataSequential*>::iterator I = CDSConstants.begin(),
        E = CDSConstants.end(); I != E; ++I)
@@ -167,15 +176,15 @@ void LLVMContextImpl::dropTriviallyDeadConstantArrays() {
   do {
     Changed = false;
 
-    for (auto I = ArrayConstants.map_begin(), E = ArrayConstants.map_end();
-         I != E; ) {
-      auto *C = I->first;
-      I++;
-      if (C->use_empty()) {
-        Changed = true;
-        C->destroyConstant();
+    for (auto &Map : ArrayConstants.shard_maps())
+      for (auto I = Map.begin(), E = Map.end(); I != E; ) {
+        auto *C = I->first;
+        I++;
+        if (C->use_empty()) {
+          Changed = true;
+          C->destroyConstant();
+        }
       }
-    }
 
   } while (Changed);
 }
@@ -184,6 +193,88 @@ void Module::dropTriviallyDeadConstantArrays() {
   Context.pImpl->dropTriviallyDeadConstantArrays();
 }
 
+void LLVMContextImpl::logSharedValueDeletion(const Value *V) {
+  if (!isMultithreaded())
+    return;
+  unsigned Shard = getUseListShard(V);
+  ContextLockGuard Guard(MultithreadedDepth, UseListLocks[Shard]);
+  UseListLogs[Shard].push_back({nullptr, V, Clock.now()});
+}
+
+void LLVMContextImpl::restoreUseListOrder() {
+  // Find the last event of each value and of each use. The sequence numbers
+  // come from a single counter, so they also order the events of a use whose
+  // memory was reused by another thread.
+  DenseMap<const Value *, const UseListEvent *> LastValueEvents;
+  DenseMap<const Use *, const UseListEvent *> LastUseEvents;
+  for (const auto &Log : UseListLogs)
+    for (const UseListEvent &E : Log) {
+      const UseListEvent *&LastV = LastValueEvents[E.V];
+      if (!LastV || LastV->Time.Seq < E.Time.Seq)
+        LastV = &E;
+      if (!E.U)
+        continue;
+      const UseListEvent *&LastU = LastUseEvents[E.U];
+      if (!LastU || LastU->Time.Seq < E.Time.Seq)
+        LastU = &E;
+    }
+
+  // The operands of a constant created in the region were added when a
+  // serial run would have created it, which may be before the thread that
+  // won the race created it.
+  DenseMap<const Constant *, RegionTime> Requests;
+  ExprConstants.takeRequests(Requests);
+  ArrayConstants.takeRequests(Requests);
+  StructConstants.takeRequests(Requests);
+  VectorConstants.takeRequests(Requests);
+  for (const auto &I : BlockAddressRequests)
+    Requests[I.first] = I.second;
+  BlockAddressRequests.clear();
+
+  for (const auto &I : LastValueEvents) {
+    // Skip the values deleted in the region.
+    if (!I.second->U)
+      continue;
+    Value *V = const_cast<Value *>(I.first);
+
+    // Order the uses added in the region by the time a serial run would have
+    // added them, and then by the time they were added, as a constant adds
+    // its operands in order. The other uses were in the list before the
+    // region and are still in their original order.
+    typedef std::pair<RegionTime, unsigned> KeyTy;
+    DenseMap<const Use *, KeyTy> Keys;
+    for (const Use &U : V->uses()) {
+      auto E = LastUseEvents.find(&U);
+      if (E == LastUseEvents.end() || E->second->V != V)
+        continue;
+      RegionTime Time = E->second->Time;
+      if (auto *C = dyn_cast<Constant>(U.getUser())) {
+        auto R = Requests.find(C);
+        if (R != Requests.end())
+          Time = R->second;
+      }
+      Keys[&U] = KeyTy(Time, E->second->Time.Seq);
+    }
+    if (Keys.empty())
+      continue;
+
+    // The last use added is at the front of the list.
+    V->sortUseList([&](const Use &L, const Use &R) {
+      auto LK = Keys.find(&L);
+      if (LK == Keys.end())
+        return false;
+      auto RK = Keys.find(&R);
+      if (RK == Keys.end())
+        return true;
+      return RK->second < LK->second;
+    });
+  }
+
+  for (auto &Log : UseListLogs)
+    Log.clear();
+  Clock.reset();
+}
+
 namespace llvm {
 /// \brief Make MDOperand transparent for hashing.
 ///
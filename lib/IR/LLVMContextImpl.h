@@ -17,6 +17,7 @@
 
 #include "AttributeImpl.h"
 #include "ConstantsContext.h"
+#include "ContextLocks.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/ArrayRef.h"
@@ -32,6 +33,8 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/Mutex.h"
+#include <atomic>
 #include <vector>
 
 namespace llvm {
@@ -908,11 +911,30 @@ public:
   LLVMContext::YieldCallbackTy YieldCallback;
   void *YieldOpaqueHandle;
 
+  /// See LLVMContext::setUseFunctionArenas.
+  bool UseFunctionArenas;
+
+  /// Number of nested multithreaded regions the context is in, see
+  /// LLVMContext::enterMultithreadedRegion.
+  std::atomic<unsigned> MultithreadedDepth;
+
+  /// Orders the events of the current multithreaded region.
+  RegionClock Clock;
+
+  /// Number of functions whose changes are tracked, see
+  /// Function::startTrackingChanges. While it is zero, replacing uses doesn't
+  /// need to look for users to record.
+  std::atomic<unsigned> NumChangeTrackingFunctions;
+
+  /// The integer and floating point constants, split in shards by hash (see
+  /// getContextShard). Each shard has its own lock.
   typedef DenseMap<APInt, ConstantInt *, DenseMapAPIntKeyInfo> IntMapTy;
-  IntMapTy IntConstants;
+  IntMapTy IntConstants[NumContextShards];
+  sys::SmartMutex<true> IntConstantsLocks[NumContextShards];
 
   typedef DenseMap<APFloat, ConstantFP *, DenseMapAPFloatKeyInfo> FPMapTy;
-  FPMapTy FPConstants;
+  FPMapTy FPConstants[NumContextShards];
+  sys::SmartMutex<true> FPConstantsLocks[NumContextShards];
 
   FoldingSet<AttributeImpl> AttrsSet;
   FoldingSet<AttributeSetImpl> AttrsLists;
@@ -952,6 +974,9 @@ public:
 
   DenseMap<std::pair<const Function *, const BasicBlock *>, BlockAddress *>
     BlockAddresses;
+  /// The block addresses created in the current multithreaded region, see
+  /// ConstantUniqueMap::Requests.
+  DenseMap<const BlockAddress *, RegionTime> BlockAddressRequests;
   ConstantUniqueMap<ConstantExpr> ExprConstants;
 
   ConstantUniqueMap<InlineAsm> InlineAsms;
@@ -1015,6 +1040,69 @@ public:
   typedef DenseMap<const Function *, ReturnInst *> PrologueDataMapTy;
   PrologueDataMapTy PrologueDataMap;
 
+  /// Protects the state above that is shared between functions while the
+  /// context is multithreaded, apart from the tables that have their own
+  /// locks below. Use a SharedStateGuard to take it. See ContextLocks.h for
+  /// the order in which the locks are taken.
+  sys::SmartMutex<true> SharedStateLock;
+
+  /// Protects AttrsSet, AttrsLists and AttrsSetNodes.
+  sys::SmartMutex<true> AttributesLock;
+
+  /// Protects CAZConstants, CPNConstants, UVConstants, CDSConstants,
+  /// BlockAddresses, BlockAddressRequests, TheTrueVal and TheFalseVal.
+  sys::SmartMutex<true> ConstantsLock;
+
+  /// Protects MDStringCache and the uniquing sets of the metadata nodes. The
+  /// nodes can be looked up under this lock alone, but are only created or
+  /// erased under the shared state lock as well.
+  sys::SmartMutex<true> MetadataUniquingLock;
+
+  /// Protects the type tables and TypeAllocator.
+  sys::SmartMutex<true> TypeLock;
+
+  /// Protects the use lists of the values that aren't local to a function,
+  /// split in shards by the address of the value.
+  sys::SmartMutex<true> UseListLocks[NumContextShards];
+
+  /// An event of a multithreaded region on the use list of a value that
+  /// isn't local to a function: U was added to it, or the value was deleted
+  /// if U is null.
+  struct UseListEvent {
+    Use *U;
+    const Value *V;
+    RegionTime Time;
+  };
+
+  /// The use-list events of the current multithreaded region, split like
+  /// UseListLocks by the value whose use list they are about.
+  std::vector<UseListEvent> UseListLogs[NumContextShards];
+
+  bool isMultithreaded() const {
+    return MultithreadedDepth.load(std::memory_order_relaxed) != 0;
+  }
+
+  static unsigned getUseListShard(const Value *V) {
+    return getContextShard(DenseMapInfo<const Value *>::getHashValue(V));
+  }
+
+  /// Log that \p U was added to the use list of \p V while the context is
+  /// multithreaded. V isn't local to a function and the use-list lock of V
+  /// is held.
+  void logUseListAddition(Use &U, const Value *V) {
+    UseListLogs[getUseListShard(V)].push_back({&U, V, Clock.now()});
+  }
+
+  /// Log that \p V, which isn't local to a function, is deleted. Does
+  /// nothing unless the context is multithreaded.
+  void logSharedValueDeletion(const Value *V);
+
+  /// Put the use lists that changed in the multithreaded region that just
+  /// ended back in the order a serial run of its work would have given them.
+  /// The uses added by a function come before the ones added by the
+  /// functions before it, as if the functions had been processed in order.
+  void restoreUseListOrder();
+
   int getOrAddScopeRecordIdxEntry(MDNode *N, int ExistingIdx);
   int getOrAddScopeInlinedAtIdxEntry(MDNode *Scope, MDNode *IA,int ExistingIdx);
 
@@ -1025,6 +1113,28 @@ public:
   void dropTriviallyDeadConstantArrays();
 };
 
+/// \brief Scoped lock of the state of a context that is shared between
+/// functions. Does nothing unless the context is in a multithreaded region.
+class SharedStateGuard {
+  sys::SmartMutex<true> *Lock;
+
+  SharedStateGuard(const SharedStateGuard &) = delete;
+  void operator=(const SharedStateGuard &) = delete;
+
+public:
+  explicit SharedStateGuard(LLVMContextImpl &Impl)
+      : Lock(Impl.isMultithreaded() ? &Impl.SharedStateLock : nullptr) {
+    if (Lock)
+      Lock->lock();
+  }
+  explicit SharedStateGuard(LLVMContext &Context)
+      : SharedStateGuard(*Context.pImpl) {}
+  ~SharedStateGuard() {
+    if (Lock)
+      Lock->unlock();
+  }
+};
+
 }
 
 #endif
@@ -23,10 +23,13 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/TimeValue.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/thread.h"
 #include <algorithm>
+#include <atomic>
 #include <map>
 using namespace llvm;
 using namespace llvm::legacy;
@@ -494,7 +497,8 @@ static TimingInfo *TheTimeInfo;
 // PMTopLevelManager implementation
 
 /// Initialize top level manager. Create first pass manager.
-PMTopLevelManager::PMTopLevelManager(PMDataManager *PMDM) {
+PMTopLevelManager::PMTopLevelManager(PMDataManager *PMDM)
+    : NumFunctionPassThreads(1) {
   PMDM->setTopLevelManager(this);
   addPassManager(PMDM);
   activeStack.push(PMDM);
@@ -1534,6 +1538,12 @@ bool FPPassManager::runOnFunction(Function &F) {
 }
 
 bool FPPassManager::runOnModule(Module &M) {
+  unsigned NumThreads = TPM->getNumFunctionPassThreads();
+  if (NumThreads == 0)
+    NumThreads = thread::hardware_concurrency();
+  if (NumThreads > 1 && canRunInParallel(M))
+    return runInParallel(M, NumThreads);
+
   bool Changed = false;
 
   for (Function &F : M)
@@ -1542,6 +1552,186 @@ bool FPPassManager::runOnModule(Module &M) {
   return Changed;
 }
 
+bool FPPassManager::canRunInParallel(Module &M) {
+  // Debug output and timers are per pass instance and aren't synchronized.
+  if (PassDebugging >= Executions || TimePassesIsEnabled)
+    return false;
+
+  // Materializing a function touches the module and the reader state.
+  unsigned NumDefined = 0;
+  for (Function &F : M) {
+    if (F.isMaterializable())
+      return false;
+    if (!F.isDeclaration())
+      ++NumDefined;
+  }
+  if (NumDefined < 2)
+    return false;
+
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+    FunctionPass *FP = getContainedPass(Index);
+    std::unique_ptr<FunctionPass> Copy(FP->createParallelCopy());
+    if (!Copy)
+      return false;
+
+    // The copies can only release the analyses of this manager.
+    SmallVector<Pass *, 12> LastUses;
+    TPM->collectLastUses(LastUses, FP);
+    for (Pass *P : LastUses)
+      if (std::find(PassVector.begin(), PassVector.end(), P) ==
+          PassVector.end())
+        return false;
+  }
+  return true;
+}
+
+namespace {
+/// The analysis bookkeeping of a pass of a FPPassManager, computed before
+/// the threads start so that they never query the top level manager.
+struct ParallelPassInfo {
+  AnalysisUsage *AnUsage;
+  /// The IDs that the pass is available as once it ran.
+  SmallVector<AnalysisID, 2> ProvidedIDs;
+  /// The indices of the passes whose last user is this pass.
+  SmallVector<unsigned, 4> DeadPasses;
+  /// The required analyses that are provided outside of this manager.
+  SmallVector<std::pair<AnalysisID, Pass *>, 4> ExternalImpls;
+};
+} // End of anonymous namespace
+
+bool FPPassManager::runInParallel(Module &M, unsigned NumThreads) {
+  std::vector<Function *> Functions;
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      Functions.push_back(&F);
+  NumThreads = std::min<unsigned>(NumThreads, Functions.size());
+
+  unsigned NumPasses = getNumContainedPasses();
+  std::vector<ParallelPassInfo> Infos(NumPasses);
+  SmallPtrSet<AnalysisID, 16> InternalIDs;
+  for (unsigned Index = 0; Index < NumPasses; ++Index) {
+    FunctionPass *FP = getContainedPass(Index);
+    ParallelPassInfo &Info = Infos[Index];
+    Info.AnUsage = TPM->findAnalysisUsage(FP);
+    Info.ProvidedIDs.push_back(FP->getPassID());
+    if (const PassInfo *PInf = TPM->findAnalysisPassInfo(FP->getPassID()))
+      for (const PassInfo *II : PInf->getInterfacesImplemented())
+        Info.ProvidedIDs.push_back(II->getTypeInfo());
+    InternalIDs.insert(Info.ProvidedIDs.begin(), Info.ProvidedIDs.end());
+
+    SmallVector<Pass *, 12> LastUses;
+    TPM->collectLastUses(LastUses, FP);
+    for (Pass *P : LastUses)
+      Info.DeadPasses.push_back(
+          std::find(PassVector.begin(), PassVector.end(), P) -
+          PassVector.begin());
+  }
+  for (ParallelPassInfo &Info : Infos)
+    for (AnalysisID ID : Info.AnUsage->getRequiredSet())
+      if (!InternalIDs.count(ID))
+        if (Pass *Impl = TPM->findAnalysisPass(ID))
+          Info.ExternalImpls.push_back(std::make_pair(ID, Impl));
+
+  // getAnalysisIfAvailable looks the analyses up in the top level manager.
+  // Fill its pass info cache for the immutable passes now, and make sure it
+  // doesn't find stale results of the passes of this manager.
+  for (ImmutablePass *IP : TPM->getImmutablePasses())
+    TPM->findAnalysisPassInfo(IP->getPassID());
+  getAvailableAnalysis()->clear();
+
+  // Each thread runs its own copies of the passes, owned by a manager that
+  // tracks the analyses available for the function being processed.
+  std::vector<std::unique_ptr<FPPassManager>> Shadows;
+  for (unsigned I = 0; I < NumThreads; ++I) {
+    Shadows.emplace_back(new FPPassManager());
+    FPPassManager *Shadow = Shadows.back().get();
+    Shadow->setTopLevelManager(TPM);
+    Shadow->setDepth(getDepth());
+    for (unsigned Index = 0; Index < NumPasses; ++Index)
+      Shadow->add(getContainedPass(Index)->createParallelCopy(),
+                  /*ProcessAnalysis=*/false);
+  }
+
+  std::atomic<unsigned> NextFunction(0);
+  std::vector<char> FunctionChanged(Functions.size(), false);
+  auto Worker = [&](FPPassManager &Shadow) {
+    DenseMap<AnalysisID, Pass *> &Available = *Shadow.getAvailableAnalysis();
+    for (unsigned FI = NextFunction++; FI < Functions.size();
+         FI = NextFunction++) {
+      Function &F = *Functions[FI];
+      LLVMContext::setMultithreadedWorkOrder(FI);
+      Available.clear();
+      for (unsigned Index = 0; Index < NumPasses; ++Index) {
+        FunctionPass *FP = Shadow.getContainedPass(Index);
+        const ParallelPassInfo &Info = Infos[Index];
+
+        AnalysisResolver *AR = FP->getResolver();
+        AR->clearAnalysisImpls();
+        for (AnalysisID ID : Info.AnUsage->getRequiredSet()) {
+          auto I = Available.find(ID);
+          if (I != Available.end())
+            AR->addAnalysisImplsPair(ID, I->second);
+        }
+        for (const auto &Impl : Info.ExternalImpls)
+          AR->addAnalysisImplsPair(Impl.first, Impl.second);
+
+        {
+          PassManagerPrettyStackEntry X(FP, F);
+          if (FP->runOnFunction(F))
+            FunctionChanged[FI] = true;
+        }
+
+        if (!Info.AnUsage->getPreservesAll()) {
+          const AnalysisUsage::VectorType &PreservedSet =
+              Info.AnUsage->getPreservedSet();
+          for (auto I = Available.begin(), E = Available.end(); I != E;) {
+            auto Cur = I++;
+            if (std::find(PreservedSet.begin(), PreservedSet.end(),
+                          Cur->first) == PreservedSet.end())
+              Available.erase(Cur);
+          }
+        }
+        for (AnalysisID ID : Info.ProvidedIDs)
+          Available[ID] = FP;
+
+        for (unsigned DeadIndex : Info.DeadPasses) {
+          FunctionPass *DP = Shadow.getContainedPass(DeadIndex);
+          {
+            PassManagerPrettyStackEntry X(DP);
+            DP->releaseMemory();
+          }
+          for (AnalysisID ID : Infos[DeadIndex].ProvidedIDs) {
+            auto I = Available.find(ID);
+            if (I != Available.end() && I->second == DP)
+              Available.erase(I);
+          }
+        }
+      }
+    }
+  };
+
+  LLVMContext &Context = M.getContext();
+  Context.enterMultithreadedRegion();
+  {
+    ThreadPool Pool(NumThreads);
+    for (auto &Shadow : Shadows) {
+      FPPassManager *S = Shadow.get();
+      Pool.async([&Worker, S] { Worker(*S); });
+    }
+    Pool.wait();
+  }
+  Context.exitMultithreadedRegion();
+
+  // The higher level analyses that the passes don't preserve are gone, as
+  // they would be after a serial run.
+  populateInheritedAnalysis(TPM->activeStack);
+  for (unsigned Index = 0; Index < NumPasses; ++Index)
+    removeNotPreservedAnalysis(getContainedPass(Index));
+
+  return std::find(FunctionChanged.begin(), FunctionChanged.end(), true) !=
+         FunctionChanged.end();
+}
+
 bool FPPassManager::doInitialization(Module &M) {
   bool Changed = false;
 
@@ -1729,6 +1919,10 @@ bool PassManager::run(Module &M) {
   return PM->run(M);
 }
 
+void PassManager::setNumFunctionPassThreads(unsigned N) {
+  PM->setNumFunctionPassThreads(N);
+}
+
 //===----------------------------------------------------------------------===//
 // TimingInfo implementation
 
@@ -35,8 +35,11 @@ MetadataAsValue::MetadataAsValue(Type *Ty, Metadata *MD)
 }
 
 MetadataAsValue::~MetadataAsValue() {
-  getType()->getContext().pImpl->MetadataAsValues.erase(MD);
+  LLVMContext &Context = getType()->getContext();
+  SharedStateGuard Guard(Context);
+  Context.pImpl->MetadataAsValues.erase(MD);
   untrack();
+  Context.pImpl->logSharedValueDeletion(this);
 }
 
 /// \brief Canonicalize metadata arguments to intrinsics.
@@ -74,6 +77,7 @@ static Metadata *canonicalizeMetadataForValue(LLVMContext &Context,
 
 MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
   MD = canonicalizeMetadataForValue(Context, MD);
+  SharedStateGuard Guard(Context);
   auto *&Entry = Context.pImpl->MetadataAsValues[MD];
   if (!Entry)
     Entry = new MetadataAsValue(Type::getMetadataTy(Context), MD);
@@ -83,6 +87,7 @@ MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
 MetadataAsValue *MetadataAsValue::getIfExists(LLVMContext &Context,
                                               Metadata *MD) {
   MD = canonicalizeMetadataForValue(Context, MD);
+  SharedStateGuard Guard(Context);
   auto &Store = Context.pImpl->MetadataAsValues;
   return Store.lookup(MD);
 }
@@ -90,6 +95,7 @@ MetadataAsValue *MetadataAsValue::getIfExists(LLVMContext &Context,
 void MetadataAsValue::handleChangedMetadata(Metadata *MD) {
   LLVMContext &Context = getContext();
   MD = canonicalizeMetadataForValue(Context, MD);
+  SharedStateGuard Guard(Context);
   auto &Store = Context.pImpl->MetadataAsValues;
 
   // Stop tracking the old metadata.
@@ -121,6 +127,7 @@ void MetadataAsValue::untrack() {
 }
 
 void ReplaceableMetadataImpl::addRef(void *Ref, OwnerTy Owner) {
+  SharedStateGuard Guard(Context);
   bool WasInserted =
       UseMap.insert(std::make_pair(Ref, std::make_pair(Owner, NextIndex)))
           .second;
@@ -132,6 +139,7 @@ void ReplaceableMetadataImpl::addRef(void *Ref, OwnerTy Owner) {
 }
 
 void ReplaceableMetadataImpl::dropRef(void *Ref) {
+  SharedStateGuard Guard(Context);
   bool WasErased = UseMap.erase(Ref);
   (void)WasErased;
   assert(WasErased && "Expected to drop a reference");
@@ -139,6 +147,7 @@ void ReplaceableMetadataImpl::dropRef(void *Ref) {
 
 void ReplaceableMetadataImpl::moveRef(void *Ref, void *New,
                                       const Metadata &MD) {
+  SharedStateGuard Guard(Context);
   auto I = UseMap.find(Ref);
   assert(I != UseMap.end() && "Expected to move a reference");
   auto OwnerAndIndex = I->second;
@@ -158,6 +167,7 @@ void ReplaceableMetadataImpl::moveRef(void *Ref, void *New,
 void ReplaceableMetadataImpl::replaceAllUsesWith(Metadata *MD) {
   assert(!(MD && isa<MDNode>(MD) && cast<MDNode>(MD)->isTemporary()) &&
          "Expected non-temp node");
+  SharedStateGuard Guard(Context);
 
   if (UseMap.empty())
     return;
@@ -207,6 +217,7 @@ void ReplaceableMetadataImpl::replaceAllUsesWith(Metadata *MD) {
 }
 
 void ReplaceableMetadataImpl::resolveAllUses(bool ResolveUsers) {
+  SharedStateGuard Guard(Context);
   if (UseMap.empty())
     return;
 
@@ -252,6 +263,7 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
   assert(V && "Unexpected null Value");
 
   auto &Context = V->getContext();
+  SharedStateGuard Guard(Context);
   auto *&Entry = Context.pImpl->ValuesAsMetadata[V];
   if (!Entry) {
     assert((isa<Constant>(V) || isa<Argument>(V) || isa<Instruction>(V)) &&
@@ -270,13 +282,17 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
 
 ValueAsMetadata *ValueAsMetadata::getIfExists(Value *V) {
   assert(V && "Unexpected null Value");
-  return V->getContext().pImpl->ValuesAsMetadata.lookup(V);
+  LLVMContext &Context = V->getContext();
+  SharedStateGuard Guard(Context);
+  return Context.pImpl->ValuesAsMetadata.lookup(V);
 }
 
 void ValueAsMetadata::handleDeletion(Value *V) {
   assert(V && "Expected valid value");
 
-  auto &Store = V->getType()->getContext().pImpl->ValuesAsMetadata;
+  LLVMContext &Context = V->getType()->getContext();
+  SharedStateGuard Guard(Context);
+  auto &Store = Context.pImpl->ValuesAsMetadata;
   auto I = Store.find(V);
   if (I == Store.end())
     return;
@@ -299,6 +315,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
   assert(From->getType() == To->getType() && "Unexpected type change");
 
   LLVMContext &Context = From->getType()->getContext();
+  SharedStateGuard Guard(Context);
   auto &Store = Context.pImpl->ValuesAsMetadata;
   auto I = Store.find(From);
   if (I == Store.end()) {
@@ -358,6 +375,8 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
 //
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
+  ContextLockGuard Guard(Context.pImpl->MultithreadedDepth,
+                         Context.pImpl->MetadataUniquingLock);
   auto &Store = Context.pImpl->MDStringCache;
   auto I = Store.find(Str);
   if (I != Store.end())
@@ -631,7 +650,10 @@ void MDNode::deleteAsSubclass() {
 
 template <class T, class InfoT>
 static T *uniquifyImpl(T *N, DenseSet<T *, InfoT> &Store) {
-  if (T *U = getUniqued(Store, N))
+  LLVMContextImpl *pImpl = N->getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth,
+                         pImpl->MetadataUniquingLock);
+  if (T *U = getUniqued(N->getContext(), Store, N))
     return U;
 
   Store.insert(N);
@@ -652,6 +674,7 @@ template <class NodeTy> struct MDNode::HasCachedHash {
 
 MDNode *MDNode::uniquify() {
   assert(!hasSelfReference(this) && "Cannot uniquify a self-referencing node");
+  SharedStateGuard Guard(getContext());
 
   // Try to insert into uniquing store.
   switch (getMetadataID()) {
@@ -670,6 +693,9 @@ MDNode *MDNode::uniquify() {
 }
 
 void MDNode::eraseFromStore() {
+  SharedStateGuard Guard(getContext());
+  ContextLockGuard UniquingGuard(getContext().pImpl->MultithreadedDepth,
+                                 getContext().pImpl->MetadataUniquingLock);
   switch (getMetadataID()) {
   default:
     llvm_unreachable("Invalid subclass of MDNode");
@@ -686,7 +712,7 @@ MDTuple *MDTuple::getImpl(LLVMContext &Context, ArrayRef<Metadata *> MDs,
   unsigned Hash = 0;
   if (Storage == Uniqued) {
     MDTupleInfo::KeyTy Key(MDs);
-    if (auto *N = getUniqued(Context.pImpl->MDTuples, Key))
+    if (auto *N = getUniqued(Context, Context.pImpl->MDTuples, Key))
       return N;
     if (!ShouldCreate)
       return nullptr;
@@ -695,6 +721,12 @@ MDTuple *MDTuple::getImpl(LLVMContext &Context, ArrayRef<Metadata *> MDs,
     assert(ShouldCreate && "Expected non-uniqued nodes to always be created");
   }
 
+  SharedStateGuard Guard(Context);
+  if (Storage == Uniqued && Context.pImpl->isMultithreaded())
+    if (auto *N = getUniqued(Context, Context.pImpl->MDTuples,
+                             MDTupleInfo::KeyTy(MDs)))
+      return N;
+
   return storeImpl(new (MDs.size()) MDTuple(Context, Storage, Hash, MDs),
                    Storage, Context.pImpl->MDTuples);
 }
@@ -722,6 +754,7 @@ void MDNode::storeDistinctInContext() {
 #include "llvm/IR/Metadata.def"
   }
 
+  SharedStateGuard Guard(getContext());
   getContext().pImpl->DistinctMDNodes.insert(this);
 }
 
@@ -1041,6 +1074,7 @@ void Instruction::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
   if (!hasMetadataHashEntry())
     return; // Nothing to remove!
 
+  SharedStateGuard Guard(getContext());
   auto &InstructionMetadata = getContext().pImpl->InstructionMetadata;
 
   if (KnownSet.empty()) {
@@ -1074,7 +1108,9 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
     DbgLoc = DebugLoc(Node);
     return;
   }
-  
+
+  SharedStateGuard Guard(getContext());
+
   // Handle the case when we're adding/updating metadata on an instruction.
   if (Node) {
     auto &Info = getContext().pImpl->InstructionMetadata[this];
@@ -1117,6 +1153,7 @@ MDNode *Instruction::getMetadataImpl(unsigned KindID) const {
 
   if (!hasMetadataHashEntry())
     return nullptr;
+  SharedStateGuard Guard(getContext());
   auto &Info = getContext().pImpl->InstructionMetadata[this];
   assert(!Info.empty() && "bit out of sync with hash table");
 
@@ -1134,6 +1171,7 @@ void Instruction::getAllMetadataImpl(
     if (!hasMetadataHashEntry()) return;
   }
 
+  SharedStateGuard Guard(getContext());
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->InstructionMetadata.count(this) &&
          "Shouldn't have called this");
@@ -1145,6 +1183,7 @@ void Instruction::getAllMetadataImpl(
 void Instruction::getAllMetadataOtherThanDebugLocImpl(
     SmallVectorImpl<std::pair<unsigned, MDNode *>> &Result) const {
   Result.clear();
+  SharedStateGuard Guard(getContext());
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->InstructionMetadata.count(this) &&
          "Shouldn't have called this");
@@ -1157,6 +1196,7 @@ void Instruction::getAllMetadataOtherThanDebugLocImpl(
 /// this instruction.
 void Instruction::clearMetadataHashEntries() {
   assert(hasMetadataHashEntry() && "Caller should check");
+  SharedStateGuard Guard(getContext());
   getContext().pImpl->InstructionMetadata.erase(this);
   setHasMetadataHashEntry(false);
 }
@@ -1164,6 +1204,7 @@ void Instruction::clearMetadataHashEntries() {
 MDNode *Function::getMetadata(unsigned KindID) const {
   if (!hasMetadata())
     return nullptr;
+  SharedStateGuard Guard(getContext());
   return getContext().pImpl->FunctionMetadata[this].lookup(KindID);
 }
 
@@ -1174,6 +1215,7 @@ MDNode *Function::getMetadata(StringRef Kind) const {
 }
 
 void Function::setMetadata(unsigned KindID, MDNode *MD) {
+  SharedStateGuard Guard(getContext());
   if (MD) {
     if (!hasMetadata())
       setHasMetadataHashEntry(true);
@@ -1205,6 +1247,7 @@ void Function::getAllMetadata(
   if (!hasMetadata())
     return;
 
+  SharedStateGuard Guard(getContext());
   getContext().pImpl->FunctionMetadata[this].getAll(MDs);
 }
 
@@ -1219,6 +1262,7 @@ void Function::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
   SmallSet<unsigned, 5> KnownSet;
   KnownSet.insert(KnownIDs.begin(), KnownIDs.end());
 
+  SharedStateGuard Guard(getContext());
   auto &Store = getContext().pImpl->FunctionMetadata[this];
   assert(!Store.empty());
 
@@ -1233,6 +1277,7 @@ void Function::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
 void Function::clearMetadata() {
   if (!hasMetadata())
     return;
+  SharedStateGuard Guard(getContext());
   getContext().pImpl->FunctionMetadata.erase(this);
   setHasMetadataHashEntry(false);
 }
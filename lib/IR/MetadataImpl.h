@@ -14,14 +14,22 @@
 #ifndef LLVM_IR_METADATAIMPL_H
 #define LLVM_IR_METADATAIMPL_H
 
+#include "LLVMContextImpl.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/IR/Metadata.h"
 
 namespace llvm {
 
+/// Look up a uniqued node. This only takes the metadata uniquing lock, so
+/// it doesn't need to hold the shared state lock of the context. A node that
+/// isn't found has to be created under the shared state lock, after checking
+/// again that no other thread created it in the meantime.
 template <class T, class InfoT>
-static T *getUniqued(DenseSet<T *, InfoT> &Store,
+static T *getUniqued(LLVMContext &Context, DenseSet<T *, InfoT> &Store,
                      const typename InfoT::KeyTy &Key) {
+  LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth,
+                         pImpl->MetadataUniquingLock);
   auto I = Store.find_as(Key);
   return I == Store.end() ? nullptr : *I;
 }
@@ -29,9 +37,13 @@ static T *getUniqued(DenseSet<T *, InfoT> &Store,
 template <class T, class StoreT>
 T *MDNode::storeImpl(T *N, StorageType Storage, StoreT &Store) {
   switch (Storage) {
-  case Uniqued:
+  case Uniqued: {
+    LLVMContextImpl *pImpl = N->getContext().pImpl;
+    ContextLockGuard Guard(pImpl->MultithreadedDepth,
+                           pImpl->MetadataUniquingLock);
     Store.insert(N);
     break;
+  }
   case Distinct:
     N->storeDistinctInContext();
     break;
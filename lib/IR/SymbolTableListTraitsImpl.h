@@ -16,11 +16,56 @@
 #ifndef LLVM_LIB_IR_SYMBOLTABLELISTTRAITSIMPL_H
 #define LLVM_LIB_IR_SYMBOLTABLELISTTRAITSIMPL_H
 
+#include "llvm/IR/Function.h"
 #include "llvm/IR/SymbolTableListTraits.h"
 #include "llvm/IR/ValueSymbolTable.h"
 
 namespace llvm {
 
+/// noteAddedToList/noteRemovedFromList - These let a function that tracks its
+/// changes (see Function::startTrackingChanges) see the instructions that
+/// enter and leave it, alone or with their block. They do nothing for the
+/// other lists.
+template<typename ValueSubClass, typename ItemParentClass>
+inline void noteAddedToList(ValueSubClass *, ItemParentClass *) {}
+template<typename ValueSubClass, typename ItemParentClass>
+inline void noteRemovedFromList(ValueSubClass *, ItemParentClass *) {}
+
+inline void noteAddedToList(Instruction *I, BasicBlock *BB) {
+  if (Function *F = BB->getParent())
+    F->noteChangedInstruction(I);
+}
+inline void noteRemovedFromList(Instruction *I, BasicBlock *BB) {
+  if (Function *F = BB->getParent())
+    F->noteRemovedInstruction(I);
+}
+inline void noteAddedToList(BasicBlock *BB, Function *F) {
+  if (F->isTrackingChanges())
+    for (Instruction &I : *BB)
+      F->noteChangedInstruction(&I);
+}
+inline void noteRemovedFromList(BasicBlock *BB, Function *F) {
+  // The whole block leaves, so there is no point in recording the operands
+  // that are in it, and recording those elsewhere is left to whoever erases
+  // the instructions.
+  if (F->isTrackingChanges())
+    for (Instruction &I : *BB)
+      F->noteRemovedInstruction(&I, /*NoteOperands=*/false);
+}
+/// noteMovedInList - This lets a function that tracks its changes see the
+/// instructions in [First, Last) that move within it, e.g. with
+/// Instruction::moveBefore.
+template<typename ValueSubClass, typename ItemParentClass>
+inline void noteMovedInList(ilist_iterator<ValueSubClass>,
+                            ilist_iterator<ValueSubClass>, ItemParentClass *) {}
+inline void noteMovedInList(ilist_iterator<Instruction> First,
+                            ilist_iterator<Instruction> Last, BasicBlock *BB) {
+  Function *F = BB->getParent();
+  if (F && F->isTrackingChanges())
+    for (; First != Last; ++First)
+      F->noteChangedInstruction(&*First);
+}
+
 /// setSymTabObject - This is called when (f.e.) the parent of a basic block
 /// changes.  This requires us to remove all the instruction symtab entries from
 /// the current function and reinsert them into the new function.
@@ -71,11 +116,13 @@ void SymbolTableListTraits<ValueSubClass,ItemParentClass>
   if (V->hasName())
     if (ValueSymbolTable *ST = TraitsClass::getSymTab(Owner))
       ST->reinsertValue(V);
+  noteAddedToList(V, Owner);
 }
 
 template<typename ValueSubClass, typename ItemParentClass>
 void SymbolTableListTraits<ValueSubClass,ItemParentClass>
 ::removeNodeFromList(ValueSubClass *V) {
+  noteRemovedFromList(V, getListOwner());
   V->setParent(nullptr);
   if (V->hasName())
     if (ValueSymbolTable *ST = TraitsClass::getSymTab(getListOwner()))
@@ -89,7 +136,10 @@ void SymbolTableListTraits<ValueSubClass,ItemParentClass>
                         ilist_iterator<ValueSubClass> last) {
   // We only have to do work here if transferring instructions between BBs
   ItemParentClass *NewIP = getListOwner(), *OldIP = L2.getListOwner();
-  if (NewIP == OldIP) return;  // No work to do at all...
+  if (NewIP == OldIP) {
+    noteMovedInList(first, last, NewIP);
+    return;
+  }
 
   // We only have to update symbol table entries if we are transferring the
   // instructions to a different symtab object...
@@ -101,15 +151,18 @@ void SymbolTableListTraits<ValueSubClass,ItemParentClass>
       bool HasName = V.hasName();
       if (OldST && HasName)
         OldST->removeValueName(V.getValueName());
+      noteRemovedFromList(&V, OldIP);
       V.setParent(NewIP);
       if (NewST && HasName)
         NewST->reinsertValue(&V);
+      noteAddedToList(&V, NewIP);
     }
   } else {
     // Just transferring between blocks in the same function, simply update the
     // parent fields in the instructions...
-    for (; first != last; ++first)
-      first->setParent(NewIP);
+    for (ilist_iterator<ValueSubClass> I = first; I != last; ++I)
+      I->setParent(NewIP);
+    noteMovedInList(first, last, NewIP);
   }
 }
 
@@ -317,7 +317,9 @@ IntegerType *IntegerType::get(LLVMContext &C, unsigned NumBits) {
     break;
   }
   
-  IntegerType *&Entry = C.pImpl->IntegerTypes[NumBits];
+  LLVMContextImpl *pImpl = C.pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->TypeLock);
+  IntegerType *&Entry = pImpl->IntegerTypes[NumBits];
 
   if (!Entry)
     Entry = new (C.pImpl->TypeAllocator) IntegerType(C, NumBits);
@@ -361,6 +363,7 @@ FunctionType::FunctionType(Type *Result, ArrayRef<Type*> Params,
 FunctionType *FunctionType::get(Type *ReturnType,
                                 ArrayRef<Type*> Params, bool isVarArg) {
   LLVMContextImpl *pImpl = ReturnType->getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->TypeLock);
   FunctionTypeKeyInfo::KeyTy Key(ReturnType, Params, isVarArg);
   auto I = pImpl->FunctionTypes.find_as(Key);
   FunctionType *FT;
@@ -404,6 +407,7 @@ bool FunctionType::isValidArgumentType(Type *ArgTy) {
 StructType *StructType::get(LLVMContext &Context, ArrayRef<Type*> ETypes, 
                             bool isPacked) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->TypeLock);
   AnonStructTypeKeyInfo::KeyTy Key(ETypes, isPacked);
   auto I = pImpl->AnonStructTypes.find_as(Key);
   StructType *ST;
@@ -429,7 +433,9 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
     setSubclassData(getSubclassData() | SCDB_Packed);
 
   unsigned NumElements = Elements.size();
-  Type **Elts = getContext().pImpl->TypeAllocator.Allocate<Type*>(NumElements);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->TypeLock);
+  Type **Elts = pImpl->TypeAllocator.Allocate<Type*>(NumElements);
   memcpy(Elts, Elements.data(), sizeof(Elements[0]) * NumElements);
   
   ContainedTys = Elts;
@@ -439,7 +445,9 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
 void StructType::setName(StringRef Name) {
   if (Name == getName()) return;
 
-  StringMap<StructType *> &SymbolTable = getContext().pImpl->NamedStructTypes;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->TypeLock);
+  StringMap<StructType *> &SymbolTable = pImpl->NamedStructTypes;
   typedef StringMap<StructType *>::MapEntryTy EntryTy;
 
   // If this struct already had a name, remove its symbol table entry. Don't
@@ -488,7 +496,9 @@ void StructType::setName(StringRef Name) {
 // StructType Helper functions.
 
 StructType *StructType::create(LLVMContext &Context, StringRef Name) {
-  StructType *ST = new (Context.pImpl->TypeAllocator) StructType(Context);
+  LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->TypeLock);
+  StructType *ST = new (pImpl->TypeAllocator) StructType(Context);
   if (!Name.empty())
     ST->setName(Name);
   return ST;
@@ -620,7 +630,9 @@ bool StructType::isLayoutIdentical(StructType *Other) const {
 /// getTypeByName - Return the type with the specified name, or null if there
 /// is none by that name.
 StructType *Module::getTypeByName(StringRef Name) const {
-  return getContext().pImpl->NamedStructTypes.lookup(Name);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->TypeLock);
+  return pImpl->NamedStructTypes.lookup(Name);
 }
 
 
@@ -685,6 +697,7 @@ ArrayType *ArrayType::get(Type *elementType, uint64_t NumElements) {
   assert(isValidElementType(ElementType) && "Invalid type for array element!");
     
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->TypeLock);
   ArrayType *&Entry = 
     pImpl->ArrayTypes[std::make_pair(ElementType, NumElements)];
 
@@ -715,6 +728,7 @@ VectorType *VectorType::get(Type *elementType, unsigned NumElements) {
                                             "pointer type.");
 
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  ContextLockGuard Guard(pImpl->MultithreadedDepth, pImpl->TypeLock);
   VectorType *&Entry = ElementType->getContext().pImpl
     ->VectorTypes[std::make_pair(ElementType, NumElements)];
 
@@ -737,7 +751,8 @@ PointerType *PointerType::get(Type *EltTy, unsigned AddressSpace) {
   assert(isValidElementType(EltTy) && "Invalid type for pointer element!");
   
   LLVMContextImpl *CImpl = EltTy->getContext().pImpl;
-  
+  ContextLockGuard Guard(CImpl->MultithreadedDepth, CImpl->TypeLock);
+
   // Since AddressSpace #0 is the common case, we special case it.
   PointerType *&Entry = AddressSpace == 0 ? CImpl->PointerTypes[EltTy]
      : CImpl->ASPointerTypes[std::make_pair(EltTy, AddressSpace)];
@@ -8,16 +8,147 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/Use.h"
+#include "LLVMContextImpl.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constant.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalValue.h"
+#include "llvm/IR/Instruction.h"
 #include "llvm/IR/User.h"
 #include "llvm/IR/Value.h"
 #include <new>
 
 namespace llvm {
 
+std::atomic<unsigned> Use::NumMultithreadedContexts(0);
+std::atomic<unsigned> Use::NumChangeTrackingFunctions(0);
+
+namespace {
+/// Return the context of \p V if its use list may be edited by several
+/// threads. Only the values that aren't local to a function can be used from
+/// several functions at once.
+LLVMContextImpl *getContextIfShared(const Value *V) {
+  if (!V || isa<Instruction>(V) || isa<Argument>(V) || isa<BasicBlock>(V))
+    return nullptr;
+  LLVMContextImpl *Impl = V->getContext().pImpl;
+  return Impl->isMultithreaded() ? Impl : nullptr;
+}
+
+/// Log the addition of \p U to the use list of \p V if it is shared, so that
+/// the context can restore a deterministic order at the end of the region.
+void logAddition(Use &U, const Value *V) {
+  if (LLVMContextImpl *Impl = getContextIfShared(V))
+    Impl->logUseListAddition(U, V);
+}
+
+/// Takes the locks of the use lists of V1 and V2 that may be edited by several
+/// threads. These use lists are protected by the shard of the use-list locks
+/// of their context that their address hashes to.
+class UseListGuard {
+  sys::SmartMutex<true> *Locks[2];
+
+public:
+  UseListGuard(const Value *V1, const Value *V2) : Locks{nullptr, nullptr} {
+    LLVMContextImpl *Impl1 = getContextIfShared(V1);
+    LLVMContextImpl *Impl2 = getContextIfShared(V2);
+    if (Impl1)
+      Locks[0] = &Impl1->UseListLocks[LLVMContextImpl::getUseListShard(V1)];
+    if (Impl2)
+      Locks[1] = &Impl2->UseListLocks[LLVMContextImpl::getUseListShard(V2)];
+    // Take the shards in index order. Both values are in the same context.
+    if (Locks[0] == Locks[1])
+      Locks[1] = nullptr;
+    else if (Locks[0] && Locks[1] && Locks[1] < Locks[0])
+      std::swap(Locks[0], Locks[1]);
+    for (sys::SmartMutex<true> *Lock : Locks)
+      if (Lock)
+        Lock->lock();
+  }
+  ~UseListGuard() {
+    for (sys::SmartMutex<true> *Lock : Locks)
+      if (Lock)
+        Lock->unlock();
+  }
+};
+} // end anonymous namespace
+
+void Use::setSlow(Value *V) {
+  if (mayNeedUseListLock()) {
+    setLocked(V);
+  } else {
+    if (Val)
+      removeFromList();
+    Val = V;
+    if (V)
+      V->addUse(*this);
+  }
+
+  // Uses are only cleared when their user is being deleted, which isn't a
+  // change worth looking at.
+  if (!V || !NumChangeTrackingFunctions.load(std::memory_order_relaxed))
+    return;
+  if (auto *I = dyn_cast<Instruction>(getUser()))
+    if (BasicBlock *BB = I->getParent())
+      if (Function *F = BB->getParent())
+        F->noteChangedInstruction(I);
+}
+
+void Use::setLocked(Value *V) {
+  UseListGuard Guard(Val, V);
+  if (Val)
+    removeFromList();
+  Val = V;
+  if (V) {
+    V->addUse(*this);
+    logAddition(*this, V);
+  }
+}
+
+void Use::removeFromListLocked() {
+  UseListGuard Guard(Val, nullptr);
+  removeFromList();
+}
+
+void Use::replaceLeadingUses(Value *From, Value *To) {
+  Optional<UseListGuard> Guard;
+  if (mayNeedUseListLock())
+    Guard.emplace(From, To);
+
+  if (From->use_empty())
+    return;
+  Use *U = &*From->use_begin();
+  Use **Head = U->Prev.getPointer();
+  LLVMContextImpl *LogImpl = Guard ? getContextIfShared(To) : nullptr;
+
+  while (U) {
+    auto *C = dyn_cast<Constant>(U->getUser());
+    if (C && !isa<GlobalValue>(C))
+      break;
+    // Pushing the uses on the list of To in list order gives the order that
+    // setting them one by one does.
+    Use *Next = U->Next;
+    U->Val = To;
+    To->addUse(*U);
+    if (LogImpl)
+      LogImpl->logUseListAddition(*U, To);
+    U = Next;
+  }
+
+  // Cut the uses that were moved from the list of From.
+  *Head = U;
+  if (U)
+    U->setPrev(Head);
+}
+
 void Use::swap(Use &RHS) {
   if (Val == RHS.Val)
     return;
 
+  Optional<UseListGuard> Guard;
+  if (mayNeedUseListLock())
+    Guard.emplace(Val, RHS.Val);
+
   if (Val)
     removeFromList();
 
@@ -26,6 +157,8 @@ void Use::swap(Use &RHS) {
     RHS.removeFromList();
     Val = RHS.Val;
     Val->addUse(*this);
+    if (Guard)
+      logAddition(*this, Val);
   } else {
     Val = nullptr;
   }
@@ -33,6 +166,8 @@ void Use::swap(Use &RHS) {
   if (OldVal) {
     RHS.Val = OldVal;
     RHS.Val->addUse(RHS);
+    if (Guard)
+      logAddition(RHS, OldVal);
   } else {
     RHS.Val = nullptr;
   }
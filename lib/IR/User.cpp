@@ -10,11 +10,26 @@
 #include "llvm/IR/User.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/GlobalValue.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/Operator.h"
 
 namespace llvm {
 class BasicBlock;
 
+/// Allocate \p Size bytes from \p Arena, or from the global heap if it is
+/// null.
+static void *allocateStorage(size_t Size, IRArena *Arena) {
+  return Arena ? Arena->allocate(Size) : ::operator new(Size);
+}
+
+/// Free storage allocated by allocateStorage.
+static void freeStorage(void *Storage, bool InArena) {
+  if (InArena)
+    IRArena::deallocate(Storage);
+  else
+    ::operator delete(Storage);
+}
+
 //===----------------------------------------------------------------------===//
 //                                 User Class
 //===----------------------------------------------------------------------===//
@@ -47,7 +62,11 @@ void User::allocHungoffUses(unsigned N, bool IsPhi) {
   size_t size = N * sizeof(Use) + sizeof(Use::UserRef);
   if (IsPhi)
     size += N * sizeof(BasicBlock *);
-  Use *Begin = static_cast<Use*>(::operator new(size));
+  // The uses of a User allocated from an arena come from the same arena.
+  IRArena *Arena =
+      HasArenaStorage ? IRArena::getArena(reinterpret_cast<Use **>(this) - 1)
+                      : nullptr;
+  Use *Begin = static_cast<Use*>(allocateStorage(size, Arena));
   Use *End = Begin + N;
   (void) new(End) Use::UserRef(const_cast<User*>(this), 1);
   setOperandList(Use::initTags(Begin, End));
@@ -77,36 +96,47 @@ void User::growHungoffUses(unsigned NewNumUses, bool IsPhi) {
         reinterpret_cast<char *>(NewOps + NewNumUses) + sizeof(Use::UserRef);
     std::copy(OldPtr, OldPtr + (OldNumUses * sizeof(BasicBlock *)), NewPtr);
   }
-  Use::zap(OldOps, OldOps + OldNumUses, true);
+  Use::zap(OldOps, OldOps + OldNumUses);
+  freeStorage(OldOps, HasArenaStorage);
 }
 
 //===----------------------------------------------------------------------===//
 //                         User operator new Implementations
 //===----------------------------------------------------------------------===//
 
-void *User::operator new(size_t Size, unsigned Us) {
+void *User::allocateFixedUser(size_t Size, unsigned Us, IRArena *Arena) {
   assert(Us < (1u << NumUserOperandsBits) && "Too many operands");
-  void *Storage = ::operator new(Size + sizeof(Use) * Us);
+  void *Storage = allocateStorage(Size + sizeof(Use) * Us, Arena);
   Use *Start = static_cast<Use*>(Storage);
   Use *End = Start + Us;
   User *Obj = reinterpret_cast<User*>(End);
   Obj->NumUserOperands = Us;
   Obj->HasHungOffUses = false;
+  Obj->HasArenaStorage = Arena != nullptr;
   Use::initTags(Start, End);
   return Obj;
 }
 
-void *User::operator new(size_t Size) {
+void *User::allocateHungoffUser(size_t Size, IRArena *Arena) {
   // Allocate space for a single Use*
-  void *Storage = ::operator new(Size + sizeof(Use *));
+  void *Storage = allocateStorage(Size + sizeof(Use *), Arena);
   Use **HungOffOperandList = static_cast<Use **>(Storage);
   User *Obj = reinterpret_cast<User *>(HungOffOperandList + 1);
   Obj->NumUserOperands = 0;
   Obj->HasHungOffUses = true;
+  Obj->HasArenaStorage = Arena != nullptr;
   *HungOffOperandList = nullptr;
   return Obj;
 }
 
+void *User::operator new(size_t Size, unsigned Us) {
+  return allocateFixedUser(Size, Us, nullptr);
+}
+
+void *User::operator new(size_t Size) {
+  return allocateHungoffUser(Size, nullptr);
+}
+
 //===----------------------------------------------------------------------===//
 //                         User operator delete Implementation
 //===----------------------------------------------------------------------===//
@@ -119,13 +149,15 @@ void User::operator delete(void *Usr) {
     Use **HungOffOperandList = static_cast<Use **>(Usr) - 1;
     // drop the hung off uses.
     Use::zap(*HungOffOperandList, *HungOffOperandList + Obj->NumUserOperands,
-             /* Delete */ true);
-    ::operator delete(HungOffOperandList);
+             /* Delete */ false);
+    if (*HungOffOperandList)
+      freeStorage(*HungOffOperandList, Obj->HasArenaStorage);
+    freeStorage(HungOffOperandList, Obj->HasArenaStorage);
   } else {
     Use *Storage = static_cast<Use *>(Usr) - Obj->NumUserOperands;
     Use::zap(Storage, Storage + Obj->NumUserOperands,
              /* Delete */ false);
-    ::operator delete(Storage);
+    freeStorage(Storage, Obj->HasArenaStorage);
   }
 }
 
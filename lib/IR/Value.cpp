@@ -163,6 +163,7 @@ ValueName *Value::getValueName() const {
   if (!HasName) return nullptr;
 
   LLVMContext &Ctx = getContext();
+  SharedStateGuard Guard(Ctx);
   auto I = Ctx.pImpl->ValueNames.find(this);
   assert(I != Ctx.pImpl->ValueNames.end() &&
          "No name entry found!");
@@ -172,6 +173,7 @@ ValueName *Value::getValueName() const {
 
 void Value::setValueName(ValueName *VN) {
   LLVMContext &Ctx = getContext();
+  SharedStateGuard Guard(Ctx);
 
   assert(HasName == Ctx.pImpl->ValueNames.count(this) &&
          "HasName bit out of sync!");
@@ -350,6 +352,19 @@ static bool contains(Value *Expr, Value *V) {
 }
 #endif
 
+/// Record the instructions that use \p V as changed, in the functions that
+/// track their changes. Use::set records the users it sets, but the uses that
+/// replaceAllUsesWith moves in bulk don't go through it.
+static void noteUsersChanged(Value *V) {
+  if (!V->getContext().pImpl->NumChangeTrackingFunctions)
+    return;
+  for (User *U : V->users())
+    if (auto *I = dyn_cast<Instruction>(U))
+      if (BasicBlock *BB = I->getParent())
+        if (Function *F = BB->getParent())
+          F->noteChangedInstruction(I);
+}
+
 void Value::replaceAllUsesWith(Value *New) {
   assert(New && "Value::replaceAllUsesWith(<null>) is invalid!");
   assert(!contains(New, this) &&
@@ -362,6 +377,7 @@ void Value::replaceAllUsesWith(Value *New) {
     ValueHandleBase::ValueIsRAUWd(this, New);
   if (isUsedByMetadata())
     ValueAsMetadata::handleRAUW(this, New);
+  noteUsersChanged(this);
 
   while (!use_empty()) {
     Use &U = *UseList;
@@ -374,7 +390,8 @@ void Value::replaceAllUsesWith(Value *New) {
       }
     }
 
-    U.set(New);
+    // Move U along with the uses after it that can simply be set as well.
+    Use::replaceLeadingUses(this, New);
   }
 
   if (BasicBlock *BB = dyn_cast<BasicBlock>(this))
@@ -545,6 +562,7 @@ void Value::reverseUseList() {
 
 void ValueHandleBase::AddToExistingUseList(ValueHandleBase **List) {
   assert(List && "Handle list is null?");
+  SharedStateGuard Guard(V->getContext());
 
   // Splice ourselves into the list.
   Next = *List;
@@ -570,6 +588,7 @@ void ValueHandleBase::AddToUseList() {
   assert(V && "Null pointer doesn't have a use list!");
 
   LLVMContextImpl *pImpl = V->getContext().pImpl;
+  SharedStateGuard Guard(*pImpl);
 
   if (V->HasValueHandle) {
     // If this value already has a ValueHandle, then it must be in the
@@ -612,6 +631,8 @@ void ValueHandleBase::AddToUseList() {
 void ValueHandleBase::RemoveFromUseList() {
   assert(V && V->HasValueHandle &&
          "Pointer doesn't have a use list!");
+  LLVMContextImpl *pImpl = V->getContext().pImpl;
+  SharedStateGuard Guard(*pImpl);
 
   // Unlink this from its use list.
   ValueHandleBase **PrevPtr = getPrevPtr();
@@ -627,7 +648,6 @@ void ValueHandleBase::RemoveFromUseList() {
   // If the Next pointer was null, then it is possible that this was the last
   // ValueHandle watching VP.  If so, delete its entry from the ValueHandles
   // map.
-  LLVMContextImpl *pImpl = V->getContext().pImpl;
   DenseMap<Value*, ValueHandleBase*> &Handles = pImpl->ValueHandles;
   if (Handles.isPointerIntoBucketsArray(PrevPtr)) {
     Handles.erase(V);
@@ -642,6 +662,7 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = V->getContext().pImpl;
+  SharedStateGuard Guard(*pImpl);
   ValueHandleBase *Entry = pImpl->ValueHandles[V];
   assert(Entry && "Value bit set but no entries exist");
 
@@ -702,6 +723,7 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = Old->getContext().pImpl;
+  SharedStateGuard Guard(*pImpl);
   ValueHandleBase *Entry = pImpl->ValueHandles[Old];
 
   assert(Entry && "Value bit set but no entries exist");
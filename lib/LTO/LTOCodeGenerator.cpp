@@ -18,6 +18,7 @@
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/CodeGen/RuntimeLibcalls.h"
 #include "llvm/Config/config.h"
 #include "llvm/IR/Constants.h"
@@ -36,10 +37,14 @@
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Support/CachePruning.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
@@ -201,8 +206,9 @@ bool LTOCodeGenerator::writeMergedModules(const char *path,
     return false;
   }
 
-  // write bitcode to it
-  WriteBitcodeToFile(IRLinker.getModule(), Out.os(), ShouldEmbedUselists);
+  // write bitcode to it, using as many threads as code generation does
+  WriteBitcodeToFile(IRLinker.getModule(), Out.os(), ShouldEmbedUselists,
+                     /*EmitFunctionSummary=*/false, CodeGenJobs);
   Out.os().close();
 
   if (Out.os().has_error()) {
@@ -216,8 +222,43 @@ bool LTOCodeGenerator::writeMergedModules(const char *path,
   return true;
 }
 
+bool LTOCodeGenerator::writeObjectToTempFile(MemoryBufferRef Object,
+                                             const char **name,
+                                             std::string &errMsg) {
+  SmallString<128> Filename;
+  int FD;
+  std::error_code EC =
+      sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
+  if (EC) {
+    errMsg = EC.message();
+    return false;
+  }
+
+  tool_output_file objFile(Filename.c_str(), FD);
+  objFile.os() << Object.getBuffer();
+  objFile.os().close();
+  if (objFile.os().has_error()) {
+    objFile.os().clear_error();
+    errMsg = "could not write object file: ";
+    errMsg += Filename.c_str();
+    return false;
+  }
+  objFile.keep();
+
+  NativeObjectPath = Filename.c_str();
+  *name = NativeObjectPath.c_str();
+  return true;
+}
+
 bool LTOCodeGenerator::compileOptimizedToFile(const char **name,
                                               std::string &errMsg) {
+  // The cached objects live in memory, copy them to the file.
+  if (!CacheDir.empty()) {
+    std::unique_ptr<MemoryBuffer> Object = compileOptimized(errMsg);
+    return Object &&
+           writeObjectToTempFile(Object->getMemBufferRef(), name, errMsg);
+  }
+
   // make unique temp .o file to put generated object file
   SmallString<128> Filename;
   int FD;
@@ -231,7 +272,8 @@ bool LTOCodeGenerator::compileOptimizedToFile(const char **name,
   // generate object file
   tool_output_file objFile(Filename.c_str(), FD);
 
-  bool genResult = compileOptimized(objFile.os(), errMsg);
+  raw_pwrite_stream *OS = &objFile.os();
+  bool genResult = compileOptimized(OS, errMsg);
   objFile.os().close();
   if (objFile.os().has_error()) {
     objFile.os().clear_error();
@@ -252,6 +294,20 @@ bool LTOCodeGenerator::compileOptimizedToFile(const char **name,
 
 std::unique_ptr<MemoryBuffer>
 LTOCodeGenerator::compileOptimized(std::string &errMsg) {
+  if (!CacheDir.empty()) {
+    if (!determineTarget(errMsg))
+      return nullptr;
+    std::vector<std::unique_ptr<MemoryBuffer>> Objects;
+    if (!compileCached(computeCacheKey("codegen"),
+                       [&](std::vector<std::unique_ptr<MemoryBuffer>> &Objs,
+                           std::string &Err) {
+                         return compileOptimizedToBuffers(1, Objs, Err);
+                       },
+                       Objects, errMsg))
+      return nullptr;
+    return std::move(Objects[0]);
+  }
+
   const char *name;
   if (!compileOptimizedToFile(&name, errMsg))
     return nullptr;
@@ -271,12 +327,86 @@ LTOCodeGenerator::compileOptimized(std::string &errMsg) {
   return std::move(*BufferOrErr);
 }
 
+bool LTOCodeGenerator::compileOptimizedParallel(
+    std::vector<std::unique_ptr<MemoryBuffer>> &Objects, std::string &errMsg) {
+  if (CacheDir.empty())
+    return compileOptimizedToBuffers(CodeGenJobs, Objects, errMsg);
+
+  if (CodeGenJobs == 1) {
+    std::unique_ptr<MemoryBuffer> Object = compileOptimized(errMsg);
+    if (!Object)
+      return false;
+    Objects.push_back(std::move(Object));
+    return true;
+  }
+
+  if (!determineTarget(errMsg))
+    return false;
+  if (sys::fs::create_directories(CacheDir))
+    return compileOptimizedToBuffers(CodeGenJobs, Objects, errMsg);
+
+  // Each partition is cached on its own, keyed on its bitcode, so that a
+  // change to the merged module only makes the partitions it lands in miss.
+  // There is no lock: concurrent links that miss on the same partition both
+  // generate it, and the entries are renamed into place whole.
+  std::vector<std::string> Keys(CodeGenJobs);
+  std::vector<std::unique_ptr<MemoryBuffer>> Cached(CodeGenJobs);
+  auto ReuseOutput = [&](unsigned Idx, StringRef Bitcode) {
+    Keys[Idx] = computePartitionCacheKey(Bitcode);
+    Cached[Idx] = loadCacheEntry(Keys[Idx]);
+    return Cached[Idx] != nullptr;
+  };
+  size_t FirstObject = Objects.size();
+  if (!compileOptimizedToBuffers(CodeGenJobs, Objects, errMsg, ReuseOutput))
+    return false;
+
+  for (unsigned I = 0; I != CodeGenJobs; ++I) {
+    std::unique_ptr<MemoryBuffer> &Object = Objects[FirstObject + I];
+    if (Cached[I])
+      Object = std::move(Cached[I]);
+    else
+      storeCacheEntry(Keys[I], Object->getMemBufferRef());
+  }
+  pruneCache();
+  return true;
+}
+
+bool LTOCodeGenerator::compileOptimizedToBuffers(
+    unsigned NumObjects, std::vector<std::unique_ptr<MemoryBuffer>> &Objects,
+    std::string &errMsg, std::function<bool(unsigned, StringRef)> ReuseOutput) {
+  std::vector<SmallVector<char, 0>> Buffers(NumObjects);
+  {
+    std::vector<std::unique_ptr<raw_svector_ostream>> OSs;
+    std::vector<raw_pwrite_stream *> OSPtrs;
+    for (SmallVector<char, 0> &Buffer : Buffers) {
+      OSs.emplace_back(new raw_svector_ostream(Buffer));
+      OSPtrs.push_back(OSs.back().get());
+    }
+
+    if (!compileOptimized(OSPtrs, errMsg, ReuseOutput))
+      return false;
+  }
+
+  for (unsigned I = 0; I != NumObjects; ++I)
+    Objects.push_back(MemoryBuffer::getMemBufferCopy(
+        StringRef(Buffers[I].data(), Buffers[I].size()),
+        "lto-llvm-" + Twine(I) + ".o"));
+  return true;
+}
 
 bool LTOCodeGenerator::compile_to_file(const char **name,
                                        bool disableInline,
                                        bool disableGVNLoadPRE,
                                        bool disableVectorization,
                                        std::string &errMsg) {
+  // The cached objects live in memory, copy them to the file.
+  if (!CacheDir.empty()) {
+    std::unique_ptr<MemoryBuffer> Object = compile(
+        disableInline, disableGVNLoadPRE, disableVectorization, errMsg);
+    return Object &&
+           writeObjectToTempFile(Object->getMemBufferRef(), name, errMsg);
+  }
+
   if (!optimize(disableInline, disableGVNLoadPRE,
                 disableVectorization, errMsg))
     return false;
@@ -287,6 +417,32 @@ bool LTOCodeGenerator::compile_to_file(const char **name,
 std::unique_ptr<MemoryBuffer>
 LTOCodeGenerator::compile(bool disableInline, bool disableGVNLoadPRE,
                           bool disableVectorization, std::string &errMsg) {
+  if (!CacheDir.empty()) {
+    if (!determineTarget(errMsg))
+      return nullptr;
+
+    // Key the objects on the unoptimized module and on the optimization
+    // options, so that a hit skips the optimizer as well.
+    std::string Pipeline = "O" + utostr(OptLevel);
+    Pipeline += disableInline ? " no-inline" : "";
+    Pipeline += disableGVNLoadPRE ? " no-gvn-load-pre" : "";
+    Pipeline += disableVectorization ? " no-vectorize" : "";
+    Pipeline += ShouldInternalize ? " internalize" : "";
+
+    std::vector<std::unique_ptr<MemoryBuffer>> Objects;
+    if (!compileCached(
+            computeCacheKey(Pipeline),
+            [&](std::vector<std::unique_ptr<MemoryBuffer>> &Objs,
+                std::string &Err) {
+              return optimize(disableInline, disableGVNLoadPRE,
+                              disableVectorization, Err) &&
+                     compileOptimizedToBuffers(1, Objs, Err);
+            },
+            Objects, errMsg))
+      return nullptr;
+    return std::move(Objects[0]);
+  }
+
   if (!optimize(disableInline, disableGVNLoadPRE,
                 disableVectorization, errMsg))
     return nullptr;
@@ -294,6 +450,237 @@ LTOCodeGenerator::compile(bool disableInline, bool disableGVNLoadPRE,
   return compileOptimized(errMsg);
 }
 
+/// Hash the target options that can affect the generated code.
+static void hashTargetOptions(MD5 &Hasher, const TargetOptions &Options) {
+  auto AddInt = [&](uint64_t Value) { Hasher.update(utostr(Value) + ","); };
+  AddInt(Options.LessPreciseFPMADOption);
+  AddInt(Options.UnsafeFPMath);
+  AddInt(Options.NoInfsFPMath);
+  AddInt(Options.NoNaNsFPMath);
+  AddInt(Options.HonorSignDependentRoundingFPMathOption);
+  AddInt(Options.NoZerosInBSS);
+  AddInt(Options.GuaranteedTailCallOpt);
+  AddInt(Options.StackAlignmentOverride);
+  AddInt(Options.EnableFastISel);
+  AddInt(Options.PositionIndependentExecutable);
+  AddInt(Options.UseInitArray);
+  AddInt(Options.DisableIntegratedAS);
+  AddInt(Options.CompressDebugSections);
+  AddInt(Options.FunctionSections);
+  AddInt(Options.DataSections);
+  AddInt(Options.UniqueSectionNames);
+  AddInt(Options.TrapUnreachable);
+  Hasher.update(Options.TrapFuncName + ",");
+  AddInt(Options.FloatABIType);
+  AddInt(Options.AllowFPOpFusion);
+  AddInt(Options.JTType);
+  AddInt(Options.ThreadModel);
+
+  // Settings that were not customized are reported differently by the two
+  // copies, which makes the hash tell them apart from explicit settings.
+  static const char *const RecipOps[] = {"divd",  "divf",      "vec-divd",
+                                         "vec-divf", "sqrtd",  "sqrtf",
+                                         "vec-sqrtd", "vec-sqrtf"};
+  TargetRecip RecipOff = Options.Reciprocals, RecipOn = Options.Reciprocals;
+  RecipOff.setDefaults("all", false, 0);
+  RecipOn.setDefaults("all", true, 1);
+  for (const char *Op : RecipOps) {
+    AddInt(RecipOff.isEnabled(Op));
+    AddInt(RecipOff.getRefinementSteps(Op));
+    AddInt(RecipOn.isEnabled(Op));
+    AddInt(RecipOn.getRefinementSteps(Op));
+  }
+
+  const MCTargetOptions &MCOptions = Options.MCOptions;
+  AddInt(MCOptions.SanitizeAddress);
+  AddInt(MCOptions.MCRelaxAll);
+  AddInt(MCOptions.MCNoExecStack);
+  AddInt(MCOptions.MCFatalWarnings);
+  AddInt(MCOptions.MCSaveTempLabels);
+  AddInt(MCOptions.MCUseDwarfDirectory);
+  AddInt(MCOptions.DwarfVersion);
+  Hasher.update(MCOptions.ABIName + ",");
+}
+
+/// Hash \p Str, terminated so that consecutive strings can't run together.
+static void hashString(MD5 &Hasher, StringRef Str) {
+  Hasher.update(Str);
+  Hasher.update(ArrayRef<uint8_t>((const uint8_t *)"", 1));
+}
+
+/// Return the cache key for the hash computed so far.
+static std::string getCacheKey(MD5 &Hasher) {
+  MD5::MD5Result Result;
+  Hasher.final(Result);
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+  return Key.str();
+}
+
+/// Hash everything besides the module that can change the generated code.
+void LTOCodeGenerator::hashCodeGenOptions(MD5 &Hasher) {
+  hashString(Hasher, TargetMach->getTargetTriple().str());
+  hashString(Hasher, MCpu);
+  hashString(Hasher, FeatureStr);
+  hashString(Hasher, utostr(RelocModel));
+  hashString(Hasher, utostr(CGOptLevel));
+  hashString(Hasher, utostr(EmitDwarfDebugInfo));
+  for (const char *Option : CodegenOptions)
+    hashString(Hasher, Option);
+  hashTargetOptions(Hasher, Options);
+}
+
+/// Compute the key under which the objects generated from the merged module,
+/// in its current state, are cached. \p Pipeline describes the work left to
+/// do on the module; everything else that can change the generated code is
+/// hashed here.
+std::string LTOCodeGenerator::computeCacheKey(StringRef Pipeline) {
+  MD5 Hasher;
+  hashString(Hasher, getVersionString());
+  hashString(Hasher, Pipeline);
+
+  // The module itself. Preserve the use-list order, which can change the
+  // generated code.
+  {
+    SmallVector<char, 0> Bitcode;
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(IRLinker.getModule(), OS,
+                       /*ShouldPreserveUseListOrder=*/true);
+    OS.flush();
+    Hasher.update(
+        ArrayRef<uint8_t>((const uint8_t *)Bitcode.data(), Bitcode.size()));
+  }
+
+  // The symbols that must survive internalization, in a stable order.
+  for (const StringSet *Symbols : {&MustPreserveSymbols, &AsmUndefinedRefs}) {
+    std::vector<StringRef> Names;
+    for (const auto &Entry : *Symbols)
+      Names.push_back(Entry.getKey());
+    std::sort(Names.begin(), Names.end());
+    for (StringRef Name : Names)
+      hashString(Hasher, Name);
+    hashString(Hasher, "");
+  }
+
+  hashCodeGenOptions(Hasher);
+  return getCacheKey(Hasher);
+}
+
+/// Compute the key under which the object generated from a partition of the
+/// optimized module is cached. \p Bitcode is the partition exactly as it is
+/// handed to the code generator.
+std::string LTOCodeGenerator::computePartitionCacheKey(StringRef Bitcode) {
+  MD5 Hasher;
+  hashString(Hasher, getVersionString());
+  hashString(Hasher, "codegen-partition");
+  Hasher.update(
+      ArrayRef<uint8_t>((const uint8_t *)Bitcode.data(), Bitcode.size()));
+  hashCodeGenOptions(Hasher);
+  return getCacheKey(Hasher);
+}
+
+std::string LTOCodeGenerator::getCacheEntryPath(StringRef Key) {
+  SmallString<128> EntryPath(CacheDir);
+  sys::path::append(EntryPath, "llvmcache-" + Key);
+  return EntryPath.str();
+}
+
+/// Return the object cached under \p Key, marking it as just used, or null if
+/// there is none.
+std::unique_ptr<MemoryBuffer> LTOCodeGenerator::loadCacheEntry(StringRef Key) {
+  std::string EntryPath = getCacheEntryPath(Key);
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getFile(EntryPath, -1, false);
+  if (!BufferOrErr)
+    return nullptr;
+  CachePruning::touchEntry(EntryPath);
+  return std::move(*BufferOrErr);
+}
+
+/// Cache \p Object under \p Key. The entry is written to a temporary file
+/// renamed into place, so that readers never see a partial object. Caching is
+/// best effort: failures are ignored.
+void LTOCodeGenerator::storeCacheEntry(StringRef Key, MemoryBufferRef Object) {
+  SmallString<128> TempPath(CacheDir);
+  sys::path::append(TempPath, "tmp-%%%%%%%%.o");
+  int FD;
+  if (sys::fs::createUniqueFile(TempPath, FD, TempPath))
+    return;
+  raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  OS << Object.getBuffer();
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    sys::fs::remove(TempPath);
+    return;
+  }
+  if (sys::fs::rename(TempPath, getCacheEntryPath(Key)))
+    sys::fs::remove(TempPath);
+}
+
+void LTOCodeGenerator::pruneCache() {
+  CachePruning(CacheDir)
+      .setPruningInterval(CachePruningInterval)
+      .setEntryExpiration(CacheEntryExpiration)
+      .setMaxSize(MaxCacheSize)
+      .prune();
+}
+
+/// Append to \p Objects the object cached under \p Key, or run \p Compile
+/// and cache the object it appends if there is none. A lock file makes
+/// concurrent links that miss on the same key compile only once.
+bool LTOCodeGenerator::compileCached(
+    StringRef Key, CompileFnTy Compile,
+    std::vector<std::unique_ptr<MemoryBuffer>> &Objects, std::string &errMsg) {
+  if (sys::fs::create_directories(CacheDir))
+    return Compile(Objects, errMsg);
+
+  auto tryLoadFromCache = [&]() {
+    std::unique_ptr<MemoryBuffer> Cached = loadCacheEntry(Key);
+    if (!Cached)
+      return false;
+    Objects.push_back(std::move(Cached));
+    return true;
+  };
+
+  if (tryLoadFromCache()) {
+    pruneCache();
+    return true;
+  }
+
+  // The lock file name must not look like a cache entry, so that pruning
+  // leaves it alone.
+  SmallString<128> LockPath(CacheDir);
+  sys::path::append(LockPath, "lock-" + Key);
+  LockFileManager Lock(LockPath);
+  switch (Lock) {
+  case LockFileManager::LFS_Error:
+    // Caching is best effort, just compile.
+    return Compile(Objects, errMsg);
+
+  case LockFileManager::LFS_Shared:
+    // Another process is generating the same object, wait for it.
+    if (Lock.waitForUnlock() == LockFileManager::Res_Success &&
+        tryLoadFromCache())
+      return true;
+    return Compile(Objects, errMsg);
+
+  case LockFileManager::LFS_Owned:
+    break;
+  }
+
+  // The object may have been added while we were acquiring the lock.
+  if (tryLoadFromCache())
+    return true;
+
+  if (!Compile(Objects, errMsg))
+    return false;
+
+  storeCacheEntry(Key, Objects.back()->getMemBufferRef());
+  pruneCache();
+  return true;
+}
+
 bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
   if (TargetMach)
     return true;
@@ -310,7 +697,7 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
 
   // The relocation model is actually a static member of TargetMachine and
   // needs to be set before the TargetMachine is instantiated.
-  Reloc::Model RelocModel = Reloc::Default;
+  RelocModel = Reloc::Default;
   switch (CodeModel) {
   case LTO_CODEGEN_PIC_MODEL_STATIC:
     RelocModel = Reloc::Static;
@@ -330,7 +717,7 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
   // the default set of features.
   SubtargetFeatures Features(MAttr);
   Features.getDefaultSubtargetFeatures(Triple);
-  std::string FeatureStr = Features.getString();
+  FeatureStr = Features.getString();
   // Set a default CPU for Darwin triples.
   if (MCpu.empty() && Triple.isOSDarwin()) {
     if (Triple.getArch() == llvm::Triple::x86_64)
@@ -341,7 +728,6 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
       MCpu = "cyclone";
   }
 
-  CodeGenOpt::Level CGOptLevel;
   switch (OptLevel) {
   case 0:
     CGOptLevel = CodeGenOpt::None;
@@ -546,27 +932,43 @@ bool LTOCodeGenerator::optimize(bool DisableInline,
   return true;
 }
 
-bool LTOCodeGenerator::compileOptimized(raw_pwrite_stream &out,
-                                        std::string &errMsg) {
+bool LTOCodeGenerator::compileOptimized(
+    ArrayRef<raw_pwrite_stream *> Out, std::string &errMsg,
+    std::function<bool(unsigned, StringRef)> ReuseOutput) {
   if (!this->determineTarget(errMsg))
     return false;
 
   Module *mergedModule = IRLinker.getModule();
 
-  legacy::PassManager codeGenPasses;
+  if (Out.size() == 1) {
+    legacy::PassManager codeGenPasses;
 
-  // If the bitcode files contain ARC code and were compiled with optimization,
-  // the ObjCARCContractPass must be run, so do it unconditionally here.
-  codeGenPasses.add(createObjCARCContractPass());
+    // If the bitcode files contain ARC code and were compiled with
+    // optimization, the ObjCARCContractPass must be run, so do it
+    // unconditionally here.
+    codeGenPasses.add(createObjCARCContractPass());
 
-  if (TargetMach->addPassesToEmitFile(codeGenPasses, out,
-                                      TargetMachine::CGFT_ObjectFile)) {
-    errMsg = "target file type not supported";
-    return false;
+    if (TargetMach->addPassesToEmitFile(codeGenPasses, *Out[0],
+                                        TargetMachine::CGFT_ObjectFile)) {
+      errMsg = "target file type not supported";
+      return false;
+    }
+
+    // Run the code generator, and write assembly file
+    codeGenPasses.run(*mergedModule);
+
+    return true;
   }
 
-  // Run the code generator, and write assembly file
-  codeGenPasses.run(*mergedModule);
+  // The ObjCARCContractPass must run before the module is split, as each
+  // partition is code generated with a plain codegen pipeline.
+  legacy::PassManager preCodeGenPasses;
+  preCodeGenPasses.add(createObjCARCContractPass());
+  preCodeGenPasses.run(*mergedModule);
+
+  splitCodeGen(*mergedModule, Out, MCpu, FeatureStr, Options, RelocModel,
+               CodeModel::Default, CGOptLevel, TargetMachine::CGFT_ObjectFile,
+               ReuseOutput);
 
   return true;
 }
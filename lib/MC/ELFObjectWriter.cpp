@@ -1015,8 +1015,10 @@ void ELFObjectWriter::writeSectionData(const MCAssembler &Asm, MCSection &Sec,
   SmallVector<char, 128> UncompressedData =
       getUncompressedData(Layout, Fragments);
 
+  // Large sections such as .debug_info and .debug_line are deflated in blocks
+  // on several threads. The result does not depend on the number of threads.
   SmallVector<char, 128> CompressedContents;
-  zlib::Status Success = zlib::compress(
+  zlib::Status Success = zlib::compressInBlocks(
       StringRef(UncompressedData.data(), UncompressedData.size()),
       CompressedContents);
   if (Success != zlib::StatusOK) {
@@ -53,6 +53,7 @@ STATISTIC(evaluateFixup, "Number of evaluated fixups");
 STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
+STATISTIC(RelaxationChecks, "Number of fragments checked for relaxation");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
 }
 }
@@ -856,7 +857,8 @@ void MCAssembler::Finish() {
   }
 
   // Layout until everything fits.
-  while (layoutOnce(Layout))
+  SmallPtrSet<const MCSection *, 16> FinalSections;
+  while (layoutOnce(Layout, FinalSections))
     continue;
 
   DEBUG_WITH_TYPE("mc-dump", {
@@ -1012,56 +1014,231 @@ bool MCAssembler::relaxDwarfCallFrameFragment(MCAsmLayout &Layout,
   return OldSize != Data.size();
 }
 
-bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec) {
-  // Holds the first fragment which needed relaxing during this layout. It will
-  // remain NULL if none were relaxed.
-  // When a fragment is relaxed, all the fragments following it should get
-  // invalidated because their offset is going to change.
-  MCFragment *FirstRelaxedFragment = nullptr;
+bool MCAssembler::relaxFragment(MCAsmLayout &Layout, MCFragment &F) {
+  switch(F.getKind()) {
+  default:
+    return false;
+  case MCFragment::FT_Relaxable:
+    assert(!getRelaxAll() &&
+           "Did not expect a MCRelaxableFragment in RelaxAll mode");
+    return relaxInstruction(Layout, cast<MCRelaxableFragment>(F));
+  case MCFragment::FT_Dwarf:
+    return relaxDwarfLineAddr(Layout, cast<MCDwarfLineAddrFragment>(F));
+  case MCFragment::FT_DwarfFrame:
+    return relaxDwarfCallFrameFragment(Layout,
+                                       cast<MCDwarfCallFrameFragment>(F));
+  case MCFragment::FT_LEB:
+    return relaxLEB(Layout, cast<MCLEBFragment>(F));
+  }
+}
 
-  // Attempt to relax all the fragments in the section.
-  for (MCSection::iterator I = Sec.begin(), IE = Sec.end(); I != IE; ++I) {
-    // Check if this is a fragment that needs relaxation.
-    bool RelaxedFrag = false;
-    switch(I->getKind()) {
-    default:
-      break;
-    case MCFragment::FT_Relaxable:
-      assert(!getRelaxAll() &&
-             "Did not expect a MCRelaxableFragment in RelaxAll mode");
-      RelaxedFrag = relaxInstruction(Layout, *cast<MCRelaxableFragment>(I));
-      break;
-    case MCFragment::FT_Dwarf:
-      RelaxedFrag = relaxDwarfLineAddr(Layout,
-                                       *cast<MCDwarfLineAddrFragment>(I));
-      break;
-    case MCFragment::FT_DwarfFrame:
-      RelaxedFrag =
-        relaxDwarfCallFrameFragment(Layout,
-                                    *cast<MCDwarfCallFrameFragment>(I));
-      break;
-    case MCFragment::FT_LEB:
-      RelaxedFrag = relaxLEB(Layout, *cast<MCLEBFragment>(I));
-      break;
+namespace {
+/// A fragment which relaxation may resize, and the fragments of the section
+/// being relaxed whose offsets the value it is encoded from depends on.
+struct RelaxationInput {
+  MCFragment *F;
+
+  /// Each fragment the value depends on, and whether its offset is added to
+  /// (1) or subtracted from (-1) the value.
+  SmallVector<std::pair<const MCFragment *, int>, 2> Terms;
+
+  /// The sum of the offsets in Terms when the fragment was last checked.
+  int64_t Distance;
+
+  /// The value depends on the layout in a way that is not described by
+  /// Terms, so the fragment has to be checked whenever the section changes.
+  bool Untracked;
+
+  /// The value depends on the offsets of fragments in other sections.
+  bool UsesOtherSections;
+
+  /// The fragment has to be checked in the next relaxation step, because it
+  /// has not been checked yet or it was resized.
+  bool NeedsCheck;
+
+  explicit RelaxationInput(MCFragment *F)
+      : F(F), Distance(0), Untracked(false), UsesOtherSections(false),
+        NeedsCheck(true) {}
+};
+}
+
+/// Add the offsets of the fragments which \p E refers to with the given sign
+/// to \p In. Return false if \p E is not a sum of symbols and constants.
+static bool addRelaxationTerms(const MCExpr *E, int Sign,
+                               RelaxationInput &In) {
+  switch (E->getKind()) {
+  case MCExpr::Constant:
+    return true;
+
+  case MCExpr::SymbolRef: {
+    const MCSymbol &Sym = cast<MCSymbolRefExpr>(E)->getSymbol();
+    if (Sym.isVariable())
+      return false;
+    // Undefined and absolute symbols do not move.
+    const MCFragment *F = Sym.getFragment();
+    if (!F)
+      return true;
+    if (F->getParent() != In.F->getParent())
+      In.UsesOtherSections = true;
+    else
+      In.Terms.push_back(std::make_pair(F, Sign));
+    return true;
+  }
+
+  case MCExpr::Unary: {
+    const MCUnaryExpr *UE = cast<MCUnaryExpr>(E);
+    if (UE->getOpcode() == MCUnaryExpr::Plus)
+      return addRelaxationTerms(UE->getSubExpr(), Sign, In);
+    if (UE->getOpcode() == MCUnaryExpr::Minus)
+      return addRelaxationTerms(UE->getSubExpr(), -Sign, In);
+    return false;
+  }
+
+  case MCExpr::Binary: {
+    const MCBinaryExpr *BE = cast<MCBinaryExpr>(E);
+    if (BE->getOpcode() == MCBinaryExpr::Add)
+      return addRelaxationTerms(BE->getLHS(), Sign, In) &&
+             addRelaxationTerms(BE->getRHS(), Sign, In);
+    if (BE->getOpcode() == MCBinaryExpr::Sub)
+      return addRelaxationTerms(BE->getLHS(), Sign, In) &&
+             addRelaxationTerms(BE->getRHS(), -Sign, In);
+    return false;
+  }
+
+  case MCExpr::Target:
+    return false;
+  }
+
+  llvm_unreachable("Invalid assembly expression kind!");
+}
+
+/// Compute what the encoding of \p In.F depends on. Return false if the
+/// fragment can not be resized by relaxation anymore.
+static bool computeRelaxationInput(const MCAsmBackend &Backend,
+                                   RelaxationInput &In) {
+  In.Terms.clear();
+  In.Untracked = false;
+  In.UsesOtherSections = false;
+
+  const MCExpr *Value;
+  switch (In.F->getKind()) {
+  default:
+    return false;
+  case MCFragment::FT_Relaxable: {
+    MCRelaxableFragment &RF = cast<MCRelaxableFragment>(*In.F);
+    if (!Backend.mayNeedRelaxation(RF.getInst()))
+      return false;
+    for (MCRelaxableFragment::const_fixup_iterator it = RF.fixup_begin(),
+         ie = RF.fixup_end(); it != ie; ++it) {
+      unsigned Flags = Backend.getFixupKindInfo(it->getKind()).Flags;
+      // PC alignment does not preserve differences between offsets.
+      if (!addRelaxationTerms(it->getValue(), 1, In) ||
+          (Flags & MCFixupKindInfo::FKF_IsAlignedDownTo32Bits))
+        In.Untracked = true;
+      if (Flags & MCFixupKindInfo::FKF_IsPCRel)
+        In.Terms.push_back(std::make_pair(In.F, -1));
     }
-    if (RelaxedFrag && !FirstRelaxedFragment)
-      FirstRelaxedFragment = I;
+    return true;
   }
-  if (FirstRelaxedFragment) {
+  case MCFragment::FT_Dwarf:
+    Value = &cast<MCDwarfLineAddrFragment>(In.F)->getAddrDelta();
+    break;
+  case MCFragment::FT_DwarfFrame:
+    Value = &cast<MCDwarfCallFrameFragment>(In.F)->getAddrDelta();
+    break;
+  case MCFragment::FT_LEB:
+    Value = &cast<MCLEBFragment>(In.F)->getValue();
+    break;
+  }
+  if (!addRelaxationTerms(Value, 1, In))
+    In.Untracked = true;
+  return true;
+}
+
+bool MCAssembler::relaxSection(MCAsmLayout &Layout, MCSection &Sec,
+                               bool &IsFinal) {
+  // Collect the fragments which relaxation may resize. A section with org
+  // fragments may move whenever the symbols they refer to do.
+  std::vector<RelaxationInput> Inputs;
+  IsFinal = true;
+  for (MCSection::iterator I = Sec.begin(), IE = Sec.end(); I != IE; ++I) {
+    if (isa<MCOrgFragment>(I))
+      IsFinal = false;
+    RelaxationInput In(&*I);
+    if (computeRelaxationInput(getBackend(), In))
+      Inputs.push_back(In);
+  }
+
+  // Relax the fragments until the section layout stops changing. A fragment
+  // is encoded from a value that is a sum of fragment offsets, so it only has
+  // to be checked again if it was resized itself, or if the fragments its
+  // value depends on moved by different amounts. Fragments of other sections
+  // do not move while this one is relaxed.
+  bool WasRelaxed = false;
+  for (;;) {
+    MCFragment *FirstRelaxedFragment = nullptr;
+    bool HasFinishedFragments = false;
+    for (unsigned i = 0, e = Inputs.size(); i != e; ++i) {
+      RelaxationInput &In = Inputs[i];
+      int64_t Distance = 0;
+      for (unsigned t = 0, te = In.Terms.size(); t != te; ++t)
+        Distance += In.Terms[t].second *
+                    (int64_t)Layout.getFragmentOffset(In.Terms[t].first);
+      if (!In.NeedsCheck && !In.Untracked && Distance == In.Distance)
+        continue;
+
+      ++stats::RelaxationChecks;
+      In.Distance = Distance;
+      In.NeedsCheck = relaxFragment(Layout, *In.F);
+      if (!In.NeedsCheck)
+        continue;
+      if (!FirstRelaxedFragment)
+        FirstRelaxedFragment = In.F;
+      if (!computeRelaxationInput(getBackend(), In)) {
+        In.F = nullptr;
+        HasFinishedFragments = true;
+      }
+    }
+
+    // Stop tracking fragments which relaxation can not resize anymore.
+    if (HasFinishedFragments)
+      Inputs.erase(std::remove_if(Inputs.begin(), Inputs.end(),
+                                  [](const RelaxationInput &In) {
+                                    return !In.F;
+                                  }),
+                   Inputs.end());
+
+    if (!FirstRelaxedFragment)
+      break;
+
+    // When a fragment is relaxed, all the fragments following it should get
+    // invalidated because their offset is going to change.
     Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
-    return true;
+    WasRelaxed = true;
   }
-  return false;
+
+  // Once relaxed, a section which only depends on its own layout does not
+  // have to be revisited when other sections change.
+  for (unsigned i = 0, e = Inputs.size(); i != e && IsFinal; ++i)
+    if (Inputs[i].Untracked || Inputs[i].UsesOtherSections)
+      IsFinal = false;
+  return WasRelaxed;
 }
 
-bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
+bool MCAssembler::layoutOnce(MCAsmLayout &Layout,
+                             SmallPtrSetImpl<const MCSection *> &FinalSections) {
   ++stats::RelaxationSteps;
 
   bool WasRelaxed = false;
   for (iterator it = begin(), ie = end(); it != ie; ++it) {
     MCSection &Sec = *it;
-    while (layoutSectionOnce(Layout, Sec))
+    if (FinalSections.count(&Sec))
+      continue;
+    bool IsFinal;
+    if (relaxSection(Layout, Sec, IsFinal))
       WasRelaxed = true;
+    if (IsFinal)
+      FinalSections.insert(&Sec);
   }
 
   return WasRelaxed;
@@ -11,30 +11,85 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/COFF.h"
 #include "llvm/Support/Endian.h"
+#include <algorithm>
 
 using namespace llvm;
 
-static bool compareBySuffix(StringRef a, StringRef b) {
-  size_t sizeA = a.size();
-  size_t sizeB = b.size();
-  size_t len = std::min(sizeA, sizeB);
-  for (size_t i = 0; i < len; ++i) {
-    char ca = a[sizeA - i - 1];
-    char cb = b[sizeB - i - 1];
-    if (ca != cb)
-      return ca > cb;
+typedef StringMapEntry<size_t> StringEntry;
+
+/// Return the character at \p Pos counting from the end of the string in \p E,
+/// or -1 if the string is not longer than \p Pos.
+static int charTailAt(const StringEntry *E, size_t Pos) {
+  StringRef S = E->getKey();
+  if (Pos >= S.size())
+    return -1;
+  return (unsigned char)S[S.size() - Pos - 1];
+}
+
+/// Sort the strings in [Begin, End), which have the same last \p Pos
+/// characters, by their reversed characters in decreasing order, so that a
+/// string comes right after the strings it is a suffix of.
+///
+/// This is a three-way radix quicksort. Unlike a comparison sort it looks at
+/// every character once per partitioning step instead of comparing the whole
+/// common suffix of two strings over and over, which matters for mangled C++
+/// names that share long suffixes.
+static void multikeySort(StringEntry **Begin, StringEntry **End, size_t Pos) {
+  while (End - Begin > 1) {
+    // Partition the strings into those whose character at Pos is greater than,
+    // equal to and less than the pivot's: [Begin, Greater), [Greater, Less)
+    // and [Less, End).
+    int Pivot = charTailAt(Begin[(End - Begin) / 2], Pos);
+    StringEntry **Greater = Begin;
+    StringEntry **Less = End;
+    for (StringEntry **I = Begin; I < Less;) {
+      int C = charTailAt(*I, Pos);
+      if (C > Pivot)
+        std::swap(*Greater++, *I++);
+      else if (C < Pivot)
+        std::swap(*--Less, *I);
+      else
+        ++I;
+    }
+
+    // The strings equal to the pivot are sorted by their next character. If
+    // they have all ended, they are the same string and there is nothing left
+    // to sort.
+    struct Partition {
+      StringEntry **Begin, **End;
+      size_t Pos;
+    } Parts[] = {{Begin, Greater, Pos},
+                 {Less, End, Pos},
+                 {Greater, Pivot == -1 ? Greater : Less, Pos + 1}};
+
+    // Sort the two smaller partitions recursively and continue with the
+    // largest one, so that the recursion depth is logarithmic.
+    auto size = [](const Partition &P) { return P.End - P.Begin; };
+    Partition *Largest = std::max_element(
+        std::begin(Parts), std::end(Parts),
+        [&](const Partition &A, const Partition &B) {
+          return size(A) < size(B);
+        });
+    for (Partition &P : Parts)
+      if (&P != Largest)
+        multikeySort(P.Begin, P.End, P.Pos);
+    Begin = Largest->Begin;
+    End = Largest->End;
+    Pos = Largest->Pos;
   }
-  return sizeA > sizeB;
 }
 
 void StringTableBuilder::finalize(Kind kind) {
-  SmallVector<StringRef, 8> Strings;
+  // The strings have already been deduplicated by StringIndexMap. Sort its
+  // entries directly so that the offsets can be stored without looking the
+  // strings up again.
+  SmallVector<StringEntry *, 8> Strings;
   Strings.reserve(StringIndexMap.size());
 
   for (auto i = StringIndexMap.begin(), e = StringIndexMap.end(); i != e; ++i)
-    Strings.push_back(i->getKey());
+    Strings.push_back(&*i);
 
-  std::sort(Strings.begin(), Strings.end(), compareBySuffix);
+  multikeySort(Strings.begin(), Strings.end(), 0);
 
   switch (kind) {
   case ELF:
@@ -46,26 +101,34 @@ void StringTableBuilder::finalize(Kind kind) {
     // Make room to write the table size later.
     StringTable.append(4, '\x00');
     break;
+  case RAW:
+    break;
   }
 
+  // Strings are NUL terminated, except in a RAW table where the strings are
+  // expected to carry their own terminators.
+  size_t TerminatorSize = kind == RAW ? 0 : 1;
   StringRef Previous;
-  for (StringRef s : Strings) {
+  for (StringEntry *E : Strings) {
+    StringRef s = E->getKey();
     if (kind == WinCOFF)
       assert(s.size() > COFF::NameSize && "Short string in COFF string table!");
 
     if (Previous.endswith(s)) {
-      StringIndexMap[s] = StringTable.size() - 1 - s.size();
+      E->setValue(StringTable.size() - TerminatorSize - s.size());
       continue;
     }
 
-    StringIndexMap[s] = StringTable.size();
+    E->setValue(StringTable.size());
     StringTable += s;
-    StringTable += '\x00';
+    if (kind != RAW)
+      StringTable += '\x00';
     Previous = s;
   }
 
   switch (kind) {
   case ELF:
+  case RAW:
     break;
   case MachO:
     // Pad to multiple of 4.
@@ -80,9 +143,12 @@ void StringTableBuilder::finalize(Kind kind) {
         StringTable.data(), size);
     break;
   }
+
+  Finalized = true;
 }
 
 void StringTableBuilder::clear() {
   StringTable.clear();
   StringIndexMap.clear();
+  Finalized = false;
 }
@@ -15,6 +15,7 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/MC/StringTableBuilder.h"
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Object/SymbolicFile.h"
@@ -132,29 +133,32 @@ static void printMemberHeader(raw_fd_ostream &Out, unsigned NameOffset,
 static void writeStringTable(raw_fd_ostream &Out,
                              ArrayRef<NewArchiveIterator> Members,
                              std::vector<unsigned> &StringMapIndexes) {
-  unsigned StartOffset = 0;
+  // Names are stored with their "/\n" terminator, so a name that is a suffix
+  // of another one, such as a member added twice, reuses the longer entry.
+  StringTableBuilder StrTab;
+  std::vector<StringRef> LongNames;
   for (ArrayRef<NewArchiveIterator>::iterator I = Members.begin(),
                                               E = Members.end();
        I != E; ++I) {
     StringRef Name = I->getName();
     if (Name.size() < 16)
       continue;
-    if (StartOffset == 0) {
-      printWithSpacePadding(Out, "//", 58);
-      Out << "`\n";
-      StartOffset = Out.tell();
-    }
-    StringMapIndexes.push_back(Out.tell() - StartOffset);
-    Out << Name << "/\n";
+    LongNames.push_back(StrTab.add((Name + "/\n").str()));
   }
-  if (StartOffset == 0)
+  if (LongNames.empty())
     return;
-  if (Out.tell() % 2)
+
+  StrTab.finalize(StringTableBuilder::RAW);
+  for (StringRef Name : LongNames)
+    StringMapIndexes.push_back(StrTab.getOffset(Name));
+
+  StringRef Data = StrTab.data();
+  printWithSpacePadding(Out, "//", 48);
+  printWithSpacePadding(Out, Data.size() + Data.size() % 2, 10);
+  Out << "`\n";
+  Out << Data;
+  if (Data.size() % 2)
     Out << '\n';
-  int Pos = Out.tell();
-  Out.seek(StartOffset - 12);
-  printWithSpacePadding(Out, Pos - StartOffset, 10);
-  Out.seek(Pos);
 }
 
 // Returns the offset of the first reference to a member offset.
@@ -106,6 +106,22 @@ InstrProfWriter::addFunctionCounts(StringRef FunctionName,
   return instrprof_error::success;
 }
 
+void InstrProfWriter::mergeRecordsFromWriter(
+    InstrProfWriter &&IPW,
+    function_ref<void(StringRef, std::error_code)> Warn) {
+  for (auto &I : IPW.FunctionData)
+    for (auto &Counts : I.getValue())
+      if (std::error_code EC =
+              addFunctionCounts(I.getKey(), Counts.first, Counts.second))
+        Warn(I.getKey(), EC);
+  IPW.FunctionData.clear();
+  IPW.MaxFunctionCount = 0;
+}
+
+void InstrProfWriter::removeFunctionCounts(StringRef FunctionName) {
+  FunctionData.erase(FunctionName);
+}
+
 std::pair<uint64_t, uint64_t> InstrProfWriter::writeImpl(raw_ostream &OS) {
   OnDiskChainedHashTableGenerator<InstrProfRecordTrait> Generator;
 
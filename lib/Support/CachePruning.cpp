@@ -0,0 +1,129 @@
+//===-CachePruning.cpp - LLVM Cache Directory Pruning ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the pruning of a directory based on least recently used.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CachePruning.h"
+
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#define DEBUG_TYPE "cache-pruning"
+
+using namespace llvm;
+
+/// Set the modification time of the file at \p Path to now, creating the file
+/// if it does not exist.
+static void touchFile(const Twine &Path) {
+  int FD;
+  if (sys::fs::openFileForWrite(Path, FD, sys::fs::F_Append))
+    return;
+  sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+  sys::Process::SafelyCloseFileDescriptor(FD);
+}
+
+void CachePruning::touchEntry(StringRef EntryPath) {
+  if (sys::fs::exists(EntryPath))
+    touchFile(EntryPath);
+}
+
+/// Prune the cache of files that haven't been accessed in a long time.
+bool CachePruning::prune() {
+  if (Path.empty() || Interval < 0)
+    return false;
+
+  if (!Expiration && !MaxSize) {
+    DEBUG(dbgs() << "No pruning settings set, exit early\n");
+    // Nothing will be pruned, early exit
+    return false;
+  }
+
+  // Try to stat() the timestamp file.
+  SmallString<128> TimestampFile(Path);
+  sys::path::append(TimestampFile, "llvmcache.timestamp");
+  sys::fs::file_status FileStatus;
+  sys::TimeValue CurrentTime = sys::TimeValue::now();
+  if (!sys::fs::status(TimestampFile, FileStatus) &&
+      sys::fs::exists(FileStatus)) {
+    sys::TimeValue TimeStampModTime = FileStatus.getLastModificationTime();
+    auto TimeInterval = CurrentTime.seconds() - TimeStampModTime.seconds();
+    if (TimeInterval < Interval) {
+      // We don't want to prune the cache too often.
+      DEBUG(dbgs() << "Timestamp file too recent (" << TimeInterval
+                   << "s < " << Interval << "s), skip pruning\n");
+      return false;
+    }
+  }
+
+  // Write a new timestamp file so that nobody else attempts to prune.
+  touchFile(TimestampFile);
+
+  // Walk the entire directory cache, looking for unused files.
+  std::error_code EC;
+  SmallString<128> CachePathNative;
+  sys::path::native(Path, CachePathNative);
+
+  // Keep track of the remaining entries, with their last use time and size,
+  // to prune by size once the expired ones are gone.
+  typedef std::tuple<sys::TimeValue::SecondsType, uint64_t, std::string>
+      EntryInfo;
+  std::vector<EntryInfo> Entries;
+  uint64_t TotalSize = 0;
+
+  for (sys::fs::directory_iterator File(CachePathNative, EC), FileEnd;
+       File != FileEnd && !EC; File.increment(EC)) {
+    // Do not touch the timestamp, nor anything which is not a cache entry.
+    if (!sys::path::filename(File->path()).startswith("llvmcache-"))
+      continue;
+
+    if (File->status(FileStatus)) {
+      errs() << "warning: can't stat cache entry " << File->path() << '\n';
+      continue;
+    }
+
+    // If the file hasn't been used recently enough, delete it.
+    sys::TimeValue FileUseTime = FileStatus.getLastModificationTime();
+    auto FileUseInterval = CurrentTime.seconds() - FileUseTime.seconds();
+    if (Expiration && FileUseInterval > Expiration) {
+      DEBUG(dbgs() << "Remove " << File->path() << " (" << FileUseInterval
+                   << "s old)\n");
+      sys::fs::remove(File->path());
+      continue;
+    }
+
+    TotalSize += FileStatus.getSize();
+    Entries.push_back(EntryInfo(FileUseTime.seconds(), FileStatus.getSize(),
+                                File->path()));
+  }
+
+  if (!MaxSize || TotalSize <= MaxSize)
+    return true;
+
+  // Remove the least recently used entries until we fit in the budget.
+  std::sort(Entries.begin(), Entries.end());
+  for (const EntryInfo &Entry : Entries) {
+    if (TotalSize <= MaxSize)
+      break;
+    DEBUG(dbgs() << "Remove " << std::get<2>(Entry) << " to shrink the cache ("
+                 << TotalSize << " > " << MaxSize << ")\n");
+    sys::fs::remove(std::get<2>(Entry));
+    TotalSize -= std::get<1>(Entry);
+  }
+  return true;
+}
@@ -17,6 +17,9 @@
 #include "llvm/Config/config.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/thread.h"
+#include <algorithm>
+#include <vector>
 #if LLVM_ENABLE_ZLIB == 1 && HAVE_ZLIB_H
 #include <zlib.h>
 #endif
@@ -62,6 +65,123 @@ zlib::Status zlib::compress(StringRef InputBuffer,
   return Res;
 }
 
+namespace {
+/// One block of the input of compressInBlocks and what it deflates to.
+struct CompressedBlock {
+  StringRef Input;
+  StringRef Dictionary;
+  bool IsLast;
+  SmallVector<char, 0> Output;
+  uLong Adler;
+  int Result;
+};
+}
+
+/// Deflate B.Input as a raw deflate stream that continues the data before it.
+/// All blocks but the last end with a sync flush, which leaves the stream
+/// byte-aligned and open so that the next block can be appended to it.
+static void deflateBlock(CompressedBlock &B, int CLevel) {
+  B.Adler = ::adler32(::adler32(0, Z_NULL, 0), (const Bytef *)B.Input.data(),
+                      B.Input.size());
+
+  z_stream Strm;
+  Strm.zalloc = Z_NULL;
+  Strm.zfree = Z_NULL;
+  Strm.opaque = Z_NULL;
+  // These are the parameters compress2() uses, without the zlib wrapper.
+  B.Result = ::deflateInit2(&Strm, CLevel, Z_DEFLATED, -MAX_WBITS, 8,
+                            Z_DEFAULT_STRATEGY);
+  if (B.Result != Z_OK)
+    return;
+  if (!B.Dictionary.empty())
+    B.Result = ::deflateSetDictionary(&Strm, (const Bytef *)B.Dictionary.data(),
+                                      B.Dictionary.size());
+  if (B.Result != Z_OK) {
+    ::deflateEnd(&Strm);
+    return;
+  }
+
+  // The bound covers the final block; a sync flush adds at most an empty
+  // stored block on top of it.
+  B.Output.resize(::deflateBound(&Strm, B.Input.size()) + 8);
+  Strm.next_in = const_cast<Bytef *>(
+      reinterpret_cast<const Bytef *>(B.Input.data()));
+  Strm.avail_in = B.Input.size();
+  Strm.next_out = (Bytef *)B.Output.data();
+  Strm.avail_out = B.Output.size();
+  int Flush = B.IsLast ? Z_FINISH : Z_SYNC_FLUSH;
+  B.Result = ::deflate(&Strm, Flush);
+  if (B.Result == Z_STREAM_END ||
+      (B.Result == Z_OK && Flush == Z_SYNC_FLUSH && Strm.avail_in == 0 &&
+       Strm.avail_out != 0))
+    B.Result = Z_OK;
+  else if (B.Result == Z_OK)
+    B.Result = Z_BUF_ERROR;
+  __msan_unpoison(B.Output.data(), B.Output.size() - Strm.avail_out);
+  B.Output.resize(B.Output.size() - Strm.avail_out);
+  ::deflateEnd(&Strm);
+}
+
+zlib::Status zlib::compressInBlocks(StringRef InputBuffer,
+                                    SmallVectorImpl<char> &CompressedBuffer,
+                                    CompressionLevel Level, size_t BlockSize,
+                                    unsigned NumThreads) {
+  if (InputBuffer.size() <= BlockSize)
+    return compress(InputBuffer, CompressedBuffer, Level);
+
+  const size_t DictionarySize = 32 * 1024;
+  std::vector<CompressedBlock> Blocks;
+  for (size_t Offset = 0; Offset < InputBuffer.size(); Offset += BlockSize) {
+    CompressedBlock B;
+    B.Input = InputBuffer.substr(Offset, BlockSize);
+    B.Dictionary = InputBuffer.slice(
+        Offset - std::min(Offset, DictionarySize), Offset);
+    B.IsLast = Offset + BlockSize >= InputBuffer.size();
+    Blocks.push_back(std::move(B));
+  }
+
+  // Each thread takes every NumThreads-th block. The blocks only depend on
+  // the input, so the result is the same however they are scheduled.
+  int CLevel = encodeZlibCompressionLevel(Level);
+  if (NumThreads == 0)
+    NumThreads = thread::hardware_concurrency();
+  NumThreads = std::max(1U, std::min<unsigned>(NumThreads, Blocks.size()));
+  auto DeflateBlocks = [&](unsigned First) {
+    for (size_t I = First; I < Blocks.size(); I += NumThreads)
+      deflateBlock(Blocks[I], CLevel);
+  };
+  std::vector<thread> Threads;
+  for (unsigned I = 1; I < NumThreads; ++I)
+    Threads.emplace_back(DeflateBlocks, I);
+  DeflateBlocks(0);
+  for (thread &T : Threads)
+    T.join();
+
+  // Write the zlib header as deflate() would for this level, the deflate data
+  // of the blocks in order, and the Adler-32 of the whole input.
+  int HeaderLevel = CLevel == Z_DEFAULT_COMPRESSION ? 6 : CLevel;
+  unsigned LevelFlags =
+      HeaderLevel < 2 ? 0 : HeaderLevel < 6 ? 1 : HeaderLevel == 6 ? 2 : 3;
+  unsigned Header = (Z_DEFLATED + ((MAX_WBITS - 8) << 4)) << 8 |
+                    LevelFlags << 6;
+  Header += 31 - Header % 31;
+  CompressedBuffer.clear();
+  CompressedBuffer.push_back(Header >> 8);
+  CompressedBuffer.push_back(Header & 0xff);
+  uLong Adler = ::adler32(0, Z_NULL, 0);
+  for (CompressedBlock &B : Blocks) {
+    if (B.Result != Z_OK) {
+      CompressedBuffer.clear();
+      return encodeZlibReturnValue(B.Result);
+    }
+    CompressedBuffer.append(B.Output.begin(), B.Output.end());
+    Adler = ::adler32_combine(Adler, B.Adler, B.Input.size());
+  }
+  for (int Shift = 24; Shift >= 0; Shift -= 8)
+    CompressedBuffer.push_back((Adler >> Shift) & 0xff);
+  return StatusOK;
+}
+
 zlib::Status zlib::uncompress(StringRef InputBuffer,
                               SmallVectorImpl<char> &UncompressedBuffer,
                               size_t UncompressedSize) {
@@ -87,6 +207,12 @@ zlib::Status zlib::compress(StringRef InputBuffer,
                             CompressionLevel Level) {
   return zlib::StatusUnsupported;
 }
+zlib::Status zlib::compressInBlocks(StringRef InputBuffer,
+                                    SmallVectorImpl<char> &CompressedBuffer,
+                                    CompressionLevel Level, size_t BlockSize,
+                                    unsigned NumThreads) {
+  return zlib::StatusUnsupported;
+}
 zlib::Status zlib::uncompress(StringRef InputBuffer,
                               SmallVectorImpl<char> &UncompressedBuffer,
                               size_t UncompressedSize) {
@@ -0,0 +1,26 @@
+//===- GenericDomTree.cpp - Dominator tree options ------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the options shared by all instantiations of the generic
+// dominator tree.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/GenericDomTree.h"
+#include "llvm/Support/CommandLine.h"
+
+using namespace llvm;
+
+bool llvm::DomTreeUseSemiNCA = false;
+
+static cl::opt<bool, true>
+DomTreeUseSemiNCAX("dom-tree-semi-nca", cl::location(DomTreeUseSemiNCA),
+                   cl::Hidden,
+                   cl::desc("Build dominator trees with the Semi-NCA "
+                            "algorithm rather than Lengauer-Tarjan"));
@@ -0,0 +1,239 @@
+//==-- llvm/Support/ThreadPool.cpp - A ThreadPool implementation -*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a crude C++11 based thread pool.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+void ThreadPool::runTask(PackagedTaskTy &Task) {
+#ifndef _MSC_VER
+  Task();
+#else
+  Task(/* unused */ false);
+#endif
+
+  // Notify task completion, in case someone waits on ThreadPool::wait(). The
+  // lock makes sure that a waiter sees the count reach zero or is waiting.
+  if (--UnfinishedTasks == 0) {
+    std::unique_lock<std::mutex> LockGuard(CompletionLock);
+    CompletionCondition.notify_all();
+  }
+}
+
+void TaskGroup::finishTask() {
+  std::unique_lock<std::mutex> LockGuard(Lock);
+  if (--UnfinishedTasks == 0)
+    Condition.notify_all();
+}
+
+void TaskGroup::wait() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> LockGuard(Lock);
+      if (!UnfinishedTasks)
+        return;
+    }
+    // A worker helps with the work rather than block, as its queue may hold
+    // tasks of the group.
+    if (Pool.runPendingTask())
+      continue;
+    // The remaining tasks of the group are running on other threads.
+    std::unique_lock<std::mutex> LockGuard(Lock);
+    Condition.wait(LockGuard, [&] { return !UnfinishedTasks; });
+    return;
+  }
+}
+
+#if LLVM_ENABLE_THREADS
+
+/// The pool that the calling thread is a worker of, and its index there.
+static LLVM_THREAD_LOCAL ThreadPool *CurrentPool = nullptr;
+static LLVM_THREAD_LOCAL unsigned CurrentWorker = 0;
+
+// Default to std::thread::hardware_concurrency
+ThreadPool::ThreadPool() : ThreadPool(std::thread::hardware_concurrency()) {}
+
+ThreadPool::ThreadPool(unsigned ThreadCount)
+    : NextQueue(0), PendingTasks(0), EnableFlag(true), UnfinishedTasks(0),
+      ThreadCount(ThreadCount ? ThreadCount : 1) {
+  Queues.reserve(this->ThreadCount);
+  for (unsigned ThreadID = 0; ThreadID < this->ThreadCount; ++ThreadID)
+    Queues.emplace_back(new WorkerQueue());
+
+  // Create ThreadCount threads that will loop forever, running the tasks of
+  // their queue or stolen from others, and wait on QueueCondition for tasks
+  // to be queued or the Pool to be destroyed.
+  Threads.reserve(this->ThreadCount);
+  for (unsigned ThreadID = 0; ThreadID < this->ThreadCount; ++ThreadID) {
+    Threads.emplace_back([this, ThreadID] {
+      CurrentPool = this;
+      CurrentWorker = ThreadID;
+      while (true) {
+        PackagedTaskTy Task;
+        if (popTask(ThreadID, Task)) {
+          runTask(Task);
+          continue;
+        }
+        std::unique_lock<std::mutex> LockGuard(QueueLock);
+        // Wait for tasks to be pushed in a queue
+        QueueCondition.wait(LockGuard,
+                            [&] { return !EnableFlag || PendingTasks; });
+        // Exit condition
+        if (!EnableFlag && !PendingTasks)
+          return;
+      }
+    });
+  }
+}
+
+bool ThreadPool::popTask(unsigned Self, PackagedTaskTy &Task) {
+  // Take the newest task of our own queue, as it likely works on data that is
+  // still in the cache.
+  {
+    WorkerQueue &Queue = *Queues[Self];
+    std::unique_lock<std::mutex> LockGuard(Queue.Lock);
+    if (!Queue.Tasks.empty()) {
+      Task = std::move(Queue.Tasks.back());
+      Queue.Tasks.pop_back();
+      --PendingTasks;
+      return true;
+    }
+  }
+
+  // Otherwise steal the oldest task of another queue, starting with the next
+  // one so that the thieves spread over the queues.
+  for (unsigned I = 1; I != ThreadCount; ++I) {
+    WorkerQueue &Queue = *Queues[(Self + I) % ThreadCount];
+    std::unique_lock<std::mutex> LockGuard(Queue.Lock);
+    if (!Queue.Tasks.empty()) {
+      Task = std::move(Queue.Tasks.front());
+      Queue.Tasks.pop_front();
+      --PendingTasks;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::runPendingTask() {
+  // Other threads don't help, as a task may be waiting for them.
+  PackagedTaskTy Task;
+  if (CurrentPool != this || !popTask(CurrentWorker, Task))
+    return false;
+  runTask(Task);
+  return true;
+}
+
+void ThreadPool::wait() {
+  assert(CurrentPool != this && "Waiting on the pool from one of its tasks");
+  // Wait for all threads to complete and the queues to be empty
+  std::unique_lock<std::mutex> LockGuard(CompletionLock);
+  CompletionCondition.wait(LockGuard, [&] { return !UnfinishedTasks; });
+}
+
+std::shared_future<ThreadPool::VoidTy> ThreadPool::asyncImpl(TaskTy Task) {
+  /// Wrap the Task in a packaged_task to return a future object.
+  PackagedTaskTy PackagedTask(std::move(Task));
+  auto Future = PackagedTask.get_future();
+  ++UnfinishedTasks;
+  {
+    // Count the task before it can be taken, so that a worker that sees the
+    // task also sees the count.
+    std::unique_lock<std::mutex> LockGuard(QueueLock);
+
+    // Don't allow enqueueing after disabling the pool
+    assert(EnableFlag && "Queuing a thread during ThreadPool destruction");
+
+    ++PendingTasks;
+  }
+  {
+    // A worker keeps the tasks it submits, and the others are dealt in turn.
+    unsigned Index =
+        CurrentPool == this ? CurrentWorker : NextQueue++ % ThreadCount;
+    WorkerQueue &Queue = *Queues[Index];
+    std::unique_lock<std::mutex> LockGuard(Queue.Lock);
+    Queue.Tasks.push_back(std::move(PackagedTask));
+  }
+  QueueCondition.notify_one();
+  return Future.share();
+}
+
+// The destructor joins all threads, waiting for completion. The tasks may
+// still submit tasks until they are all done.
+ThreadPool::~ThreadPool() {
+  wait();
+  {
+    std::unique_lock<std::mutex> LockGuard(QueueLock);
+    EnableFlag = false;
+  }
+  QueueCondition.notify_all();
+  for (auto &Worker : Threads)
+    Worker.join();
+}
+
+#else // LLVM_ENABLE_THREADS Disabled
+
+ThreadPool::ThreadPool() : ThreadPool(0) {}
+
+// No threads are launched, issue a warning if ThreadCount is not 0
+ThreadPool::ThreadPool(unsigned ThreadCount)
+    : UnfinishedTasks(0), ThreadCount(1) {
+  if (ThreadCount) {
+    errs() << "Warning: request a ThreadPool with " << ThreadCount
+           << " threads, but LLVM_ENABLE_THREADS has been turned off\n";
+  }
+}
+
+bool ThreadPool::runPendingTask() {
+  if (Tasks.empty())
+    return false;
+  auto Task = std::move(Tasks.front());
+  Tasks.pop();
+  runTask(Task);
+  return true;
+}
+
+void ThreadPool::wait() {
+  // Sequential implementation running the tasks
+  while (runPendingTask())
+    ;
+}
+
+std::shared_future<ThreadPool::VoidTy> ThreadPool::asyncImpl(TaskTy Task) {
+#ifndef _MSC_VER
+  // Get a Future with launch::deferred execution using std::async
+  auto Future = std::async(std::launch::deferred, std::move(Task)).share();
+  // Wrap the future so that both ThreadPool::wait() can operate and the
+  // returned future can be sync'ed on.
+  PackagedTaskTy PackagedTask([Future]() { Future.get(); });
+#else
+  auto Future = std::async(std::launch::deferred, std::move(Task), false).share();
+  PackagedTaskTy PackagedTask([Future](bool) -> bool {
+    Future.get();
+    return false;
+  });
+#endif
+  ++UnfinishedTasks;
+  Tasks.push(std::move(PackagedTask));
+  return Future;
+}
+
+ThreadPool::~ThreadPool() {
+  wait();
+}
+
+#endif
@@ -24,6 +24,7 @@
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/MCInstrInfo.h"
 #include "llvm/MC/MCSectionMachO.h"
+#include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCTargetOptions.h"
 #include "llvm/MC/SectionKind.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -43,6 +44,7 @@ TargetMachine::TargetMachine(const Target &T, StringRef DataLayoutString,
     : TheTarget(T), DL(DataLayoutString), TargetTriple(TT), TargetCPU(CPU),
       TargetFS(FS), CodeGenInfo(nullptr), AsmInfo(nullptr), MRI(nullptr),
       MII(nullptr), STI(nullptr), RequireStructuredCFG(false),
+      FirstFunctionNumber(0), LastCodeGenPart(true),
       Options(Options) {}
 
 TargetMachine::~TargetMachine() {
@@ -154,6 +156,12 @@ TargetIRAnalysis TargetMachine::getTargetIRAnalysis() {
       [this](Function &) { return TargetTransformInfo(getDataLayout()); });
 }
 
+std::unique_ptr<MCStreamer>
+TargetMachine::createMCStreamer(raw_pwrite_stream &, CodeGenFileType,
+                                MCContext &) {
+  return nullptr;
+}
+
 static bool canUsePrivateLabel(const MCAsmInfo &AsmInfo,
                                const MCSection &Section) {
   if (!AsmInfo.isSectionAtomizableBySymbols(Section))
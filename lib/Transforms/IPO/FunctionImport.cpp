@@ -0,0 +1,296 @@
+//===- FunctionImport.cpp - ThinLTO Summary-based Function Import ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements Function import based on summaries.
+//
+// Starting from the functions the module declares and uses, the importer walks
+// the call graph recorded in the combined function summary index and selects
+// small definitions living in other modules. Each source module is then loaded
+// lazily, reduced to the selected functions and linked into the destination
+// module, where the imported functions are then made available_externally.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/FunctionImport.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/FunctionInfo.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "function-import"
+
+STATISTIC(NumImported, "Number of functions imported");
+
+/// Limit on instruction count of imported functions.
+static cl::opt<unsigned> ImportInstrLimit(
+    "import-instr-limit", cl::init(100), cl::Hidden, cl::value_desc("N"),
+    cl::desc("Only import functions with less than N instructions"));
+
+/// Select the definition of \p Name to import into the module \p DestModPath,
+/// or return null if no suitable definition is known.
+static const FunctionSummary *selectCallee(const FunctionInfoIndex &Index,
+                                           StringRef Name,
+                                           StringRef DestModPath) {
+  const FunctionSummaryList *Summaries = Index.findFunctionSummaries(Name);
+  if (!Summaries)
+    return nullptr;
+  for (const auto &Summary : *Summaries) {
+    if (Summary->modulePath() == DestModPath)
+      continue;
+    if (!Summary->isEligibleForImport() ||
+        Summary->instCount() > ImportInstrLimit)
+      continue;
+    return Summary.get();
+  }
+  return nullptr;
+}
+
+/// Strip \p SrcM down to the definitions in \p FunctionsToImport. Everything
+/// else is turned into a declaration or removed, so that linking the module
+/// only adds the imported bodies. The linker doesn't replace a declaration by
+/// an available_externally definition, so the imported functions keep their
+/// linkage until they are linked.
+static std::error_code
+prepareModuleForImport(Module &SrcM, const StringSet<> &FunctionsToImport) {
+  if (std::error_code EC = SrcM.materializeMetadata())
+    return EC;
+
+  for (Function &F : SrcM) {
+    if (F.isDeclaration())
+      continue;
+    F.setComdat(nullptr);
+    if (!FunctionsToImport.count(F.getName())) {
+      F.deleteBody();
+      continue;
+    }
+    if (std::error_code EC = F.materialize())
+      return EC;
+  }
+
+  for (GlobalVariable &GV : SrcM.globals()) {
+    if (GV.isDeclaration())
+      continue;
+    GV.setInitializer(nullptr);
+    GV.setLinkage(GlobalValue::ExternalLinkage);
+    GV.setComdat(nullptr);
+  }
+
+  // Aliases cannot be declarations: replace the ones still referenced with a
+  // declaration of the aliasee's type.
+  for (auto I = SrcM.alias_begin(), E = SrcM.alias_end(); I != E;) {
+    GlobalAlias &GA = *I++;
+    if (!GA.use_empty()) {
+      Type *Ty = GA.getType()->getElementType();
+      GlobalValue *Decl;
+      if (auto *FTy = dyn_cast<FunctionType>(Ty))
+        Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", &SrcM);
+      else
+        Decl = new GlobalVariable(SrcM, Ty, /*isConstant=*/false,
+                                  GlobalValue::ExternalLinkage, nullptr, "");
+      Decl->takeName(&GA);
+      GA.replaceAllUsesWith(
+          ConstantExpr::getPointerBitCastOrAddrSpaceCast(Decl, GA.getType()));
+    }
+    GA.eraseFromParent();
+  }
+
+  for (auto I = SrcM.begin(), E = SrcM.end(); I != E;) {
+    Function &F = *I++;
+    F.removeDeadConstantUsers();
+    if (F.isDeclaration() && F.use_empty())
+      F.eraseFromParent();
+  }
+  for (auto I = SrcM.global_begin(), E = SrcM.global_end(); I != E;) {
+    GlobalVariable &GV = *I++;
+    GV.removeDeadConstantUsers();
+    if (GV.use_empty())
+      GV.eraseFromParent();
+  }
+
+  // Only the module flags are needed to link the module.
+  NamedMDNode *ModFlags = SrcM.getModuleFlagsMetadata();
+  for (auto I = SrcM.named_metadata_begin(), E = SrcM.named_metadata_end();
+       I != E;) {
+    NamedMDNode &NMD = *I++;
+    if (&NMD != ModFlags)
+      SrcM.eraseNamedMetadata(&NMD);
+  }
+  SrcM.getComdatSymbolTable().clear();
+  SrcM.setModuleInlineAsm("");
+  return std::error_code();
+}
+
+bool FunctionImporter::importFunctions(Module &DestModule) {
+  DEBUG(dbgs() << "Starting import for Module "
+               << DestModule.getModuleIdentifier() << "\n");
+
+  // Compute the transitive set of functions to import, grouped by the module
+  // defining them. The callees of an imported function are visited as well,
+  // since the inliner may expose them after importing.
+  StringMap<StringSet<>> ModuleToFunctionsToImport;
+  SmallVector<StringRef, 64> Worklist;
+  StringSet<> Visited;
+  for (Function &F : DestModule)
+    if (F.isDeclaration() && F.hasName() && !F.isIntrinsic() && !F.use_empty())
+      Worklist.push_back(F.getName());
+
+  while (!Worklist.empty()) {
+    StringRef Name = Worklist.pop_back_val();
+    if (!Visited.insert(Name).second)
+      continue;
+
+    const FunctionSummary *Summary =
+        selectCallee(Index, Name, DestModule.getModuleIdentifier());
+    if (!Summary) {
+      DEBUG(dbgs() << "Ignoring " << Name << "\n");
+      continue;
+    }
+    DEBUG(dbgs() << "Importing " << Name << " from " << Summary->modulePath()
+                 << "\n");
+    ModuleToFunctionsToImport[Summary->modulePath()].insert(Name);
+
+    for (StringRef Callee : Summary->callees()) {
+      Function *F = DestModule.getFunction(Callee);
+      if (!F || F->isDeclaration())
+        Worklist.push_back(Callee);
+    }
+  }
+
+  bool Changed = false;
+  for (auto &ModuleFunctions : ModuleToFunctionsToImport) {
+    StringRef SrcPath = ModuleFunctions.first();
+    std::unique_ptr<Module> SrcModule = ModuleLoader(SrcPath);
+    if (!SrcModule) {
+      DEBUG(dbgs() << "Cannot load " << SrcPath << ", skipping\n");
+      continue;
+    }
+
+    const StringSet<> &FunctionsToImport = ModuleFunctions.second;
+    if (std::error_code EC =
+            prepareModuleForImport(*SrcModule, FunctionsToImport))
+      report_fatal_error("Error while importing from " + SrcPath + ": " +
+                         EC.message());
+
+    if (Linker::LinkModules(&DestModule, SrcModule.get()))
+      report_fatal_error("Function Import: link error");
+
+    // The module still defines the imported functions in its own object file.
+    for (const auto &Name : FunctionsToImport)
+      if (Function *F = DestModule.getFunction(Name.first()))
+        F->setLinkage(GlobalValue::AvailableExternallyLinkage);
+
+    NumImported += FunctionsToImport.size();
+    Changed = true;
+  }
+
+  return Changed;
+}
+
+/// Summary file to use for function importing when using -function-import from
+/// the command line.
+static cl::opt<std::string>
+    SummaryFile("summary-file",
+                cl::desc("The summary file to use for function importing."));
+
+static void diagnosticHandler(const DiagnosticInfo &DI) {
+  raw_ostream &OS = errs();
+  DiagnosticPrinterRawOStream DP(OS);
+  DI.print(DP);
+  OS << '\n';
+}
+
+/// Parse the function index out of an IR file and return the function
+/// index object if found, or nullptr if not.
+static std::unique_ptr<FunctionInfoIndex>
+getFunctionIndexForFile(StringRef Path, std::string &Error) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
+      MemoryBuffer::getFileOrSTDIN(Path);
+  if (std::error_code EC = FileOrErr.getError()) {
+    Error = EC.message();
+    return nullptr;
+  }
+  ErrorOr<std::unique_ptr<FunctionInfoIndex>> IndexOrErr =
+      getFunctionInfoIndex((*FileOrErr)->getMemBufferRef(), diagnosticHandler);
+  if (std::error_code EC = IndexOrErr.getError()) {
+    Error = EC.message();
+    return nullptr;
+  }
+  return std::move(*IndexOrErr);
+}
+
+namespace {
+/// Pass that performs cross-module function import provided a summary file.
+class FunctionImportPass : public ModulePass {
+  /// Optional function summary index to use for importing, otherwise
+  /// the summary-file option must be specified.
+  const FunctionInfoIndex *Index;
+
+  /// Index loaded from -summary-file, when no index was provided.
+  std::unique_ptr<FunctionInfoIndex> IndexFromFile;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit FunctionImportPass(const FunctionInfoIndex *Index = nullptr)
+      : ModulePass(ID), Index(Index) {
+    initializeFunctionImportPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  const char *getPassName() const override { return "Function Importing"; }
+
+  bool runOnModule(Module &M) override {
+    if (!Index) {
+      if (SummaryFile.empty())
+        report_fatal_error("error: -function-import requires -summary-file "
+                           "or a file containing the summary index\n");
+      std::string Error;
+      IndexFromFile = getFunctionIndexForFile(SummaryFile, Error);
+      if (!IndexFromFile)
+        report_fatal_error("Error loading file '" + SummaryFile + "': " +
+                           Error + "\n");
+      Index = IndexFromFile.get();
+    }
+
+    // Source modules are loaded lazily in the context of the destination
+    // module so that only the imported bodies are materialized.
+    LLVMContext &Ctx = M.getContext();
+    auto ModuleLoader = [&Ctx](StringRef Path) -> std::unique_ptr<Module> {
+      SMDiagnostic Err;
+      std::unique_ptr<Module> Result = getLazyIRFileModule(Path, Err, Ctx);
+      if (!Result)
+        Err.print("function-import", errs());
+      return Result;
+    };
+
+    FunctionImporter Importer(*Index, ModuleLoader);
+    return Importer.importFunctions(M);
+  }
+};
+} // anonymous namespace
+
+char FunctionImportPass::ID = 0;
+INITIALIZE_PASS(FunctionImportPass, "function-import",
+                "Summary Based Function Import", false, false)
+
+ModulePass *llvm::createFunctionImportPass(const FunctionInfoIndex *Index) {
+  return new FunctionImportPass(Index);
+}
@@ -74,6 +74,13 @@ STATISTIC(NumSunkInst , "Number of instructions sunk");
 STATISTIC(NumExpand,    "Number of expansions");
 STATISTIC(NumFactor   , "Number of factorizations");
 STATISTIC(NumReassoc  , "Number of reassociations");
+STATISTIC(NumIncrementalRuns, "Number of runs on the changed insts only");
+STATISTIC(NumChangedInsts, "Number of changed insts visited");
+
+static cl::opt<bool>
+IncrementalInstCombine("instcombine-incremental", cl::init(false),
+                       cl::desc("Only combine the instructions that changed "
+                                "since instcombine last ran on a function"));
 
 Value *InstCombiner::EmitGEPOffset(User *GEP) {
   return llvm::EmitGEPOffset(Builder, DL, GEP);
@@ -2807,6 +2814,36 @@ bool InstCombiner::run() {
   return MadeIRChange;
 }
 
+/// addReachableSuccessors - Add the successors of TI that can be reached to
+/// Worklist.  If TI is a branch or switch on a constant, that is only the
+/// successor it takes.
+static void addReachableSuccessors(TerminatorInst *TI,
+                                   SmallVectorImpl<BasicBlock *> &Worklist) {
+  if (BranchInst *BI = dyn_cast<BranchInst>(TI)) {
+    if (BI->isConditional() && isa<ConstantInt>(BI->getCondition())) {
+      bool CondVal = cast<ConstantInt>(BI->getCondition())->getZExtValue();
+      BasicBlock *ReachableBB = BI->getSuccessor(!CondVal);
+      Worklist.push_back(ReachableBB);
+      return;
+    }
+  } else if (SwitchInst *SI = dyn_cast<SwitchInst>(TI)) {
+    if (ConstantInt *Cond = dyn_cast<ConstantInt>(SI->getCondition())) {
+      // See if this is an explicit destination.
+      for (SwitchInst::CaseIt i = SI->case_begin(), e = SI->case_end();
+           i != e; ++i)
+        if (i.getCaseValue() == Cond)
+          Worklist.push_back(i.getCaseSuccessor());
+
+      // Otherwise it is the default destination.
+      Worklist.push_back(SI->getDefaultDest());
+      return;
+    }
+  }
+
+  for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i)
+    Worklist.push_back(TI->getSuccessor(i));
+}
+
 /// AddReachableCodeToWorklist - Walk the function in depth-first order, adding
 /// all reachable code to the worklist.
 ///
@@ -2880,33 +2917,7 @@ static bool AddReachableCodeToWorklist(BasicBlock *BB, const DataLayout &DL,
 
     // Recursively visit successors.  If this is a branch or switch on a
     // constant, only visit the reachable successor.
-    TerminatorInst *TI = BB->getTerminator();
-    if (BranchInst *BI = dyn_cast<BranchInst>(TI)) {
-      if (BI->isConditional() && isa<ConstantInt>(BI->getCondition())) {
-        bool CondVal = cast<ConstantInt>(BI->getCondition())->getZExtValue();
-        BasicBlock *ReachableBB = BI->getSuccessor(!CondVal);
-        Worklist.push_back(ReachableBB);
-        continue;
-      }
-    } else if (SwitchInst *SI = dyn_cast<SwitchInst>(TI)) {
-      if (ConstantInt *Cond = dyn_cast<ConstantInt>(SI->getCondition())) {
-        // See if this is an explicit destination.
-        for (SwitchInst::CaseIt i = SI->case_begin(), e = SI->case_end();
-             i != e; ++i)
-          if (i.getCaseValue() == Cond) {
-            BasicBlock *ReachableBB = i.getCaseSuccessor();
-            Worklist.push_back(ReachableBB);
-            continue;
-          }
-
-        // Otherwise it is the default destination.
-        Worklist.push_back(SI->getDefaultDest());
-        continue;
-      }
-    }
-
-    for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i)
-      Worklist.push_back(TI->getSuccessor(i));
+    addReachableSuccessors(BB->getTerminator(), Worklist);
   } while (!Worklist.empty());
 
   // Once we've found all of the instructions to add to instcombine's worklist,
@@ -2968,6 +2979,39 @@ static bool prepareICWorklistFromFunction(Function &F, const DataLayout &DL,
   return MadeIRChange;
 }
 
+/// \brief Populate the IC worklist with the instructions of a function that
+/// changed since instcombine last ran on it.
+///
+/// The instructions in blocks that are not reachable are left alone. If such
+/// a block has instructions other than its terminator, nothing is added and
+/// false is returned: the function has to be swept as a whole, so that they
+/// are deleted before instcombine could trip over them.
+static bool prepareICWorklistFromChanges(Function &F,
+                                         ArrayRef<Instruction *> Changed,
+                                         InstCombineWorklist &ICWorklist) {
+  SmallPtrSet<BasicBlock *, 64> Visited;
+  SmallVector<BasicBlock *, 256> Worklist;
+  Worklist.push_back(F.begin());
+  do {
+    BasicBlock *BB = Worklist.pop_back_val();
+    if (Visited.insert(BB).second)
+      addReachableSuccessors(BB->getTerminator(), Worklist);
+  } while (!Worklist.empty());
+
+  for (BasicBlock &BB : F)
+    if (!Visited.count(&BB) && &BB.front() != BB.getTerminator())
+      return false;
+
+  SmallVector<Instruction *, 128> InstrsForInstCombineWorklist;
+  for (Instruction *I : Changed)
+    if (Visited.count(I->getParent()))
+      InstrsForInstCombineWorklist.push_back(I);
+  NumChangedInsts += InstrsForInstCombineWorklist.size();
+  ICWorklist.AddInitialGroup(InstrsForInstCombineWorklist.data(),
+                             InstrsForInstCombineWorklist.size());
+  return true;
+}
+
 static bool
 combineInstructionsOverFunction(Function &F, InstCombineWorklist &Worklist,
                                 AssumptionCache &AC, TargetLibraryInfo &TLI,
@@ -2981,9 +3025,35 @@ combineInstructionsOverFunction(Function &F, InstCombineWorklist &Worklist,
   IRBuilder<true, TargetFolder, InstCombineIRInserter> Builder(
       F.getContext(), TargetFolder(DL), InstCombineIRInserter(Worklist, &AC));
 
+  // If instcombine ran on the function before, and the changes since were
+  // tracked, only the instructions that changed need to be looked at.
+  std::vector<Instruction *> ChangedInsts;
+  bool Incremental = IncrementalInstCombine && F.isTrackingChanges();
+  if (Incremental) {
+    F.takeChangedInstructions(ChangedInsts);
+    if (ChangedInsts.empty())
+      return false;
+    // After a full run, only new code can have dbg.declare intrinsics.
+    // Lowering them deletes them, so leave that to a full run as well.
+    if (std::any_of(ChangedInsts.begin(), ChangedInsts.end(),
+                    [](Instruction *I) { return isa<DbgDeclareInst>(I); }))
+      Incremental = false;
+  }
+
   // Lower dbg.declare intrinsics otherwise their value may be clobbered
   // by instcombiner.
-  bool DbgDeclaresChanged = LowerDbgDeclare(F);
+  bool DbgDeclaresChanged = !Incremental && LowerDbgDeclare(F);
+
+  if (Incremental && prepareICWorklistFromChanges(F, ChangedInsts, Worklist)) {
+    DEBUG(dbgs() << "\n\nINSTCOMBINE INCREMENTAL RUN on " << F.getName()
+                 << "\n");
+    ++NumIncrementalRuns;
+    InstCombiner IC(Worklist, &Builder, MinimizeSize, &AC, &TLI, &DT, DL, LI);
+    bool MadeIRChange = IC.run();
+    // The worklist followed the changes instcombine made itself.
+    F.startTrackingChanges();
+    return DbgDeclaresChanged || MadeIRChange;
+  }
 
   // Iterate while there is work to do.
   int Iteration = 0;
@@ -3004,6 +3074,10 @@ combineInstructionsOverFunction(Function &F, InstCombineWorklist &Worklist,
       break;
   }
 
+  // Let the next run start from what changes after this one.
+  if (IncrementalInstCombine)
+    F.startTrackingChanges();
+
   return DbgDeclaresChanged || Iteration > 1;
 }
 
@@ -3043,6 +3117,7 @@ public:
 
   void getAnalysisUsage(AnalysisUsage &AU) const override;
   bool runOnFunction(Function &F) override;
+  bool doFinalization(Module &M) override;
 };
 }
 
@@ -3070,6 +3145,15 @@ bool InstructionCombiningPass::runOnFunction(Function &F) {
   return combineInstructionsOverFunction(F, Worklist, AC, TLI, DT, LI);
 }
 
+bool InstructionCombiningPass::doFinalization(Module &M) {
+  // The changes are only tracked for the later runs of instcombine in the
+  // same pipeline. Setting uses is slower while any function is tracked.
+  if (IncrementalInstCombine)
+    for (Function &F : M)
+      F.stopTrackingChanges();
+  return false;
+}
+
 char InstructionCombiningPass::ID = 0;
 INITIALIZE_PASS_BEGIN(InstructionCombiningPass, "instcombine",
                       "Combine redundant instructions", false, false)
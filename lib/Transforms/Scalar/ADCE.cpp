@@ -40,6 +40,8 @@ struct ADCE : public FunctionPass {
 
   bool runOnFunction(Function& F) override;
 
+  FunctionPass *createParallelCopy() const override { return new ADCE(); }
+
   void getAnalysisUsage(AnalysisUsage& AU) const override {
     AU.setPreservesCFG();
   }
@@ -42,6 +42,10 @@ namespace {
 
     bool runOnFunction(Function &F) override;
 
+    FunctionPass *createParallelCopy() const override {
+      return new ConstantPropagation();
+    }
+
     void getAnalysisUsage(AnalysisUsage &AU) const override {
       AU.setPreservesCFG();
       AU.addRequired<TargetLibraryInfoWrapperPass>();
@@ -83,6 +83,8 @@ namespace {
 
     bool runOnFunction(Function &F) override;
 
+    FunctionPass *createParallelCopy() const override { return new DCE(); }
+
     void getAnalysisUsage(AnalysisUsage &AU) const override {
       AU.setPreservesCFG();
     }
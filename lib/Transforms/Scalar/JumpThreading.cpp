@@ -24,7 +24,9 @@
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/Analysis/Loads.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
@@ -80,6 +82,7 @@ namespace {
   class JumpThreading : public FunctionPass {
     TargetLibraryInfo *TLI;
     LazyValueInfo *LVI;
+    DominatorTree *DT;
 #ifdef NDEBUG
     SmallPtrSet<BasicBlock*, 16> LoopHeaders;
 #else
@@ -115,9 +118,12 @@ namespace {
       AU.addRequired<LazyValueInfo>();
       AU.addPreserved<LazyValueInfo>();
       AU.addRequired<TargetLibraryInfoWrapperPass>();
+      AU.addPreserved<DominatorTreeWrapperPass>();
     }
 
     void FindLoopHeaders(Function &F);
+    void UpdateDomTreeForNewSuccessors(BasicBlock *BB,
+                                       ArrayRef<BasicBlock *> OldSuccs);
     bool ProcessBlock(BasicBlock *BB);
     bool ThreadEdge(BasicBlock *BB, const SmallVectorImpl<BasicBlock*> &PredBBs,
                     BasicBlock *SuccBB);
@@ -160,6 +166,9 @@ bool JumpThreading::runOnFunction(Function &F) {
   DEBUG(dbgs() << "Jump threading on function '" << F.getName() << "'\n");
   TLI = &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
   LVI = &getAnalysis<LazyValueInfo>();
+  DominatorTreeWrapperPass *DTWP =
+      getAnalysisIfAvailable<DominatorTreeWrapperPass>();
+  DT = DTWP ? &DTWP->getDomTree() : nullptr;
 
   // Remove unreachable blocks from function as they may result in infinite
   // loop. We do threading if we found something profitable. Jump threading a
@@ -167,8 +176,11 @@ bool JumpThreading::runOnFunction(Function &F) {
   // i.e. if any jump treading is undoing previous threading in the path, then
   // we will loop forever. We take care of this issue by not jump threading for
   // back edges. This works for normal cases but not for unreachable blocks as
-  // they may have cycle with no back edge.
-  removeUnreachableBlocks(F);
+  // they may have cycle with no back edge. This also cuts off blocks that
+  // follow calls that can't return, so the dominator tree is rebuilt if
+  // anything changed.
+  if (removeUnreachableBlocks(F) && DT)
+    DT->recalculate(F);
 
   FindLoopHeaders(F);
 
@@ -216,7 +228,7 @@ bool JumpThreading::runOnFunction(Function &F) {
         // awesome, but it allows us to use AssertingVH to prevent nasty
         // dangling pointer issues within LazyValueInfo.
         LVI->eraseBlock(BB);
-        if (TryToSimplifyUncondBranchFromEmptyBlock(BB)) {
+        if (TryToSimplifyUncondBranchFromEmptyBlock(BB, DT)) {
           Changed = true;
           // If we deleted BB and BB was the header of a loop, then the
           // successor is now the header of the loop.
@@ -234,6 +246,29 @@ bool JumpThreading::runOnFunction(Function &F) {
   return EverChanged;
 }
 
+/// UpdateDomTreeForNewSuccessors - The successors of BB changed from OldSuccs to
+/// its current ones. Tell the dominator tree, if there is one, about the edges
+/// that were added and removed.
+void JumpThreading::UpdateDomTreeForNewSuccessors(
+    BasicBlock *BB, ArrayRef<BasicBlock *> OldSuccs) {
+  if (!DT)
+    return;
+
+  SmallPtrSet<BasicBlock *, 8> Old(OldSuccs.begin(), OldSuccs.end());
+  SmallPtrSet<BasicBlock *, 8> New(succ_begin(BB), succ_end(BB));
+  SmallVector<DominatorTree::UpdateType, 8> Updates;
+  SmallPtrSet<BasicBlock *, 8> Seen;
+  for (BasicBlock *Succ : OldSuccs)
+    if (!New.count(Succ) && Seen.insert(Succ).second)
+      Updates.push_back(
+          DominatorTree::UpdateType(DominatorTree::Delete, BB, Succ));
+  for (BasicBlock *Succ : successors(BB))
+    if (!Old.count(Succ) && Seen.insert(Succ).second)
+      Updates.push_back(
+          DominatorTree::UpdateType(DominatorTree::Insert, BB, Succ));
+  DT->applyUpdates(Updates);
+}
+
 /// getJumpThreadDuplicationCost - Return the cost of duplicating this block to
 /// thread across it. Stop scanning the block when passing the threshold.
 static unsigned getJumpThreadDuplicationCost(const BasicBlock *BB,
@@ -676,7 +711,7 @@ bool JumpThreading::ProcessBlock(BasicBlock *BB) {
         LoopHeaders.insert(BB);
 
       LVI->eraseBlock(SinglePred);
-      MergeBasicBlockIntoOnlyPred(BB);
+      MergeBasicBlockIntoOnlyPred(BB, DT);
 
       return true;
     }
@@ -723,6 +758,7 @@ bool JumpThreading::ProcessBlock(BasicBlock *BB) {
 
     // Fold the branch/switch.
     TerminatorInst *BBTerm = BB->getTerminator();
+    SmallVector<BasicBlock *, 8> OldSuccs(succ_begin(BB), succ_end(BB));
     for (unsigned i = 0, e = BBTerm->getNumSuccessors(); i != e; ++i) {
       if (i == BestSucc) continue;
       BBTerm->getSuccessor(i)->removePredecessor(BB, true);
@@ -732,6 +768,7 @@ bool JumpThreading::ProcessBlock(BasicBlock *BB) {
           << "' folding undef terminator: " << *BBTerm << '\n');
     BranchInst::Create(BBTerm->getSuccessor(BestSucc), BBTerm);
     BBTerm->eraseFromParent();
+    UpdateDomTreeForNewSuccessors(BB, OldSuccs);
     return true;
   }
 
@@ -742,7 +779,9 @@ bool JumpThreading::ProcessBlock(BasicBlock *BB) {
     DEBUG(dbgs() << "  In block '" << BB->getName()
           << "' folding terminator: " << *BB->getTerminator() << '\n');
     ++NumFolds;
+    SmallVector<BasicBlock *, 8> OldSuccs(succ_begin(BB), succ_end(BB));
     ConstantFoldTerminator(BB, true);
+    UpdateDomTreeForNewSuccessors(BB, OldSuccs);
     return true;
   }
 
@@ -771,9 +810,12 @@ bool JumpThreading::ProcessBlock(BasicBlock *BB) {
       if (Ret != LazyValueInfo::Unknown) {
         unsigned ToRemove = Ret == LazyValueInfo::True ? 1 : 0;
         unsigned ToKeep = Ret == LazyValueInfo::True ? 0 : 1;
+        BasicBlock *OldSuccs[] = {CondBr->getSuccessor(0),
+                                  CondBr->getSuccessor(1)};
         CondBr->getSuccessor(ToRemove)->removePredecessor(BB, true);
         BranchInst::Create(CondBr->getSuccessor(ToKeep), CondBr);
         CondBr->eraseFromParent();
+        UpdateDomTreeForNewSuccessors(BB, OldSuccs);
         if (CondCmp->use_empty())
           CondCmp->eraseFromParent();
         else if (CondCmp->getParent() == BB) {
@@ -969,7 +1011,8 @@ bool JumpThreading::SimplifyPartiallyRedundantLoad(LoadInst *LI) {
 
     // Split them out to their own block.
     UnavailablePred =
-      SplitBlockPredecessors(LoadBB, PredsToSplit, "thread-pre-split");
+      SplitBlockPredecessors(LoadBB, PredsToSplit, "thread-pre-split",
+                             /*AliasAnalysis*/ nullptr, DT);
   }
 
   // If the value isn't available in all predecessors, then there will be
@@ -1394,7 +1437,8 @@ bool JumpThreading::ThreadEdge(BasicBlock *BB,
   else {
     DEBUG(dbgs() << "  Factoring out " << PredBBs.size()
           << " common predecessors.\n");
-    PredBB = SplitBlockPredecessors(BB, PredBBs, ".thr_comm");
+    PredBB = SplitBlockPredecessors(BB, PredBBs, ".thr_comm",
+                                    /*AliasAnalysis*/ nullptr, DT);
   }
 
   // And finally, do it!
@@ -1494,6 +1538,15 @@ bool JumpThreading::ThreadEdge(BasicBlock *BB,
       PredTerm->setSuccessor(i, NewBB);
     }
 
+  // PredBB now reaches SuccBB through NewBB, and no longer reaches BB directly.
+  if (DT) {
+    DominatorTree::UpdateType Updates[] = {
+        DominatorTree::UpdateType(DominatorTree::Insert, NewBB, SuccBB),
+        DominatorTree::UpdateType(DominatorTree::Insert, PredBB, NewBB),
+        DominatorTree::UpdateType(DominatorTree::Delete, PredBB, BB)};
+    DT->applyUpdates(Updates);
+  }
+
   // At this point, the IR is fully up to date and consistent.  Do a quick scan
   // over the new instructions and zap any that are constants or dead.  This
   // frequently happens because of phi translation.
@@ -1537,7 +1590,8 @@ bool JumpThreading::DuplicateCondBranchOnPHIIntoPred(BasicBlock *BB,
   else {
     DEBUG(dbgs() << "  Factoring out " << PredBBs.size()
           << " common predecessors.\n");
-    PredBB = SplitBlockPredecessors(BB, PredBBs, ".thr_comm");
+    PredBB = SplitBlockPredecessors(BB, PredBBs, ".thr_comm",
+                                    /*AliasAnalysis*/ nullptr, DT);
   }
 
   // Okay, we decided to do this!  Clone all the instructions in BB onto the end
@@ -1551,7 +1605,7 @@ bool JumpThreading::DuplicateCondBranchOnPHIIntoPred(BasicBlock *BB,
   BranchInst *OldPredBranch = dyn_cast<BranchInst>(PredBB->getTerminator());
 
   if (!OldPredBranch || !OldPredBranch->isUnconditional()) {
-    PredBB = SplitEdge(PredBB, BB);
+    PredBB = SplitEdge(PredBB, BB, DT);
     OldPredBranch = cast<BranchInst>(PredBB->getTerminator());
   }
 
@@ -1642,6 +1696,7 @@ bool JumpThreading::DuplicateCondBranchOnPHIIntoPred(BasicBlock *BB,
 
   // Remove the unconditional branch at the end of the PredBB block.
   OldPredBranch->eraseFromParent();
+  UpdateDomTreeForNewSuccessors(PredBB, BB);
 
   ++NumDupes;
   return true;
@@ -1719,6 +1774,10 @@ bool JumpThreading::TryToUnfoldSelect(CmpInst *CondCmp, BasicBlock *BB) {
            PHINode *Phi = dyn_cast<PHINode>(BI); ++BI)
         if (Phi != CondLHS)
           Phi->addIncoming(Phi->getIncomingValueForBlock(Pred), NewBB);
+
+      // NewBB is only reached from Pred, which already reached BB.
+      if (DT)
+        DT->addNewBlock(NewBB, Pred);
       return true;
     }
   }
@@ -206,7 +206,7 @@ namespace {
     void EmitPreheaderBranchOnCondition(Value *LIC, Constant *Val,
                                         BasicBlock *TrueDest,
                                         BasicBlock *FalseDest,
-                                        Instruction *InsertPt);
+                                        BranchInst *OldBranch);
 
     void SimplifyCode(std::vector<Instruction*> &Worklist, Loop *L);
     bool IsTrivialUnswitchCondition(Value *Cond, Constant **Val = nullptr,
@@ -394,7 +394,6 @@ bool LoopUnswitch::runOnLoop(Loop *L, LPPassManager &LPM_Ref) {
       getAnalysisIfAvailable<DominatorTreeWrapperPass>();
   DT = DTWP ? &DTWP->getDomTree() : nullptr;
   currentLoop = L;
-  Function *F = currentLoop->getHeader()->getParent();
   bool Changed = false;
   do {
     assert(currentLoop->isLCSSAForm(*DT));
@@ -402,11 +401,6 @@ bool LoopUnswitch::runOnLoop(Loop *L, LPPassManager &LPM_Ref) {
     Changed |= processCurrentLoop();
   } while(redoLoop);
 
-  if (Changed) {
-    // FIXME: Reconstruct dom info, because it is not preserved properly.
-    if (DT)
-      DT->recalculate(*F);
-  }
   return Changed;
 }
 
@@ -686,30 +680,54 @@ static Loop *CloneLoop(Loop *L, Loop *PL, ValueToValueMapTy &VM,
 }
 
 /// EmitPreheaderBranchOnCondition - Emit a conditional branch on two values
-/// if LIC == Val, branch to TrueDst, otherwise branch to FalseDest.  Insert the
-/// code immediately before InsertPt.
+/// if LIC == Val, branch to TrueDst, otherwise branch to FalseDest.  The branch
+/// replaces the unconditional branch OldBranch.
 void LoopUnswitch::EmitPreheaderBranchOnCondition(Value *LIC, Constant *Val,
                                                   BasicBlock *TrueDest,
                                                   BasicBlock *FalseDest,
-                                                  Instruction *InsertPt) {
+                                                  BranchInst *OldBranch) {
+  assert(OldBranch->isUnconditional() && "Preheader is not split correctly");
   // Insert a conditional branch on LIC to the two preheaders.  The original
   // code is the true version and the new code is the false version.
   Value *BranchVal = LIC;
   if (!isa<ConstantInt>(Val) ||
       Val->getType() != Type::getInt1Ty(LIC->getContext()))
-    BranchVal = new ICmpInst(InsertPt, ICmpInst::ICMP_EQ, LIC, Val);
+    BranchVal = new ICmpInst(OldBranch, ICmpInst::ICMP_EQ, LIC, Val);
   else if (Val != ConstantInt::getTrue(Val->getContext()))
     // We want to enter the new loop when the condition is true.
     std::swap(TrueDest, FalseDest);
 
   // Insert the new branch.
-  BranchInst *BI = BranchInst::Create(TrueDest, FalseDest, BranchVal, InsertPt);
+  BasicBlock *OldBranchSucc = OldBranch->getSuccessor(0);
+  BasicBlock *OldBranchParent = OldBranch->getParent();
+  BranchInst *BI = BranchInst::Create(TrueDest, FalseDest, BranchVal, OldBranch);
 
   // If either edge is critical, split it. This helps preserve LoopSimplify
-  // form for enclosing loops.
-  auto Options = CriticalEdgeSplittingOptions(DT, LI).setPreserveLCSSA();
+  // form for enclosing loops. The dominator tree is updated for all of the new
+  // edges at once below.
+  auto Options = CriticalEdgeSplittingOptions(nullptr, LI).setPreserveLCSSA();
   SplitCriticalEdge(BI, 0, Options);
   SplitCriticalEdge(BI, 1, Options);
+
+  LPM->deleteSimpleAnalysisValue(OldBranch, currentLoop);
+  OldBranch->eraseFromParent();
+
+  // The new edges may make the cloned loop reachable.
+  if (DT) {
+    SmallVector<DominatorTree::UpdateType, 3> Updates;
+    bool KeepsOldSucc = false;
+    for (BasicBlock *Succ : successors(OldBranchParent)) {
+      if (Succ == OldBranchSucc)
+        KeepsOldSucc = true;
+      else
+        Updates.push_back(DominatorTree::UpdateType(DominatorTree::Insert,
+                                                    OldBranchParent, Succ));
+    }
+    if (!KeepsOldSucc)
+      Updates.push_back(DominatorTree::UpdateType(
+          DominatorTree::Delete, OldBranchParent, OldBranchSucc));
+    DT->applyUpdates(Updates);
+  }
 }
 
 /// UnswitchTrivialCondition - Given a loop that has a trivial unswitchable
@@ -743,10 +761,9 @@ void LoopUnswitch::UnswitchTrivialCondition(Loop *L, Value *Cond,
 
   // Okay, now we have a position to branch from and a position to branch to,
   // insert the new conditional branch.
-  EmitPreheaderBranchOnCondition(Cond, Val, NewExit, NewPH,
-                                 loopPreheader->getTerminator());
-  LPM->deleteSimpleAnalysisValue(loopPreheader->getTerminator(), L);
-  loopPreheader->getTerminator()->eraseFromParent();
+  EmitPreheaderBranchOnCondition(
+      Cond, Val, NewExit, NewPH,
+      cast<BranchInst>(loopPreheader->getTerminator()));
 
   // We need to reprocess this loop, it could be unswitched again.
   redoLoop = true;
@@ -898,8 +915,6 @@ void LoopUnswitch::UnswitchNontrivialCondition(Value *LIC, Constant *Val,
 
   // Emit the new branch that selects between the two versions of this loop.
   EmitPreheaderBranchOnCondition(LIC, Val, NewBlocks[0], LoopBlocks[0], OldBR);
-  LPM->deleteSimpleAnalysisValue(OldBR, L);
-  OldBR->eraseFromParent();
 
   LoopProcessWorklist.push_back(NewLoop);
   redoLoop = true;
@@ -1062,10 +1077,8 @@ void LoopUnswitch::RewriteLoopBodyWithConditionConstant(Loop *L, Value *LIC,
          PHINode *PN = dyn_cast<PHINode>(II); ++II)
       PN->setIncomingValue(PN->getBasicBlockIndex(Switch),
                            UndefValue::get(PN->getType()));
-    // Tell the domtree about the new block. We don't fully update the
-    // domtree here -- instead we force it to do a full recomputation
-    // after the pass is complete -- but we do need to inform it of
-    // new blocks.
+    // Tell the domtree about the new block, which is only reached from
+    // NewSISucc.
     if (DT)
       DT->addNewBlock(Abort, NewSISucc);
   }
@@ -1141,6 +1154,16 @@ void LoopUnswitch::SimplifyCode(std::vector<Instruction*> &Worklist, Loop *L) {
         BI->eraseFromParent();
         RemoveFromWorklist(BI, Worklist);
 
+        // Pred now dominates whatever Succ dominated.
+        if (DT)
+          if (DomTreeNode *SuccNode = DT->getNode(Succ)) {
+            DomTreeNode *PredNode = DT->getNode(Pred);
+            while (!SuccNode->getChildren().empty())
+              DT->changeImmediateDominator(SuccNode->getChildren().back(),
+                                           PredNode);
+            DT->eraseNode(Succ);
+          }
+
         // Remove Succ from the loop tree.
         LI->removeBlock(Succ);
         LPM->deleteSimpleAnalysisValue(Succ, L);
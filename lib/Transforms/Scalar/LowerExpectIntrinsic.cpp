@@ -180,6 +180,10 @@ public:
   }
 
   bool runOnFunction(Function &F) override { return lowerExpectIntrinsic(F); }
+
+  FunctionPass *createParallelCopy() const override {
+    return new LowerExpectIntrinsic();
+  }
 };
 }
 
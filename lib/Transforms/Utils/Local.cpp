@@ -531,13 +531,22 @@ void llvm::MergeBasicBlockIntoOnlyPred(BasicBlock *DestBB, DominatorTree *DT) {
   if (PredBB == &DestBB->getParent()->getEntryBlock())
     DestBB->moveAfter(PredBB);
 
-  if (DT) {
-    BasicBlock *PredBBIDom = DT->getNode(PredBB)->getIDom()->getBlock();
-    DT->changeImmediateDominator(DestBB, PredBBIDom);
-    DT->eraseNode(PredBB);
-  }
+  // DestBB takes the place of PredBB in the dominator tree. If PredBB was the
+  // entry block, DestBB becomes the root, which is simplest to rebuild.
+  bool RecalculateDT = false;
+  if (DT)
+    if (DomTreeNode *PredNode = DT->getNode(PredBB)) {
+      if (DomTreeNode *PredIDom = PredNode->getIDom()) {
+        DT->changeImmediateDominator(DestBB, PredIDom->getBlock());
+        DT->eraseNode(PredBB);
+      } else {
+        RecalculateDT = true;
+      }
+    }
   // Nuke BB.
   PredBB->eraseFromParent();
+  if (RecalculateDT)
+    DT->recalculate(*DestBB->getParent());
 }
 
 /// CanMergeValues - Return true if we can choose one of these values to use
@@ -745,7 +754,8 @@ static void redirectValuesFromPredecessorsToPhi(BasicBlock *BB,
 /// potential side-effect free intrinsics and the branch.  If possible,
 /// eliminate BB by rewriting all the predecessors to branch to the successor
 /// block and return true.  If we can't transform, return false.
-bool llvm::TryToSimplifyUncondBranchFromEmptyBlock(BasicBlock *BB) {
+bool llvm::TryToSimplifyUncondBranchFromEmptyBlock(BasicBlock *BB,
+                                                   DominatorTree *DT) {
   assert(BB != &BB->getParent()->getEntryBlock() &&
          "TryToSimplifyUncondBranchFromEmptyBlock called on entry block!");
 
@@ -818,6 +828,18 @@ bool llvm::TryToSimplifyUncondBranchFromEmptyBlock(BasicBlock *BB) {
   // Everything that jumped to BB now goes to Succ.
   BB->replaceAllUsesWith(Succ);
   if (!Succ->hasName()) Succ->takeName(BB);
+
+  // Removing BB doesn't change which other blocks dominate each other, as
+  // every path through BB goes on to Succ. The only block that BB can
+  // immediately dominate is Succ, which moves up to BB's place.
+  if (DT)
+    if (DomTreeNode *BBNode = DT->getNode(BB)) {
+      if (DomTreeNode *SuccNode = DT->getNode(Succ))
+        if (SuccNode->getIDom() == BBNode)
+          DT->changeImmediateDominator(SuccNode, BBNode->getIDom());
+      DT->eraseNode(BB);
+    }
+
   BB->eraseFromParent();              // Delete the old basic block.
   return true;
 }
@@ -0,0 +1,67 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-cached-loops=1 \
+; RUN:   -scalar-evolution-max-cached-exit-values=1 | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -stats \
+; RUN:   -scalar-evolution-max-cached-loops=1 \
+; RUN:   -scalar-evolution-max-cached-exit-values=1 2>&1 >/dev/null \
+; RUN:   | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; Flushing the caches of backedge-taken counts and constant exit values when
+; they are full must not change the results.
+
+; CHECK-LABEL: Determining loop execution counts for: @loops
+; CHECK: Loop %shift2: backedge-taken count is 6
+; CHECK: Loop %shift: backedge-taken count is 4
+; CHECK: Loop %second: backedge-taken count is 29
+; CHECK: Loop %inner: backedge-taken count is 19
+; CHECK: Loop %outer: backedge-taken count is 9
+
+; STATS: scalar-evolution - Number of SCEV expressions created
+; STATS: scalar-evolution - Number of backedge-taken counts dropped from a full cache
+; STATS: scalar-evolution - Number of bytes allocated for SCEV expressions
+; STATS: scalar-evolution - Number of constant loop exit values dropped from a full cache
+
+define i32 @loops(i32* %p) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i32 [ 0, %outer ], [ %j.next, %inner ]
+  store i32 %j, i32* %p
+  %j.next = add nuw nsw i32 %j, 1
+  %inner.cond = icmp ult i32 %j.next, 20
+  br i1 %inner.cond, label %inner, label %outer.latch
+
+outer.latch:
+  %i.next = add nuw nsw i32 %i, 1
+  %outer.cond = icmp ult i32 %i.next, 10
+  br i1 %outer.cond, label %outer, label %second
+
+second:
+  %k = phi i32 [ 0, %outer.latch ], [ %k.next, %second ]
+  %k.next = add nuw nsw i32 %k, 1
+  %second.cond = icmp ult i32 %k.next, 30
+  br i1 %second.cond, label %second, label %shift
+
+; The trip counts of these two can only be found by evaluating them.
+shift:
+  %s = phi i32 [ 1, %second ], [ %s.next, %shift ]
+  %s.next = shl i32 %s, 1
+  %shift.cond = icmp ne i32 %s.next, 32
+  br i1 %shift.cond, label %shift, label %shift2
+
+shift2:
+  %t = phi i32 [ 3, %shift ], [ %t.next, %shift2 ]
+  %t.next = shl i32 %t, 1
+  %shift2.cond = icmp ne i32 %t.next, 384
+  br i1 %shift2.cond, label %shift2, label %exit
+
+exit:
+  %r = add i32 %s.next, %t.next
+  ret i32 %r
+}
@@ -0,0 +1,154 @@
+; Check that parsing the function bodies on several threads gives the use
+; lists of the values that the functions share the order of a serial read,
+; both where the bitcode records an order and where it relies on the order in
+; which the reader adds the uses.
+;
+; RUN: llvm-as -preserve-bc-uselistorder < %s > %t.bc
+; RUN: opt -S -preserve-ll-uselistorder -bitcode-reader-threads=1 %t.bc \
+; RUN:   -o %t.serial.ll
+; RUN: opt -S -preserve-ll-uselistorder -bitcode-reader-threads=4 %t.bc \
+; RUN:   -o %t.parallel.ll
+; RUN: diff %t.serial.ll %t.parallel.ll
+; RUN: FileCheck %s < %t.parallel.ll
+
+@g = global i32 0
+@h = global i32 0
+@arr = global [4 x i32] zeroinitializer
+
+define i32 @f0(i32 %x) {
+  %a = load i32, i32* @g
+  %b = add i32 %a, 0
+  store i32 %b, i32* getelementptr ([4 x i32], [4 x i32]* @arr, i32 0, i32 1)
+  %c = mul i32 %b, 7
+  %p = ptrtoint i32* @g to i32
+  %d = add i32 %c, %p
+  store i32 %d, i32* @g
+  ret i32 %d
+}
+
+define i32 @f1(i32 %x) {
+  %a = load i32, i32* @g
+  %b = add i32 %a, 1
+  store i32 %b, i32* getelementptr ([4 x i32], [4 x i32]* @arr, i32 0, i32 2)
+  %c = mul i32 %b, 7
+  %p = ptrtoint i32* @g to i32
+  %d = add i32 %c, %p
+  store i32 %d, i32* @g
+  ret i32 %d
+}
+
+define i32 @f2(i32 %x) {
+  %a = load i32, i32* @g
+  %b = add i32 %a, 2
+  store i32 %b, i32* getelementptr ([4 x i32], [4 x i32]* @arr, i32 0, i32 1)
+  %c = mul i32 %b, 7
+  %p = ptrtoint i32* @g to i32
+  %d = add i32 %c, %p
+  store i32 %d, i32* @g
+  ret i32 %d
+}
+
+define i32 @f3(i32 %x) {
+  %a = load i32, i32* @g
+  %b = add i32 %a, 0
+  store i32 %b, i32* getelementptr ([4 x i32], [4 x i32]* @arr, i32 0, i32 2)
+  %c = mul i32 %b, 7
+  %p = ptrtoint i32* @g to i32
+  %d = add i32 %c, %p
+  store i32 %d, i32* @g
+  store i32 %x, i32* @h
+  ret i32 %d
+}
+
+define i32 @f4(i32 %x) {
+  %a = load i32, i32* @g
+  %b = add i32 %a, 1
+  store i32 %b, i32* getelementptr ([4 x i32], [4 x i32]* @arr, i32 0, i32 1)
+  %c = mul i32 %b, 7
+  %p = ptrtoint i32* @g to i32
+  %d = add i32 %c, %p
+  store i32 %d, i32* @g
+  ret i32 %d
+}
+
+define i32 @f5(i32 %x) {
+  %a = load i32, i32* @g
+  %b = add i32 %a, 2
+  store i32 %b, i32* getelementptr ([4 x i32], [4 x i32]* @arr, i32 0, i32 2)
+  %c = mul i32 %b, 7
+  %p = ptrtoint i32* @g to i32
+  %d = add i32 %c, %p
+  store i32 %d, i32* @g
+  ret i32 %d
+}
+
+define i32 @f6(i32 %x) {
+  %a = load i32, i32* @g
+  %b = add i32 %a, 0
+  store i32 %b, i32* getelementptr ([4 x i32], [4 x i32]* @arr, i32 0, i32 1)
+  %c = mul i32 %b, 7
+  %p = ptrtoint i32* @g to i32
+  %d = add i32 %c, %p
+  store i32 %d, i32* @g
+  ret i32 %d
+}
+
+define i32 @f7(i32 %x) {
+  %a = load i32, i32* @g
+  %b = add i32 %a, 1
+  store i32 %b, i32* getelementptr ([4 x i32], [4 x i32]* @arr, i32 0, i32 2)
+  %c = mul i32 %b, 7
+  %p = ptrtoint i32* @g to i32
+  %d = add i32 %c, %p
+  store i32 %d, i32* @g
+  store i32 %x, i32* @h
+  ret i32 %d
+}
+
+define i32 @f8(i32 %x) {
+  %a = load i32, i32* @g
+  %b = add i32 %a, 2
+  store i32 %b, i32* getelementptr ([4 x i32], [4 x i32]* @arr, i32 0, i32 1)
+  %c = mul i32 %b, 7
+  %p = ptrtoint i32* @g to i32
+  %d = add i32 %c, %p
+  store i32 %d, i32* @g
+  ret i32 %d
+}
+
+define i32 @f9(i32 %x) {
+  %a = load i32, i32* @g
+  %b = add i32 %a, 0
+  store i32 %b, i32* getelementptr ([4 x i32], [4 x i32]* @arr, i32 0, i32 2)
+  %c = mul i32 %b, 7
+  %p = ptrtoint i32* @g to i32
+  %d = add i32 %c, %p
+  store i32 %d, i32* @g
+  ret i32 %d
+}
+
+define i32 @f10(i32 %x) {
+  %a = load i32, i32* @g
+  %b = add i32 %a, 1
+  store i32 %b, i32* getelementptr ([4 x i32], [4 x i32]* @arr, i32 0, i32 1)
+  %c = mul i32 %b, 7
+  %p = ptrtoint i32* @g to i32
+  %d = add i32 %c, %p
+  store i32 %d, i32* @g
+  store i32 %x, i32* @h
+  ret i32 %d
+}
+
+define i32 @f11(i32 %x) {
+  %a = load i32, i32* @g
+  %b = add i32 %a, 2
+  store i32 %b, i32* getelementptr ([4 x i32], [4 x i32]* @arr, i32 0, i32 2)
+  %c = mul i32 %b, 7
+  %p = ptrtoint i32* @g to i32
+  %d = add i32 %c, %p
+  store i32 %d, i32* @g
+  ret i32 %d
+}
+
+; CHECK: uselistorder i32* @h, { 1, 0, 2 }
+uselistorder i32* @h, { 1, 0, 2 }
@@ -0,0 +1,94 @@
+; Check that parsing the function bodies on several threads gives the same
+; module as a serial read, including block addresses that refer to other
+; functions and the use-list orders of function-local values.
+;
+; RUN: llvm-as -preserve-bc-uselistorder < %s > %t.bc
+; RUN: opt -S -preserve-ll-uselistorder %t.bc -o %t.serial.ll
+; RUN: opt -S -preserve-ll-uselistorder -bitcode-reader-threads=3 %t.bc \
+; RUN:   -o %t.parallel.ll
+; RUN: diff %t.serial.ll %t.parallel.ll
+; RUN: opt -S -bitcode-reader-threads=0 %t.bc | FileCheck %s
+
+@g = global i32 0
+@table = constant [2 x i8*] [i8* blockaddress(@f3, %a), i8* blockaddress(@f3, %b)]
+
+; CHECK: @table = constant [2 x i8*] [i8* blockaddress(@f3, %a), i8* blockaddress(@f3, %b)]
+
+; CHECK-LABEL: define i32 @f1(
+define i32 @f1(i32 %x, i32 %y) {
+entry:
+  %e = add i32 %x, 7
+  %f = mul i32 %e, %y
+  %h = mul i32 %e, %f
+  ret i32 %h
+
+  uselistorder i32 %e, { 1, 0 }
+}
+
+; CHECK-LABEL: define i8* @f2(
+; CHECK: ret i8* blockaddress(@f3, %b)
+define i8* @f2() {
+  %v = load i32, i32* @g, !range !0
+  %c = call i32 @f1(i32 %v, i32 1)
+  ret i8* blockaddress(@f3, %b)
+}
+
+; CHECK-LABEL: define void @f3(
+; CHECK: store i8* blockaddress(@f3, %a), i8** %p
+; CHECK: indirectbr
+define void @f3(i8** %p) {
+entry:
+  store i8* blockaddress(@f3, %a), i8** %p
+  %t = load i8*, i8** %p
+  indirectbr i8* %t, [label %a, label %b]
+a:
+  store i32 1, i32* @g
+  ret void
+b:
+  store i32 2, i32* @g
+  ret void
+}
+
+; CHECK-LABEL: define i8* @0(
+; CHECK: ret i8* blockaddress(@f3, %a)
+define i8* @0() {
+  call void @f3(i8** null)
+  ret i8* blockaddress(@f3, %a)
+}
+
+; CHECK-LABEL: define i32 @f5(
+; CHECK: phi i32 [ 0, %entry ], [ %i.next, %loop ]
+define i32 @f5(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+exit:
+  ret i32 %i
+}
+
+; CHECK-LABEL: define void @f6(
+; CHECK: call void @llvm.dbg.value(metadata i32 %x, i64 0, metadata !{{[0-9]+}}, metadata !{{[0-9]+}}), !dbg
+define void @f6(i32 %x) {
+  call void @llvm.dbg.value(metadata i32 %x, i64 0, metadata !5, metadata !6), !dbg !7
+  ret void
+}
+
+declare void @llvm.dbg.value(metadata, i64, metadata, metadata)
+
+!llvm.dbg.cu = !{!1}
+!llvm.module.flags = !{!8}
+
+!0 = !{i32 0, i32 3}
+!1 = distinct !DICompileUnit(language: DW_LANG_C99, file: !2, subprograms: !{!3})
+!2 = !DIFile(filename: "t.c", directory: "/")
+!3 = distinct !DISubprogram(name: "f6", scope: !2, file: !2, line: 1, type: !4, function: void (i32)* @f6)
+!4 = !DISubroutineType(types: !{null})
+!5 = !DILocalVariable(tag: DW_TAG_arg_variable, name: "x", arg: 1, scope: !3, file: !2, line: 1, type: !9)
+!6 = !DIExpression()
+!7 = !DILocation(line: 1, column: 2, scope: !3)
+!8 = !{i32 2, !"Debug Info Version", i32 3}
+!9 = !DIBasicType(name: "int", size: 32, align: 32, encoding: DW_ATE_signed)
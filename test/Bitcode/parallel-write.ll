@@ -0,0 +1,66 @@
+; Check that encoding the function bodies on several threads gives the same
+; bitcode as a serial write, including the use-list orders of each function.
+;
+; RUN: llvm-link %s -o %t.serial.bc
+; RUN: llvm-link %s -bitcode-writer-threads=3 -o %t.parallel.bc
+; RUN: cmp %t.serial.bc %t.parallel.bc
+; RUN: llvm-link %s -bitcode-writer-threads=0 -o %t.parallel0.bc
+; RUN: cmp %t.serial.bc %t.parallel0.bc
+; RUN: llvm-dis -preserve-ll-uselistorder < %t.parallel.bc | FileCheck %s
+
+@g = global i32 0
+@p = global i8* blockaddress(@f3, %target)
+
+; CHECK-LABEL: define i32 @f1(
+; CHECK: uselistorder i32 %e, { 1, 0 }
+define i32 @f1(i32 %a, i32 %b) {
+entry:
+  %e = add i32 %a, 7
+  %f = mul i32 %e, %b
+  %h = mul i32 %e, %f
+  ret i32 %h
+
+  uselistorder i32 %e, { 1, 0 }
+}
+
+; CHECK-LABEL: define i32 @f2(
+; CHECK: load i32, i32* @g, !range
+define i32 @f2() {
+  %v = load i32, i32* @g, !range !0
+  %c = call i32 @f1(i32 %v, i32 1)
+  ret i32 %c
+}
+
+; CHECK-LABEL: define void @f3(
+; CHECK: indirectbr
+define void @f3(i8* %x) {
+entry:
+  indirectbr i8* %x, [label %target]
+target:
+  store i32 1, i32* @g
+  ret void
+}
+
+; CHECK-LABEL: define void @0(
+define void @0() {
+  call void @f3(i8* blockaddress(@f3, %target))
+  ret void
+}
+
+; CHECK-LABEL: define i32 @f5(
+; CHECK: uselistorder label %loop, { 1, 0 }
+define i32 @f5(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+exit:
+  ret i32 %i
+
+  uselistorder label %loop, { 1, 0 }
+}
+
+!0 = !{i32 0, i32 10}
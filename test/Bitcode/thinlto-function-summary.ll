@@ -0,0 +1,34 @@
+; RUN: llvm-as -function-summary < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=NOSUMMARY
+; Check the combined index written by the thin link.
+; RUN: llvm-as -function-summary < %s > %t.bc
+; RUN: llvm-lto -thinlto -o %t2 %t.bc
+; RUN: llvm-bcanalyzer -dump %t2.thinlto.bc | FileCheck %s -check-prefix=COMBINED
+
+; BC: <FUNCTION_SUMMARY_BLOCK
+; BC-NEXT: <NAME abbrevid=4 op0=102 op1=111 op2=111/>
+; BC-NEXT: <NAME abbrevid=4 op0=98 op1=97 op2=114/>
+; BC-NEXT: <PERMODULE_ENTRY op0=0 op1=0 op2=2 op3=0 op4=1/>
+; BC-NEXT: <PERMODULE_ENTRY op0=1 op1=3 op2=1 op3=0/>
+; BC-NEXT: </FUNCTION_SUMMARY_BLOCK>
+
+; NOSUMMARY-NOT: FUNCTION_SUMMARY_BLOCK
+
+; COMBINED: <FUNCTION_SUMMARY_BLOCK
+; COMBINED-NEXT: <MODULE_PATH op0=0
+; COMBINED: <COMBINED_ENTRY op0=0
+; COMBINED: <COMBINED_ENTRY op0=0
+; COMBINED: </FUNCTION_SUMMARY_BLOCK>
+
+; foo calls bar, an internal function. Neither can be imported, as locals are
+; not promoted.
+define i32 @foo() {
+entry:
+  %call = call i32 @bar()
+  ret i32 %call
+}
+
+define internal i32 @bar() {
+entry:
+  ret i32 1
+}
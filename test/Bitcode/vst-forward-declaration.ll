@@ -0,0 +1,63 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s --check-prefix=BC
+; RUN: llvm-as < %s | llvm-dis | FileCheck %s
+; RUN: llvm-as < %s | llvm-extract -func=bar | llvm-dis \
+; RUN:   | FileCheck %s --check-prefix=EXTRACT
+; RUN: verify-uselistorder < %s
+
+; Check that the module-level value symbol table follows the function blocks,
+; that a VSTOFFSET record gives its offset and that it holds the offset of
+; every function body, including those of unnamed functions. The triple adds
+; a wrapper header, which the offsets must not include.
+
+; BC: <MODULE_BLOCK
+; BC: <VSTOFFSET {{.*}}op0=
+; BC: <FUNCTION_BLOCK
+; BC: <FUNCTION_BLOCK
+; BC: <FUNCTION_BLOCK
+; BC: </FUNCTION_BLOCK>
+; BC-NEXT: <VALUE_SYMTAB
+; 'foo'
+; BC-DAG: <FNENTRY {{.*}}op0=1 op1={{[0-9]+}} op2=102 op3=111 op4=111/>
+; 'bar'
+; BC-DAG: <FNENTRY {{.*}}op0=3 op1={{[0-9]+}} op2=98 op3=97 op4=114/>
+; @0
+; BC-DAG: <FNENTRY {{.*}}op0=2 op1={{[0-9]+}}/>
+; 'g'
+; BC-DAG: <ENTRY {{.*}}op0=0 op1=103/>
+; 'baz'
+; BC-DAG: <ENTRY {{.*}}op0=4 op1=98 op2=97 op3=122/>
+; BC: </VALUE_SYMTAB>
+; BC-NEXT: </MODULE_BLOCK>
+
+target triple = "x86_64-apple-macosx10.10.0"
+
+; CHECK: @g = global i32 0
+@g = global i32 0
+
+; CHECK: define i32 @foo()
+; EXTRACT: declare i32 @foo()
+define i32 @foo() {
+  %v = load i32, i32* @g
+  ret i32 %v
+}
+
+; CHECK: define void @0()
+; EXTRACT: declare void @0()
+define void @0() {
+  ret void
+}
+
+; CHECK: define void @bar()
+; EXTRACT: define void @bar()
+; EXTRACT-NEXT: entry:
+; EXTRACT-NEXT: call void @0()
+; EXTRACT-NEXT: %x = call i32 @foo()
+define void @bar() {
+entry:
+  call void @0()
+  %x = call i32 @foo()
+  ret void
+}
+
+; CHECK: declare void @baz()
+declare void @baz()
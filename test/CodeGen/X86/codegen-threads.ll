@@ -0,0 +1,125 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -codegen-threads=3 \
+; RUN:   | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -filetype=obj -o %t.o
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -filetype=obj \
+; RUN:   -codegen-threads=3 -o %t.threads.o
+; RUN: cmp %t.o %t.threads.o
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -relocation-model=pic \
+; RUN:   -o %t.s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -relocation-model=pic \
+; RUN:   -codegen-threads=3 -o %t.threads.s
+; RUN: cmp %t.s %t.threads.s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -codegen-threads=3 \
+; RUN:   | grep -c -e '\.file' -e '\.ident' | FileCheck %s --check-prefix=ONCE
+
+; Code generating the functions on several threads gives one output with the
+; functions in their original order. Function numbers are the same as when
+; they are code generated in one piece, file-level directives are emitted
+; once, and references to symbols defined by other pieces are the same as
+; references to symbols defined in the same piece.
+
+module asm "\09.globl\09module_asm_sym"
+
+@.str = private unnamed_addr constant [6 x i8] c"hello\00", align 1
+@counter = internal global i32 0, align 4
+@table = global [2 x i32 (i32)*] [i32 (i32)* @first, i32 (i32)* @last], align 16
+@tls = thread_local global i32 0, align 4
+@tls_alias = thread_local alias i32* @tls
+
+; ONCE: 2
+
+; CHECK: .file "<stdin>"
+; CHECK: module_asm_sym
+
+; CHECK-LABEL: first:
+; CHECK: .LBB0_1:
+; CHECK: movl %eax, %fs:tls_alias@TPOFF
+define i32 @first(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %acc.next = add i32 %acc, %i
+  %i.next = add i32 %i, 1
+  %cond = icmp slt i32 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  store i32 %acc.next, i32* @counter
+  store i32 %acc.next, i32* @tls_alias
+  ret i32 %acc.next
+}
+
+; CHECK-LABEL: helper:
+define internal i32 @helper(i32 %x) noinline {
+  %c = load i32, i32* @counter
+  %r = mul i32 %x, %c
+  %s = add i32 %r, 7
+  %t = xor i32 %s, %x
+  ret i32 %t
+}
+
+; CHECK-LABEL: middle:
+; CHECK: callq helper
+; CHECK: movl $.L.str, %edi
+; CHECK: jmpq *.LJTI2_0(,%rax,8)
+define i32 @middle(i32 %x) {
+entry:
+  switch i32 %x, label %default [
+    i32 0, label %a
+    i32 1, label %b
+    i32 2, label %c
+    i32 3, label %d
+  ]
+
+a:
+  br label %exit
+b:
+  br label %exit
+c:
+  br label %exit
+d:
+  br label %exit
+default:
+  %h = call i32 @helper(i32 %x)
+  %p = call i32 @puts(i8* getelementptr inbounds ([6 x i8], [6 x i8]* @.str, i64 0, i64 0))
+  br label %exit
+
+exit:
+  %r = phi i32 [ 10, %a ], [ 20, %b ], [ 30, %c ], [ 40, %d ], [ %h, %default ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: last:
+; CHECK: callq helper
+; CHECK: .LBB3_
+define i32 @last(i32 %n) {
+entry:
+  %h = call i32 @helper(i32 %n)
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ %h, %entry ], [ %acc.next, %loop ]
+  %acc.next = mul i32 %acc, %i
+  %i.next = add i32 %i, 1
+  %cond = icmp slt i32 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  ret i32 %acc.next
+}
+
+declare i32 @puts(i8*)
+
+; CHECK: .L.str:
+; CHECK: .comm counter,4,4
+; CHECK: table:
+; CHECK: tls_alias = tls
+; CHECK: .ident "codegen-threads test"
+
+!llvm.ident = !{!0}
+!0 = !{!"codegen-threads test"}
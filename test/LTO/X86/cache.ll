@@ -0,0 +1,50 @@
+; RUN: llvm-as -o %t.bc %s
+; RUN: rm -rf %t.cache
+; RUN: llvm-lto -exported-symbol=foo -exported-symbol=bar -cache-dir=%t.cache \
+; RUN:    -o %t.o %t.bc
+; RUN: ls %t.cache | FileCheck --check-prefix=ONE %s
+
+; Linking the same input again reuses the cached object.
+; RUN: llvm-lto -exported-symbol=foo -exported-symbol=bar -cache-dir=%t.cache \
+; RUN:    -o %t2.o %t.bc
+; RUN: cmp %t.o %t2.o
+; RUN: ls %t.cache | FileCheck --check-prefix=ONE %s
+
+; A different optimization level gives a different cache entry.
+; RUN: llvm-lto -exported-symbol=foo -exported-symbol=bar -cache-dir=%t.cache \
+; RUN:    -O0 -o %t3.o %t.bc
+; RUN: ls %t.cache | FileCheck --check-prefix=TWO %s
+
+; The partitions of a split code generation are cached one by one.
+; RUN: llvm-lto -exported-symbol=foo -exported-symbol=bar -cache-dir=%t.cache \
+; RUN:    -codegen-jobs=2 -o %t4.o %t.bc
+; RUN: ls %t.cache | grep llvmcache- | count 4
+; RUN: llvm-lto -exported-symbol=foo -exported-symbol=bar -cache-dir=%t.cache \
+; RUN:    -codegen-jobs=2 -o %t5.o %t.bc
+; RUN: cmp %t4.o0 %t5.o0
+; RUN: cmp %t4.o1 %t5.o1
+; RUN: ls %t.cache | grep llvmcache- | count 4
+
+; Changing one function only makes the partition it lands in miss.
+; RUN: sed -e 's/ret i32 7/ret i32 8/' %s | llvm-as -o %t.changed.bc
+; RUN: llvm-lto -exported-symbol=foo -exported-symbol=bar -cache-dir=%t.cache \
+; RUN:    -codegen-jobs=2 -o %t6.o %t.changed.bc
+; RUN: ls %t.cache | grep llvmcache- | count 5
+
+; ONE-NOT: llvmcache-
+; ONE: llvmcache-{{[0-9a-f]+$}}
+; ONE-NOT: llvmcache-
+
+; TWO: llvmcache-{{[0-9a-f]+$}}
+; TWO: llvmcache-{{[0-9a-f]+$}}
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @foo() {
+  ret i32 42
+}
+
+define i32 @bar() {
+  ret i32 7
+}
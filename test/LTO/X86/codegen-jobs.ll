@@ -0,0 +1,29 @@
+; RUN: llvm-as -o %t.bc %s
+; RUN: llvm-lto -exported-symbol=foo -exported-symbol=bar -codegen-jobs=2 \
+; RUN:    -o %t.o %t.bc
+; RUN: llvm-nm %t.o0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-nm %t.o1 | FileCheck --check-prefix=CHECK1 %s
+
+; Check that the merged module is split into two object files, each of which
+; defines the functions of its own partition and refers to the others.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @ext()
+
+; CHECK0: U bar
+; CHECK0: T foo
+define void @foo() noinline {
+  call void @ext()
+  call void @bar()
+  ret void
+}
+
+; CHECK1: T bar
+; CHECK1: U foo
+define void @bar() noinline {
+  call void @ext()
+  call void @foo()
+  ret void
+}
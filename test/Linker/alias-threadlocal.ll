@@ -0,0 +1,11 @@
+; RUN: llvm-link %s -S -o - | FileCheck %s
+
+; The thread-local mode of an alias is one of the attributes copied by
+; GlobalValue::copyAttributesFrom, so linking keeps it.
+
+@v = thread_local global i32 0
+@a = thread_local alias i32* @v
+@a.ld = thread_local(localdynamic) alias i32* @v
+
+; CHECK: @a = thread_local alias i32* @v
+; CHECK: @a.ld = thread_local(localdynamic) alias i32* @v
@@ -0,0 +1,63 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o %t
+// RUN: llvm-objdump -d %t | FileCheck %s
+// RUN: llvm-readobj -s -sd %t | FileCheck %s --check-prefix=DATA
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o /dev/null \
+// RUN:   -stats 2>&1 | FileCheck %s --check-prefix=STATS
+// REQUIRES: asserts
+
+// Each jump is short until the jump after it is relaxed, so the jumps are
+// relaxed one per step, from the last one to the first. Only the jump in
+// front of the last relaxed one is checked again in each step. The LEB is
+// checked again until its size and the size of .text stop changing.
+
+// CHECK:      0: e9 80 00 00 00 jmp 128
+// CHECK:     80: e9 80 00 00 00 jmp 128
+// CHECK:    100: e9 80 00 00 00 jmp 128
+// CHECK:    180: e9 80 00 00 00 jmp 128
+// CHECK:    200: e9 80 00 00 00 jmp 128
+// CHECK:    280: e9 80 00 00 00 jmp 128
+// CHECK:    300: e9 80 00 00 00 jmp 128
+// CHECK:    380: e9 43 01 00 00 jmp 323
+// CHECK:    4c8: c3 retq
+
+// The size of the chain is encoded once all the jumps are relaxed.
+// DATA:      Name: .data
+// DATA:      SectionData (
+// DATA-NEXT:   0000: C909 |
+// DATA-NEXT: )
+
+// STATS: 18 assembler - Number of fragments checked for relaxation
+// STATS:  8 assembler - Number of relaxed instructions
+
+        .text
+.Lstart:
+        jmp .L0
+        .skip 123, 0x90
+        jmp .L1
+.L0:
+        .skip 123, 0x90
+        jmp .L2
+.L1:
+        .skip 123, 0x90
+        jmp .L3
+.L2:
+        .skip 123, 0x90
+        jmp .L4
+.L3:
+        .skip 123, 0x90
+        jmp .L5
+.L4:
+        .skip 123, 0x90
+        jmp .L6
+.L5:
+        .skip 123, 0x90
+        jmp .L7
+.L6:
+        .skip 123, 0x90
+        .skip 200, 0x90
+.L7:
+        retq
+.Lend:
+
+        .data
+        .uleb128 .Lend - .Lstart
@@ -0,0 +1,71 @@
+; Check that dominator trees and loops read back from an analysis result cache
+; are the same as the computed ones, and that a second run finds all of them.
+;
+; RUN: rm -f %t.cache
+; RUN: opt -disable-output -passes='print<loops>,print<domtree>' %s \
+; RUN:   2> %t.computed
+; RUN: opt -disable-output -analysis-cache=%t.cache \
+; RUN:   -passes='print<loops>,print<domtree>' %s 2> %t.first
+; RUN: diff %t.computed %t.first
+; RUN: opt -disable-output -analysis-cache=%t.cache \
+; RUN:   -passes='print<loops>,print<domtree>' %s 2> %t.second
+; RUN: diff %t.computed %t.second
+; RUN: opt -disable-output -stats -analysis-cache=%t.cache \
+; RUN:   -passes='print<loops>,print<domtree>' %s 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; CHECK: 4 analysis-result-cache - Number of analysis results found in the cache
+; CHECK-NOT: Number of analysis results not found
+
+define void @nested(i32 %n, i1 %c) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i32 [ 0, %outer ], [ %j.next, %inner ]
+  %j.next = add i32 %j, 1
+  %inner.cond = icmp slt i32 %j.next, %n
+  br i1 %inner.cond, label %inner, label %outer.latch
+
+outer.latch:
+  %i.next = add i32 %i, 1
+  %outer.cond = icmp slt i32 %i.next, %n
+  br i1 %outer.cond, label %outer, label %second
+
+second:
+  br i1 %c, label %second.a, label %second.b
+
+second.a:
+  br label %second.latch
+
+second.b:
+  br label %second.latch
+
+second.latch:
+  br i1 %c, label %second, label %exit
+
+dead:
+  br label %second.latch
+
+exit:
+  ret void
+}
+
+define i32 @diamond(i1 %c) {
+entry:
+  br i1 %c, label %left, label %right
+
+left:
+  br label %join
+
+right:
+  br label %join
+
+join:
+  %r = phi i32 [ 1, %left ], [ 2, %right ]
+  ret i32 %r
+}
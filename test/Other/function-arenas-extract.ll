@@ -0,0 +1,111 @@
+; Check that the objects of a function that were moved to another function are
+; deleted into the arena of the function they were read into, even while the
+; passes on that function run on another thread. Loop extraction moves the
+; loops out of the functions, and the dead instructions that the loops and the
+; rest of each function keep are then deleted on several threads.
+;
+; RUN: opt -S -disable-verify -loop-extract -globalopt -adce -dce < %s \
+; RUN:   > %t.serial
+; RUN: opt -S -disable-verify -function-arenas -loop-extract -globalopt -adce \
+; RUN:   -dce < %s | diff %t.serial -
+; RUN: opt -S -disable-verify -function-arenas -loop-extract -globalopt -adce \
+; RUN:   -dce -function-pass-threads=4 < %s | diff %t.serial -
+; RUN: FileCheck %s < %t.serial
+
+@g = global i32 0
+
+; CHECK-LABEL: define i32 @f0(
+; CHECK-NOT: mul
+; CHECK: call fastcc void @f0_loop(
+define i32 @f0(i32 %n) {
+entry:
+  %dead.entry = mul i32 %n, 3
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %dead.loop = mul i32 %i, 5
+  %v = load i32, i32* @g
+  %w = add i32 %v, %i
+  store i32 %w, i32* @g
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  %dead.exit = mul i32 %n, 7
+  br label %done
+done:
+  ret i32 %n
+}
+
+; CHECK-LABEL: define i32 @f1(
+; CHECK-NOT: mul
+; CHECK: call fastcc void @f1_loop(
+define i32 @f1(i32 %n) {
+entry:
+  %dead.entry = mul i32 %n, 3
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %dead.loop = mul i32 %i, 5
+  %v = load i32, i32* @g
+  %w = sub i32 %v, %i
+  store i32 %w, i32* @g
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  %dead.exit = mul i32 %n, 7
+  br label %done
+done:
+  ret i32 %n
+}
+
+; CHECK-LABEL: define i32 @f2(
+; CHECK-NOT: mul
+; CHECK: call fastcc void @f2_loop(
+define i32 @f2(i32 %n) {
+entry:
+  %dead.entry = mul i32 %n, 3
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %dead.loop = mul i32 %i, 5
+  %v = load i32, i32* @g
+  %w = xor i32 %v, %i
+  store i32 %w, i32* @g
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  %dead.exit = mul i32 %n, 7
+  br label %done
+done:
+  ret i32 %n
+}
+
+; CHECK-LABEL: define i32 @f3(
+; CHECK-NOT: mul
+; CHECK: call fastcc void @f3_loop(
+define i32 @f3(i32 %n) {
+entry:
+  %dead.entry = mul i32 %n, 3
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %dead.loop = mul i32 %i, 5
+  %v = load i32, i32* @g
+  %w = or i32 %v, %i
+  store i32 %w, i32* @g
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  %dead.exit = mul i32 %n, 7
+  br label %done
+done:
+  ret i32 %n
+}
+
+; CHECK: define internal fastcc void @f0_loop(
+; CHECK-NOT: mul
+; CHECK: ret void
@@ -0,0 +1,81 @@
+; Check that reading function bodies into arenas gives the same module, both
+; for textual and bitcode input, and that passes can rewrite and delete the
+; instructions and blocks that were allocated from the arenas.
+;
+; RUN: llvm-as < %s > %t.bc
+; RUN: opt -S < %s -o %t.ll
+; RUN: opt -S -function-arenas < %s | diff %t.ll -
+; RUN: opt -S -function-arenas < %t.bc | diff %t.ll -
+; RUN: opt -S -simplifycfg -instcombine -gvn < %s -o %t.opt.ll
+; RUN: opt -S -function-arenas -simplifycfg -instcombine -gvn < %t.bc \
+; RUN:   | diff %t.opt.ll -
+; RUN: opt -S -function-arenas -bitcode-reader-threads=2 -simplifycfg \
+; RUN:   -instcombine -gvn < %t.bc | diff %t.opt.ll -
+
+@g = global i32 0
+
+define i32 @switch(i32 %x) {
+entry:
+  switch i32 %x, label %default [
+    i32 0, label %a
+    i32 1, label %b
+    i32 2, label %a
+    i32 3, label %c
+  ]
+a:
+  br label %exit
+b:
+  %y = add i32 %x, 0
+  br label %exit
+c:
+  br label %exit
+default:
+  br label %exit
+exit:
+  %r = phi i32 [ 1, %a ], [ %y, %b ], [ 3, %c ], [ 4, %default ]
+  ret i32 %r
+}
+
+define void @indirect(i8* %p) {
+entry:
+  indirectbr i8* %p, [label %a, label %b, label %a]
+a:
+  store i32 1, i32* @g
+  ret void
+b:
+  store i32 1, i32* @g
+  ret void
+}
+
+declare i32 @__gxx_personality_v0(...)
+declare void @may_throw()
+
+define i32 @landing() {
+entry:
+  invoke void @may_throw()
+          to label %ok unwind label %lpad
+ok:
+  ret i32 0
+lpad:
+  %lp = landingpad { i8*, i32 } personality i32 (...)* @__gxx_personality_v0
+          cleanup
+          catch i8* null
+  %sel = extractvalue { i8*, i32 } %lp, 1
+  ret i32 %sel
+}
+
+define i32 @loop(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %t = mul i32 %i, 2
+  %u = add i32 %t, %t
+  %s.next = add i32 %s, %u
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+exit:
+  ret i32 %s.next
+}
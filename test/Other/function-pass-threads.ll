@@ -0,0 +1,179 @@
+; Check that running function passes on several functions at the same time
+; gives the same module and the same use-list order as a serial run, and that
+; the sequences of passes that don't support it still run. The verifier
+; doesn't support it.
+;
+; RUN: opt -S -disable-verify -lower-expect -domtree -loops -postdomtree -adce \
+; RUN:   -constprop -dce -preserve-ll-uselistorder < %s > %t.serial
+; RUN: opt -S -disable-verify -lower-expect -domtree -loops -postdomtree -adce \
+; RUN:   -constprop -dce -preserve-ll-uselistorder -function-pass-threads=4 \
+; RUN:   < %s > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+;
+; RUN: opt -S -lower-expect -instcombine -dce -function-pass-threads=0 < %s \
+; RUN:   | FileCheck %s
+; RUN: opt -S -disable-verify -adce -debug-pass=Executions \
+; RUN:   -function-pass-threads=4 < %s \
+; RUN:   2>&1 | FileCheck %s --check-prefix=DEBUG
+
+; DEBUG: Executing Pass 'Aggressive Dead Code Elimination' on Function 'f1'
+; DEBUG: Executing Pass 'Aggressive Dead Code Elimination' on Function 'f4'
+
+@g = global i32 0
+@s = private unnamed_addr constant [4 x i8] c"abc\00"
+
+declare i64 @llvm.expect.i64(i64, i64)
+declare i32 @llvm.expect.i32(i32, i32)
+declare i32 @puts(i8*)
+
+; CHECK-LABEL: define i32 @f1(
+; CHECK-NOT: llvm.expect
+; CHECK: br i1 %{{.*}}, label %{{.*}}, label %{{.*}}, !prof
+define i32 @f1(i64 %x) {
+entry:
+  %dead = add i64 %x, 1
+  %e = call i64 @llvm.expect.i64(i64 %x, i64 1)
+  %c = icmp ne i64 %e, 0
+  br i1 %c, label %then, label %else
+then:
+  %v = load i32, i32* @g
+  ret i32 %v
+else:
+  ret i32 0
+}
+
+; CHECK-LABEL: define i32 @f2(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: store i32 7, i32* @g
+; CHECK-NEXT: ret i32 7
+define i32 @f2() {
+entry:
+  %a = add i32 3, 4
+  %unused = mul i32 %a, 2
+  store i32 %a, i32* @g
+  ret i32 %a
+}
+
+; CHECK-LABEL: define void @f3(
+; CHECK: loop:
+; CHECK: call i32 @puts
+; CHECK-NOT: %dead
+define void @f3(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %dead = mul i32 %i, %i
+  %p = getelementptr [4 x i8], [4 x i8]* @s, i32 0, i32 0
+  call i32 @puts(i8* %p)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+exit:
+  ret void
+}
+
+; CHECK-LABEL: define i32 @f4(
+; CHECK: switch i32 %x, label %default [
+; CHECK: ], !prof
+define i32 @f4(i32 %x) {
+entry:
+  %e = call i32 @llvm.expect.i32(i32 %x, i32 2)
+  switch i32 %e, label %default [
+    i32 1, label %one
+    i32 2, label %two
+  ]
+one:
+  store i32 1, i32* @g
+  ret i32 1
+two:
+  store i32 2, i32* @g
+  ret i32 2
+default:
+  ret i32 0
+}
+
+; The functions below fold the same constant expressions of @g, and add uses
+; of @g and @s, so the use lists of the globals change on every thread.
+; CHECK-LABEL: define i64 @f5(
+; CHECK: ret i64 add (i64 ptrtoint (i32* @g to i64), i64 5)
+define i64 @f5() {
+entry:
+  %a = ptrtoint i32* @g to i64
+  %b = add i64 %a, 5
+  %p = getelementptr [4 x i8], [4 x i8]* @s, i32 0, i32 1
+  call i32 @puts(i8* %p)
+  store i32 5, i32* @g
+  ret i64 %b
+}
+
+define i64 @f6() {
+entry:
+  %a = ptrtoint i32* @g to i64
+  %b = add i64 %a, 6
+  %p = getelementptr [4 x i8], [4 x i8]* @s, i32 0, i32 2
+  call i32 @puts(i8* %p)
+  store i32 6, i32* @g
+  ret i64 %b
+}
+
+define i64 @f7() {
+entry:
+  %a = ptrtoint i32* @g to i64
+  %b = add i64 %a, 7
+  %p = getelementptr [4 x i8], [4 x i8]* @s, i32 0, i32 3
+  call i32 @puts(i8* %p)
+  store i32 7, i32* @g
+  ret i64 %b
+}
+
+define i64 @f8() {
+entry:
+  %a = ptrtoint i32* @g to i64
+  %b = add i64 %a, 8
+  %p = getelementptr [4 x i8], [4 x i8]* @s, i32 0, i32 0
+  call i32 @puts(i8* %p)
+  store i32 8, i32* @g
+  ret i64 %b
+}
+
+define i64 @f9() {
+entry:
+  %a = ptrtoint i32* @g to i64
+  %b = add i64 %a, 9
+  %p = getelementptr [4 x i8], [4 x i8]* @s, i32 0, i32 1
+  call i32 @puts(i8* %p)
+  store i32 9, i32* @g
+  ret i64 %b
+}
+
+define i64 @f10() {
+entry:
+  %a = ptrtoint i32* @g to i64
+  %b = add i64 %a, 10
+  %p = getelementptr [4 x i8], [4 x i8]* @s, i32 0, i32 2
+  call i32 @puts(i8* %p)
+  store i32 10, i32* @g
+  ret i64 %b
+}
+
+define i64 @f11() {
+entry:
+  %a = ptrtoint i32* @g to i64
+  %b = add i64 %a, 11
+  %p = getelementptr [4 x i8], [4 x i8]* @s, i32 0, i32 3
+  call i32 @puts(i8* %p)
+  store i32 11, i32* @g
+  ret i64 %b
+}
+
+define i64 @f12() {
+entry:
+  %a = ptrtoint i32* @g to i64
+  %b = add i64 %a, 12
+  %p = getelementptr [4 x i8], [4 x i8]* @s, i32 0, i32 0
+  call i32 @puts(i8* %p)
+  store i32 12, i32* @g
+  ret i64 %b
+}
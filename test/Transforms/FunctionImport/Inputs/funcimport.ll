@@ -0,0 +1,23 @@
+@staticvar = internal global i32 1, align 4
+
+define void @globalfunc() {
+entry:
+  ret void
+}
+
+define void @referencestatics() {
+entry:
+  %0 = load i32, i32* @staticvar, align 4
+  ret void
+}
+
+define linkonce_odr i32 @linkonceodrfunc() {
+entry:
+  %call = call i32 @callee()
+  ret i32 %call
+}
+
+define i32 @callee() {
+entry:
+  ret i32 7
+}
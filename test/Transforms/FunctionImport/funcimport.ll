@@ -0,0 +1,32 @@
+; Do setup work for all below tests: generate bitcode and combined index
+; RUN: llvm-as -function-summary %s -o %t.bc
+; RUN: llvm-as -function-summary %p/Inputs/funcimport.ll -o %t2.bc
+; RUN: llvm-lto -thinlto -o %t3 %t.bc %t2.bc
+
+; Import the functions that are small enough and do not reference local
+; symbols of their module.
+; RUN: opt -function-import -summary-file %t3.thinlto.bc %t.bc -S | FileCheck %s --check-prefix=IMPORT
+; IMPORT-DAG: define available_externally void @globalfunc()
+; IMPORT-DAG: declare void @referencestatics()
+; IMPORT-DAG: define available_externally i32 @linkonceodrfunc()
+; IMPORT-DAG: define available_externally i32 @callee()
+; IMPORT-NOT: @staticvar
+
+; Nothing is imported when the instruction limit is too low.
+; RUN: opt -function-import -summary-file %t3.thinlto.bc -import-instr-limit=0 %t.bc -S | FileCheck %s --check-prefix=LIMIT
+; LIMIT-DAG: declare void @globalfunc()
+; LIMIT-DAG: declare i32 @linkonceodrfunc()
+
+define i32 @main() {
+entry:
+  call void @globalfunc()
+  call void @referencestatics()
+  %call = call i32 @linkonceodrfunc()
+  ret i32 %call
+}
+
+declare void @globalfunc()
+
+declare void @referencestatics()
+
+declare i32 @linkonceodrfunc()
@@ -0,0 +1,35 @@
+; RUN: opt < %s -S -instcombine -gvn -instcombine -instcombine-incremental \
+; RUN:   | FileCheck %s
+; RUN: opt < %s -disable-output -stats -instcombine -gvn -instcombine \
+; RUN:   -instcombine-incremental 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; The second run of instcombine only visits the multiplication, whose operand
+; GVN replaced. The functions that GVN left alone are not looked at.
+; STATS: 1 instcombine - Number of changed insts visited
+; STATS: 1 instcombine - Number of runs on the changed insts only
+
+define i32 @forwarded(i32* %p, i32 %x, i1 %c) {
+; CHECK-LABEL: @forwarded(
+; CHECK: %m = shl i32 %x, 3
+; CHECK-NEXT: ret i32 %m
+entry:
+  store i32 8, i32* %p
+  br i1 %c, label %then, label %join
+
+then:
+  br label %join
+
+join:
+  %v = load i32, i32* %p
+  %m = mul i32 %x, %v
+  ret i32 %m
+}
+
+define i32 @untouched(i32 %x) {
+; CHECK-LABEL: @untouched(
+; CHECK-NEXT: %a = shl i32 %x, 1
+; CHECK-NEXT: ret i32 %a
+  %a = add i32 %x, %x
+  ret i32 %a
+}
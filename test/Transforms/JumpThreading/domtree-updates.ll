@@ -0,0 +1,119 @@
+; RUN: opt < %s -S -domtree -jump-threading -verify-dom-info | FileCheck %s
+; RUN: opt < %s -disable-output -domtree -jump-threading -licm \
+; RUN:   -debug-pass=Structure 2>&1 | FileCheck %s --check-prefix=PASSES
+
+; Jump threading keeps the dominator tree up to date, so LICM doesn't have to
+; compute it again.
+; PASSES: Dominator Tree Construction
+; PASSES: Jump Threading
+; PASSES-NOT: Dominator Tree Construction
+; PASSES: Loop Invariant Code Motion
+
+declare i32 @f1()
+declare i32 @f2()
+declare void @f3()
+
+; Both edges into %merge are threaded, which leaves it unreachable. The blocks
+; left with a single predecessor are then merged into it.
+define i32 @thread_both(i1 %cond) {
+; CHECK-LABEL: @thread_both(
+; CHECK: br i1 %cond, label %t2, label %f2
+; CHECK: t2:
+; CHECK-NEXT: %v1 = call i32 @f1()
+; CHECK-NEXT: call void @f3()
+; CHECK-NEXT: ret i32 %v1
+; CHECK: f2:
+; CHECK-NEXT: %v2 = call i32 @f2()
+; CHECK-NEXT: ret i32 %v2
+entry:
+  br i1 %cond, label %t1, label %f1
+
+t1:
+  %v1 = call i32 @f1()
+  br label %merge
+
+f1:
+  %v2 = call i32 @f2()
+  br label %merge
+
+merge:
+  %a = phi i1 [ true, %t1 ], [ false, %f1 ]
+  %b = phi i32 [ %v1, %t1 ], [ %v2, %f1 ]
+  br i1 %a, label %t2, label %f2
+
+t2:
+  call void @f3()
+  ret i32 %b
+
+f2:
+  ret i32 %b
+}
+
+; Only the edge from %t1 is threaded, through a copy of %merge.
+define i32 @thread_one(i1 %cond, i1 %other) {
+; CHECK-LABEL: @thread_one(
+; CHECK: br i1 %cond, label %merge.thread, label %merge
+; CHECK: merge.thread:
+; CHECK: br label %t2
+; CHECK: merge:
+; CHECK: br i1 %other, label %t2, label %f2
+entry:
+  br i1 %cond, label %t1, label %f1
+
+t1:
+  %v1 = call i32 @f1()
+  br label %merge
+
+f1:
+  %v2 = call i32 @f2()
+  br label %merge
+
+merge:
+  %a = phi i1 [ true, %t1 ], [ %other, %f1 ]
+  %b = phi i32 [ %v1, %t1 ], [ %v2, %f1 ]
+  call void @f3()
+  br i1 %a, label %t2, label %f2
+
+t2:
+  ret i32 %b
+
+f2:
+  ret i32 0
+}
+
+; A branch on undef is folded, after which all of the blocks are merged into
+; the entry block.
+define i32 @fold_undef() {
+; CHECK-LABEL: @fold_undef(
+; CHECK-NOT: br
+; CHECK: ret i32 %d
+entry:
+  br label %header
+
+header:
+  %c = call i32 @f1()
+  br i1 undef, label %live, label %dead
+
+dead:
+  %d = call i32 @f2()
+  br label %live
+
+live:
+  %r = phi i32 [ %c, %header ], [ %d, %dead ]
+  ret i32 %r
+}
+
+; The loop makes LICM ask for the dominator tree.
+define void @loop(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
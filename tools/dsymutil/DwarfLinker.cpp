@@ -32,8 +32,10 @@
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
+#include <algorithm>
 #include <string>
 #include <tuple>
 
@@ -42,9 +44,10 @@ namespace dsymutil {
 
 namespace {
 
-void warn(const Twine &Warning, const Twine &Context) {
-  errs() << Twine("while processing ") + Context + ":\n";
-  errs() << Twine("warning: ") + Warning + "\n";
+void warn(const Twine &Warning, const Twine &Context,
+          raw_ostream &OS = errs()) {
+  OS << Twine("while processing ") + Context + ":\n";
+  OS << Twine("warning: ") + Warning + "\n";
 }
 
 bool error(const Twine &Error, const Twine &Context) {
@@ -104,8 +107,8 @@ public:
     bool InDebugMap;    ///< Was this DIE's entity found in the map?
   };
 
-  CompileUnit(DWARFUnit &OrigUnit, unsigned ID)
-      : OrigUnit(OrigUnit), ID(ID), LowPc(UINT64_MAX), HighPc(0), RangeAlloc(),
+  CompileUnit(DWARFUnit &OrigUnit)
+      : OrigUnit(OrigUnit), ID(0), LowPc(UINT64_MAX), HighPc(0), RangeAlloc(),
         Ranges(RangeAlloc) {
     Info.resize(OrigUnit.getNumDIEs());
   }
@@ -122,6 +125,7 @@ public:
   DWARFUnit &getOrigUnit() const { return OrigUnit; }
 
   unsigned getUniqueID() const { return ID; }
+  void setUniqueID(unsigned NewID) { ID = NewID; }
 
   DIE *getOutputUnitDIE() const { return CUDie.get(); }
   void setOutputUnitDIE(DIE *Die) { CUDie.reset(Die); }
@@ -1043,7 +1047,7 @@ class DwarfLinker {
 public:
   DwarfLinker(StringRef OutputFilename, const LinkOptions &Options)
       : OutputFilename(OutputFilename), Options(Options),
-        BinHolder(Options.Verbose), LastCIEOffset(0) {}
+        OutputDebugInfoSize(0), UnitID(0), LastCIEOffset(0) {}
 
   ~DwarfLinker() {
     for (auto *Abbrev : Abbreviations)
@@ -1054,12 +1058,6 @@ public:
   bool link(const DebugMap &);
 
 private:
-  /// \brief Called at the start of a debug object link.
-  void startDebugObject(DWARFContext &, DebugMapObject &);
-
-  /// \brief Called at the end of a debug object link.
-  void endDebugObject();
-
   /// \defgroup FindValidRelocations Translate debug map into a list
   /// of relevant relocations
   ///
@@ -1076,28 +1074,85 @@ private:
 
     bool operator<(const ValidReloc &RHS) const { return Offset < RHS.Offset; }
   };
+  /// @}
+
+  /// \brief The state of the link of a single DebugMapObject.
+  ///
+  /// Loading an object and selecting the DIEs to keep only touch the
+  /// object's LinkContext, so that the next objects can be analyzed on
+  /// worker threads while the current one is being cloned. The state
+  /// shared by all the objects (string pool, abbreviations, output
+  /// sections) is only used while cloning, which is done in debug map
+  /// order. This keeps the output independent of the number of threads.
+  struct LinkContext {
+    const DebugMapObject &DMO;
+
+    /// \brief Owns the object file mapping while the object is linked.
+    BinaryHolder BinHolder;
+
+    /// \brief Access to the debug info of the object, or null if the
+    /// object has nothing to link.
+    std::unique_ptr<DWARFContextInMemory> DwarfContext;
+
+    /// \brief The units of the object.
+    std::vector<CompileUnit> Units;
+
+    /// \brief The valid relocations for the object.
+    /// This vector is sorted by relocation offset.
+    std::vector<ValidReloc> ValidRelocs;
+
+    /// \brief Index into ValidRelocs of the next relocation to
+    /// consider. As we walk the DIEs in acsending file offset and as
+    /// ValidRelocs is sorted by file offset, keeping this index
+    /// uptodate is all we have to do to have a cheap lookup during the
+    /// root DIE selection and during DIE cloning.
+    unsigned NextValidReloc;
+
+    /// \brief This map is keyed by the entry PC of functions in that
+    /// debug object and the associated value is a pair storing the
+    /// corresponding end PC and the offset to apply to get the linked
+    /// address.
+    ///
+    /// See startDebugObject() for a more complete description of its use.
+    std::map<uint64_t, std::pair<uint64_t, int64_t>> Ranges;
+
+    /// \brief The warnings reported for this object. They are printed
+    /// once the object is linked, so that they come out in debug map
+    /// order whatever the number of threads.
+    std::string Warnings;
+
+    LinkContext(const DebugMapObject &DMO, bool Verbose)
+        : DMO(DMO), BinHolder(Verbose), NextValidReloc(0) {}
+  };
 
-  /// \brief The valid relocations for the current DebugMapObject.
-  /// This vector is sorted by relocation offset.
-  std::vector<ValidReloc> ValidRelocs;
+  /// \brief Called at the start of a debug object link.
+  void startDebugObject(LinkContext &Ctx);
+
+  /// \brief Called at the end of a debug object link.
+  void endDebugObject(LinkContext &Ctx);
 
-  /// \brief Index into ValidRelocs of the next relocation to
-  /// consider. As we walk the DIEs in acsending file offset and as
-  /// ValidRelocs is sorted by file offset, keeping this index
-  /// uptodate is all we have to do to have a cheap lookup during the
-  /// root DIE selection and during DIE cloning.
-  unsigned NextValidReloc;
+  /// \brief Load the object of \p Ctx, find its valid relocations and
+  /// select the DIEs to keep. This only touches \p Ctx, and can thus
+  /// run concurrently with the cloning of other objects.
+  void analyzeDebugObject(LinkContext &Ctx);
 
+  /// \brief Clone the DIEs selected by analyzeDebugObject() and emit
+  /// them along with the rest of the object's debug info. This must be
+  /// called on the objects in debug map order.
+  void cloneDebugObject(LinkContext &Ctx);
+
+  /// \addtogroup FindValidRelocations
+  ///
+  /// @{
   bool findValidRelocsInDebugInfo(const object::ObjectFile &Obj,
-                                  const DebugMapObject &DMO);
+                                  LinkContext &Ctx);
 
   bool findValidRelocs(const object::SectionRef &Section,
-                       const object::ObjectFile &Obj,
-                       const DebugMapObject &DMO);
+                       const object::ObjectFile &Obj, LinkContext &Ctx);
 
   void findValidRelocsMachO(const object::SectionRef &Section,
                             const object::MachOObjectFile &Obj,
-                            const DebugMapObject &DMO);
+                            LinkContext &Ctx);
   /// @}
 
   /// \defgroup FindRootDIEs Find DIEs corresponding to debug map entries.
@@ -1106,8 +1161,7 @@ private:
   /// \brief Recursively walk the \p DIE tree and look for DIEs to
   /// keep. Store that information in \p CU's DIEInfo.
   void lookForDIEsToKeep(const DWARFDebugInfoEntryMinimal &DIE,
-                         const DebugMapObject &DMO, CompileUnit &CU,
-                         unsigned Flags);
+                         LinkContext &Ctx, CompileUnit &CU, unsigned Flags);
 
   /// \brief Flags passed to DwarfLinker::lookForDIEsToKeep
   enum TravesalFlags {
@@ -1120,25 +1174,24 @@ private:
   /// \brief Mark the passed DIE as well as all the ones it depends on
   /// as kept.
   void keepDIEAndDenpendencies(const DWARFDebugInfoEntryMinimal &DIE,
-                               CompileUnit::DIEInfo &MyInfo,
-                               const DebugMapObject &DMO, CompileUnit &CU,
-                               unsigned Flags);
+                               CompileUnit::DIEInfo &MyInfo, LinkContext &Ctx,
+                               CompileUnit &CU, unsigned Flags);
 
   unsigned shouldKeepDIE(const DWARFDebugInfoEntryMinimal &DIE,
-                         CompileUnit &Unit, CompileUnit::DIEInfo &MyInfo,
-                         unsigned Flags);
+                         LinkContext &Ctx, CompileUnit &Unit,
+                         CompileUnit::DIEInfo &MyInfo, unsigned Flags);
 
   unsigned shouldKeepVariableDIE(const DWARFDebugInfoEntryMinimal &DIE,
-                                 CompileUnit &Unit,
+                                 LinkContext &Ctx, CompileUnit &Unit,
                                  CompileUnit::DIEInfo &MyInfo, unsigned Flags);
 
   unsigned shouldKeepSubprogramDIE(const DWARFDebugInfoEntryMinimal &DIE,
-                                   CompileUnit &Unit,
+                                   LinkContext &Ctx, CompileUnit &Unit,
                                    CompileUnit::DIEInfo &MyInfo,
                                    unsigned Flags);
 
-  bool hasValidRelocation(uint32_t StartOffset, uint32_t EndOffset,
-                          CompileUnit::DIEInfo &Info);
+  bool hasValidRelocation(LinkContext &Ctx, uint32_t StartOffset,
+                          uint32_t EndOffset, CompileUnit::DIEInfo &Info);
   /// @}
 
   /// \defgroup Linking Methods used to link the debug information
@@ -1155,8 +1208,8 @@ private:
   /// applied to the entry point of the function to get the linked address.
   ///
   /// \returns the root of the cloned tree.
-  DIE *cloneDIE(const DWARFDebugInfoEntryMinimal &InputDIE, CompileUnit &U,
-                int64_t PCOffset, uint32_t OutOffset);
+  DIE *cloneDIE(const DWARFDebugInfoEntryMinimal &InputDIE, LinkContext &Ctx,
+                CompileUnit &U, int64_t PCOffset, uint32_t OutOffset);
 
   typedef DWARFAbbreviationDeclaration::AttributeSpec AttributeSpec;
 
@@ -1180,7 +1233,8 @@ private:
 
   /// \brief Helper for cloneDIE.
   unsigned cloneAttribute(DIE &Die, const DWARFDebugInfoEntryMinimal &InputDIE,
-                          CompileUnit &U, const DWARFFormValue &Val,
+                          LinkContext &Ctx, CompileUnit &U,
+                          const DWARFFormValue &Val,
                           const AttributeSpec AttrSpec, unsigned AttrSize,
                           AttributesInfo &AttrInfo);
 
@@ -1192,8 +1246,9 @@ private:
   unsigned
   cloneDieReferenceAttribute(DIE &Die,
                              const DWARFDebugInfoEntryMinimal &InputDIE,
-                             AttributeSpec AttrSpec, unsigned AttrSize,
-                             const DWARFFormValue &Val, CompileUnit &Unit);
+                             LinkContext &Ctx, AttributeSpec AttrSpec,
+                             unsigned AttrSize, const DWARFFormValue &Val,
+                             CompileUnit &Unit);
 
   /// \brief Helper for cloneDIE.
   unsigned cloneBlockAttribute(DIE &Die, AttributeSpec AttrSpec,
@@ -1207,13 +1262,14 @@ private:
   /// \brief Helper for cloneDIE.
   unsigned cloneScalarAttribute(DIE &Die,
                                 const DWARFDebugInfoEntryMinimal &InputDIE,
-                                CompileUnit &U, AttributeSpec AttrSpec,
+                                LinkContext &Ctx, CompileUnit &U,
+                                AttributeSpec AttrSpec,
                                 const DWARFFormValue &Val, unsigned AttrSize,
                                 AttributesInfo &Info);
 
   /// \brief Helper for cloneDIE.
-  bool applyValidRelocs(MutableArrayRef<char> Data, uint32_t BaseOffset,
-                        bool isLittleEndian);
+  bool applyValidRelocs(LinkContext &Ctx, MutableArrayRef<char> Data,
+                        uint32_t BaseOffset, bool isLittleEndian);
 
   /// \brief Assign an abbreviation number to \p Abbrev
   void AssignAbbrev(DIEAbbrev &Abbrev);
@@ -1227,7 +1283,7 @@ private:
 
   /// \brief Compute and emit debug_ranges section for \p Unit, and
   /// patch the attributes referencing it.
-  void patchRangesForUnit(const CompileUnit &Unit, DWARFContext &Dwarf) const;
+  void patchRangesForUnit(const CompileUnit &Unit, LinkContext &Ctx) const;
 
   /// \brief Generate and emit the DW_AT_ranges attribute for a
   /// compile_unit if it had one.
@@ -1236,14 +1292,13 @@ private:
   /// \brief Extract the line tables fromt he original dwarf, extract
   /// the relevant parts according to the linked function ranges and
   /// emit the result in the debug_line section.
-  void patchLineTableForUnit(CompileUnit &Unit, DWARFContext &OrigDwarf);
+  void patchLineTableForUnit(CompileUnit &Unit, LinkContext &Ctx);
 
   /// \brief Emit the accelerator entries for \p Unit.
   void emitAcceleratorEntriesForUnit(CompileUnit &Unit);
 
   /// \brief Patch the frame info for an object file and emit it.
-  void patchFrameInfoForObject(const DebugMapObject &, DWARFContext &,
-                               unsigned AddressSize);
+  void patchFrameInfoForObject(LinkContext &Ctx, unsigned AddressSize);
 
   /// \brief DIELoc objects that need to be destructed (but not freed!).
   std::vector<DIELoc *> DIELocs;
@@ -1257,16 +1312,18 @@ private:
   ///
   /// @{
   const DWARFDebugInfoEntryMinimal *
-  resolveDIEReference(DWARFFormValue &RefValue, const DWARFUnit &Unit,
+  resolveDIEReference(LinkContext &Ctx, DWARFFormValue &RefValue,
+                      const DWARFUnit &Unit,
                       const DWARFDebugInfoEntryMinimal &DIE,
                       CompileUnit *&ReferencedCU);
 
-  CompileUnit *getUnitForOffset(unsigned Offset);
+  CompileUnit *getUnitForOffset(LinkContext &Ctx, unsigned Offset);
 
   bool getDIENames(const DWARFDebugInfoEntryMinimal &Die, DWARFUnit &U,
                    AttributesInfo &Info);
 
-  void reportWarning(const Twine &Warning, const DWARFUnit *Unit = nullptr,
+  void reportWarning(const Twine &Warning, LinkContext &Ctx,
+                     const DWARFUnit *Unit = nullptr,
                      const DWARFDebugInfoEntryMinimal *DIE = nullptr) const;
 
   bool createStreamer(Triple TheTriple, StringRef OutputFilename);
@@ -1275,25 +1332,17 @@ private:
 private:
   std::string OutputFilename;
   LinkOptions Options;
-  BinaryHolder BinHolder;
   std::unique_ptr<DwarfStreamer> Streamer;
 
-  /// The units of the current debug map object.
-  std::vector<CompileUnit> Units;
-
-  /// The debug map object curently under consideration.
-  DebugMapObject *CurrentDebugObject;
-
   /// \brief The Dwarf string pool
   NonRelocatableStringpool StringPool;
 
-  /// \brief This map is keyed by the entry PC of functions in that
-  /// debug object and the associated value is a pair storing the
-  /// corresponding end PC and the offset to apply to get the linked
-  /// address.
-  ///
-  /// See startDebugObject() for a more complete description of its use.
-  std::map<uint64_t, std::pair<uint64_t, int64_t>> Ranges;
+  /// \brief Size of the DIEs (and headers) generated for the linked
+  /// output so far.
+  uint64_t OutputDebugInfoSize;
+
+  /// \brief The unique ID to give to the next cloned compile unit.
+  unsigned UnitID;
 
   /// \brief The CIEs that have been emitted in the output
   /// section. The actual CIE data serves a the key to this StringMap,
@@ -1308,13 +1357,14 @@ private:
 
 /// \brief Similar to DWARFUnitSection::getUnitForOffset(), but
 /// returning our CompileUnit object instead.
-CompileUnit *DwarfLinker::getUnitForOffset(unsigned Offset) {
+CompileUnit *DwarfLinker::getUnitForOffset(LinkContext &Ctx,
+                                           unsigned Offset) {
   auto CU =
-      std::upper_bound(Units.begin(), Units.end(), Offset,
+      std::upper_bound(Ctx.Units.begin(), Ctx.Units.end(), Offset,
                        [](uint32_t LHS, const CompileUnit &RHS) {
                          return LHS < RHS.getOrigUnit().getNextUnitOffset();
                        });
-  return CU != Units.end() ? &*CU : nullptr;
+  return CU != Ctx.Units.end() ? &*CU : nullptr;
 }
 
 /// \brief Resolve the DIE attribute reference that has been
@@ -1322,16 +1372,16 @@ CompileUnit *DwarfLinker::getUnitForOffset(unsigned Offset) {
 /// CompileUnit which is stored into \p ReferencedCU.
 /// \returns null if resolving fails for any reason.
 const DWARFDebugInfoEntryMinimal *DwarfLinker::resolveDIEReference(
-    DWARFFormValue &RefValue, const DWARFUnit &Unit,
+    LinkContext &Ctx, DWARFFormValue &RefValue, const DWARFUnit &Unit,
     const DWARFDebugInfoEntryMinimal &DIE, CompileUnit *&RefCU) {
   assert(RefValue.isFormClass(DWARFFormValue::FC_Reference));
   uint64_t RefOffset = *RefValue.getAsReference(&Unit);
 
-  if ((RefCU = getUnitForOffset(RefOffset)))
+  if ((RefCU = getUnitForOffset(Ctx, RefOffset)))
     if (const auto *RefDie = RefCU->getOrigUnit().getDIEForOffset(RefOffset))
       return RefDie;
 
-  reportWarning("could not find referenced DIE", &Unit, &DIE);
+  reportWarning("could not find referenced DIE", Ctx, &Unit, &DIE);
   return nullptr;
 }
 
@@ -1354,19 +1404,19 @@ bool DwarfLinker::getDIENames(const DWARFDebugInfoEntryMinimal &Die,
 }
 
 /// \brief Report a warning to the user, optionaly including
-/// information about a specific \p DIE related to the warning.
-void DwarfLinker::reportWarning(const Twine &Warning, const DWARFUnit *Unit,
+/// information about a specific \p DIE related to the warning. The
+/// warning is buffered in \p Ctx until the object is linked.
+void DwarfLinker::reportWarning(const Twine &Warning, LinkContext &Ctx,
+                                const DWARFUnit *Unit,
                                 const DWARFDebugInfoEntryMinimal *DIE) const {
-  StringRef Context = "<debug map>";
-  if (CurrentDebugObject)
-    Context = CurrentDebugObject->getObjectFilename();
-  warn(Warning, Context);
+  raw_string_ostream OS(Ctx.Warnings);
+  warn(Warning, Ctx.DMO.getObjectFilename(), OS);
 
   if (!Options.Verbose || !DIE)
     return;
 
-  errs() << "    in DIE:\n";
-  DIE->dump(errs(), const_cast<DWARFUnit *>(Unit), 0 /* RecurseDepth */,
+  OS << "    in DIE:\n";
+  DIE->dump(OS, const_cast<DWARFUnit *>(Unit), 0 /* RecurseDepth */,
             6 /* Indent */);
 }
 
@@ -1406,9 +1456,9 @@ static bool dieNeedsChildrenToBeMeaningful(uint32_t Tag) {
   llvm_unreachable("Invalid Tag");
 }
 
-void DwarfLinker::startDebugObject(DWARFContext &Dwarf, DebugMapObject &Obj) {
-  Units.reserve(Dwarf.getNumCompileUnits());
-  NextValidReloc = 0;
+void DwarfLinker::startDebugObject(LinkContext &Ctx) {
+  Ctx.Units.reserve(Ctx.DwarfContext->getNumCompileUnits());
+  Ctx.NextValidReloc = 0;
   // Iterate over the debug map entries and put all the ones that are
   // functions (because they have a size) into the Ranges map. This
   // map is very similar to the FunctionRanges that are stored in each
@@ -1423,19 +1473,22 @@ void DwarfLinker::startDebugObject(DWARFContext &Dwarf, DebugMapObject &Obj) {
   // FIXME: Once we understood exactly if that information is needed,
   // maybe totally remove this (or try to use it to do a real
   // -gline-tables-only on Darwin.
-  for (const auto &Entry : Obj.symbols()) {
+  for (const auto &Entry : Ctx.DMO.symbols()) {
     const auto &Mapping = Entry.getValue();
     if (Mapping.Size)
-      Ranges[Mapping.ObjectAddress] = std::make_pair(
+      Ctx.Ranges[Mapping.ObjectAddress] = std::make_pair(
           Mapping.ObjectAddress + Mapping.Size,
           int64_t(Mapping.BinaryAddress) - Mapping.ObjectAddress);
   }
 }
 
-void DwarfLinker::endDebugObject() {
-  Units.clear();
-  ValidRelocs.clear();
-  Ranges.clear();
+void DwarfLinker::endDebugObject(LinkContext &Ctx) {
+  errs() << Ctx.Warnings;
+
+  Ctx.Units.clear();
+  Ctx.ValidRelocs.clear();
+  Ctx.Ranges.clear();
+  Ctx.Warnings.clear();
 
   for (auto *Block : DIEBlocks)
     Block->~DIEBlock();
@@ -1452,7 +1505,7 @@ void DwarfLinker::endDebugObject() {
 /// ValidRelocs array.
 void DwarfLinker::findValidRelocsMachO(const object::SectionRef &Section,
                                        const object::MachOObjectFile &Obj,
-                                       const DebugMapObject &DMO) {
+                                       LinkContext &Ctx) {
   StringRef Contents;
   Section.getContents(Contents);
   DataExtractor Data(Contents, Obj.isLittleEndian(), 0);
@@ -1463,7 +1516,7 @@ void DwarfLinker::findValidRelocsMachO(const object::SectionRef &Section,
     unsigned RelocSize = 1 << Obj.getAnyRelocationLength(MachOReloc);
     uint64_t Offset64;
     if ((RelocSize != 4 && RelocSize != 8) || Reloc.getOffset(Offset64)) {
-      reportWarning(" unsupported relocation in debug_info section.");
+      reportWarning(" unsupported relocation in debug_info section.", Ctx);
       continue;
     }
     uint32_t Offset = Offset64;
@@ -1474,16 +1527,16 @@ void DwarfLinker::findValidRelocsMachO(const object::SectionRef &Section,
     if (Sym != Obj.symbol_end()) {
       StringRef SymbolName;
       if (Sym->getName(SymbolName)) {
-        reportWarning("error getting relocation symbol name.");
+        reportWarning("error getting relocation symbol name.", Ctx);
         continue;
       }
-      if (const auto *Mapping = DMO.lookupSymbol(SymbolName))
-        ValidRelocs.emplace_back(Offset64, RelocSize, Addend, Mapping);
-    } else if (const auto *Mapping = DMO.lookupObjectAddress(Addend)) {
+      if (const auto *Mapping = Ctx.DMO.lookupSymbol(SymbolName))
+        Ctx.ValidRelocs.emplace_back(Offset64, RelocSize, Addend, Mapping);
+    } else if (const auto *Mapping = Ctx.DMO.lookupObjectAddress(Addend)) {
       // Do not store the addend. The addend was the address of the
       // symbol in the object file, the address in the binary that is
       // stored in the debug map doesn't need to be offseted.
-      ValidRelocs.emplace_back(Offset64, RelocSize, 0, Mapping);
+      Ctx.ValidRelocs.emplace_back(Offset64, RelocSize, 0, Mapping);
     }
   }
 }
@@ -1492,21 +1545,22 @@ void DwarfLinker::findValidRelocsMachO(const object::SectionRef &Section,
 /// appropriate handler depending on the object file format.
 bool DwarfLinker::findValidRelocs(const object::SectionRef &Section,
                                   const object::ObjectFile &Obj,
-                                  const DebugMapObject &DMO) {
+                                  LinkContext &Ctx) {
   // Dispatch to the right handler depending on the file type.
   if (auto *MachOObj = dyn_cast<object::MachOObjectFile>(&Obj))
-    findValidRelocsMachO(Section, *MachOObj, DMO);
+    findValidRelocsMachO(Section, *MachOObj, Ctx);
   else
-    reportWarning(Twine("unsupported object file type: ") + Obj.getFileName());
+    reportWarning(Twine("unsupported object file type: ") + Obj.getFileName(),
+                  Ctx);
 
-  if (ValidRelocs.empty())
+  if (Ctx.ValidRelocs.empty())
     return false;
 
   // Sort the relocations by offset. We will walk the DIEs linearly in
   // the file, this allows us to just keep an index in the relocation
   // array that we advance during our walk, rather than resorting to
   // some associative container. See DwarfLinker::NextValidReloc.
-  std::sort(ValidRelocs.begin(), ValidRelocs.end());
+  std::sort(Ctx.ValidRelocs.begin(), Ctx.ValidRelocs.end());
   return true;
 }
 
@@ -1516,7 +1570,7 @@ bool DwarfLinker::findValidRelocs(const object::SectionRef &Section,
 /// linked binary.
 /// \returns wether there are any valid relocations in the debug info.
 bool DwarfLinker::findValidRelocsInDebugInfo(const object::ObjectFile &Obj,
-                                             const DebugMapObject &DMO) {
+                                             LinkContext &Ctx) {
   // Find the debug_info section.
   for (const object::SectionRef &Section : Obj.sections()) {
     StringRef SectionName;
@@ -1524,7 +1578,7 @@ bool DwarfLinker::findValidRelocsInDebugInfo(const object::ObjectFile &Obj,
     SectionName = SectionName.substr(SectionName.find_first_not_of("._"));
     if (SectionName != "debug_info")
       continue;
-    return findValidRelocs(Section, Obj, DMO);
+    return findValidRelocs(Section, Obj, Ctx);
   }
   return false;
 }
@@ -1535,8 +1589,11 @@ bool DwarfLinker::findValidRelocsInDebugInfo(const object::ObjectFile &Obj,
 /// This function must be called with offsets in strictly ascending
 /// order because it never looks back at relocations it already 'went past'.
 /// \returns true and sets Info.InDebugMap if it is the case.
-bool DwarfLinker::hasValidRelocation(uint32_t StartOffset, uint32_t EndOffset,
+bool DwarfLinker::hasValidRelocation(LinkContext &Ctx, uint32_t StartOffset,
+                                     uint32_t EndOffset,
                                      CompileUnit::DIEInfo &Info) {
+  auto &ValidRelocs = Ctx.ValidRelocs;
+  unsigned &NextValidReloc = Ctx.NextValidReloc;
   assert(NextValidReloc == 0 ||
          StartOffset > ValidRelocs[NextValidReloc - 1].Offset);
   if (NextValidReloc >= ValidRelocs.size())
@@ -1590,7 +1647,7 @@ getAttributeOffsets(const DWARFAbbreviationDeclaration *Abbrev, unsigned Idx,
 /// \brief Check if a variable describing DIE should be kept.
 /// \returns updated TraversalFlags.
 unsigned DwarfLinker::shouldKeepVariableDIE(
-    const DWARFDebugInfoEntryMinimal &DIE, CompileUnit &Unit,
+    const DWARFDebugInfoEntryMinimal &DIE, LinkContext &Ctx, CompileUnit &Unit,
     CompileUnit::DIEInfo &MyInfo, unsigned Flags) {
   const auto *Abbrev = DIE.getAbbreviationDeclarationPtr();
 
@@ -1616,7 +1673,7 @@ unsigned DwarfLinker::shouldKeepVariableDIE(
   // always check in the variable has a valid relocation, so that the
   // DIEInfo is filled. However, we don't want a static variable in a
   // function to force us to keep the enclosing function.
-  if (!hasValidRelocation(LocationOffset, LocationEndOffset, MyInfo) ||
+  if (!hasValidRelocation(Ctx, LocationOffset, LocationEndOffset, MyInfo) ||
       (Flags & TF_InFunctionScope))
     return Flags;
 
@@ -1629,7 +1686,7 @@ unsigned DwarfLinker::shouldKeepVariableDIE(
 /// \brief Check if a function describing DIE should be kept.
 /// \returns updated TraversalFlags.
 unsigned DwarfLinker::shouldKeepSubprogramDIE(
-    const DWARFDebugInfoEntryMinimal &DIE, CompileUnit &Unit,
+    const DWARFDebugInfoEntryMinimal &DIE, LinkContext &Ctx, CompileUnit &Unit,
     CompileUnit::DIEInfo &MyInfo, unsigned Flags) {
   const auto *Abbrev = DIE.getAbbreviationDeclarationPtr();
 
@@ -1649,7 +1706,7 @@ unsigned DwarfLinker::shouldKeepSubprogramDIE(
       DIE.getAttributeValueAsAddress(&OrigUnit, dwarf::DW_AT_low_pc, -1ULL);
   assert(LowPc != -1ULL && "low_pc attribute is not an address.");
   if (LowPc == -1ULL ||
-      !hasValidRelocation(LowPcOffset, LowPcEndOffset, MyInfo))
+      !hasValidRelocation(Ctx, LowPcOffset, LowPcEndOffset, MyInfo))
     return Flags;
 
   if (Options.Verbose)
@@ -1659,7 +1716,7 @@ unsigned DwarfLinker::shouldKeepSubprogramDIE(
 
   DWARFFormValue HighPcValue;
   if (!DIE.getAttributeValue(&OrigUnit, dwarf::DW_AT_high_pc, HighPcValue)) {
-    reportWarning("Function without high_pc. Range will be discarded.\n",
+    reportWarning("Function without high_pc. Range will be discarded.\n", Ctx,
                   &OrigUnit, &DIE);
     return Flags;
   }
@@ -1673,7 +1730,7 @@ unsigned DwarfLinker::shouldKeepSubprogramDIE(
   }
 
   // Replace the debug map range with a more accurate one.
-  Ranges[LowPc] = std::make_pair(HighPc, MyInfo.AddrAdjust);
+  Ctx.Ranges[LowPc] = std::make_pair(HighPc, MyInfo.AddrAdjust);
   Unit.addFunctionRange(LowPc, HighPc, MyInfo.AddrAdjust);
   return Flags;
 }
@@ -1681,15 +1738,15 @@ unsigned DwarfLinker::shouldKeepSubprogramDIE(
 /// \brief Check if a DIE should be kept.
 /// \returns updated TraversalFlags.
 unsigned DwarfLinker::shouldKeepDIE(const DWARFDebugInfoEntryMinimal &DIE,
-                                    CompileUnit &Unit,
+                                    LinkContext &Ctx, CompileUnit &Unit,
                                     CompileUnit::DIEInfo &MyInfo,
                                     unsigned Flags) {
   switch (DIE.getTag()) {
   case dwarf::DW_TAG_constant:
   case dwarf::DW_TAG_variable:
-    return shouldKeepVariableDIE(DIE, Unit, MyInfo, Flags);
+    return shouldKeepVariableDIE(DIE, Ctx, Unit, MyInfo, Flags);
   case dwarf::DW_TAG_subprogram:
-    return shouldKeepSubprogramDIE(DIE, Unit, MyInfo, Flags);
+    return shouldKeepSubprogramDIE(DIE, Ctx, Unit, MyInfo, Flags);
   case dwarf::DW_TAG_module:
   case dwarf::DW_TAG_imported_module:
   case dwarf::DW_TAG_imported_declaration:
@@ -1711,15 +1768,15 @@ unsigned DwarfLinker::shouldKeepDIE(const DWARFDebugInfoEntryMinimal &DIE,
 /// tree walk.
 void DwarfLinker::keepDIEAndDenpendencies(const DWARFDebugInfoEntryMinimal &DIE,
                                           CompileUnit::DIEInfo &MyInfo,
-                                          const DebugMapObject &DMO,
-                                          CompileUnit &CU, unsigned Flags) {
+                                          LinkContext &Ctx, CompileUnit &CU,
+                                          unsigned Flags) {
   const DWARFUnit &Unit = CU.getOrigUnit();
   MyInfo.Keep = true;
 
   // First mark all the parent chain as kept.
   unsigned AncestorIdx = MyInfo.ParentIdx;
   while (!CU.getInfo(AncestorIdx).Keep) {
-    lookForDIEsToKeep(*Unit.getDIEAtIndex(AncestorIdx), DMO, CU,
+    lookForDIEsToKeep(*Unit.getDIEAtIndex(AncestorIdx), Ctx, CU,
                       TF_ParentWalk | TF_Keep | TF_DependencyWalk);
     AncestorIdx = CU.getInfo(AncestorIdx).ParentIdx;
   }
@@ -1741,8 +1798,9 @@ void DwarfLinker::keepDIEAndDenpendencies(const DWARFDebugInfoEntryMinimal &DIE,
 
     Val.extractValue(Data, &Offset, &Unit);
     CompileUnit *ReferencedCU;
-    if (const auto *RefDIE = resolveDIEReference(Val, Unit, DIE, ReferencedCU))
-      lookForDIEsToKeep(*RefDIE, DMO, *ReferencedCU,
+    if (const auto *RefDIE =
+            resolveDIEReference(Ctx, Val, Unit, DIE, ReferencedCU))
+      lookForDIEsToKeep(*RefDIE, Ctx, *ReferencedCU,
                         TF_Keep | TF_DependencyWalk);
   }
 }
@@ -1760,7 +1818,7 @@ void DwarfLinker::keepDIEAndDenpendencies(const DWARFDebugInfoEntryMinimal &DIE,
 /// not respected. The TF_DependencyWalk flag tells us which kind of
 /// traversal we are currently doing.
 void DwarfLinker::lookForDIEsToKeep(const DWARFDebugInfoEntryMinimal &DIE,
-                                    const DebugMapObject &DMO, CompileUnit &CU,
+                                    LinkContext &Ctx, CompileUnit &CU,
                                     unsigned Flags) {
   unsigned Idx = CU.getOrigUnit().getDIEIndex(&DIE);
   CompileUnit::DIEInfo &MyInfo = CU.getInfo(Idx);
@@ -1775,11 +1833,11 @@ void DwarfLinker::lookForDIEsToKeep(const DWARFDebugInfoEntryMinimal &DIE,
   // We must not call shouldKeepDIE while called from keepDIEAndDenpendencies,
   // because it would screw up the relocation finding logic.
   if (!(Flags & TF_DependencyWalk))
-    Flags = shouldKeepDIE(DIE, CU, MyInfo, Flags);
+    Flags = shouldKeepDIE(DIE, Ctx, CU, MyInfo, Flags);
 
   // If it is a newly kept DIE mark it as well as all its dependencies as kept.
   if (!AlreadyKept && (Flags & TF_Keep))
-    keepDIEAndDenpendencies(DIE, MyInfo, DMO, CU, Flags);
+    keepDIEAndDenpendencies(DIE, MyInfo, Ctx, CU, Flags);
 
   // The TF_ParentWalk flag tells us that we are currently walking up
   // the parent chain of a required DIE, and we don't want to mark all
@@ -1795,7 +1853,7 @@ void DwarfLinker::lookForDIEsToKeep(const DWARFDebugInfoEntryMinimal &DIE,
 
   for (auto *Child = DIE.getFirstChild(); Child && !Child->isNULL();
        Child = Child->getSibling())
-    lookForDIEsToKeep(*Child, DMO, CU, Flags);
+    lookForDIEsToKeep(*Child, Ctx, CU, Flags);
 }
 
 /// \brief Assign an abbreviation numer to \p Abbrev.
@@ -1846,7 +1904,7 @@ unsigned DwarfLinker::cloneStringAttribute(DIE &Die, AttributeSpec AttrSpec,
 /// it to \p Die.
 /// \returns the size of the new attribute.
 unsigned DwarfLinker::cloneDieReferenceAttribute(
-    DIE &Die, const DWARFDebugInfoEntryMinimal &InputDIE,
+    DIE &Die, const DWARFDebugInfoEntryMinimal &InputDIE, LinkContext &Ctx,
     AttributeSpec AttrSpec, unsigned AttrSize, const DWARFFormValue &Val,
     CompileUnit &Unit) {
   uint32_t Ref = *Val.getAsReference(&Unit.getOrigUnit());
@@ -1854,14 +1912,14 @@ unsigned DwarfLinker::cloneDieReferenceAttribute(
   CompileUnit *RefUnit = nullptr;
   const DWARFDebugInfoEntryMinimal *RefDie = nullptr;
 
-  if (!(RefUnit = getUnitForOffset(Ref)) ||
+  if (!(RefUnit = getUnitForOffset(Ctx, Ref)) ||
       !(RefDie = RefUnit->getOrigUnit().getDIEForOffset(Ref))) {
     const char *AttributeString = dwarf::AttributeString(AttrSpec.Attr);
     if (!AttributeString)
       AttributeString = "DW_AT_???";
     reportWarning(Twine("Missing DIE for ref in attribute ") + AttributeString +
                       ". Dropping.",
-                  &Unit.getOrigUnit(), &InputDIE);
+                  Ctx, &Unit.getOrigUnit(), &InputDIE);
     return 0;
   }
 
@@ -1983,9 +2041,9 @@ unsigned DwarfLinker::cloneAddressAttribute(DIE &Die, AttributeSpec AttrSpec,
 /// \brief Clone a scalar attribute  and add it to \p Die.
 /// \returns the size of the new attribute.
 unsigned DwarfLinker::cloneScalarAttribute(
-    DIE &Die, const DWARFDebugInfoEntryMinimal &InputDIE, CompileUnit &Unit,
-    AttributeSpec AttrSpec, const DWARFFormValue &Val, unsigned AttrSize,
-    AttributesInfo &Info) {
+    DIE &Die, const DWARFDebugInfoEntryMinimal &InputDIE, LinkContext &Ctx,
+    CompileUnit &Unit, AttributeSpec AttrSpec, const DWARFFormValue &Val,
+    unsigned AttrSize, AttributesInfo &Info) {
   uint64_t Value;
   if (AttrSpec.Attr == dwarf::DW_AT_high_pc &&
       Die.getTag() == dwarf::DW_TAG_compile_unit) {
@@ -2001,7 +2059,7 @@ unsigned DwarfLinker::cloneScalarAttribute(
     Value = *OptionalValue;
   else {
     reportWarning("Unsupported scalar attribute form. Dropping attribute.",
-                  &Unit.getOrigUnit(), &InputDIE);
+                  Ctx, &Unit.getOrigUnit(), &InputDIE);
     return 0;
   }
   DIEInteger Attr(Value);
@@ -2026,7 +2084,7 @@ unsigned DwarfLinker::cloneScalarAttribute(
 /// \returns the size of the cloned attribute.
 unsigned DwarfLinker::cloneAttribute(DIE &Die,
                                      const DWARFDebugInfoEntryMinimal &InputDIE,
-                                     CompileUnit &Unit,
+                                     LinkContext &Ctx, CompileUnit &Unit,
                                      const DWARFFormValue &Val,
                                      const AttributeSpec AttrSpec,
                                      unsigned AttrSize, AttributesInfo &Info) {
@@ -2041,8 +2099,8 @@ unsigned DwarfLinker::cloneAttribute(DIE &Die,
   case dwarf::DW_FORM_ref2:
   case dwarf::DW_FORM_ref4:
   case dwarf::DW_FORM_ref8:
-    return cloneDieReferenceAttribute(Die, InputDIE, AttrSpec, AttrSize, Val,
-                                      Unit);
+    return cloneDieReferenceAttribute(Die, InputDIE, Ctx, AttrSpec, AttrSize,
+                                      Val, Unit);
   case dwarf::DW_FORM_block:
   case dwarf::DW_FORM_block1:
   case dwarf::DW_FORM_block2:
@@ -2060,11 +2118,11 @@ unsigned DwarfLinker::cloneAttribute(DIE &Die,
   case dwarf::DW_FORM_sec_offset:
   case dwarf::DW_FORM_flag:
   case dwarf::DW_FORM_flag_present:
-    return cloneScalarAttribute(Die, InputDIE, Unit, AttrSpec, Val, AttrSize,
-                                Info);
+    return cloneScalarAttribute(Die, InputDIE, Ctx, Unit, AttrSpec, Val,
+                                AttrSize, Info);
   default:
-    reportWarning("Unsupported attribute form in cloneAttribute. Dropping.", &U,
-                  &InputDIE);
+    reportWarning("Unsupported attribute form in cloneAttribute. Dropping.",
+                  Ctx, &U, &InputDIE);
   }
 
   return 0;
@@ -2078,8 +2136,11 @@ unsigned DwarfLinker::cloneAttribute(DIE &Die,
 /// monotonic \p BaseOffset values.
 ///
 /// \returns wether any reloc has been applied.
-bool DwarfLinker::applyValidRelocs(MutableArrayRef<char> Data,
+bool DwarfLinker::applyValidRelocs(LinkContext &Ctx,
+                                   MutableArrayRef<char> Data,
                                    uint32_t BaseOffset, bool isLittleEndian) {
+  auto &ValidRelocs = Ctx.ValidRelocs;
+  unsigned &NextValidReloc = Ctx.NextValidReloc;
   assert((NextValidReloc == 0 ||
           BaseOffset > ValidRelocs[NextValidReloc - 1].Offset) &&
          "BaseOffset should only be increasing.");
@@ -2155,8 +2216,8 @@ static bool isTypeTag(uint16_t Tag) {
 ///
 /// \returns the cloned DIE object or null if nothing was selected.
 DIE *DwarfLinker::cloneDIE(const DWARFDebugInfoEntryMinimal &InputDIE,
-                           CompileUnit &Unit, int64_t PCOffset,
-                           uint32_t OutOffset) {
+                           LinkContext &Ctx, CompileUnit &Unit,
+                           int64_t PCOffset, uint32_t OutOffset) {
   DWARFUnit &U = Unit.getOrigUnit();
   unsigned Idx = U.getDIEIndex(&InputDIE);
   CompileUnit::DIEInfo &Info = Unit.getInfo(Idx);
@@ -2185,7 +2246,7 @@ DIE *DwarfLinker::cloneDIE(const DWARFDebugInfoEntryMinimal &InputDIE,
   SmallString<40> DIECopy(Data.getData().substr(Offset, NextOffset - Offset));
   Data = DataExtractor(DIECopy, Data.isLittleEndian(), Data.getAddressSize());
   // Modify the copy with relocated addresses.
-  if (applyValidRelocs(DIECopy, Offset, Data.isLittleEndian())) {
+  if (applyValidRelocs(Ctx, DIECopy, Offset, Data.isLittleEndian())) {
     // If we applied relocations, we store the value of high_pc that was
     // potentially stored in the input DIE. If high_pc is an address
     // (Dwarf version == 2), then it might have been relocated to a
@@ -2215,8 +2276,8 @@ DIE *DwarfLinker::cloneDIE(const DWARFDebugInfoEntryMinimal &InputDIE,
     Val.extractValue(Data, &Offset, &U);
     AttrSize = Offset - AttrSize;
 
-    OutOffset +=
-        cloneAttribute(*Die, InputDIE, Unit, Val, AttrSpec, AttrSize, AttrInfo);
+    OutOffset += cloneAttribute(*Die, InputDIE, Ctx, Unit, Val, AttrSpec,
+                                AttrSize, AttrInfo);
   }
 
   // Look for accelerator entries.
@@ -2261,7 +2322,7 @@ DIE *DwarfLinker::cloneDIE(const DWARFDebugInfoEntryMinimal &InputDIE,
   // Recursively clone children.
   for (auto *Child = InputDIE.getFirstChild(); Child && !Child->isNULL();
        Child = Child->getSibling()) {
-    if (DIE *Clone = cloneDIE(*Child, Unit, PCOffset, OutOffset)) {
+    if (DIE *Clone = cloneDIE(*Child, Ctx, Unit, PCOffset, OutOffset)) {
       Die->addChild(std::unique_ptr<DIE>(Clone));
       OutOffset = Clone->getOffset() + Clone->getSize();
     }
@@ -2278,7 +2339,8 @@ DIE *DwarfLinker::cloneDIE(const DWARFDebugInfoEntryMinimal &InputDIE,
 /// and emit them in the output file. Update the relevant attributes
 /// to point at the new entries.
 void DwarfLinker::patchRangesForUnit(const CompileUnit &Unit,
-                                     DWARFContext &OrigDwarf) const {
+                                     LinkContext &Ctx) const {
+  DWARFContext &OrigDwarf = *Ctx.DwarfContext;
   DWARFDebugRangeList RangeList;
   const auto &FunctionRanges = Unit.getFunctionRanges();
   unsigned AddressSize = Unit.getOrigUnit().getAddressByteSize();
@@ -2307,7 +2369,7 @@ void DwarfLinker::patchRangesForUnit(const CompileUnit &Unit,
       CurrRange = FunctionRanges.find(First.StartAddress + OrigLowPc);
       if (CurrRange == InvalidRange ||
           CurrRange.start() > First.StartAddress + OrigLowPc) {
-        reportWarning("no mapping for range.");
+        reportWarning("no mapping for range.", Ctx);
         continue;
       }
     }
@@ -2368,7 +2430,8 @@ static void insertLineSequence(std::vector<DWARFDebugLine::Row> &Seq,
 /// recreate a relocated version of these for the address ranges that
 /// are present in the binary.
 void DwarfLinker::patchLineTableForUnit(CompileUnit &Unit,
-                                        DWARFContext &OrigDwarf) {
+                                        LinkContext &Ctx) {
+  DWARFContext &OrigDwarf = *Ctx.DwarfContext;
   const DWARFDebugInfoEntryMinimal *CUDie = Unit.getOrigUnit().getUnitDIE();
   uint64_t StmtList = CUDie->getAttributeValueAsSectionOffset(
       &Unit.getOrigUnit(), dwarf::DW_AT_stmt_list, -1ULL);
@@ -2445,11 +2508,11 @@ void DwarfLinker::patchLineTableForUnit(CompileUnit &Unit,
           // for now do as dsymutil.
           // FIXME: Understand exactly what cases this addresses and
           // potentially remove it along with the Ranges map.
-          auto Range = Ranges.lower_bound(Row.Address);
-          if (Range != Ranges.begin() && Range != Ranges.end())
+          auto Range = Ctx.Ranges.lower_bound(Row.Address);
+          if (Range != Ctx.Ranges.begin() && Range != Ctx.Ranges.end())
             --Range;
 
-          if (Range != Ranges.end() && Range->first <= Row.Address &&
+          if (Range != Ctx.Ranges.end() && Range->first <= Row.Address &&
               Range->second.first >= Row.Address) {
             StopAddress = Row.Address + Range->second.second;
           }
@@ -2493,7 +2556,7 @@ void DwarfLinker::patchLineTableForUnit(CompileUnit &Unit,
       LineTable.Prologue.DefaultIsStmt != DWARF2_LINE_DEFAULT_IS_STMT ||
       LineTable.Prologue.LineBase != -5 || LineTable.Prologue.LineRange != 14 ||
       LineTable.Prologue.OpcodeBase != 13)
-    reportWarning("line table paramters mismatch. Cannot emit.");
+    reportWarning("line table paramters mismatch. Cannot emit.", Ctx);
   else
     Streamer->emitLineTableForUnit(LineData.slice(StmtList + 4, PrologueEnd),
                                    LineTable.Prologue.MinInstLength, NewRows,
@@ -2511,9 +2574,9 @@ void DwarfLinker::emitAcceleratorEntriesForUnit(CompileUnit &Unit) {
 /// This is actually pretty easy as the data of the CIEs and FDEs can
 /// be considered as black boxes and moved as is. The only thing to do
 /// is to patch the addresses in the headers.
-void DwarfLinker::patchFrameInfoForObject(const DebugMapObject &DMO,
-                                          DWARFContext &OrigDwarf,
+void DwarfLinker::patchFrameInfoForObject(LinkContext &Ctx,
                                           unsigned AddrSize) {
+  DWARFContext &OrigDwarf = *Ctx.DwarfContext;
   StringRef FrameData = OrigDwarf.getDebugFrameSection();
   if (FrameData.empty())
     return;
@@ -2529,7 +2592,7 @@ void DwarfLinker::patchFrameInfoForObject(const DebugMapObject &DMO,
     uint32_t EntryOffset = InputOffset;
     uint32_t InitialLength = Data.getU32(&InputOffset);
     if (InitialLength == 0xFFFFFFFF)
-      return reportWarning("Dwarf64 bits no supported");
+      return reportWarning("Dwarf64 bits no supported", Ctx);
 
     uint32_t CIEId = Data.getU32(&InputOffset);
     if (CIEId == 0xFFFFFFFF) {
@@ -2547,10 +2610,10 @@ void DwarfLinker::patchFrameInfoForObject(const DebugMapObject &DMO,
     // the function entry point, thus we can't just lookup the address
     // in the debug map. Use the linker's range map to see if the FDE
     // describes something that we can relocate.
-    auto Range = Ranges.upper_bound(Loc);
-    if (Range != Ranges.begin())
+    auto Range = Ctx.Ranges.upper_bound(Loc);
+    if (Range != Ctx.Ranges.begin())
       --Range;
-    if (Range == Ranges.end() || Range->first > Loc ||
+    if (Range == Ctx.Ranges.end() || Range->first > Loc ||
         Range->second.first <= Loc) {
       // The +4 is to account for the size of the InitialLength field itself.
       InputOffset = EntryOffset + InitialLength + 4;
@@ -2561,7 +2624,7 @@ void DwarfLinker::patchFrameInfoForObject(const DebugMapObject &DMO,
     // Have we already emitted a corresponding CIE?
     StringRef CIEData = LocalCIES[CIEId];
     if (CIEData.empty())
-      return reportWarning("Inconsistent debug_frame content. Dropping.");
+      return reportWarning("Inconsistent debug_frame content. Dropping.", Ctx);
 
     // Look if we already emitted a CIE that corresponds to the
     // referenced one (the CIE data is the key of that lookup).
@@ -2590,109 +2653,166 @@ void DwarfLinker::patchFrameInfoForObject(const DebugMapObject &DMO,
   }
 }
 
-bool DwarfLinker::link(const DebugMap &Map) {
+void DwarfLinker::analyzeDebugObject(LinkContext &Ctx) {
+  if (Options.Verbose)
+    outs() << "DEBUG MAP OBJECT: " << Ctx.DMO.getObjectFilename() << "\n";
+  auto ErrOrObj = Ctx.BinHolder.GetObjectFile(Ctx.DMO.getObjectFilename());
+  if (std::error_code EC = ErrOrObj.getError()) {
+    reportWarning(Twine(Ctx.DMO.getObjectFilename()) + ": " + EC.message(),
+                  Ctx);
+    return;
+  }
 
-  if (Map.begin() == Map.end()) {
-    errs() << "Empty debug map.\n";
-    return false;
+  // Look for relocations that correspond to debug map entries.
+  if (!findValidRelocsInDebugInfo(*ErrOrObj, Ctx)) {
+    if (Options.Verbose)
+      outs() << "No valid relocations found. Skipping.\n";
+    return;
   }
 
-  if (!createStreamer(Map.getTriple(), OutputFilename))
-    return false;
+  // Setup access to the debug info.
+  Ctx.DwarfContext = llvm::make_unique<DWARFContextInMemory>(*ErrOrObj);
+  startDebugObject(Ctx);
+
+  // In a first phase, just read in the debug info and store the DIE
+  // parent links that we will use during the next phase.
+  for (const auto &CU : Ctx.DwarfContext->compile_units()) {
+    auto *CUDie = CU->getUnitDIE(false);
+    if (Options.Verbose) {
+      outs() << "Input compilation unit:";
+      CUDie->dump(outs(), CU.get(), 0);
+    }
+    Ctx.Units.emplace_back(*CU);
+    gatherDIEParents(CUDie, 0, Ctx.Units.back());
+  }
 
-  // Size of the DIEs (and headers) generated for the linked output.
-  uint64_t OutputDebugInfoSize = 0;
-  // A unique ID that identifies each compile unit.
-  unsigned UnitID = 0;
-  for (const auto &Obj : Map.objects()) {
-    CurrentDebugObject = Obj.get();
+  // Then mark all the DIEs that need to be present in the linked
+  // output and collect some information about them. Note that this
+  // loop can not be merged with the previous one becaue cross-cu
+  // references require the ParentIdx to be setup for every CU in
+  // the object file before calling this.
+  for (auto &CurrentUnit : Ctx.Units)
+    lookForDIEsToKeep(*CurrentUnit.getOrigUnit().getUnitDIE(), Ctx,
+                      CurrentUnit, 0);
+}
 
-    if (Options.Verbose)
-      outs() << "DEBUG MAP OBJECT: " << Obj->getObjectFilename() << "\n";
-    auto ErrOrObj = BinHolder.GetObjectFile(Obj->getObjectFilename());
-    if (std::error_code EC = ErrOrObj.getError()) {
-      reportWarning(Twine(Obj->getObjectFilename()) + ": " + EC.message());
+void DwarfLinker::cloneDebugObject(LinkContext &Ctx) {
+  // Nothing was selected if the object couldn't be loaded or had no
+  // valid relocations.
+  if (!Ctx.DwarfContext)
+    return;
+
+  // Unit IDs are assigned here rather than during the analysis, so
+  // that they do not depend on the order the objects were analyzed in.
+  for (auto &CurrentUnit : Ctx.Units)
+    CurrentUnit.setUniqueID(UnitID++);
+
+  // The calls to applyValidRelocs inside cloneDIE will walk the
+  // reloc array again (in the same way findValidRelocsInDebugInfo()
+  // did). We need to reset the NextValidReloc index to the beginning.
+  Ctx.NextValidReloc = 0;
+
+  // Construct the output DIE tree by cloning the DIEs we chose to
+  // keep above. If there are no valid relocs, then there's nothing
+  // to clone/emit.
+  if (Ctx.ValidRelocs.empty())
+    return;
+
+  for (auto &CurrentUnit : Ctx.Units) {
+    const auto *InputDIE = CurrentUnit.getOrigUnit().getUnitDIE();
+    CurrentUnit.setStartOffset(OutputDebugInfoSize);
+    DIE *OutputDIE = cloneDIE(*InputDIE, Ctx, CurrentUnit, 0 /* PCOffset */,
+                              11 /* Unit Header size */);
+    CurrentUnit.setOutputUnitDIE(OutputDIE);
+    OutputDebugInfoSize = CurrentUnit.computeNextUnitOffset();
+    if (Options.NoOutput)
       continue;
-    }
+    // FIXME: for compatibility with the classic dsymutil, we emit
+    // an empty line table for the unit, even if the unit doesn't
+    // actually exist in the DIE tree.
+    patchLineTableForUnit(CurrentUnit, Ctx);
+    if (!OutputDIE)
+      continue;
+    patchRangesForUnit(CurrentUnit, Ctx);
+    Streamer->emitLocationsForUnit(CurrentUnit, *Ctx.DwarfContext);
+    emitAcceleratorEntriesForUnit(CurrentUnit);
+  }
 
-    // Look for relocations that correspond to debug map entries.
-    if (!findValidRelocsInDebugInfo(*ErrOrObj, *Obj)) {
-      if (Options.Verbose)
-        outs() << "No valid relocations found. Skipping.\n";
+  if (Options.NoOutput)
+    return;
+
+  // Emit all the compile unit's debug information.
+  for (auto &CurrentUnit : Ctx.Units) {
+    generateUnitRanges(CurrentUnit);
+    CurrentUnit.fixupForwardReferences();
+    Streamer->emitCompileUnitHeader(CurrentUnit);
+    if (!CurrentUnit.getOutputUnitDIE())
       continue;
-    }
+    Streamer->emitDIE(*CurrentUnit.getOutputUnitDIE());
+  }
 
-    // Setup access to the debug info.
-    DWARFContextInMemory DwarfContext(*ErrOrObj);
-    startDebugObject(DwarfContext, *Obj);
-
-    // In a first phase, just read in the debug info and store the DIE
-    // parent links that we will use during the next phase.
-    for (const auto &CU : DwarfContext.compile_units()) {
-      auto *CUDie = CU->getUnitDIE(false);
-      if (Options.Verbose) {
-        outs() << "Input compilation unit:";
-        CUDie->dump(outs(), CU.get(), 0);
-      }
-      Units.emplace_back(*CU, UnitID++);
-      gatherDIEParents(CUDie, 0, Units.back());
-    }
+  if (!Ctx.Units.empty())
+    patchFrameInfoForObject(Ctx,
+                            Ctx.Units[0].getOrigUnit().getAddressByteSize());
+}
 
-    // Then mark all the DIEs that need to be present in the linked
-    // output and collect some information about them. Note that this
-    // loop can not be merged with the previous one becaue cross-cu
-    // references require the ParentIdx to be setup for every CU in
-    // the object file before calling this.
-    for (auto &CurrentUnit : Units)
-      lookForDIEsToKeep(*CurrentUnit.getOrigUnit().getUnitDIE(), *Obj,
-                        CurrentUnit, 0);
-
-    // The calls to applyValidRelocs inside cloneDIE will walk the
-    // reloc array again (in the same way findValidRelocsInDebugInfo()
-    // did). We need to reset the NextValidReloc index to the beginning.
-    NextValidReloc = 0;
-
-    // Construct the output DIE tree by cloning the DIEs we chose to
-    // keep above. If there are no valid relocs, then there's nothing
-    // to clone/emit.
-    if (!ValidRelocs.empty())
-      for (auto &CurrentUnit : Units) {
-        const auto *InputDIE = CurrentUnit.getOrigUnit().getUnitDIE();
-        CurrentUnit.setStartOffset(OutputDebugInfoSize);
-        DIE *OutputDIE = cloneDIE(*InputDIE, CurrentUnit, 0 /* PCOffset */,
-                                  11 /* Unit Header size */);
-        CurrentUnit.setOutputUnitDIE(OutputDIE);
-        OutputDebugInfoSize = CurrentUnit.computeNextUnitOffset();
-        if (Options.NoOutput)
-          continue;
-        // FIXME: for compatibility with the classic dsymutil, we emit
-        // an empty line table for the unit, even if the unit doesn't
-        // actually exist in the DIE tree.
-        patchLineTableForUnit(CurrentUnit, DwarfContext);
-        if (!OutputDIE)
-          continue;
-        patchRangesForUnit(CurrentUnit, DwarfContext);
-        Streamer->emitLocationsForUnit(CurrentUnit, DwarfContext);
-        emitAcceleratorEntriesForUnit(CurrentUnit);
-      }
+bool DwarfLinker::link(const DebugMap &Map) {
 
-    // Emit all the compile unit's debug information.
-    if (!ValidRelocs.empty() && !Options.NoOutput)
-      for (auto &CurrentUnit : Units) {
-        generateUnitRanges(CurrentUnit);
-        CurrentUnit.fixupForwardReferences();
-        Streamer->emitCompileUnitHeader(CurrentUnit);
-        if (!CurrentUnit.getOutputUnitDIE())
-          continue;
-        Streamer->emitDIE(*CurrentUnit.getOutputUnitDIE());
-      }
+  if (Map.begin() == Map.end()) {
+    errs() << "Empty debug map.\n";
+    return false;
+  }
 
-    if (!ValidRelocs.empty() && !Options.NoOutput && !Units.empty())
-      patchFrameInfoForObject(*Obj, DwarfContext,
-                              Units[0].getOrigUnit().getAddressByteSize());
+  if (!createStreamer(Map.getTriple(), OutputFilename))
+    return false;
 
+  std::vector<std::unique_ptr<LinkContext>> Contexts;
+  for (const auto &Obj : Map.objects())
+    Contexts.push_back(llvm::make_unique<LinkContext>(*Obj, Options.Verbose));
+
+  auto LinkObject = [&](unsigned Idx) {
+    cloneDebugObject(*Contexts[Idx]);
     // Clean-up before starting working on the next object.
-    endDebugObject();
+    endDebugObject(*Contexts[Idx]);
+    Contexts[Idx].reset();
+  };
+
+  unsigned NumThreads = Options.NumThreads;
+  if (!NumThreads)
+    NumThreads = thread::hardware_concurrency();
+  // The verbose output is printed while analyzing the objects, keep it in
+  // debug map order.
+  if (Options.Verbose)
+    NumThreads = 1;
+
+  if (NumThreads <= 1 || Contexts.size() == 1) {
+    for (unsigned I = 0, E = Contexts.size(); I != E; ++I) {
+      analyzeDebugObject(*Contexts[I]);
+      LinkObject(I);
+    }
+  } else {
+    // Analyze the objects on NumThreads - 1 workers, while this thread
+    // clones them in debug map order. Limit how far the analysis gets
+    // ahead of the cloning, as every analyzed object keeps its debug info
+    // in memory until it is cloned.
+    ThreadPool Pool(NumThreads - 1);
+    unsigned Window = 2 * (NumThreads - 1);
+    std::vector<std::shared_future<ThreadPool::VoidTy>> Analyzed;
+    Analyzed.reserve(Contexts.size());
+    auto ScheduleAnalysis = [&](unsigned Idx) {
+      LinkContext &Ctx = *Contexts[Idx];
+      Analyzed.push_back(Pool.async([this, &Ctx] { analyzeDebugObject(Ctx); }));
+    };
+
+    for (unsigned I = 0, E = std::min<size_t>(Window, Contexts.size()); I != E;
+         ++I)
+      ScheduleAnalysis(I);
+    for (unsigned I = 0, E = Contexts.size(); I != E; ++I) {
+      Analyzed[I].wait();
+      if (I + Window < E)
+        ScheduleAnalysis(I + Window);
+      LinkObject(I);
+    }
   }
 
   // Emit everything that's global.
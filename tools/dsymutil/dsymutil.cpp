@@ -47,6 +47,15 @@ static opt<bool>
              desc("Do the link in memory, but do not emit the result file."),
              init(false));
 
+static opt<unsigned> NumThreads(
+    "num-threads",
+    desc("Specify the maximum number (n) of simultaneous threads to use\n"
+         "when linking multiple object files. Defaults to the number of\n"
+         "hardware threads. The output doesn't depend on this setting."),
+    value_desc("n"), init(0));
+static alias NumThreadsA("j", desc("Alias for --num-threads"),
+                         aliasopt(NumThreads), Prefix, ValueRequired);
+
 static opt<bool> DumpDebugMap(
     "dump-debug-map",
     desc("Parse and dump the debug map to standard output. Not DWARF link "
@@ -71,6 +80,7 @@ int main(int argc, char **argv) {
 
   Options.Verbose = Verbose;
   Options.NoOutput = NoOutput;
+  Options.NumThreads = NumThreads;
 
   llvm::InitializeAllTargetInfos();
   llvm::InitializeAllTargetMCs();
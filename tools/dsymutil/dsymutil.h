@@ -25,10 +25,11 @@ namespace llvm {
 namespace dsymutil {
 
 struct LinkOptions {
-  bool Verbose;  ///< Verbosity
-  bool NoOutput; ///< Skip emitting output
+  bool Verbose;        ///< Verbosity
+  bool NoOutput;       ///< Skip emitting output
+  unsigned NumThreads; ///< Number of threads, 0 for one per hardware thread
 
-  LinkOptions() : Verbose(false), NoOutput(false) {}
+  LinkOptions() : Verbose(false), NoOutput(false), NumThreads(0) {}
 };
 
 /// \brief Extract the DebugMap from the given file.
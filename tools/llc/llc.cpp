@@ -21,6 +21,7 @@
 #include "llvm/CodeGen/LinkAllAsmWriterComponents.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
 #include "llvm/CodeGen/MIRParser/MIRParser.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LLVMContext.h"
@@ -63,6 +64,11 @@ TimeCompilations("time-compilations", cl::Hidden, cl::init(1u),
                  cl::value_desc("N"),
                  cl::desc("Repeat compilation N times for timing"));
 
+static cl::opt<unsigned>
+CodeGenThreads("codegen-threads", cl::init(1u), cl::value_desc("N"),
+               cl::desc("Generate code for the functions of the module on up "
+                        "to N threads, producing the same single output"));
+
 static cl::opt<bool>
 NoIntegratedAssembler("no-integrated-as", cl::Hidden,
                       cl::desc("Disable integrated assembler"));
@@ -353,18 +359,33 @@ static int compileModule(char **argv, LLVMContext &Context) {
       StopAfterID = PI->getTypeInfo();
     }
 
-    // Ask the target to add backend passes as necessary.
-    if (Target->addPassesToEmitFile(PM, *OS, FileType, NoVerify, StartAfterID,
-                                    StopAfterID, MIR.get())) {
-      errs() << argv[0] << ": target does not support generation of this"
-             << " file type!\n";
-      return 1;
-    }
+    if (CodeGenThreads > 1) {
+      if (StartAfterID || StopAfterID || MIR || DisableSimplifyLibCalls) {
+        errs() << argv[0] << ": -codegen-threads cannot be used with "
+               << "-start-after, -stop-after, -disable-simplify-libcalls or "
+               << "MIR input\n";
+        return 1;
+      }
 
-    // Before executing passes, print the final values of the LLVM options.
-    cl::PrintOptionValues();
+      cl::PrintOptionValues();
+
+      // The module is code generated in pieces by pass managers of their own.
+      splitCodeGenInOrder(*M, *OS, CodeGenThreads, CPUStr, FeaturesStr,
+                          Options, RelocModel, CMModel, OLvl, FileType);
+    } else {
+      // Ask the target to add backend passes as necessary.
+      if (Target->addPassesToEmitFile(PM, *OS, FileType, NoVerify,
+                                      StartAfterID, StopAfterID, MIR.get())) {
+        errs() << argv[0] << ": target does not support generation of this"
+               << " file type!\n";
+        return 1;
+      }
 
-    PM.run(*M);
+      // Before executing passes, print the final values of the LLVM options.
+      cl::PrintOptionValues();
+
+      PM.run(*M);
+    }
   }
 
   // Declare success.
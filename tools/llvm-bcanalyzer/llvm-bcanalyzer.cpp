@@ -114,6 +114,7 @@ static const char *GetBlockName(unsigned BlockID,
   case bitc::METADATA_BLOCK_ID:        return "METADATA_BLOCK";
   case bitc::METADATA_ATTACHMENT_ID:   return "METADATA_ATTACHMENT_BLOCK";
   case bitc::USELIST_BLOCK_ID:         return "USELIST_BLOCK_ID";
+  case bitc::FUNCTION_SUMMARY_BLOCK_ID: return "FUNCTION_SUMMARY_BLOCK";
   }
 }
 
@@ -162,6 +163,7 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     case bitc::MODULE_CODE_ALIAS:       return "ALIAS";
     case bitc::MODULE_CODE_PURGEVALS:   return "PURGEVALS";
     case bitc::MODULE_CODE_GCNAME:      return "GCNAME";
+    case bitc::MODULE_CODE_VSTOFFSET:   return "VSTOFFSET";
     }
   case bitc::PARAMATTR_BLOCK_ID:
     switch (CodeID) {
@@ -262,6 +264,7 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     default: return nullptr;
     case bitc::VST_CODE_ENTRY: return "ENTRY";
     case bitc::VST_CODE_BBENTRY: return "BBENTRY";
+    case bitc::VST_CODE_FNENTRY: return "FNENTRY";
     }
   case bitc::METADATA_ATTACHMENT_ID:
     switch(CodeID) {
@@ -286,6 +289,14 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     case bitc::USELIST_CODE_DEFAULT: return "USELIST_CODE_DEFAULT";
     case bitc::USELIST_CODE_BB:      return "USELIST_CODE_BB";
     }
+  case bitc::FUNCTION_SUMMARY_BLOCK_ID:
+    switch(CodeID) {
+    default:return nullptr;
+    case bitc::FS_CODE_MODULE_PATH:     return "MODULE_PATH";
+    case bitc::FS_CODE_NAME:            return "NAME";
+    case bitc::FS_CODE_PERMODULE_ENTRY: return "PERMODULE_ENTRY";
+    case bitc::FS_CODE_COMBINED_ENTRY:  return "COMBINED_ENTRY";
+    }
   }
 }
 
@@ -69,6 +69,10 @@ DumpType("debug-dump", cl::init(DIDT_All),
         clEnumValN(DIDT_StrOffsetsDwo, "str_offsets.dwo", ".debug_str_offsets.dwo"),
         clEnumValEnd));
 
+static cl::opt<unsigned> MaxUnitsWithDIEs(
+    "max-units-with-dies", cl::init(0), cl::value_desc("N"),
+    cl::desc("Keep the DIEs of at most N units in memory (0 means no limit)"));
+
 static void DumpInput(StringRef Filename) {
   ErrorOr<std::unique_ptr<MemoryBuffer>> BuffOrErr =
       MemoryBuffer::getFileOrSTDIN(Filename);
@@ -87,7 +91,8 @@ static void DumpInput(StringRef Filename) {
   }
   ObjectFile &Obj = *ObjOrErr.get();
 
-  std::unique_ptr<DIContext> DICtx(new DWARFContextInMemory(Obj));
+  std::unique_ptr<DWARFContext> DICtx(new DWARFContextInMemory(Obj));
+  DICtx->setMaxUnitsWithDIEs(MaxUnitsWithDIEs);
 
   outs() << Filename
          << ":\tfile format " << Obj.getFileFormatName() << "\n\n";
@@ -69,6 +69,12 @@ static cl::opt<bool> PreserveBitcodeUseListOrder(
     cl::desc("Preserve use-list order when writing LLVM bitcode."),
     cl::init(true), cl::Hidden);
 
+static cl::opt<unsigned> BitcodeWriterThreads(
+    "bitcode-writer-threads",
+    cl::desc("Encode the function bodies of the output on up to N threads "
+             "(0 for one per hardware thread)"),
+    cl::value_desc("N"), cl::init(1));
+
 static cl::opt<bool> PreserveAssemblyUseListOrder(
     "preserve-ll-uselistorder",
     cl::desc("Preserve use-list order when writing LLVM assembly."),
@@ -175,7 +181,8 @@ int main(int argc, char **argv) {
   if (OutputAssembly) {
     Composite->print(Out.os(), nullptr, PreserveAssemblyUseListOrder);
   } else if (Force || !CheckBitcodeOutputToConsole(Out.os(), true))
-    WriteBitcodeToFile(Composite.get(), Out.os(), PreserveBitcodeUseListOrder);
+    WriteBitcodeToFile(Composite.get(), Out.os(), PreserveBitcodeUseListOrder,
+                       /*EmitFunctionSummary=*/false, BitcodeWriterThreads);
 
   // Declare success.
   Out.keep();
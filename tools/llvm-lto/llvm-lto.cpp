@@ -12,8 +12,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/CommandFlags.h"
+#include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/FunctionInfo.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
 #include "llvm/LTO/LTOModule.h"
 #include "llvm/Support/CommandLine.h"
@@ -73,6 +77,32 @@ static cl::opt<bool> ListSymbolsOnly(
     "list-symbols-only", cl::init(false),
     cl::desc("Instead of running LTO, list the symbols in each IR file"));
 
+static cl::opt<unsigned> CodeGenJobs(
+    "codegen-jobs", cl::init(1),
+    cl::desc("Split the merged module into this many partitions and generate "
+             "code for them in parallel, writing <output>0, <output>1, ..."));
+
+static cl::opt<std::string>
+    CacheDir("cache-dir", cl::init(""),
+             cl::desc("Directory used to cache the generated objects"));
+
+static cl::opt<int> CachePruningInterval(
+    "cache-pruning-interval", cl::init(1200),
+    cl::desc("Minimum interval in seconds between two cache prunings "
+             "(negative to disable pruning)"));
+
+static cl::opt<unsigned> CacheEntryExpiration(
+    "cache-entry-expiration", cl::init(7 * 24 * 3600),
+    cl::desc("Remove cache entries unused for this many seconds"));
+
+static cl::opt<unsigned long long> MaxCacheSize(
+    "max-cache-size", cl::init(0),
+    cl::desc("Maximum size in bytes of the cache directory"));
+
+static cl::opt<bool>
+    ThinLTO("thinlto", cl::init(false),
+            cl::desc("Only write combined global index for ThinLTO backends"));
+
 static cl::opt<bool> SetMergedModule(
     "set-merged-module", cl::init(false),
     cl::desc("Use the first input module as the merged module"));
@@ -116,6 +146,65 @@ getLocalLTOModule(StringRef Path, std::unique_ptr<MemoryBuffer> &Buffer,
       Buffer->getBufferStart(), Buffer->getBufferSize(), Options, Error, Path));
 }
 
+static void diagnosticHandler(const DiagnosticInfo &DI) {
+  raw_ostream &OS = errs();
+  DiagnosticPrinterRawOStream DP(OS);
+  DI.print(DP);
+  OS << '\n';
+}
+
+/// Parse the function index out of an IR file and return the function
+/// index object if found, or nullptr if not.
+static std::unique_ptr<FunctionInfoIndex>
+getFunctionIndexForFile(StringRef Path, std::string &Error) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getFile(Path);
+  if (std::error_code EC = BufferOrErr.getError()) {
+    Error = EC.message();
+    return nullptr;
+  }
+  ErrorOr<std::unique_ptr<FunctionInfoIndex>> IndexOrErr =
+      getFunctionInfoIndex((*BufferOrErr)->getMemBufferRef(),
+                           diagnosticHandler);
+  if (std::error_code EC = IndexOrErr.getError()) {
+    Error = EC.message();
+    return nullptr;
+  }
+  return std::move(IndexOrErr.get());
+}
+
+/// \brief Create a combined index file from the input IR files and write it.
+///
+/// This is the "thin link" step of ThinLTO: only the function summaries of the
+/// inputs are read, no IR is loaded.
+static int createCombinedFunctionIndex(StringRef Command) {
+  FunctionInfoIndex CombinedIndex;
+  uint64_t NextModuleId = 0;
+  for (auto &Filename : InputFilenames) {
+    std::string Error;
+    std::unique_ptr<FunctionInfoIndex> Index =
+        getFunctionIndexForFile(Filename, Error);
+    if (!Index) {
+      errs() << Command << ": error loading file '" << Filename
+             << "': " << Error << "\n";
+      return 1;
+    }
+    CombinedIndex.mergeFrom(*Index, NextModuleId);
+  }
+  std::error_code EC;
+  assert(!OutputFilename.empty());
+  raw_fd_ostream OS(OutputFilename + ".thinlto.bc", EC,
+                    sys::fs::OpenFlags::F_None);
+  if (EC) {
+    errs() << Command << ": error opening the file '" << OutputFilename
+           << ".thinlto.bc': " << EC.message() << "\n";
+    return 1;
+  }
+  WriteFunctionSummaryToFile(CombinedIndex, OS);
+  OS.close();
+  return 0;
+}
+
 /// \brief List symbols in each IR file.
 ///
 /// The main point here is to provide lit-testable coverage for the LTOModule
@@ -167,6 +256,14 @@ int main(int argc, char **argv) {
   if (ListSymbolsOnly)
     return listSymbols(argv[0], Options);
 
+  if (ThinLTO) {
+    if (OutputFilename.empty()) {
+      errs() << argv[0] << ": -thinlto requires an output file name\n";
+      return 1;
+    }
+    return createCombinedFunctionIndex(argv[0]);
+  }
+
   unsigned BaseArg = 0;
 
   LTOCodeGenerator CodeGen;
@@ -252,7 +349,42 @@ int main(int argc, char **argv) {
   if (!attrs.empty())
     CodeGen.setAttr(attrs.c_str());
 
-  if (!OutputFilename.empty()) {
+  CodeGen.setCacheDir(CacheDir);
+  CodeGen.setCachePruningInterval(CachePruningInterval);
+  CodeGen.setCacheEntryExpiration(CacheEntryExpiration);
+  CodeGen.setMaxCacheSize(MaxCacheSize);
+
+  if (CodeGenJobs > 1) {
+    if (OutputFilename.empty()) {
+      errs() << argv[0] << ": -codegen-jobs requires an output filename\n";
+      return 1;
+    }
+
+    std::string ErrorInfo;
+    std::vector<std::unique_ptr<MemoryBuffer>> Objects;
+    CodeGen.setCodeGenJobs(CodeGenJobs);
+    if (!CodeGen.optimize(DisableInline, DisableGVNLoadPRE,
+                          DisableLTOVectorization, ErrorInfo) ||
+        !CodeGen.compileOptimizedParallel(Objects, ErrorInfo)) {
+      errs() << argv[0]
+             << ": error compiling the code: " << ErrorInfo << "\n";
+      return 1;
+    }
+
+    for (unsigned I = 0, E = Objects.size(); I != E; ++I) {
+      std::string PartFilename = OutputFilename + utostr(I);
+      std::error_code EC;
+      raw_fd_ostream FileStream(PartFilename, EC, sys::fs::F_None);
+      if (EC) {
+        errs() << argv[0] << ": error opening the file '" << PartFilename
+               << "': " << EC.message() << "\n";
+        return 1;
+      }
+
+      FileStream.write(Objects[I]->getBufferStart(),
+                       Objects[I]->getBufferSize());
+    }
+  } else if (!OutputFilename.empty()) {
     std::string ErrorInfo;
     std::unique_ptr<MemoryBuffer> Code = CodeGen.compile(
         DisableInline, DisableGVNLoadPRE, DisableLTOVectorization, ErrorInfo);
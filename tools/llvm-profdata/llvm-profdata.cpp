@@ -11,7 +11,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/ProfileData/InstrProfWriter.h"
@@ -25,7 +29,11 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 
 using namespace llvm;
 
@@ -41,8 +49,83 @@ namespace {
 enum ProfileKinds { instr, sample };
 }
 
-static void mergeInstrProfile(const cl::list<std::string> &Inputs,
-                              StringRef OutputFilename) {
+/// Return the number of threads to merge \p NumInputs inputs with, given the
+/// requested number of threads (0 meaning one per hardware thread).
+static unsigned getNumMergeThreads(unsigned NumThreads, size_t NumInputs) {
+  if (!NumThreads)
+    NumThreads = std::max(1u, thread::hardware_concurrency());
+  return std::max<size_t>(1, std::min<size_t>(NumThreads, NumInputs));
+}
+
+/// Call \p MergeInput(Worker, Idx) for each input index \p Idx below
+/// \p NumInputs, on \p NumWorkers threads numbered by \p Worker.
+///
+/// Each thread takes the next input in command line order as soon as it is
+/// done with the previous one, so a single thread merges the inputs in order.
+/// When \p MergeInput returns false, the inputs after \p Idx are skipped.
+static void forEachInput(size_t NumInputs, unsigned NumWorkers,
+                         function_ref<bool(unsigned, size_t)> MergeInput) {
+  std::atomic<size_t> NextInput(0), EndInput(NumInputs);
+  auto Work = [&](unsigned Worker) {
+    for (;;) {
+      size_t Idx = NextInput++;
+      if (Idx >= EndInput)
+        return;
+      if (MergeInput(Worker, Idx))
+        continue;
+      size_t End = EndInput;
+      while (Idx + 1 < End && !EndInput.compare_exchange_weak(End, Idx + 1))
+        ;
+    }
+  };
+  if (NumWorkers == 1)
+    return Work(0);
+
+  ThreadPool Pool(NumWorkers);
+  for (unsigned I = 0; I < NumWorkers; ++I)
+    Pool.async([&Work, I] { Work(I); });
+  Pool.wait();
+}
+
+/// Return the index of the first input that failed to be read, or the number
+/// of inputs if none did.
+static size_t getFirstInputError(ArrayRef<std::string> InputErrors) {
+  return std::find_if(InputErrors.begin(), InputErrors.end(),
+                      [](const std::string &Error) { return !Error.empty(); }) -
+         InputErrors.begin();
+}
+
+/// Number of parts the merged profile is split into per thread. The functions
+/// are spread over the parts by name, so that threads adding the records of
+/// different functions rarely wait for each other.
+static const unsigned PartitionsPerThread = 8;
+
+namespace {
+/// The functions of the merged instrumentation profile whose name hashes to
+/// this part.
+struct InstrMergePartition {
+  std::mutex Lock;
+  InstrProfWriter Writer;
+  /// Functions for which some record failed to merge.
+  StringSet<> FailedFunctions;
+};
+
+/// The counts of a function read from an input, copied out of its reader.
+struct InstrRecord {
+  std::string Name;
+  uint64_t Hash;
+  std::vector<uint64_t> Counts;
+};
+
+/// The functions of the merged sample profile whose name hashes to this part.
+struct SampleMergePartition {
+  std::mutex Lock;
+  StringMap<sampleprof::FunctionSamples> Profiles;
+};
+}
+
+static void mergeInstrProfile(ArrayRef<std::string> Inputs,
+                              StringRef OutputFilename, unsigned NumThreads) {
   if (OutputFilename.compare("-") == 0)
     exitWithError("Cannot write indexed profdata format to stdout.");
 
@@ -51,53 +134,145 @@ static void mergeInstrProfile(const cl::list<std::string> &Inputs,
   if (EC)
     exitWithError(EC.message(), OutputFilename);
 
-  InstrProfWriter Writer;
-  for (const auto &Filename : Inputs) {
+  // Every function is merged in a single part, so the parts together hold one
+  // copy of the profile whatever the number of threads. Records are added as
+  // they are read, so no more than one input per thread is read at a time.
+  unsigned NumWorkers = getNumMergeThreads(NumThreads, Inputs.size());
+  bool Ordered = NumWorkers == 1;
+  std::vector<InstrMergePartition> Partitions(
+      Ordered ? 1 : NumWorkers * PartitionsPerThread);
+  std::vector<std::string> InputErrors(Inputs.size());
+  std::string Warnings;
+  forEachInput(Inputs.size(), NumWorkers, [&](unsigned, size_t Idx) {
+    const std::string &Filename = Inputs[Idx];
     auto ReaderOrErr = InstrProfReader::create(Filename);
-    if (std::error_code ec = ReaderOrErr.getError())
-      exitWithError(ec.message(), Filename);
+    if (std::error_code EC = ReaderOrErr.getError()) {
+      InputErrors[Idx] = EC.message();
+      return false;
+    }
 
     auto Reader = std::move(ReaderOrErr.get());
-    for (const auto &I : *Reader)
+    for (const auto &I : *Reader) {
+      InstrMergePartition &Partition =
+          Partitions[hash_value(I.Name) % Partitions.size()];
+      std::lock_guard<std::mutex> Guard(Partition.Lock);
       if (std::error_code EC =
-              Writer.addFunctionCounts(I.Name, I.Hash, I.Counts))
-        errs() << Filename << ": " << I.Name << ": " << EC.message() << "\n";
-    if (Reader->hasError())
-      exitWithError(Reader->getError().message(), Filename);
+              Partition.Writer.addFunctionCounts(I.Name, I.Hash, I.Counts)) {
+        Partition.FailedFunctions.insert(I.Name);
+        if (Ordered)
+          Warnings += (Twine(Filename) + ": " + I.Name + ": " + EC.message() +
+                       "\n").str();
+      }
+    }
+    if (Reader->hasError()) {
+      InputErrors[Idx] = Reader->getError().message();
+      return false;
+    }
+    return true;
+  });
+
+  // A serial merge stops at the first input it can't read.
+  size_t FirstError = getFirstInputError(InputErrors);
+  size_t NumMerged = std::min(FirstError + 1, Inputs.size());
+
+  // A record that fails to merge is dropped and reported against the input it
+  // comes from. Out of order, another record of the same function may be the
+  // one dropped, and the counters may overflow on another one. Drop the
+  // functions with failed records and merge their records again, in input
+  // order, to drop and report the same records as a serial merge. Only the
+  // records of these functions are kept when the inputs are read again.
+  InstrProfWriter Writer;
+  StringSet<> FailedFunctions;
+  for (InstrMergePartition &Partition : Partitions) {
+    if (!Ordered)
+      for (const auto &F : Partition.FailedFunctions) {
+        Partition.Writer.removeFunctionCounts(F.getKey());
+        FailedFunctions.insert(F.getKey());
+      }
+    Writer.mergeRecordsFromWriter(std::move(Partition.Writer),
+                                  [](StringRef, std::error_code) {
+      llvm_unreachable("Functions are merged in a single partition");
+    });
+  }
+  Partitions.clear();
+
+  if (!FailedFunctions.empty()) {
+    std::vector<std::vector<InstrRecord>> FailedRecords(NumMerged);
+    forEachInput(NumMerged, NumWorkers, [&](unsigned, size_t Idx) {
+      // Read errors were already recorded above.
+      auto ReaderOrErr = InstrProfReader::create(Inputs[Idx]);
+      if (ReaderOrErr.getError())
+        return false;
+      for (const auto &I : *ReaderOrErr.get())
+        if (FailedFunctions.count(I.Name))
+          FailedRecords[Idx].push_back({I.Name, I.Hash, I.Counts});
+      return true;
+    });
+    for (size_t Idx = 0; Idx < NumMerged; ++Idx)
+      for (const InstrRecord &R : FailedRecords[Idx])
+        if (std::error_code EC =
+                Writer.addFunctionCounts(R.Name, R.Hash, R.Counts))
+          Warnings += (Twine(Inputs[Idx]) + ": " + R.Name + ": " +
+                       EC.message() + "\n").str();
   }
+
+  errs() << Warnings;
+  if (FirstError != Inputs.size())
+    exitWithError(InputErrors[FirstError], Inputs[FirstError]);
   Writer.write(Output);
 }
 
-static void mergeSampleProfile(const cl::list<std::string> &Inputs,
+static void mergeSampleProfile(ArrayRef<std::string> Inputs,
                                StringRef OutputFilename,
-                               sampleprof::SampleProfileFormat OutputFormat) {
+                               sampleprof::SampleProfileFormat OutputFormat,
+                               unsigned NumThreads) {
   using namespace sampleprof;
   auto WriterOrErr = SampleProfileWriter::create(OutputFilename, OutputFormat);
   if (std::error_code EC = WriterOrErr.getError())
     exitWithError(EC.message(), OutputFilename);
 
-  auto Writer = std::move(WriterOrErr.get());
-  StringMap<FunctionSamples> ProfileMap;
-  for (const auto &Filename : Inputs) {
-    auto ReaderOrErr =
-        SampleProfileReader::create(Filename, getGlobalContext());
-    if (std::error_code EC = ReaderOrErr.getError())
-      exitWithError(EC.message(), Filename);
+  // Samples are summed whatever the order, so the parts only need to be put
+  // together at the end. Each reader is destroyed once its profiles have been
+  // added, so only one input per thread is held in memory at any time.
+  unsigned NumWorkers = getNumMergeThreads(NumThreads, Inputs.size());
+  std::vector<SampleMergePartition> Partitions(
+      NumWorkers == 1 ? 1 : NumWorkers * PartitionsPerThread);
+  std::vector<LLVMContext> Contexts(NumWorkers);
+  std::vector<std::string> InputErrors(Inputs.size());
+  forEachInput(Inputs.size(), NumWorkers, [&](unsigned Worker, size_t Idx) {
+    auto ReaderOrErr = SampleProfileReader::create(Inputs[Idx],
+                                                   Contexts[Worker]);
+    if (std::error_code EC = ReaderOrErr.getError()) {
+      InputErrors[Idx] = EC.message();
+      return false;
+    }
 
     auto Reader = std::move(ReaderOrErr.get());
-    if (std::error_code EC = Reader->read())
-      exitWithError(EC.message(), Filename);
-
-    StringMap<FunctionSamples> &Profiles = Reader->getProfiles();
-    for (StringMap<FunctionSamples>::iterator I = Profiles.begin(),
-                                              E = Profiles.end();
-         I != E; ++I) {
-      StringRef FName = I->first();
-      FunctionSamples &Samples = I->second;
-      ProfileMap[FName].merge(Samples);
+    if (std::error_code EC = Reader->read()) {
+      InputErrors[Idx] = EC.message();
+      return false;
     }
+
+    for (const auto &I : Reader->getProfiles()) {
+      SampleMergePartition &Partition =
+          Partitions[hash_value(I.first()) % Partitions.size()];
+      std::lock_guard<std::mutex> Guard(Partition.Lock);
+      Partition.Profiles[I.first()].merge(I.second);
+    }
+    return true;
+  });
+
+  size_t FirstError = getFirstInputError(InputErrors);
+  if (FirstError != Inputs.size())
+    exitWithError(InputErrors[FirstError], Inputs[FirstError]);
+
+  StringMap<FunctionSamples> Profiles;
+  for (SampleMergePartition &Partition : Partitions) {
+    for (const auto &I : Partition.Profiles)
+      Profiles[I.first()].merge(I.second);
+    Partition.Profiles.clear();
   }
-  Writer->write(ProfileMap);
+  WriterOrErr.get()->write(Profiles);
 }
 
 static int merge_main(int argc, const char *argv[]) {
@@ -123,12 +298,21 @@ static int merge_main(int argc, const char *argv[]) {
                  clEnumValN(sampleprof::SPF_GCC, "gcc", "GCC encoding"),
                  clEnumValEnd));
 
+  cl::opt<unsigned> NumThreads(
+      "num-threads", cl::init(0),
+      cl::desc("Number of merge threads to use (default: one per hardware "
+               "thread, at most one per input)"));
+  cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                        cl::aliasopt(NumThreads), cl::Prefix,
+                        cl::ValueRequired);
+
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
+  std::vector<std::string> Filenames(Inputs.begin(), Inputs.end());
   if (ProfileKind == instr)
-    mergeInstrProfile(Inputs, OutputFilename);
+    mergeInstrProfile(Filenames, OutputFilename, NumThreads);
   else
-    mergeSampleProfile(Inputs, OutputFilename, OutputFormat);
+    mergeSampleProfile(Filenames, OutputFilename, OutputFormat, NumThreads);
 
   return 0;
 }
@@ -51,8 +51,9 @@ getDILineInfoSpecifier(const LLVMSymbolizer::Options &Opts) {
       Opts.PrintFunctions);
 }
 
-ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
-    : Module(Obj), DebugInfoContext(DICtx) {
+ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx,
+                       std::unique_ptr<ModuleIndex> Index)
+    : Module(Obj), DebugInfoContext(DICtx), Index(std::move(Index)) {
   std::unique_ptr<DataExtractor> OpdExtractor;
   uint64_t OpdAddress = 0;
   // Find the .opd (function descriptor) section if any, for big-endian
@@ -83,6 +84,21 @@ ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
       addSymbol(*si, OpdExtractor.get(), OpdAddress);
     }
   }
+  sortSymbolTable(Functions);
+  sortSymbolTable(Objects);
+}
+
+void ModuleInfo::sortSymbolTable(SymbolTable &Symbols) {
+  typedef std::pair<SymbolDesc, StringRef> Entry;
+  std::stable_sort(Symbols.begin(), Symbols.end(),
+                   [](const Entry &LHS, const Entry &RHS) {
+                     return LHS.first < RHS.first;
+                   });
+  Symbols.erase(std::unique(Symbols.begin(), Symbols.end(),
+                            [](const Entry &LHS, const Entry &RHS) {
+                              return LHS.first.Addr == RHS.first.Addr;
+                            }),
+                Symbols.end());
 }
 
 void ModuleInfo::addSymbol(const SymbolRef &Symbol, DataExtractor *OpdExtractor,
@@ -128,7 +144,7 @@ void ModuleInfo::addSymbol(const SymbolRef &Symbol, DataExtractor *OpdExtractor,
   // with same address size. Make sure we choose the correct one.
   auto &M = SymbolType == SymbolRef::ST_Function ? Functions : Objects;
   SymbolDesc SD = { SymbolAddress, SymbolSize };
-  M.insert(std::make_pair(SD, SymbolName));
+  M.push_back(std::make_pair(SD, SymbolName));
 }
 
 bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
@@ -137,8 +153,11 @@ bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
   const auto &SymbolMap = Type == SymbolRef::ST_Function ? Functions : Objects;
   if (SymbolMap.empty())
     return false;
-  SymbolDesc SD = { Address, Address };
-  auto SymbolIterator = SymbolMap.upper_bound(SD);
+  auto SymbolIterator = std::upper_bound(
+      SymbolMap.begin(), SymbolMap.end(), Address,
+      [](uint64_t Address, const std::pair<SymbolDesc, StringRef> &Symbol) {
+        return Address < Symbol.first.Addr;
+      });
   if (SymbolIterator == SymbolMap.begin())
     return false;
   --SymbolIterator;
@@ -154,7 +173,9 @@ bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
 DILineInfo ModuleInfo::symbolizeCode(
     uint64_t ModuleOffset, const LLVMSymbolizer::Options &Opts) const {
   DILineInfo LineInfo;
-  if (DebugInfoContext) {
+  if (Index) {
+    LineInfo = Index->getLineInfoForAddress(ModuleOffset);
+  } else if (DebugInfoContext) {
     LineInfo = DebugInfoContext->getLineInfoForAddress(
         ModuleOffset, getDILineInfoSpecifier(Opts));
   }
@@ -174,7 +195,9 @@ DIInliningInfo ModuleInfo::symbolizeInlinedCode(
     uint64_t ModuleOffset, const LLVMSymbolizer::Options &Opts) const {
   DIInliningInfo InlinedContext;
 
-  if (DebugInfoContext) {
+  if (Index) {
+    InlinedContext = Index->getInliningInfoForAddress(ModuleOffset);
+  } else if (DebugInfoContext) {
     InlinedContext = DebugInfoContext->getInliningInfoForAddress(
         ModuleOffset, getDILineInfoSpecifier(Opts));
   }
@@ -472,6 +495,7 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
     return nullptr;
   }
   DIContext *Context = nullptr;
+  std::unique_ptr<ModuleIndex> Index;
   if (auto CoffObject = dyn_cast<COFFObjectFile>(Objects.first)) {
     // If this is a COFF object, assume it contains PDB debug information.  If
     // we don't find any we will fall back to the DWARF case.
@@ -483,14 +507,48 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
                                Opts.RelativeAddresses);
     }
   }
-  if (!Context)
+  if (!Context && Opts.UseIndex) {
+    // The index replaces the DWARF context.
+    Index = getOrCreateModuleIndex(BinaryName, ArchName, Objects.second);
+  }
+  if (!Context && !Index)
     Context = new DWARFContextInMemory(*Objects.second);
-  assert(Context);
-  ModuleInfo *Info = new ModuleInfo(Objects.first, Context);
+  assert(Context || Index);
+  ModuleInfo *Info = new ModuleInfo(Objects.first, Context, std::move(Index));
   Modules.insert(make_pair(ModuleName, Info));
   return Info;
 }
 
+std::unique_ptr<ModuleIndex> LLVMSymbolizer::getOrCreateModuleIndex(
+    const std::string &BinaryName, const std::string &ArchName,
+    ObjectFile *DbgObj) {
+  ModuleIndexKey Key = {Opts.PrintFunctions, 0, 0};
+  std::string CachePath;
+  if (Opts.UseIndexCache) {
+    // Only trust a cache file built from the same debug info. Without a way
+    // to tell, don't use the cache at all.
+    sys::fs::file_status Status;
+    if (!sys::fs::status(DbgObj->getFileName(), Status) &&
+        sys::fs::is_regular_file(Status)) {
+      Key.ObjectSize = Status.getSize();
+      Key.ObjectModTime = Status.getLastModificationTime().toEpochTime();
+      CachePath = BinaryName;
+      if (!ArchName.empty())
+        CachePath += "." + ArchName;
+      CachePath += ".symidx";
+      if (std::unique_ptr<ModuleIndex> Index = ModuleIndex::load(CachePath, Key))
+        return Index;
+    }
+  }
+  DWARFContextInMemory Context(*DbgObj);
+  std::unique_ptr<ModuleIndex> Index = ModuleIndex::build(Context, Key);
+  // Failing to write the cache, e.g. next to a binary in a read-only
+  // directory, only costs a rebuild next time.
+  if (!CachePath.empty())
+    Index->save(CachePath);
+  return Index;
+}
+
 std::string LLVMSymbolizer::printDILineInfo(DILineInfo LineInfo) const {
   // By default, DILineInfo contains "<invalid>" for function/filename it
   // cannot fetch. We replace it to "??" to make our output closer to addr2line.
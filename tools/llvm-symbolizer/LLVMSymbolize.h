@@ -13,6 +13,7 @@
 #ifndef LLVM_TOOLS_LLVM_SYMBOLIZER_LLVMSYMBOLIZE_H
 #define LLVM_TOOLS_LLVM_SYMBOLIZER_LLVMSYMBOLIZE_H
 
+#include "ModuleIndex.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/DebugInfo/DIContext.h"
 #include "llvm/Object/MachOUniversal.h"
@@ -22,6 +23,8 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace llvm {
 
@@ -40,6 +43,11 @@ public:
     bool PrintInlining : 1;
     bool Demangle : 1;
     bool RelativeAddresses : 1;
+    // Build a flat address index of the debug info of each module on first
+    // use, to symbolize large batches of addresses.
+    bool UseIndex : 1;
+    // Also keep the index in a cache file next to each binary.
+    bool UseIndexCache : 1;
     std::string DefaultArch;
     std::vector<std::string> DsymHints;
     Options(FunctionNameKind PrintFunctions = FunctionNameKind::LinkageName,
@@ -48,7 +56,8 @@ public:
             std::string DefaultArch = "")
         : PrintFunctions(PrintFunctions), UseSymbolTable(UseSymbolTable),
           PrintInlining(PrintInlining), Demangle(Demangle),
-          RelativeAddresses(RelativeAddresses), DefaultArch(DefaultArch) {}
+          RelativeAddresses(RelativeAddresses), UseIndex(false),
+          UseIndexCache(false), DefaultArch(DefaultArch) {}
   };
 
   LLVMSymbolizer(const Options &Opts = Options()) : Opts(Opts) {}
@@ -77,6 +86,11 @@ private:
   /// \brief Returns a parsed object file for a given architecture in a
   /// universal binary (or the binary itself if it is an object file).
   ObjectFile *getObjectFileFromBinary(Binary *Bin, const std::string &ArchName);
+  /// \brief Returns the address index of the debug info of \p DbgObj, read
+  /// from the cache file if possible.
+  std::unique_ptr<ModuleIndex>
+  getOrCreateModuleIndex(const std::string &BinaryName,
+                         const std::string &ArchName, ObjectFile *DbgObj);
 
   std::string printDILineInfo(DILineInfo LineInfo) const;
 
@@ -104,7 +118,8 @@ private:
 
 class ModuleInfo {
 public:
-  ModuleInfo(ObjectFile *Obj, DIContext *DICtx);
+  ModuleInfo(ObjectFile *Obj, DIContext *DICtx,
+             std::unique_ptr<ModuleIndex> Index = nullptr);
 
   DILineInfo symbolizeCode(uint64_t ModuleOffset,
                            const LLVMSymbolizer::Options &Opts) const;
@@ -124,6 +139,8 @@ private:
                  uint64_t OpdAddress = 0);
   ObjectFile *Module;
   std::unique_ptr<DIContext> DebugInfoContext;
+  // If set, answers the debug info queries instead of DebugInfoContext.
+  std::unique_ptr<ModuleIndex> Index;
 
   struct SymbolDesc {
     uint64_t Addr;
@@ -134,8 +151,12 @@ private:
       return s1.Addr < s2.Addr;
     }
   };
-  std::map<SymbolDesc, StringRef> Functions;
-  std::map<SymbolDesc, StringRef> Objects;
+  // Symbols sorted by address, keeping only the first symbol added for each
+  // address.
+  typedef std::vector<std::pair<SymbolDesc, StringRef>> SymbolTable;
+  static void sortSymbolTable(SymbolTable &Symbols);
+  SymbolTable Functions;
+  SymbolTable Objects;
 };
 
 } // namespace symbolize
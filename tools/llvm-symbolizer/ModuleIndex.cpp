@@ -0,0 +1,257 @@
+//===-- ModuleIndex.cpp ---------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the flat address index used by llvm-symbolizer.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ModuleIndex.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+
+namespace llvm {
+namespace symbolize {
+
+static const char IndexMagic[8] = {'L', 'L', 'V', 'M', 'S', 'Y', 'M', 'X'};
+static const uint32_t IndexVersion = 1;
+
+ModuleIndex::ModuleIndex(std::unique_ptr<MemoryBuffer> Buffer)
+    : Buffer(std::move(Buffer)) {}
+
+std::unique_ptr<ModuleIndex> ModuleIndex::build(DWARFContext &DICtx,
+                                                const ModuleIndexKey &Key) {
+  // Collect the addresses where the inlining info may change: the start and
+  // end of every DIE range, and every line table row. The DIEs of each unit
+  // are released once their ranges are collected, so that only one unit has
+  // all its DIEs extracted at a time. The lookups below then go through the
+  // subprogram address map of the unit and only extract the subtree of the
+  // subprogram they need.
+  std::vector<uint64_t> Boundaries;
+  auto AddDIERanges = [&](DWARFUnit *U) {
+    for (unsigned I = 0, E = U->getNumDIEs(); I != E; ++I) {
+      for (const auto &R : U->getDIEAtIndex(I)->getAddressRanges(U)) {
+        if (R.first >= R.second)
+          continue;
+        Boundaries.push_back(R.first);
+        Boundaries.push_back(R.second);
+      }
+    }
+    U->clearDIEs(/*KeepCUDie=*/true);
+  };
+  for (const auto &CU : DICtx.compile_units()) {
+    AddDIERanges(CU.get());
+    if (DWARFUnit *DWO = CU->getDWOUnit())
+      AddDIERanges(DWO);
+    if (const DWARFDebugLine::LineTable *LineTable =
+            DICtx.getLineTableForUnit(CU.get()))
+      for (const DWARFDebugLine::Row &Row : LineTable->Rows)
+        Boundaries.push_back(Row.Address);
+  }
+  // A lookup exactly at the address of a line table row may return another
+  // row than a lookup right after it when several rows share the address.
+  // Split the range after each boundary to capture both answers.
+  for (size_t I = 0, E = Boundaries.size(); I != E; ++I)
+    if (Boundaries[I] != UINT64_MAX)
+      Boundaries.push_back(Boundaries[I] + 1);
+  std::sort(Boundaries.begin(), Boundaries.end());
+  Boundaries.erase(std::unique(Boundaries.begin(), Boundaries.end()),
+                   Boundaries.end());
+
+  // Compute the frames once per boundary, merging neighbouring ranges with
+  // the same answer. Boundaries are sorted, so consecutive lookups mostly hit
+  // the subprogram subtree the unit extracted for the previous one.
+  std::vector<Range> RangeTable;
+  std::vector<Frame> FrameTable;
+  std::string StringTable;
+  StringMap<uint32_t> StringOffsets;
+  auto GetStringOffset = [&](const std::string &S) {
+    auto Inserted = StringOffsets.insert(std::make_pair(S, 0));
+    if (Inserted.second) {
+      Inserted.first->second = StringTable.size();
+      StringTable += S;
+      StringTable += '\0';
+    }
+    return Inserted.first->second;
+  };
+
+  DILineInfoSpecifier Spec(
+      DILineInfoSpecifier::FileLineInfoKind::AbsoluteFilePath, Key.NameKind);
+  std::vector<DILineInfo> PrevFrames, Frames;
+  for (uint64_t Address : Boundaries) {
+    DIInliningInfo InliningInfo = DICtx.getInliningInfoForAddress(Address, Spec);
+    Frames.clear();
+    for (uint32_t I = 0, E = InliningInfo.getNumberOfFrames(); I != E; ++I)
+      Frames.push_back(InliningInfo.getFrame(I));
+    if (!RangeTable.empty() && Frames == PrevFrames)
+      continue;
+    Range R;
+    R.Start = Address;
+    R.FirstFrame = FrameTable.size();
+    R.NumFrames = Frames.size();
+    RangeTable.push_back(R);
+    for (const DILineInfo &Info : Frames) {
+      Frame F;
+      F.FunctionName = GetStringOffset(Info.FunctionName);
+      F.FileName = GetStringOffset(Info.FileName);
+      F.Line = Info.Line;
+      F.Column = Info.Column;
+      FrameTable.push_back(F);
+    }
+    std::swap(PrevFrames, Frames);
+  }
+
+  Header H;
+  memcpy(H.Magic, IndexMagic, sizeof(IndexMagic));
+  H.Version = IndexVersion;
+  H.NameKind = static_cast<uint32_t>(Key.NameKind);
+  H.ObjectSize = Key.ObjectSize;
+  H.ObjectModTime = Key.ObjectModTime;
+  H.NumRanges = RangeTable.size();
+  H.NumFrames = FrameTable.size();
+  H.StringTableSize = StringTable.size();
+  H.Reserved = 0;
+
+  // The tables only hold little-endian integers, their in-memory image is the
+  // on-disk format.
+  SmallString<0> Data;
+  raw_svector_ostream OS(Data);
+  OS.write(reinterpret_cast<const char *>(&H), sizeof(H));
+  OS.write(reinterpret_cast<const char *>(RangeTable.data()),
+           RangeTable.size() * sizeof(Range));
+  OS.write(reinterpret_cast<const char *>(FrameTable.data()),
+           FrameTable.size() * sizeof(Frame));
+  OS << StringTable;
+  OS.flush();
+
+  std::unique_ptr<ModuleIndex> Index(
+      new ModuleIndex(MemoryBuffer::getMemBufferCopy(Data, "<module index>")));
+  bool Valid = Index->parse(Key);
+  assert(Valid && "Built an invalid index");
+  (void)Valid;
+  return Index;
+}
+
+std::unique_ptr<ModuleIndex> ModuleIndex::load(StringRef Path,
+                                               const ModuleIndexKey &Key) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getFile(Path, -1, /*RequiresNullTerminator=*/false);
+  if (!BufferOrErr)
+    return nullptr;
+  std::unique_ptr<ModuleIndex> Index(
+      new ModuleIndex(std::move(BufferOrErr.get())));
+  if (!Index->parse(Key))
+    return nullptr;
+  return Index;
+}
+
+bool ModuleIndex::parse(const ModuleIndexKey &Key) {
+  StringRef Data = Buffer->getBuffer();
+  if (Data.size() < sizeof(Header))
+    return false;
+  const Header *H = reinterpret_cast<const Header *>(Data.data());
+  if (memcmp(H->Magic, IndexMagic, sizeof(IndexMagic)) != 0 ||
+      H->Version != IndexVersion ||
+      H->NameKind != static_cast<uint32_t>(Key.NameKind) ||
+      H->ObjectSize != Key.ObjectSize || H->ObjectModTime != Key.ObjectModTime)
+    return false;
+  uint64_t RangesSize = uint64_t(H->NumRanges) * sizeof(Range);
+  uint64_t FramesSize = uint64_t(H->NumFrames) * sizeof(Frame);
+  if (sizeof(Header) + RangesSize + FramesSize + H->StringTableSize !=
+      Data.size())
+    return false;
+
+  const char *Ptr = Data.data() + sizeof(Header);
+  Ranges = makeArrayRef(reinterpret_cast<const Range *>(Ptr), H->NumRanges);
+  Ptr += RangesSize;
+  Frames = makeArrayRef(reinterpret_cast<const Frame *>(Ptr), H->NumFrames);
+  Ptr += FramesSize;
+  Strings = StringRef(Ptr, H->StringTableSize);
+
+  // Make sure that a corrupted file can't make the lookups go out of bounds.
+  if (!Strings.empty() && Strings.back() != '\0')
+    return false;
+  for (size_t I = 0, E = Ranges.size(); I != E; ++I) {
+    if (I != 0 && Ranges[I - 1].Start >= Ranges[I].Start)
+      return false;
+    if (uint64_t(Ranges[I].FirstFrame) + Ranges[I].NumFrames > Frames.size())
+      return false;
+  }
+  for (const Frame &F : Frames)
+    if (F.FunctionName >= Strings.size() || F.FileName >= Strings.size())
+      return false;
+  return true;
+}
+
+std::error_code ModuleIndex::save(StringRef Path) const {
+  // Write to a temporary file first, so that concurrent symbolizers never see
+  // a partially written index.
+  int FD;
+  SmallString<128> TempPath;
+  if (std::error_code EC =
+          sys::fs::createUniqueFile(Path + ".tmp%%%%%%", FD, TempPath))
+    return EC;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Buffer->getBuffer();
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return make_error_code(errc::io_error);
+    }
+  }
+  if (std::error_code EC = sys::fs::rename(TempPath, Path)) {
+    sys::fs::remove(TempPath);
+    return EC;
+  }
+  return std::error_code();
+}
+
+const ModuleIndex::Range *ModuleIndex::findRange(uint64_t Address) const {
+  auto It = std::upper_bound(
+      Ranges.begin(), Ranges.end(), Address,
+      [](uint64_t Address, const Range &R) { return Address < R.Start; });
+  if (It == Ranges.begin())
+    return nullptr;
+  return std::prev(It);
+}
+
+DILineInfo ModuleIndex::getFrame(const Frame &F) const {
+  DILineInfo Info;
+  Info.FunctionName = Strings.data() + F.FunctionName;
+  Info.FileName = Strings.data() + F.FileName;
+  Info.Line = F.Line;
+  Info.Column = F.Column;
+  return Info;
+}
+
+DIInliningInfo ModuleIndex::getInliningInfoForAddress(uint64_t Address) const {
+  DIInliningInfo InliningInfo;
+  if (const Range *R = findRange(Address))
+    for (const Frame &F : Frames.slice(R->FirstFrame, R->NumFrames))
+      InliningInfo.addFrame(getFrame(F));
+  return InliningInfo;
+}
+
+DILineInfo ModuleIndex::getLineInfoForAddress(uint64_t Address) const {
+  const Range *R = findRange(Address);
+  if (!R || R->NumFrames == 0)
+    return DILineInfo();
+  return getFrame(Frames[R->FirstFrame]);
+}
+
+} // namespace symbolize
+} // namespace llvm
@@ -0,0 +1,120 @@
+//===-- ModuleIndex.h ------------------------------------------- C++ -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Flat address index of the debug info of a module, used by the batch mode of
+// llvm-symbolizer.
+//
+//===----------------------------------------------------------------------===//
+#ifndef LLVM_TOOLS_LLVM_SYMBOLIZER_MODULEINDEX_H
+#define LLVM_TOOLS_LLVM_SYMBOLIZER_MODULEINDEX_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/DebugInfo/DIContext.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+#include <system_error>
+
+namespace llvm {
+
+class DWARFContext;
+
+namespace symbolize {
+
+/// \brief Identifies the debug info an index was built from, so that a stale
+/// cache file is never used.
+struct ModuleIndexKey {
+  DINameKind NameKind;
+  uint64_t ObjectSize;
+  uint64_t ObjectModTime;
+};
+
+/// \brief A sorted, flat index of the inlining info of every code address of
+/// a module.
+///
+/// The address space is split into ranges along the boundaries of the line
+/// table rows and of the DIE address ranges, which are the only addresses
+/// where the answer of DWARFContext::getInliningInfoForAddress can change.
+/// Each range stores its precomputed frames, so that a lookup is a binary
+/// search instead of a walk of the DWARF structures.
+///
+/// The index lives in a single buffer in a little-endian on-disk format. It
+/// can be written to a cache file and mapped back in without any parsing.
+class ModuleIndex {
+public:
+  /// \brief Build the index of the code described by \p DICtx. Function names
+  /// are computed with \p Key.NameKind. The DIEs of the units of \p DICtx are
+  /// released along the way, so no pointers to them may be held.
+  static std::unique_ptr<ModuleIndex> build(DWARFContext &DICtx,
+                                            const ModuleIndexKey &Key);
+
+  /// \brief Map the index stored at \p Path. Returns nullptr if the file
+  /// doesn't exist, is malformed or was built for a different \p Key.
+  static std::unique_ptr<ModuleIndex> load(StringRef Path,
+                                           const ModuleIndexKey &Key);
+
+  /// \brief Atomically write the index to \p Path.
+  std::error_code save(StringRef Path) const;
+
+  /// \brief Same result as DWARFContext::getInliningInfoForAddress with an
+  /// absolute file path specifier.
+  DIInliningInfo getInliningInfoForAddress(uint64_t Address) const;
+
+  /// \brief Same result as DWARFContext::getLineInfoForAddress with an
+  /// absolute file path specifier.
+  DILineInfo getLineInfoForAddress(uint64_t Address) const;
+
+  /// \brief On-disk layout: a header followed by the range table, the frame
+  /// table and the string table.
+  struct Header {
+    char Magic[8];
+    support::ulittle32_t Version;
+    support::ulittle32_t NameKind;
+    support::ulittle64_t ObjectSize;
+    support::ulittle64_t ObjectModTime;
+    support::ulittle32_t NumRanges;
+    support::ulittle32_t NumFrames;
+    support::ulittle32_t StringTableSize;
+    support::ulittle32_t Reserved;
+  };
+  /// \brief Addresses [Start, next range's Start) have frames
+  /// [FirstFrame, FirstFrame + NumFrames), innermost first.
+  struct Range {
+    support::ulittle64_t Start;
+    support::ulittle32_t FirstFrame;
+    support::ulittle32_t NumFrames;
+  };
+  /// \brief A frame. Names are offsets in the string table.
+  struct Frame {
+    support::ulittle32_t FunctionName;
+    support::ulittle32_t FileName;
+    support::ulittle32_t Line;
+    support::ulittle32_t Column;
+  };
+
+private:
+  explicit ModuleIndex(std::unique_ptr<MemoryBuffer> Buffer);
+
+  /// \brief Check the buffer and set up the tables. Returns false if the
+  /// buffer isn't a valid index for \p Key.
+  bool parse(const ModuleIndexKey &Key);
+  const Range *findRange(uint64_t Address) const;
+  DILineInfo getFrame(const Frame &F) const;
+
+  std::unique_ptr<MemoryBuffer> Buffer;
+  ArrayRef<Range> Ranges;
+  ArrayRef<Frame> Frames;
+  StringRef Strings;
+};
+
+} // namespace symbolize
+} // namespace llvm
+
+#endif
@@ -69,6 +69,16 @@ ClBinaryName("obj", cl::init(""),
              cl::desc("Path to object file to be symbolized (if not provided, "
                       "object file should be specified for each input line)"));
 
+static cl::opt<bool>
+ClBatch("batch", cl::init(false),
+        cl::desc("Index the debug info of each object file on first use, to "
+                 "symbolize large numbers of addresses faster"));
+
+static cl::opt<bool>
+ClIndexCache("index-cache", cl::init(false),
+             cl::desc("Keep the debug info index of each object file in a "
+                      "<file>.symidx cache file next to it (implies -batch)"));
+
 static cl::list<std::string>
 ClDsymHint("dsym-hint", cl::ZeroOrMore,
            cl::desc("Path to .dSYM bundles to search for debug info for the "
@@ -135,6 +145,8 @@ int main(int argc, char **argv) {
   LLVMSymbolizer::Options Opts(ClPrintFunctions, ClUseSymbolTable,
                                ClPrintInlining, ClDemangle,
                                ClUseRelativeAddress, ClDefaultArch);
+  Opts.UseIndex = ClBatch || ClIndexCache;
+  Opts.UseIndexCache = ClIndexCache;
   for (const auto &hint : ClDsymHint) {
     if (sys::path::extension(hint) == ".dSYM") {
       Opts.DsymHints.push_back(hint);
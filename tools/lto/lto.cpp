@@ -84,6 +84,7 @@ struct LibLTOCodeGenerator : LTOCodeGenerator {
       : LTOCodeGenerator(std::move(Context)) {}
 
   std::unique_ptr<MemoryBuffer> NativeObjectFile;
+  std::vector<std::unique_ptr<MemoryBuffer>> NativeObjectFiles;
 };
 
 }
@@ -344,6 +345,24 @@ const void *lto_codegen_compile_optimized(lto_code_gen_t cg, size_t *length) {
   return CG->NativeObjectFile->getBufferStart();
 }
 
+unsigned int lto_codegen_compile_optimized_parallel(lto_code_gen_t cg) {
+  maybeParseOptions(cg);
+  LibLTOCodeGenerator *CG = unwrap(cg);
+  CG->NativeObjectFiles.clear();
+  if (!CG->compileOptimizedParallel(CG->NativeObjectFiles, sLastErrorString))
+    return 0;
+  return CG->NativeObjectFiles.size();
+}
+
+const void *lto_codegen_get_object(lto_code_gen_t cg, unsigned int index,
+                                   size_t *length) {
+  LibLTOCodeGenerator *CG = unwrap(cg);
+  if (index >= CG->NativeObjectFiles.size())
+    return nullptr;
+  *length = CG->NativeObjectFiles[index]->getBufferSize();
+  return CG->NativeObjectFiles[index]->getBufferStart();
+}
+
 bool lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name) {
   maybeParseOptions(cg);
   return !unwrap(cg)->compile_to_file(
@@ -366,3 +385,19 @@ void lto_codegen_set_should_embed_uselists(lto_code_gen_t cg,
                                            lto_bool_t ShouldEmbedUselists) {
   unwrap(cg)->setShouldEmbedUselists(ShouldEmbedUselists);
 }
+
+void lto_codegen_set_codegen_jobs(lto_code_gen_t cg, unsigned int jobs) {
+  unwrap(cg)->setCodeGenJobs(jobs);
+}
+
+void lto_codegen_set_cache_dir(lto_code_gen_t cg, const char *cache_dir) {
+  unwrap(cg)->setCacheDir(cache_dir ? cache_dir : "");
+}
+
+void lto_codegen_set_cache_pruning_policy(lto_code_gen_t cg, int interval,
+                                          unsigned int expiration,
+                                          unsigned long long max_size) {
+  unwrap(cg)->setCachePruningInterval(interval);
+  unwrap(cg)->setCacheEntryExpiration(expiration);
+  unwrap(cg)->setMaxCacheSize(max_size);
+}
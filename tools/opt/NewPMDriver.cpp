@@ -16,6 +16,7 @@
 #include "NewPMDriver.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Analysis/CGSCCPassManager.h"
+#include "llvm/IR/AnalysisResultCache.h"
 #include "llvm/Bitcode/BitcodeWriterPass.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/IRPrintingPasses.h"
@@ -36,6 +37,12 @@ static cl::opt<bool>
     DebugPM("debug-pass-manager", cl::Hidden,
             cl::desc("Print pass management debugging information"));
 
+static cl::opt<std::string>
+    AnalysisCacheFile("analysis-cache", cl::Hidden,
+                      cl::desc("Reuse the function analysis results saved in "
+                               "this file, and save new ones to it"),
+                      cl::value_desc("filename"));
+
 bool llvm::runPassPipeline(StringRef Arg0, LLVMContext &Context, Module &M,
                            TargetMachine *TM, tool_output_file *Out,
                            StringRef PassPipeline, OutputKind OK,
@@ -48,6 +55,16 @@ bool llvm::runPassPipeline(StringRef Arg0, LLVMContext &Context, Module &M,
   CGSCCAnalysisManager CGAM(DebugPM);
   ModuleAnalysisManager MAM(DebugPM);
 
+  AnalysisResultCache ResultCache;
+  if (!AnalysisCacheFile.empty()) {
+    if (std::error_code EC = ResultCache.load(AnalysisCacheFile)) {
+      errs() << Arg0 << ": " << AnalysisCacheFile << ": " << EC.message()
+             << "\n";
+      return false;
+    }
+    FAM.setResultCache(&ResultCache);
+  }
+
   // Register all the basic analyses with the managers.
   PB.registerModuleAnalyses(MAM);
   PB.registerCGSCCAnalyses(CGAM);
@@ -94,6 +111,11 @@ bool llvm::runPassPipeline(StringRef Arg0, LLVMContext &Context, Module &M,
   // Now that we have all of the passes ready, run them.
   MPM.run(M, &MAM);
 
+  if (!AnalysisCacheFile.empty())
+    if (std::error_code EC = ResultCache.save(AnalysisCacheFile))
+      errs() << Arg0 << ": " << AnalysisCacheFile << ": " << EC.message()
+             << "\n";
+
   // Declare success.
   if (OK != OK_NoOutput)
     Out->keep();
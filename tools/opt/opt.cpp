@@ -190,6 +190,29 @@ static cl::opt<bool> PreserveAssemblyUseListOrder(
     cl::desc("Preserve use-list order when writing LLVM assembly."),
     cl::init(false), cl::Hidden);
 
+static cl::opt<bool> EmitFunctionSummary(
+    "function-summary",
+    cl::desc("Emit function summary index when writing bitcode"),
+    cl::init(false));
+
+static cl::opt<unsigned> FunctionPassThreads(
+    "function-pass-threads",
+    cl::desc("Number of functions that function passes may process at the "
+             "same time (0 = number of hardware threads)"),
+    cl::init(1));
+
+static cl::opt<unsigned> BitcodeReaderThreads(
+    "bitcode-reader-threads",
+    cl::desc("Number of threads to parse the function bodies of a bitcode "
+             "input on (0 = number of hardware threads)"),
+    cl::init(1));
+
+static cl::opt<bool> FunctionArenas(
+    "function-arenas",
+    cl::desc("Allocate the instructions and blocks of each function body "
+             "that is read from an arena of its own"),
+    cl::init(false));
+
 static inline void addPass(legacy::PassManagerBase &PM, Pass *P) {
   // Add the pass to the pass manager...
   PM.add(P);
@@ -340,7 +363,9 @@ int main(int argc, char **argv) {
   SMDiagnostic Err;
 
   // Load the input module...
-  std::unique_ptr<Module> M = parseIRFile(InputFilename, Err, Context);
+  Context.setUseFunctionArenas(FunctionArenas);
+  std::unique_ptr<Module> M =
+      parseIRFile(InputFilename, Err, Context, BitcodeReaderThreads);
 
   if (!M) {
     Err.print(argv[0], errs());
@@ -432,6 +457,7 @@ int main(int argc, char **argv) {
   // about to build.
   //
   legacy::PassManager Passes;
+  Passes.setNumFunctionPassThreads(FunctionPassThreads);
 
   // Add an appropriate TargetLibraryInfo pass for the module's triple.
   TargetLibraryInfoImpl TLII(ModuleTriple);
@@ -589,7 +615,8 @@ int main(int argc, char **argv) {
           createPrintModulePass(Out->os(), "", PreserveAssemblyUseListOrder));
     else
       Passes.add(
-          createBitcodeWriterPass(Out->os(), PreserveBitcodeUseListOrder));
+          createBitcodeWriterPass(Out->os(), PreserveBitcodeUseListOrder,
+                                  EmitFunctionSummary));
   }
 
   // Before executing passes, print the final values of the LLVM options.
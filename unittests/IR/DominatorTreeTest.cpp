@@ -17,6 +17,7 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
+#include <algorithm>
 
 using namespace llvm;
 
@@ -250,6 +251,221 @@ namespace llvm {
       Passes.add(P);
       Passes.run(*M);
     }
+
+    // A function whose blocks branch to a set of successors that can be
+    // changed edge by edge.
+    class EditableCFG {
+      LLVMContext C;
+      std::unique_ptr<Module> M;
+      Function *F;
+      std::vector<BasicBlock *> Blocks;
+      std::vector<std::vector<unsigned>> Succs;
+
+      void rebuildTerminator(unsigned Block) {
+        BasicBlock *BB = Blocks[Block];
+        if (TerminatorInst *TI = BB->getTerminator())
+          TI->eraseFromParent();
+        const std::vector<unsigned> &S = Succs[Block];
+        if (S.empty()) {
+          ReturnInst::Create(C, BB);
+          return;
+        }
+        SwitchInst *SI = SwitchInst::Create(F->arg_begin(), Blocks[S[0]],
+                                            S.size() - 1, BB);
+        for (unsigned i = 1, e = S.size(); i != e; ++i)
+          SI->addCase(ConstantInt::get(Type::getInt32Ty(C), i), Blocks[S[i]]);
+      }
+
+    public:
+      explicit EditableCFG(unsigned NumBlocks)
+          : M(new Module("cfg", C)), Succs(NumBlocks) {
+        F = Function::Create(
+            FunctionType::get(Type::getVoidTy(C), Type::getInt32Ty(C), false),
+            GlobalValue::ExternalLinkage, "f", M.get());
+        for (unsigned i = 0; i != NumBlocks; ++i)
+          Blocks.push_back(BasicBlock::Create(C, "", F));
+        for (unsigned i = 0; i != NumBlocks; ++i)
+          rebuildTerminator(i);
+      }
+
+      Function &function() { return *F; }
+      BasicBlock *block(unsigned i) { return Blocks[i]; }
+
+      bool hasEdge(unsigned From, unsigned To) const {
+        return std::find(Succs[From].begin(), Succs[From].end(), To) !=
+               Succs[From].end();
+      }
+
+      void insertEdge(unsigned From, unsigned To) {
+        Succs[From].push_back(To);
+        rebuildTerminator(From);
+      }
+
+      void deleteEdge(unsigned From, unsigned To) {
+        Succs[From].erase(
+            std::find(Succs[From].begin(), Succs[From].end(), To));
+        rebuildTerminator(From);
+      }
+    };
+
+    // Check that Updated has the same nodes, immediate dominators and levels
+    // as a tree computed from scratch.
+    void expectSameAsRecalculated(DominatorTreeBase<BasicBlock> &Updated,
+                                  Function &F) {
+      DominatorTreeBase<BasicBlock> Fresh(Updated.isPostDominator());
+      Fresh.recalculate(F);
+      ASSERT_EQ(Fresh.getRootNode() == nullptr,
+                Updated.getRootNode() == nullptr);
+      if (Fresh.getRootNode())
+        EXPECT_EQ(Fresh.getRootNode()->getBlock(),
+                  Updated.getRootNode()->getBlock());
+      for (BasicBlock &BB : F) {
+        DomTreeNode *FreshNode = Fresh.getNode(&BB);
+        DomTreeNode *UpdatedNode = Updated.getNode(&BB);
+        ASSERT_EQ(FreshNode == nullptr, UpdatedNode == nullptr);
+        if (!FreshNode)
+          continue;
+        EXPECT_EQ(FreshNode->getLevel(), UpdatedNode->getLevel());
+        DomTreeNode *FreshIDom = FreshNode->getIDom();
+        DomTreeNode *UpdatedIDom = UpdatedNode->getIDom();
+        ASSERT_EQ(FreshIDom == nullptr, UpdatedIDom == nullptr);
+        if (FreshIDom)
+          EXPECT_EQ(FreshIDom->getBlock(), UpdatedIDom->getBlock());
+      }
+    }
+
+    TEST(DominatorTree, InsertAndDeleteEdges) {
+      const unsigned NumBlocks = 12;
+      EditableCFG CFG(NumBlocks);
+      DominatorTreeBase<BasicBlock> DT(false), PDT(true);
+      DT.recalculate(CFG.function());
+      PDT.recalculate(CFG.function());
+
+      // Make pseudo-random single edits, adding edges more often than
+      // deleting them so that the graph gets denser over time.
+      uint32_t Seed = 1;
+      auto Next = [&Seed](unsigned Bound) {
+        Seed = Seed * 1103515245 + 12345;
+        return (Seed >> 16) % Bound;
+      };
+      for (unsigned Step = 0; Step != 400; ++Step) {
+        unsigned From = Next(NumBlocks), To = Next(NumBlocks);
+        bool Delete = Next(3) == 0;
+        if (Delete != CFG.hasEdge(From, To))
+          continue;
+        if (Delete) {
+          CFG.deleteEdge(From, To);
+          DT.deleteEdge(CFG.block(From), CFG.block(To));
+          PDT.deleteEdge(CFG.block(From), CFG.block(To));
+        } else {
+          CFG.insertEdge(From, To);
+          DT.insertEdge(CFG.block(From), CFG.block(To));
+          PDT.insertEdge(CFG.block(From), CFG.block(To));
+        }
+        expectSameAsRecalculated(DT, CFG.function());
+        expectSameAsRecalculated(PDT, CFG.function());
+      }
+    }
+
+    // Check that A and B have the same blocks, with their children in the same
+    // order.
+    void expectSameSubtree(DomTreeNode *A, DomTreeNode *B) {
+      ASSERT_EQ(A->getBlock(), B->getBlock());
+      ASSERT_EQ(A->getNumChildren(), B->getNumChildren());
+      for (unsigned i = 0, e = A->getNumChildren(); i != e; ++i)
+        expectSameSubtree(A->getChildren()[i], B->getChildren()[i]);
+    }
+
+    TEST(DominatorTree, SemiNCAMatchesLengauerTarjan) {
+      const unsigned NumBlocks = 16;
+      bool SavedUseSemiNCA = DomTreeUseSemiNCA;
+      uint32_t Seed = 3;
+      auto Next = [&Seed](unsigned Bound) {
+        Seed = Seed * 1103515245 + 12345;
+        return (Seed >> 16) % Bound;
+      };
+      auto Compare = [](EditableCFG &CFG) {
+        for (bool PostDom : {false, true}) {
+          DominatorTreeBase<BasicBlock> LT(PostDom), SNCA(PostDom);
+          DomTreeUseSemiNCA = false;
+          LT.recalculate(CFG.function());
+          DomTreeUseSemiNCA = true;
+          SNCA.recalculate(CFG.function());
+
+          ASSERT_EQ(LT.getRootNode() == nullptr, SNCA.getRootNode() == nullptr);
+          if (LT.getRootNode())
+            expectSameSubtree(LT.getRootNode(), SNCA.getRootNode());
+          for (BasicBlock &BB : CFG.function())
+            EXPECT_EQ(LT.getNode(&BB) == nullptr, SNCA.getNode(&BB) == nullptr);
+        }
+      };
+
+      for (unsigned Graph = 0; Graph != 50; ++Graph) {
+        EditableCFG CFG(NumBlocks);
+        for (unsigned i = 0, e = Next(3 * NumBlocks); i != e; ++i) {
+          unsigned From = Next(NumBlocks), To = Next(NumBlocks);
+          if (!CFG.hasEdge(From, To))
+            CFG.insertEdge(From, To);
+        }
+        Compare(CFG);
+      }
+
+      // A ladder, where each rung's ancestor walk goes up to the top.
+      const unsigned Rungs = 300;
+      EditableCFG Ladder(2 * Rungs + 1);
+      for (unsigned i = 0; i + 1 != Rungs; ++i) {
+        Ladder.insertEdge(2 * i, 2 * i + 2);
+        Ladder.insertEdge(2 * i, 2 * i + 3);
+        Ladder.insertEdge(2 * i + 1, 2 * i + 3);
+      }
+      Ladder.insertEdge(2 * Rungs - 2, 2 * Rungs);
+      Ladder.insertEdge(2 * Rungs - 1, 2 * Rungs);
+      Compare(Ladder);
+
+      DomTreeUseSemiNCA = SavedUseSemiNCA;
+    }
+
+    TEST(DominatorTree, ApplyUpdateBatches) {
+      const unsigned NumBlocks = 10;
+      EditableCFG CFG(NumBlocks);
+      DominatorTreeBase<BasicBlock> DT(false), PDT(true);
+      DT.recalculate(CFG.function());
+      PDT.recalculate(CFG.function());
+
+      typedef DominatorTreeBase<BasicBlock>::UpdateType UpdateType;
+      uint32_t Seed = 7;
+      auto Next = [&Seed](unsigned Bound) {
+        Seed = Seed * 1103515245 + 12345;
+        return (Seed >> 16) % Bound;
+      };
+      for (unsigned Batch = 0; Batch != 100; ++Batch) {
+        std::vector<UpdateType> Updates;
+        for (unsigned i = 0; i != 4; ++i) {
+          unsigned From = Next(NumBlocks), To = Next(NumBlocks);
+          bool Delete = Next(3) == 0;
+          if (Delete != CFG.hasEdge(From, To))
+            continue;
+          // Each edge may only be updated once per batch.
+          bool Seen = false;
+          for (const UpdateType &U : Updates)
+            Seen |= U.From == CFG.block(From) && U.To == CFG.block(To);
+          if (Seen)
+            continue;
+          if (Delete)
+            CFG.deleteEdge(From, To);
+          else
+            CFG.insertEdge(From, To);
+          Updates.push_back(UpdateType(
+              Delete ? DominatorTreeBase<BasicBlock>::Delete
+                     : DominatorTreeBase<BasicBlock>::Insert,
+              CFG.block(From), CFG.block(To)));
+        }
+        DT.applyUpdates(Updates);
+        PDT.applyUpdates(Updates);
+        expectSameAsRecalculated(DT, CFG.function());
+        expectSameAsRecalculated(PDT, CFG.function());
+      }
+    }
   }
 }
 
@@ -0,0 +1,135 @@
+//===- llvm/unittest/IR/FunctionTest.cpp - Function unit tests ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/Function.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+using namespace llvm;
+
+namespace {
+
+class FunctionChangeTrackingTest : public testing::Test {
+protected:
+  LLVMContext C;
+  std::unique_ptr<Module> M;
+  Function *F;
+  Instruction *A, *B, *Sub, *Ret;
+  std::vector<Instruction *> Changed;
+
+  void SetUp() override {
+    SMDiagnostic Err;
+    M = parseAssemblyString("define i32 @f(i32 %x) {\n"
+                            "entry:\n"
+                            "  %a = add i32 %x, 1\n"
+                            "  %b = mul i32 %a, 2\n"
+                            "  %sub = sub i32 %b, %a\n"
+                            "  ret i32 %sub\n"
+                            "}\n"
+                            "define void @g() {\n"
+                            "entry:\n"
+                            "  ret void\n"
+                            "}\n",
+                            Err, C);
+    ASSERT_TRUE(M != nullptr);
+    F = M->getFunction("f");
+    BasicBlock::iterator I = F->getEntryBlock().begin();
+    A = I++;
+    B = I++;
+    Sub = I++;
+    Ret = I++;
+  }
+
+  std::vector<Instruction *> takeChanged() {
+    F->takeChangedInstructions(Changed);
+    return Changed;
+  }
+};
+
+typedef std::vector<Instruction *> InstList;
+
+TEST_F(FunctionChangeTrackingTest, RecordsInsertionsAndReplacements) {
+  EXPECT_FALSE(F->isTrackingChanges());
+  F->startTrackingChanges();
+  EXPECT_TRUE(F->isTrackingChanges());
+  EXPECT_EQ(InstList(), takeChanged());
+
+  // New instructions are recorded in the order they are inserted, and so
+  // are the instructions that get an operand set.
+  IRBuilder<> Builder(Ret);
+  Instruction *Xor = cast<Instruction>(Builder.CreateXor(Sub, B));
+  Instruction *Or = cast<Instruction>(Builder.CreateOr(Xor, A));
+  Ret->setOperand(0, Or);
+  EXPECT_EQ(InstList({Xor, Or, Ret}), takeChanged());
+
+  // Replacing a value records its users, most recent use first.
+  A->replaceAllUsesWith(F->arg_begin());
+  EXPECT_EQ(InstList({Or, Sub, B}), takeChanged());
+  Sub->replaceUsesOfWith(B, F->arg_begin());
+  EXPECT_EQ(InstList({Sub}), takeChanged());
+
+  F->stopTrackingChanges();
+  EXPECT_FALSE(F->isTrackingChanges());
+}
+
+TEST_F(FunctionChangeTrackingTest, ForgetsRemovedInstructions) {
+  F->startTrackingChanges();
+  F->noteChangedInstruction(B);
+  F->noteChangedInstruction(Sub);
+  F->noteChangedInstruction(B);
+
+  // Erasing an instruction forgets about it and records its operands.
+  Ret->setOperand(0, B);
+  Sub->eraseFromParent();
+  EXPECT_EQ(InstList({B, Ret, A}), takeChanged());
+
+  // Instructions that leave with their block are forgotten, and those that
+  // come with a block are recorded.
+  Function *G = M->getFunction("g");
+  G->startTrackingChanges();
+  BasicBlock *Other = BasicBlock::Create(C, "other", F);
+  Instruction *Unreachable = new UnreachableInst(C, Other);
+  EXPECT_EQ(InstList({Unreachable}), takeChanged());
+  F->noteChangedInstruction(Unreachable);
+  G->getBasicBlockList().splice(G->end(), F->getBasicBlockList(), Other);
+  EXPECT_EQ(InstList(), takeChanged());
+  G->takeChangedInstructions(Changed);
+  EXPECT_EQ(InstList({Unreachable}), Changed);
+
+  // Deleting the body stops the tracking.
+  G->deleteBody();
+  EXPECT_FALSE(G->isTrackingChanges());
+}
+
+TEST_F(FunctionChangeTrackingTest, RecordsOperandsAndMoves) {
+  F->startTrackingChanges();
+
+  // Uses set directly record their user.
+  Sub->getOperandUse(1).set(F->arg_begin());
+  B->setOperand(1, ConstantInt::get(B->getType(), 3));
+  EXPECT_EQ(InstList({Sub, B}), takeChanged());
+
+  // Instructions that move within their block or to another block of the
+  // function are recorded.
+  B->moveBefore(A);
+  A->moveBefore(B);
+  EXPECT_EQ(InstList({B, A}), takeChanged());
+  BasicBlock *Tail = F->getEntryBlock().splitBasicBlock(Sub, "tail");
+  takeChanged();
+  A->moveBefore(Tail->getTerminator());
+  EXPECT_EQ(InstList({A}), takeChanged());
+
+  F->stopTrackingChanges();
+}
+
+} // end anonymous namespace
@@ -0,0 +1,152 @@
+//===- llvm/unittest/IR/IRArenaTest.cpp - IRArena unit tests --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/IRArena.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+using namespace llvm;
+
+namespace {
+
+class IRArenaTest : public testing::Test {
+protected:
+  LLVMContext C;
+  Module M;
+  Type *I32;
+  Function *F;
+
+  IRArenaTest()
+      : M("M", C), I32(Type::getInt32Ty(C)),
+        F(Function::Create(FunctionType::get(I32, I32, false),
+                           GlobalValue::ExternalLinkage, "f", &M)) {}
+};
+
+TEST_F(IRArenaTest, AllocatesFromCurrentArena) {
+  IntrusiveRefCntPtr<IRArena> Arena(new IRArena());
+  {
+    IRArena::Scope S(Arena.get());
+    BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+    IRBuilder<> B(Entry);
+    B.CreateRet(B.CreateAdd(F->arg_begin(), B.getInt32(1)));
+  }
+  EXPECT_EQ(3u, Arena->getNumLiveObjects());
+
+  // Nothing is allocated from an arena outside of its scope, or in a nested
+  // scope without an arena.
+  BasicBlock *Heap = BasicBlock::Create(C, "heap", F);
+  {
+    IRArena::Scope S(Arena.get());
+    IRArena::Scope NoArena(nullptr);
+    ReturnInst::Create(C, F->arg_begin(), Heap);
+  }
+  EXPECT_EQ(3u, Arena->getNumLiveObjects());
+  EXPECT_FALSE(verifyFunction(*F, &errs()));
+
+  F->deleteBody();
+  EXPECT_EQ(0u, Arena->getNumLiveObjects());
+}
+
+TEST_F(IRArenaTest, GrowsHungOffOperands) {
+  IntrusiveRefCntPtr<IRArena> Arena(new IRArena());
+  IRArena::Scope S(Arena.get());
+
+  BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+  BasicBlock *Exit = BasicBlock::Create(C, "exit", F);
+  IRBuilder<> B(Entry);
+  SwitchInst *Switch = B.CreateSwitch(F->arg_begin(), Exit);
+  B.SetInsertPoint(Exit);
+  PHINode *Phi = B.CreatePHI(I32, 0);
+  B.CreateRet(Phi);
+  Phi->addIncoming(F->arg_begin(), Entry);
+
+  const unsigned NumCases = 100;
+  for (unsigned I = 0; I != NumCases; ++I) {
+    BasicBlock *BB = BasicBlock::Create(C, "", F, Exit);
+    Switch->addCase(B.getInt32(I), BB);
+    BranchInst::Create(Exit, BB);
+    Phi->addIncoming(B.getInt32(I), BB);
+  }
+  EXPECT_FALSE(verifyFunction(*F, &errs()));
+  EXPECT_EQ(NumCases + 1, Phi->getNumIncomingValues());
+  EXPECT_EQ(Exit->getPrevNode(), Phi->getIncomingBlock(NumCases));
+  EXPECT_EQ(NumCases, Switch->getNumCases());
+  // The operand lists that were outgrown were given back to the arena.
+  EXPECT_NE(0u, Arena->getNumReusedObjects());
+
+  F->deleteBody();
+  EXPECT_EQ(0u, Arena->getNumLiveObjects());
+}
+
+TEST_F(IRArenaTest, ReusesStorageOfDeletedObjects) {
+  IntrusiveRefCntPtr<IRArena> Arena(new IRArena());
+  IRArena::Scope S(Arena.get());
+
+  BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+  IRBuilder<> B(Entry);
+  Instruction *Add =
+      cast<Instruction>(B.CreateAdd(F->arg_begin(), B.getInt32(1)));
+  B.CreateRet(Add);
+  size_t Memory = Arena->getTotalMemory();
+
+  for (unsigned I = 0; I != 1000; ++I) {
+    B.SetInsertPoint(Add);
+    Instruction *Sub =
+        cast<Instruction>(B.CreateSub(F->arg_begin(), B.getInt32(1)));
+    Add->replaceAllUsesWith(Sub);
+    Add->eraseFromParent();
+    Add = Sub;
+  }
+  // Each subtraction but the first reuses the storage of the instruction it
+  // replaced.
+  EXPECT_EQ(999u, Arena->getNumReusedObjects());
+  EXPECT_EQ(Memory, Arena->getTotalMemory());
+}
+
+TEST_F(IRArenaTest, ObjectsKeepArenaAlive) {
+  {
+    IntrusiveRefCntPtr<IRArena> Arena(new IRArena());
+    IRArena::Scope S(Arena.get());
+    BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+    ReturnInst::Create(C, F->arg_begin(), Entry);
+  }
+  // The arena goes away with the last of its objects.
+  F->deleteBody();
+}
+
+TEST(IRArenaReaderTest, FunctionArenas) {
+  LLVMContext C;
+  C.setUseFunctionArenas(true);
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(
+      "define i32 @f(i32 %x) {\n"
+      "entry:\n"
+      "  br label %loop\n"
+      "loop:\n"
+      "  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]\n"
+      "  %i.next = add i32 %i, 1\n"
+      "  %done = icmp eq i32 %i.next, %x\n"
+      "  br i1 %done, label %exit, label %loop\n"
+      "exit:\n"
+      "  ret i32 %i\n"
+      "}\n",
+      Err, C);
+  ASSERT_TRUE(M != nullptr);
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+  // Nothing that is created after parsing comes from the function's arena.
+  EXPECT_EQ(nullptr, IRArena::getCurrent());
+}
+
+} // end anonymous namespace
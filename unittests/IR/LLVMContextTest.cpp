@@ -0,0 +1,98 @@
+//===- llvm/unittest/IR/LLVMContextTest.cpp - LLVMContext unit tests ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ThreadPool.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+const unsigned NumThreads = 4;
+const unsigned NumValues = 512;
+
+/// The values a thread created, in creation order.
+struct CreatedValues {
+  std::vector<Type *> Types;
+  std::vector<Constant *> Constants;
+  std::vector<Metadata *> Nodes;
+};
+
+void createValues(LLVMContext &C, GlobalVariable *G, DISubprogram *SP,
+                  CreatedValues &Out) {
+  Type *I32 = Type::getInt32Ty(C);
+  for (unsigned I = 0; I != NumValues; ++I) {
+    ArrayType *ArrayTy = ArrayType::get(I32, I % 13 + 1);
+    Out.Types.push_back(ArrayTy);
+    Out.Types.push_back(PointerType::getUnqual(ArrayTy));
+    Out.Types.push_back(StructType::get(I32, ArrayTy, nullptr));
+    Out.Types.push_back(FunctionType::get(ArrayTy, I32, false));
+
+    Constant *Int = ConstantInt::get(I32, I);
+    Out.Constants.push_back(Int);
+    Out.Constants.push_back(ConstantFP::get(Type::getDoubleTy(C), I));
+    Out.Constants.push_back(ConstantArray::get(
+        ArrayTy, std::vector<Constant *>(I % 13 + 1, Int)));
+    Out.Constants.push_back(ConstantExpr::getGetElementPtr(
+        G->getValueType(), G, ConstantInt::get(I32, I + 1)));
+    Out.Constants.push_back(UndefValue::get(ArrayTy));
+
+    Out.Nodes.push_back(DILocation::get(C, I, I % 7, SP));
+    Out.Nodes.push_back(MDTuple::get(C, ValueAsMetadata::get(Int)));
+    Out.Nodes.push_back(MDString::get(C, "s" + std::to_string(I % 31)));
+  }
+}
+
+TEST(LLVMContextTest, MultithreadedUniquing) {
+  LLVMContext C;
+  Module M("M", C);
+  auto *G = new GlobalVariable(M, Type::getInt32Ty(C), false,
+                               GlobalValue::ExternalLinkage, nullptr, "g");
+  DISubprogram *SP = DISubprogram::getDistinct(
+      C, nullptr, "", "", nullptr, 0, nullptr, false, false, 0, nullptr, 0, 0,
+      0, 0);
+
+  std::vector<CreatedValues> Created(NumThreads);
+  C.enterMultithreadedRegion();
+  {
+    ThreadPool Pool(NumThreads);
+    for (unsigned T = 0; T != NumThreads; ++T)
+      Pool.async([&, T] { createValues(C, G, SP, Created[T]); });
+    Pool.wait();
+  }
+  C.exitMultithreadedRegion();
+
+  // Every thread must have got the same uniqued values, which must also be
+  // the ones a serial lookup finds.
+  CreatedValues Serial;
+  createValues(C, G, SP, Serial);
+  for (const CreatedValues &Values : Created) {
+    EXPECT_EQ(Serial.Types, Values.Types);
+    EXPECT_EQ(Serial.Constants, Values.Constants);
+    EXPECT_EQ(Serial.Nodes, Values.Nodes);
+  }
+
+  // The use lists of the shared operands must be consistent: each expression
+  // uses the global once.
+  unsigned NumGEPs = 0;
+  for (const User *U : G->users()) {
+    EXPECT_TRUE(isa<ConstantExpr>(U));
+    ++NumGEPs;
+  }
+  EXPECT_EQ(NumValues, NumGEPs);
+}
+
+} // end anonymous namespace
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
@@ -15,6 +16,7 @@
 #include "llvm/IR/User.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -109,4 +111,62 @@ TEST(UseTest, reverse) {
   ASSERT_EQ(8u, I);
 }
 
+TEST(UseTest, replaceAllUsesWith) {
+  // Replacing a value must leave the same use lists as setting its uses one
+  // by one, including when some of them are operands of constants.
+  const char *ModuleString =
+      "@g = global i32 0\n"
+      "@h = global i32 0\n"
+      "@p = global i32* getelementptr (i32, i32* @g, i64 1)\n"
+      "define void @f(i32 %x) {\n"
+      "entry:\n"
+      "  %v = add i32 %x, 1\n"
+      "  store i32 %v, i32* @h\n"
+      "  store i32 %v, i32* @g\n"
+      "  %l1 = load i32, i32* getelementptr (i32, i32* @g, i64 1)\n"
+      "  %l2 = load i32, i32* @g\n"
+      "  %a1 = add i32 %v, %l1\n"
+      "  %a2 = add i32 %x, %v\n"
+      "  store i32 %a2, i32* @h\n"
+      "  store i32 %a1, i32* @g\n"
+      "  ret void\n"
+      "}\n";
+
+  auto Print = [](const Module &M) {
+    std::string S;
+    raw_string_ostream OS(S);
+    M.print(OS, nullptr, /* ShouldPreserveUseListOrder */ true);
+    return OS.str();
+  };
+  auto SetOneByOne = [](Value *From, Value *To) {
+    while (!From->use_empty()) {
+      Use &U = *From->use_begin();
+      auto *C = dyn_cast<Constant>(U.getUser());
+      if (C && !isa<GlobalValue>(C))
+        C->replaceUsesOfWithOnConstant(From, To, &U);
+      else
+        U.set(To);
+    }
+  };
+
+  LLVMContext C1, C2;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M1 = parseAssemblyString(ModuleString, Err, C1);
+  std::unique_ptr<Module> M2 = parseAssemblyString(ModuleString, Err, C2);
+  ASSERT_TRUE(M1 && M2);
+
+  M1->getNamedValue("g")->replaceAllUsesWith(M1->getNamedValue("h"));
+  SetOneByOne(M2->getNamedValue("g"), M2->getNamedValue("h"));
+  EXPECT_TRUE(M1->getNamedValue("g")->use_empty());
+  EXPECT_EQ(Print(*M2), Print(*M1));
+
+  Function *F1 = M1->getFunction("f"), *F2 = M2->getFunction("f");
+  Value *V1 = F1->getEntryBlock().begin();
+  Value *V2 = F2->getEntryBlock().begin();
+  V1->replaceAllUsesWith(F1->arg_begin());
+  SetOneByOne(V2, F2->arg_begin());
+  EXPECT_TRUE(V1->use_empty());
+  EXPECT_EQ(Print(*M2), Print(*M1));
+}
+
 } // end anonymous namespace
@@ -11,6 +11,7 @@
 #include "llvm/Support/Endian.h"
 #include "gtest/gtest.h"
 #include <string>
+#include <vector>
 
 using namespace llvm;
 
@@ -68,4 +69,77 @@ TEST(StringTableBuilderTest, BasicWinCOFF) {
   EXPECT_EQ(23U, B.getOffset("river horse"));
 }
 
+TEST(StringTableBuilderTest, NestedSuffixes) {
+  StringTableBuilder B;
+
+  B.add("c");
+  B.add("abc");
+  B.add("bc");
+  B.add("xbc");
+  B.add("ab");
+  B.add("");
+
+  B.finalize(StringTableBuilder::ELF);
+
+  // "xbc" and "abc" share "bc" and "c" but not each other; "ab" stands alone
+  // and the empty string reuses the terminator of the last entry.
+  std::string Expected;
+  Expected += '\x00';
+  Expected += "xbc";
+  Expected += '\x00';
+  Expected += "abc";
+  Expected += '\x00';
+  Expected += "ab";
+  Expected += '\x00';
+
+  EXPECT_EQ(Expected, B.data());
+  EXPECT_EQ(1U, B.getOffset("xbc"));
+  EXPECT_EQ(5U, B.getOffset("abc"));
+  EXPECT_EQ(6U, B.getOffset("bc"));
+  EXPECT_EQ(7U, B.getOffset("c"));
+  EXPECT_EQ(9U, B.getOffset("ab"));
+  EXPECT_EQ(11U, B.getOffset(""));
+}
+
+TEST(StringTableBuilderTest, ManyStrings) {
+  // Strings that share long suffixes and strings that differ in every
+  // position, to exercise all three partitions of the suffix sort.
+  std::vector<std::string> Strings;
+  for (unsigned I = 0; I != 1000; ++I) {
+    Strings.push_back(std::string(I, 'a') + "_Z");
+    Strings.push_back(std::to_string(I * 7919) + "x");
+    Strings.push_back(std::string(1, char(1 + I % 255)) + std::to_string(I));
+  }
+
+  StringTableBuilder B;
+  for (const std::string &S : Strings)
+    B.add(S);
+  B.finalize(StringTableBuilder::ELF);
+
+  StringRef Data = B.data();
+  for (const std::string &S : Strings) {
+    size_t Offset = B.getOffset(S);
+    ASSERT_LE(Offset + S.size() + 1, Data.size());
+    EXPECT_EQ(S, Data.substr(Offset, S.size()));
+    EXPECT_EQ('\0', Data[Offset + S.size()]);
+  }
+  // Every "a...a_Z" is a suffix of the longest one.
+  EXPECT_GT(B.getOffset("_Z"), B.getOffset(std::string(999, 'a') + "_Z"));
+}
+
+TEST(StringTableBuilderTest, BasicRAW) {
+  StringTableBuilder B;
+
+  B.add("foo/\n");
+  B.add("barfoo/\n");
+  B.add("baz/\n");
+
+  B.finalize(StringTableBuilder::RAW);
+
+  EXPECT_EQ("baz/\nbarfoo/\n", B.data());
+  EXPECT_EQ(0U, B.getOffset("baz/\n"));
+  EXPECT_EQ(5U, B.getOffset("barfoo/\n"));
+  EXPECT_EQ(8U, B.getOffset("foo/\n"));
+}
+
 }
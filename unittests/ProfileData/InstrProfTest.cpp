@@ -95,4 +95,60 @@ TEST_F(InstrProfTest, get_max_function_count) {
   ASSERT_EQ(1ULL << 63, Reader->getMaximumFunctionCount());
 }
 
+TEST_F(InstrProfTest, merge_records_from_writer) {
+  Writer.addFunctionCounts("foo", 0x1234, {1, 2});
+  Writer.addFunctionCounts("bar", 0, {3});
+
+  InstrProfWriter Writer2;
+  Writer2.addFunctionCounts("foo", 0x1234, {4, 5});
+  Writer2.addFunctionCounts("foo", 0x5678, {6});
+  Writer2.addFunctionCounts("bar", 0, {7, 8});
+
+  std::vector<std::string> Failed;
+  Writer.mergeRecordsFromWriter(
+      std::move(Writer2), [&](StringRef Name, std::error_code EC) {
+        ASSERT_TRUE(ErrorEquals(instrprof_error::count_mismatch, EC));
+        Failed.push_back(Name);
+      });
+  ASSERT_EQ(1U, Failed.size());
+  ASSERT_EQ("bar", Failed[0]);
+
+  auto Profile = Writer.writeBuffer();
+  readProfile(std::move(Profile));
+
+  std::vector<uint64_t> Counts;
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("foo", 0x1234, Counts)));
+  ASSERT_EQ(2U, Counts.size());
+  ASSERT_EQ(5U, Counts[0]);
+  ASSERT_EQ(7U, Counts[1]);
+
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("foo", 0x5678, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(6U, Counts[0]);
+
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("bar", 0, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(3U, Counts[0]);
+
+  ASSERT_EQ(6U, Reader->getMaximumFunctionCount());
+}
+
+TEST_F(InstrProfTest, remove_function_counts) {
+  Writer.addFunctionCounts("foo", 0x1234, {1, 2});
+  Writer.addFunctionCounts("foo", 0x5678, {3});
+  Writer.addFunctionCounts("bar", 0, {4});
+  Writer.removeFunctionCounts("foo");
+  Writer.removeFunctionCounts("baz");
+  auto Profile = Writer.writeBuffer();
+  readProfile(std::move(Profile));
+
+  std::vector<uint64_t> Counts;
+  std::error_code EC = Reader->getFunctionCounts("foo", 0x1234, Counts);
+  ASSERT_TRUE(ErrorEquals(instrprof_error::unknown_function, EC));
+
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("bar", 0, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(4U, Counts[0]);
+}
+
 } // end anonymous namespace
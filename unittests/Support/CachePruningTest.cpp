@@ -0,0 +1,136 @@
+//===- unittests/Support/CachePruningTest.cpp - CachePruning tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CachePruning.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+class CachePruningTest : public ::testing::Test {
+protected:
+  SmallString<64> Dir;
+
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("CachePruningTestDir", Dir));
+  }
+
+  void TearDown() override {
+    std::error_code EC;
+    std::vector<std::string> Files;
+    for (sys::fs::directory_iterator File(Dir, EC), FileEnd;
+         File != FileEnd && !EC; File.increment(EC))
+      Files.push_back(File->path());
+    for (const std::string &File : Files)
+      sys::fs::remove(File);
+    sys::fs::remove(Dir);
+  }
+
+  std::string getPath(StringRef Name) {
+    SmallString<128> Path(Dir);
+    sys::path::append(Path, Name);
+    return Path.str();
+  }
+
+  /// Create the file \p Name of \p Size bytes, last used \p Age seconds ago.
+  void createFile(StringRef Name, size_t Size, unsigned Age) {
+    int FD;
+    ASSERT_FALSE(sys::fs::openFileForWrite(getPath(Name), FD,
+                                           sys::fs::F_None));
+    {
+      raw_fd_ostream OS(FD, /*shouldClose=*/false);
+      OS << std::string(Size, 'x');
+    }
+    sys::TimeValue Time = sys::TimeValue::now() -
+                          sys::TimeValue(sys::TimeValue::SecondsType(Age));
+    ASSERT_FALSE(sys::fs::setLastModificationAndAccessTime(FD, Time));
+    sys::Process::SafelyCloseFileDescriptor(FD);
+  }
+
+  bool exists(StringRef Name) { return sys::fs::exists(getPath(Name)); }
+};
+
+TEST_F(CachePruningTest, NoPolicy) {
+  createFile("llvmcache-a", 10, 1000);
+  EXPECT_FALSE(CachePruning(Dir).setPruningInterval(0).prune());
+  EXPECT_TRUE(exists("llvmcache-a"));
+}
+
+TEST_F(CachePruningTest, Expiration) {
+  createFile("llvmcache-old", 10, 1000);
+  createFile("llvmcache-new", 10, 0);
+  createFile("other", 10, 1000);
+  EXPECT_TRUE(
+      CachePruning(Dir).setPruningInterval(0).setEntryExpiration(500).prune());
+  EXPECT_FALSE(exists("llvmcache-old"));
+  EXPECT_TRUE(exists("llvmcache-new"));
+  // Only the cache entries are pruned.
+  EXPECT_TRUE(exists("other"));
+}
+
+TEST_F(CachePruningTest, MaxSize) {
+  createFile("llvmcache-a", 100, 300);
+  createFile("llvmcache-b", 100, 200);
+  createFile("llvmcache-c", 100, 100);
+  createFile("other", 1000, 400);
+  EXPECT_TRUE(CachePruning(Dir).setPruningInterval(0).setMaxSize(250).prune());
+  // The least recently used entries go first, until the entries fit.
+  EXPECT_FALSE(exists("llvmcache-a"));
+  EXPECT_TRUE(exists("llvmcache-b"));
+  EXPECT_TRUE(exists("llvmcache-c"));
+  EXPECT_TRUE(exists("other"));
+}
+
+TEST_F(CachePruningTest, TouchEntry) {
+  createFile("llvmcache-a", 100, 200);
+  createFile("llvmcache-b", 100, 100);
+  CachePruning::touchEntry(getPath("llvmcache-a"));
+  // Touching an entry that doesn't exist doesn't create it.
+  CachePruning::touchEntry(getPath("llvmcache-missing"));
+  EXPECT_FALSE(exists("llvmcache-missing"));
+
+  EXPECT_TRUE(CachePruning(Dir).setPruningInterval(0).setMaxSize(150).prune());
+  EXPECT_TRUE(exists("llvmcache-a"));
+  EXPECT_FALSE(exists("llvmcache-b"));
+}
+
+TEST_F(CachePruningTest, Interval) {
+  EXPECT_TRUE(
+      CachePruning(Dir).setPruningInterval(0).setEntryExpiration(500).prune());
+  EXPECT_TRUE(exists("llvmcache.timestamp"));
+
+  // The directory was just scanned, it is not scanned again before the
+  // interval is over.
+  createFile("llvmcache-old", 10, 1000);
+  EXPECT_FALSE(CachePruning(Dir)
+                   .setPruningInterval(3600)
+                   .setEntryExpiration(500)
+                   .prune());
+  EXPECT_TRUE(exists("llvmcache-old"));
+
+  // A negative interval disables pruning.
+  EXPECT_FALSE(
+      CachePruning(Dir).setPruningInterval(-1).setEntryExpiration(500).prune());
+  EXPECT_TRUE(exists("llvmcache-old"));
+
+  EXPECT_TRUE(
+      CachePruning(Dir).setPruningInterval(0).setEntryExpiration(500).prune());
+  EXPECT_FALSE(exists("llvmcache-old"));
+}
+
+} // anonymous namespace
@@ -16,6 +16,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Config/config.h"
 #include "gtest/gtest.h"
+#include <string>
 
 using namespace llvm;
 
@@ -59,6 +60,52 @@ TEST(CompressionTest, Zlib) {
   TestZlibCompression(BinaryDataStr, zlib::DefaultCompression);
 }
 
+TEST(CompressionTest, ZlibInBlocks) {
+  std::string Input;
+  for (unsigned I = 0; I < 20000; ++I)
+    Input += "block " + std::to_string(I % 97) + " of " +
+             std::to_string(I % 13) + "\n";
+
+  SmallString<32> Whole;
+  EXPECT_EQ(zlib::StatusOK, zlib::compress(Input, Whole));
+
+  // An input that fits in one block compresses as with compress().
+  SmallString<32> OneBlock;
+  EXPECT_EQ(zlib::StatusOK, zlib::compressInBlocks(Input, OneBlock,
+                                                   zlib::DefaultCompression,
+                                                   Input.size(), 4));
+  EXPECT_EQ(Whole, OneBlock);
+
+  // Larger inputs give a single zlib stream that does not depend on the
+  // number of threads, and is not much larger than the one from compress().
+  SmallString<32> Serial;
+  EXPECT_EQ(zlib::StatusOK,
+            zlib::compressInBlocks(Input, Serial, zlib::DefaultCompression,
+                                   10000, 1));
+  EXPECT_LT(Serial.size(), Whole.size() + Whole.size() / 10);
+  SmallString<32> Uncompressed;
+  EXPECT_EQ(zlib::StatusOK,
+            zlib::uncompress(Serial, Uncompressed, Input.size()));
+  EXPECT_EQ(Input, Uncompressed);
+
+  SmallString<32> Parallel;
+  EXPECT_EQ(zlib::StatusOK,
+            zlib::compressInBlocks(Input, Parallel, zlib::DefaultCompression,
+                                   10000, 4));
+  EXPECT_EQ(Serial, Parallel);
+
+  for (zlib::CompressionLevel Level :
+       {zlib::NoCompression, zlib::BestSpeedCompression,
+        zlib::BestSizeCompression}) {
+    SmallString<32> Compressed;
+    EXPECT_EQ(zlib::StatusOK,
+              zlib::compressInBlocks(Input, Compressed, Level, 4096, 3));
+    EXPECT_EQ(zlib::StatusOK,
+              zlib::uncompress(Compressed, Uncompressed, Input.size()));
+    EXPECT_EQ(Input, Uncompressed);
+  }
+}
+
 TEST(CompressionTest, ZlibCRC32) {
   EXPECT_EQ(
       0x414FA339U,
@@ -0,0 +1,206 @@
+//========- unittests/Support/ThreadPool.cpp - ThreadPool.h tests ----========//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+// Fixture for the unittests, allowing to *temporarily* wait on a condition
+// variable so that the tasks can't run before the main thread is ready.
+class ThreadPoolTest : public testing::Test {
+  std::condition_variable WaitMainThread;
+  std::mutex WaitMainThreadMutex;
+  bool MainThreadReady;
+
+protected:
+  /// Make sure this thread not progress faster than the main thread.
+  void waitForMainThread() {
+    std::unique_lock<std::mutex> LockGuard(WaitMainThreadMutex);
+    WaitMainThread.wait(LockGuard, [&] { return MainThreadReady; });
+  }
+
+  /// Set the readiness of the main thread.
+  void setMainThreadReady() {
+    {
+      std::unique_lock<std::mutex> LockGuard(WaitMainThreadMutex);
+      MainThreadReady = true;
+    }
+    WaitMainThread.notify_all();
+  }
+
+  void SetUp() override { MainThreadReady = false; }
+};
+
+TEST_F(ThreadPoolTest, AsyncBarrier) {
+  // test that async & barrier work together properly.
+
+  std::atomic_int checked_in{0};
+
+  ThreadPool Pool;
+  for (size_t i = 0; i < 5; ++i) {
+    Pool.async([this, &checked_in, i] {
+      waitForMainThread();
+      ++checked_in;
+    });
+  }
+  ASSERT_EQ(0, checked_in);
+  setMainThreadReady();
+  Pool.wait();
+  ASSERT_EQ(5, checked_in);
+}
+
+static void TestFunc(std::atomic_int &checked_in, int i) { checked_in += i; }
+
+TEST_F(ThreadPoolTest, AsyncBarrierArgs) {
+  // Test that async works with a function requiring multiple parameters.
+  std::atomic_int checked_in{0};
+
+  ThreadPool Pool;
+  for (size_t i = 0; i < 5; ++i) {
+    Pool.async(TestFunc, std::ref(checked_in), i);
+  }
+  Pool.wait();
+  ASSERT_EQ(10, checked_in);
+}
+
+TEST_F(ThreadPoolTest, Async) {
+  ThreadPool Pool;
+  std::atomic_int i{0};
+  Pool.async([this, &i] {
+    waitForMainThread();
+    ++i;
+  });
+  Pool.async([&i] { ++i; });
+  ASSERT_NE(2, i.load());
+  setMainThreadReady();
+  Pool.wait();
+  ASSERT_EQ(2, i.load());
+}
+
+TEST_F(ThreadPoolTest, GetFuture) {
+  ThreadPool Pool(2);
+  std::atomic_int i{0};
+  Pool.async([this, &i] {
+    waitForMainThread();
+    ++i;
+  });
+  // Force the future using get()
+  Pool.async([&i] { ++i; }).get();
+  ASSERT_NE(2, i.load());
+  setMainThreadReady();
+  Pool.wait();
+  ASSERT_EQ(2, i.load());
+}
+
+TEST_F(ThreadPoolTest, PoolDestruction) {
+  // Test that we are waiting on destruction
+  std::atomic_int checked_in{0};
+  {
+    ThreadPool Pool;
+    for (size_t i = 0; i < 5; ++i) {
+      Pool.async([this, &checked_in, i] {
+        waitForMainThread();
+        ++checked_in;
+      });
+    }
+    ASSERT_EQ(0, checked_in);
+    setMainThreadReady();
+  }
+  ASSERT_EQ(5, checked_in);
+}
+
+TEST_F(ThreadPoolTest, ManyTasks) {
+  // Submit many more small tasks than there are threads and check that each
+  // one runs exactly once.
+  const unsigned NumTasks = 1000;
+  std::vector<std::atomic_int> Counts(NumTasks);
+  for (auto &C : Counts)
+    C = 0;
+
+  ThreadPool Pool(4);
+  for (unsigned I = 0; I < NumTasks; ++I)
+    Pool.async([&Counts, I] { ++Counts[I]; });
+  Pool.wait();
+
+  for (unsigned I = 0; I < NumTasks; ++I)
+    ASSERT_EQ(1, Counts[I]) << "Task " << I;
+}
+
+TEST_F(ThreadPoolTest, TaskGroupWait) {
+  // Test that waiting on a group only waits for the tasks of the group.
+  std::atomic_int checked_in{0};
+  std::atomic_int in_group{0};
+
+  ThreadPool Pool(2);
+  Pool.async([this, &checked_in] {
+    waitForMainThread();
+    ++checked_in;
+  });
+  {
+    TaskGroup Group(Pool);
+    for (size_t i = 0; i < 5; ++i)
+      Group.async([&in_group] { ++in_group; });
+    Group.wait();
+    ASSERT_EQ(5, in_group);
+  }
+  ASSERT_EQ(0, checked_in);
+  setMainThreadReady();
+  Pool.wait();
+  ASSERT_EQ(1, checked_in);
+}
+
+static void addTree(ThreadPool &Pool, std::atomic_int &Count, unsigned Depth) {
+  ++Count;
+  if (!Depth)
+    return;
+  TaskGroup Group(Pool);
+  Group.async(addTree, std::ref(Pool), std::ref(Count), Depth - 1);
+  Group.async(addTree, std::ref(Pool), std::ref(Count), Depth - 1);
+  Group.wait();
+}
+
+TEST_F(ThreadPoolTest, NestedTaskGroups) {
+  // Tasks that wait on the groups of the tasks they submit must not block the
+  // workers, even when there is a single one.
+  for (unsigned Threads : {1, 4}) {
+    std::atomic_int Count{0};
+    ThreadPool Pool(Threads);
+    Pool.async(addTree, std::ref(Pool), std::ref(Count), 8);
+    Pool.wait();
+    ASSERT_EQ(511, Count) << Threads << " threads";
+  }
+}
+
+#if LLVM_ENABLE_THREADS
+TEST_F(ThreadPoolTest, Stealing) {
+  // The tasks that a worker submits go to its own queue. Check that the other
+  // workers steal them: each task waits until all of them have started.
+  const int NumTasks = 3;
+  std::atomic_int Started{0};
+
+  ThreadPool Pool(NumTasks + 1);
+  Pool.async([&Pool, &Started] {
+    TaskGroup Group(Pool);
+    for (int I = 0; I < NumTasks; ++I)
+      Group.async([&Started] {
+        ++Started;
+        while (Started < NumTasks)
+          std::this_thread::yield();
+      });
+  });
+  Pool.wait();
+  ASSERT_EQ(NumTasks, Started);
+}
+#endif
+
+} // end anonymous namespace
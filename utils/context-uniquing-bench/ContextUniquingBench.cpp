@@ -0,0 +1,138 @@
+//===- ContextUniquingBench - Benchmark the LLVMContext uniquing tables ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program uniques types, constants and DILocations from several threads
+// sharing one LLVMContext in a multithreaded region, and outputs the number
+// of values uniqued per second for each number of threads. The threads either
+// all unique the same values, so that most lookups find an existing value, or
+// each unique values of their own, so that most lookups insert one.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace llvm;
+
+static cl::list<unsigned>
+  ThreadCounts("threads", cl::CommaSeparated,
+               cl::desc("Comma separated numbers of threads to run with "
+                        "(default = 1,2,4,8)"));
+
+static cl::opt<unsigned>
+  NumValues("values", cl::desc("Number of keys each thread uniques values for"),
+            cl::init(20000));
+
+static cl::opt<unsigned>
+  NumRounds("rounds", cl::desc("Number of times to run each measurement, "
+                               "keeping the fastest"),
+            cl::init(3));
+
+/// The number of values uniqueValues looks up for each key.
+static const unsigned ValuesPerKey = 8;
+
+/// Unique the types, constants and DILocations for the keys [First, First +
+/// Count).
+static void uniqueValues(LLVMContext &C, GlobalVariable *G, DISubprogram *SP,
+                         unsigned First, unsigned Count) {
+  Type *I32 = Type::getInt32Ty(C);
+  Type *Double = Type::getDoubleTy(C);
+  for (unsigned K = First, E = First + Count; K != E; ++K) {
+    ArrayType *ArrayTy = ArrayType::get(I32, K);
+    PointerType::getUnqual(ArrayTy);
+    StructType::get(I32, ArrayTy, nullptr);
+    FunctionType::get(ArrayTy, I32, false);
+
+    Constant *Int = ConstantInt::get(I32, K);
+    ConstantFP::get(Double, K);
+    ConstantExpr::getGetElementPtr(G->getValueType(), G, Int);
+
+    DILocation::get(C, K, K % 80, SP);
+  }
+}
+
+/// Return the wall time it takes \p NumThreads threads to unique their values
+/// in a new context. With \p NumThreads of 0, unique the values of a single
+/// thread on the calling thread, outside of a multithreaded region.
+static double runOnce(unsigned NumThreads, bool Shared) {
+  LLVMContext C;
+  Module M("bench", C);
+  auto *G = new GlobalVariable(M, Type::getInt32Ty(C), false,
+                               GlobalValue::ExternalLinkage, nullptr, "g");
+  DISubprogram *SP = DISubprogram::getDistinct(
+      C, nullptr, "", "", nullptr, 0, nullptr, false, false, 0, nullptr, 0, 0,
+      0, 0);
+
+  if (NumThreads == 0) {
+    double Start = TimeRecord::getCurrentTime(true).getWallTime();
+    uniqueValues(C, G, SP, 0, NumValues);
+    return TimeRecord::getCurrentTime(false).getWallTime() - Start;
+  }
+
+  ThreadPool Pool(NumThreads);
+  C.enterMultithreadedRegion();
+  double Start = TimeRecord::getCurrentTime(true).getWallTime();
+  for (unsigned T = 0; T != NumThreads; ++T)
+    Pool.async([&, T] {
+      LLVMContext::setMultithreadedWorkOrder(T);
+      uniqueValues(C, G, SP, Shared ? 0 : T * NumValues, NumValues);
+    });
+  Pool.wait();
+  double Time = TimeRecord::getCurrentTime(false).getWallTime() - Start;
+  C.exitMultithreadedRegion();
+  return Time;
+}
+
+static void benchmark(bool Shared) {
+  outs() << (Shared ? "Same keys on every thread\n"
+                    : "Different keys on each thread\n");
+  outs() << "  threads      seconds     values/s   speedup\n";
+  double Base = 0;
+  auto Report = [&](StringRef Name, unsigned NumThreads) {
+    double Best = 0;
+    for (unsigned Round = 0; Round != NumRounds; ++Round) {
+      double Time = runOnce(NumThreads, Shared);
+      Best = Round ? std::min(Best, Time) : Time;
+    }
+    double Rate =
+        double(std::max(NumThreads, 1u)) * NumValues * ValuesPerKey / Best;
+    if (NumThreads == 1)
+      Base = Rate;
+    outs() << format("  %-8s %10.4f %12.0f", Name.str().c_str(), Best, Rate);
+    if (Base && NumThreads)
+      outs() << format(" %9.2f", Rate / Base);
+    outs() << '\n';
+  };
+
+  Report("serial", 0);
+  for (unsigned NumThreads : ThreadCounts)
+    Report(std::to_string(NumThreads), NumThreads);
+  outs() << '\n';
+}
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "LLVMContext uniquing benchmark\n");
+  if (ThreadCounts.empty())
+    for (unsigned NumThreads : {1, 2, 4, 8})
+      ThreadCounts.push_back(NumThreads);
+
+  benchmark(/*Shared=*/true);
+  benchmark(/*Shared=*/false);
+  return 0;
+}
@@ -0,0 +1,46 @@
+#!/usr/bin/env python
+"""A high fan-out IR creation program.
+
+This is a python program that creates LLVM IR in which a few values have a
+very large number of uses: an instruction that InstCombine folds away, the
+constants it and its users compute with, and an internal global that
+GlobalOpt turns into a constant.  Replacing such values touches every one of
+their uses, so the output is good for measuring how use lists scale, e.g.:
+
+  create_high_fanout_uses.py 100000 | opt -instcombine -time-passes -o /dev/null
+  create_high_fanout_uses.py 100000 | opt -globalopt -time-passes -o /dev/null
+"""
+
+from __future__ import print_function
+import argparse
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+      formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('uses', type=int,
+                      help="Number of uses of each high fan-out value")
+  parser.add_argument('--functions', type=int, default=10,
+                      help="Number of functions the uses are spread over")
+  args = parser.parse_args()
+  per_function = max(args.uses // args.functions, 1)
+
+  print("@g = internal global i32 7")
+  print("@sink = global i32 0")
+  print()
+  for f in range(args.functions):
+    print("define void @f%d(i32 %%a) {" % f)
+    print("entry:")
+    # InstCombine replaces %x with %a, which moves all uses of %x.
+    print("  %x = add i32 %a, 0")
+    print("  %s0 = add i32 %x, 7")
+    for i in range(1, per_function):
+      print("  %%l%d = load i32, i32* @g" % i)
+      print("  %%m%d = mul i32 %%x, %%l%d" % (i, i))
+      print("  %%s%d = add i32 %%s%d, %%m%d" % (i, i - 1, i))
+    print("  store i32 %%s%d, i32* @sink" % (per_function - 1))
+    print("  ret void")
+    print("}")
+    print()
+
+if __name__ == '__main__':
+  main()
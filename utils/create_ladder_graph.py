@@ -8,6 +8,12 @@ and often generate N^2 or worse behavior.
 
 One good use of this program is to test whether your linear time algorithm is
 really behaving linearly.
+
+With --ir, it creates LLVM IR instead, which can be fed to opt directly, e.g.
+to time dominator tree construction on a large CFG:
+
+  create_ladder_graph.py --ir 200000 > ladder.ll
+  opt -domtree -postdomtree -time-passes -disable-output ladder.ll
 """
 
 import argparse
@@ -15,10 +21,15 @@ def main():
   parser = argparse.ArgumentParser(description=__doc__)
   parser.add_argument('rungs', type=int,
                       help="Number of ladder rungs. Must be a multiple of 2")
+  parser.add_argument('--ir', action='store_true',
+                      help="Create LLVM IR rather than c source code")
   args = parser.parse_args()
   if (args.rungs % 2) != 0:
     print "Rungs must be a multiple of 2"
     return
+  if args.ir:
+    print_ir(args.rungs)
+    return
   print "int ladder(int *foo, int *bar, int x) {"
   rung1 = xrange(0, args.rungs, 2)
   rung2 = xrange(1, args.rungs, 2)
@@ -39,5 +50,30 @@ def main():
       print "return *foo;"
   print "}"
 
+def print_ir(rungs):
+  print "define i32 @ladder(i32* %foo, i32* %bar, i32 %x) {"
+  print "entry:"
+  print "  br label %rung10"
+  rung1 = xrange(0, rungs, 2)
+  rung2 = xrange(1, rungs, 2)
+  for i in rung1:
+    print "rung1%d:" % i
+    print "  store i32 %x, i32* %foo"
+    if i != rung1[-1]:
+      print "  %%b%d = load i32, i32* %%bar" % i
+      print "  %%c%d = icmp ne i32 %%b%d, 0" % (i, i)
+      print "  br i1 %%c%d, label %%rung1%d, label %%rung2%d" % (i, i+2, i+1)
+    else:
+      print "  br label %%rung2%d" % (i+1)
+  for i in rung2:
+    print "rung2%d:" % i
+    print "  store i32 %x, i32* %foo"
+    if i != rung2[-1]:
+      print "  br label %%rung2%d" % (i+2)
+    else:
+      print "  %r = load i32, i32* %foo"
+      print "  ret i32 %r"
+  print "}"
+
 if __name__ == '__main__':
   main()
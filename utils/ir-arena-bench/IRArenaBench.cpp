@@ -0,0 +1,152 @@
+//===- IRArenaBench - Benchmark allocating IR from arenas -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program builds, edits and destroys large functions, once allocating
+// their instructions and blocks from the global heap and once from an
+// IRArena per function, and outputs the run time of each.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRArena.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+
+using namespace llvm;
+
+static cl::opt<unsigned>
+  NumFunctions("functions", cl::desc("Number of functions to build"),
+               cl::init(20));
+
+static cl::opt<unsigned>
+  NumBlocks("blocks", cl::desc("Number of blocks of each function"),
+            cl::init(2000));
+
+static cl::opt<unsigned>
+  NumInsts("insts", cl::desc("Number of arithmetic instructions per block"),
+           cl::init(16));
+
+static cl::opt<unsigned>
+  NumRounds("rounds", cl::desc("Number of times to build the functions"),
+            cl::init(3));
+
+static cl::opt<bool>
+  Verify("verify", cl::desc("Verify the functions that are built"),
+         cl::init(false));
+
+/// Build a function whose entry block switches to one of many blocks. Each
+/// block merges its predecessors with a phi, computes a chain of arithmetic
+/// and branches to the next block.
+static Function *buildFunction(Module &M, unsigned Index) {
+  LLVMContext &C = M.getContext();
+  Type *I32 = Type::getInt32Ty(C);
+  Function *F = Function::Create(FunctionType::get(I32, I32, false),
+                                 GlobalValue::ExternalLinkage,
+                                 "f" + Twine(Index), &M);
+  Value *Arg = F->arg_begin();
+
+  BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+  BasicBlock *Exit = BasicBlock::Create(C, "exit", F);
+  IRBuilder<> B(Entry);
+  // The cases are added one at a time, so that the operand list grows.
+  SwitchInst *Switch = B.CreateSwitch(Arg, Exit);
+
+  B.SetInsertPoint(Exit);
+  PHINode *Result = B.CreatePHI(I32, 0);
+  B.CreateRet(Result);
+  Result->addIncoming(Arg, Entry);
+
+  PHINode *PrevPhi = nullptr;
+  BasicBlock *Prev = nullptr;
+  for (unsigned I = 0; I != NumBlocks; ++I) {
+    BasicBlock *BB = BasicBlock::Create(C, "", F, Exit);
+    Switch->addCase(ConstantInt::get(cast<IntegerType>(I32), I), BB);
+    B.SetInsertPoint(BB);
+    PHINode *Phi = B.CreatePHI(I32, 0);
+    Phi->addIncoming(Arg, Entry);
+    Value *V = Phi;
+    for (unsigned J = 0; J != NumInsts; ++J)
+      V = J % 2 ? B.CreateMul(V, Arg) : B.CreateAdd(V, B.getInt32(J));
+    if (Prev) {
+      // Replace the branch of the previous block with one to this block.
+      Prev->getTerminator()->eraseFromParent();
+      BranchInst::Create(BB, Prev);
+      Phi->addIncoming(PrevPhi, Prev);
+    }
+    B.CreateBr(Exit);
+    Result->addIncoming(V, BB);
+    Prev = BB;
+    PrevPhi = Phi;
+  }
+  // Only the entry block and the last block still branch to the exit block.
+  for (unsigned I = Result->getNumIncomingValues() - 1; I-- > 1;)
+    Result->removeIncomingValue(I);
+  return F;
+}
+
+/// Replace the multiplications of \p F with shifts, deleting and creating
+/// instructions the way an optimization that rewrites code does.
+static void rewriteFunction(Function &F) {
+  for (BasicBlock &BB : F) {
+    std::vector<Instruction *> Dead;
+    for (Instruction &I : BB)
+      if (I.getOpcode() == Instruction::Mul)
+        Dead.push_back(&I);
+    for (Instruction *I : Dead) {
+      Instruction *New = BinaryOperator::CreateShl(I->getOperand(0),
+                                                   I->getOperand(1), "", I);
+      I->replaceAllUsesWith(New);
+      I->eraseFromParent();
+    }
+  }
+}
+
+static void benchmark(Timer &Total, bool UseArenas) {
+  for (unsigned Round = 0; Round != NumRounds; ++Round) {
+    LLVMContext C;
+    Module M("bench", C);
+    Total.startTimer();
+    for (unsigned I = 0; I != NumFunctions; ++I) {
+      IntrusiveRefCntPtr<IRArena> Arena;
+      if (UseArenas)
+        Arena = new IRArena();
+      IRArena::Scope S(Arena.get());
+      Function *F = buildFunction(M, I);
+      rewriteFunction(*F);
+    }
+    Total.stopTimer();
+
+    if (Verify && verifyModule(M, &errs()))
+      report_fatal_error("Broken module");
+
+    Total.startTimer();
+    while (!M.empty())
+      M.begin()->eraseFromParent();
+    Total.stopTimer();
+  }
+}
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "IR arena benchmark\n");
+
+  TimerGroup Group("IR arena benchmark");
+  Timer Heap("Global heap", Group);
+  Timer Arenas("Arena per function", Group);
+  benchmark(Heap, false);
+  benchmark(Arenas, true);
+  return 0;
+}
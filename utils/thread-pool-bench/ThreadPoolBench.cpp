@@ -0,0 +1,103 @@
+//===- ThreadPoolBench - Benchmark the ThreadPool -------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program runs the same small units of work serially, as independent
+// tasks submitted to a ThreadPool, and as a tree of tasks that split their
+// work in TaskGroups, and outputs the run time of each.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
+
+using namespace llvm;
+
+static cl::opt<unsigned>
+  NumThreads("threads", cl::desc("Number of threads of the pool "
+                                 "(default = number of cores)"),
+             cl::init(0));
+
+static cl::opt<unsigned>
+  NumTasks("tasks", cl::desc("Number of units of work"), cl::init(100000));
+
+static cl::opt<unsigned>
+  Work("work", cl::desc("Number of iterations of a unit of work"),
+       cl::init(200));
+
+static cl::opt<unsigned>
+  NumRounds("rounds", cl::desc("Number of times to run the work"),
+            cl::init(3));
+
+/// The sum of the results of the units of work, so that they aren't
+/// optimized away.
+static std::atomic<unsigned> Sum(0);
+
+static void runUnit(unsigned Index) {
+  unsigned X = Index;
+  for (unsigned I = 0; I != Work; ++I)
+    X = X * 1664525 + 1013904223;
+  Sum += X;
+}
+
+/// Run the units [Begin, End), splitting the range in two tasks of \p Pool
+/// until it is small.
+static void runRange(ThreadPool &Pool, unsigned Begin, unsigned End) {
+  if (End - Begin <= 16) {
+    for (unsigned I = Begin; I != End; ++I)
+      runUnit(I);
+    return;
+  }
+  unsigned Middle = Begin + (End - Begin) / 2;
+  TaskGroup Group(Pool);
+  Group.async(runRange, std::ref(Pool), Begin, Middle);
+  runRange(Pool, Middle, End);
+  Group.wait();
+}
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "ThreadPool benchmark\n");
+
+  TimerGroup Group("ThreadPool benchmark");
+  Timer Serial("Serial", Group);
+  Timer Flat("Independent tasks", Group);
+  Timer Nested("Nested task groups", Group);
+  ThreadPool Pool(NumThreads ? NumThreads : thread::hardware_concurrency());
+
+  unsigned Expected = 0;
+  for (unsigned Round = 0; Round != NumRounds; ++Round) {
+    Sum = 0;
+    Serial.startTimer();
+    for (unsigned I = 0; I != NumTasks; ++I)
+      runUnit(I);
+    Serial.stopTimer();
+    Expected = Sum;
+
+    Sum = 0;
+    Flat.startTimer();
+    for (unsigned I = 0; I != NumTasks; ++I)
+      Pool.async(runUnit, I);
+    Pool.wait();
+    Flat.stopTimer();
+    if (Sum != Expected)
+      report_fatal_error("Independent tasks computed the wrong result");
+
+    Sum = 0;
+    Nested.startTimer();
+    Pool.async(runRange, std::ref(Pool), 0u, unsigned(NumTasks));
+    Pool.wait();
+    Nested.stopTimer();
+    if (Sum != Expected)
+      report_fatal_error("Nested task groups computed the wrong result");
+  }
+  return 0;
+}